@@ -0,0 +1,673 @@
+/*******************************************************************************
+    arith.c -- Arithmetic Kernels of binary128
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <stdint.h>
+#include <quadmath.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+/*
+ * binary128を符号，指数，暗黙の1を含む113ビットの仮数に分け，64ビット整数の演算で
+ * 加算・乗算・積和を計算する．丸めは最近接偶数である (Rubyからは丸めモードを変えられない)．
+ * 正規化数の入力と正規化数の結果に限って計算し，0，非正規化数，無限大，NaNが現れる場合と
+ * 結果がオーバーフロー・アンダーフローする場合はコンパイラの演算子かfmaq()に任せる．
+ * どちらも正しく丸めた値を返すので，結果はビット単位で同じである．
+ */
+typedef unsigned __int128 u128;
+
+union f128_bits {
+	__float128 f;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	struct { uint64_t hi, lo; } w;
+#else
+	struct { uint64_t lo, hi; } w;
+#endif
+};
+
+#define F128_BIAS_LSB 16495  /* 仮数の最下位ビットの指数 = バイアス付き指数 - F128_BIAS_LSB */
+#define F128_EXP_INF  0x7fff
+#define U128_ONE      ((u128)1)
+
+/* 正規化数ならばtrueを返す */
+static inline bool
+f128_unpack(__float128 x, int *sign, int *e, u128 *m)
+{
+	union f128_bits u = { .f = x };
+
+	*sign = (int)(u.w.hi >> 63);
+	*e = (int)(u.w.hi >> 48) & 0x7fff;
+	*m = (u128)((u.w.hi & 0xffffffffffffULL) | 1ULL << 48) << 64 | u.w.lo;
+	return *e != 0 && *e != F128_EXP_INF;
+}
+
+/* mは[2^112, 2^113)，eは[1, 0x7ffe] */
+static inline __float128
+f128_pack(int sign, int e, u128 m)
+{
+	union f128_bits u;
+
+	u.w.lo = (uint64_t)m;
+	u.w.hi = (uint64_t)sign << 63 | (uint64_t)e << 48 | ((uint64_t)(m >> 64) & 0xffffffffffffULL);
+	return u.f;
+}
+
+static inline int
+clz_u128(u128 x)
+{
+	const uint64_t h = (uint64_t)(x >> 64);
+	return h ? __builtin_clzll(h) : 64 + __builtin_clzll((uint64_t)x);
+}
+
+/*
+ * 256ビットの整数 (hi, lo)．
+ * 右シフトで落ちるビットが非零ならば最下位ビットを立てる (jam)．
+ * 最下位ビットが立っていれば丸めの境界と一致しないので，正しく丸められる．
+ */
+struct u256 {
+	u128 hi, lo;
+};
+
+static inline struct u256
+u256_shl(struct u256 x, int k)
+{
+	if (k == 0)
+		return x;
+	if (k >= 128)
+		return (struct u256){ x.lo << (k - 128), 0 };
+	return (struct u256){ x.hi << k | x.lo >> (128 - k), x.lo << k };
+}
+
+static inline struct u256
+u256_shr_jam(struct u256 x, int k)
+{
+	u128 lost;
+
+	if (k == 0)
+		return x;
+	if (k >= 256)
+		return (struct u256){ 0, (x.hi | x.lo) != 0 };
+	if (k >= 128)
+	{
+		lost = x.lo | (k > 128 ? x.hi << (256 - k) : 0);
+		return (struct u256){ 0, (x.hi >> (k - 128)) | (lost != 0) };
+	}
+	lost = x.lo << (128 - k);
+	return (struct u256){ x.hi >> k, (x.lo >> k | x.hi << (128 - k)) | (lost != 0) };
+}
+
+static inline int
+u256_cmp(struct u256 x, struct u256 y)
+{
+	if (x.hi != y.hi)
+		return x.hi < y.hi ? -1 : 1;
+	if (x.lo != y.lo)
+		return x.lo < y.lo ? -1 : 1;
+	return 0;
+}
+
+static inline struct u256
+u256_add(struct u256 x, struct u256 y)
+{
+	const u128 lo = x.lo + y.lo;
+	return (struct u256){ x.hi + y.hi + (lo < x.lo), lo };
+}
+
+static inline struct u256
+u256_sub(struct u256 x, struct u256 y)
+{
+	return (struct u256){ x.hi - y.hi - (x.lo < y.lo), x.lo - y.lo };
+}
+
+/* 113ビットどうしの積．結果は225ビットか226ビット */
+static inline struct u256
+mul_113(u128 a, u128 b)
+{
+	const uint64_t ah = (uint64_t)(a >> 64), al = (uint64_t)a,
+	               bh = (uint64_t)(b >> 64), bl = (uint64_t)b;
+	const u128 ll = (u128)al * bl, mid = (u128)ah * bl + (u128)al * bh, hh = (u128)ah * bh;
+	const u128 lo = ll + ((u128)(uint64_t)mid << 64);
+
+	return (struct u256){ hh + (mid >> 64) + (lo < ll), lo };
+}
+
+/*
+ * 最上位ビットがtにある非零のrを113ビットに丸めて詰める．
+ * 値は r × 2^(lsb - F128_BIAS_LSB) である．結果が正規化数に収まらなければfalseを返す．
+ */
+static inline bool
+round_pack(int sign, struct u256 r, int t, long lsb, __float128 *z)
+{
+	long e = lsb + t - 112;
+	u128 m;
+
+	if (e < 1)
+		return false;
+	if (t <= 112)
+		m = u256_shl(r, 112 - t).lo;
+	else
+	{
+		const int s = t - 112;
+		const struct u256 q = u256_shl(r, 256 - s);  /* 落ちる部分を上詰めにする */
+		const u128 half = U128_ONE << 127;
+
+		m = s >= 128 ? r.hi >> (s - 128) : (r.lo >> s | r.hi << (128 - s));
+		if (q.hi > half || (q.hi == half && (q.lo != 0 || (m & 1))))
+		{
+			if (++m >> 113)
+			{
+				m >>= 1;
+				e++;
+			}
+		}
+	}
+	if (e >= F128_EXP_INF)
+		return false;
+	*z = f128_pack(sign, (int)e, m);
+	return true;
+}
+
+static inline int
+top_bit_u256(struct u256 r)
+{
+	return r.hi ? 255 - clz_u128(r.hi) : 127 - clz_u128(r.lo);
+}
+
+/*
+ * 絶対値が |a| ≥ |b| である二つの正確な数の和を丸める．
+ * 二つは同じ尺度で，和が256ビットに収まるように置くこと．
+ */
+static inline bool
+add_exact(int sa, struct u256 a, int sb, struct u256 b, long lsb, __float128 *z)
+{
+	struct u256 r = sa == sb ? u256_add(a, b) : u256_sub(a, b);
+
+	if ((r.hi | r.lo) == 0)
+	{
+		*z = 0;
+		return true;
+	}
+	return round_pack(sa, r, top_bit_u256(r), lsb, z);
+}
+
+/*
+ * 加算は三つの保護ビットを付けた128ビットで計算する．
+ * 指数の差が2以上なら桁落ちは高々1ビットで，1以下ならbは保護ビットに収まり正確である．
+ */
+__float128
+add_q(__float128 x, __float128 y)
+{
+	int sx, sy, ex, ey, e;
+	u128 mx, my, a, b, s, m;
+	unsigned int rem;
+
+	if (!f128_unpack(x, &sx, &ex, &mx) || !f128_unpack(y, &sy, &ey, &my))
+		return x + y;
+	if (ex < ey || (ex == ey && mx < my))
+	{
+		int ts = sx, te = ex;
+		u128 tm = mx;
+		sx = sy; ex = ey; mx = my;
+		sy = ts; ey = te; my = tm;
+	}
+	a = mx << 3;
+	b = my << 3;
+	if (ex - ey >= 116)
+		b = 1;
+	else if (ex != ey)
+		b = b >> (ex - ey) | ((b & ((U128_ONE << (ex - ey)) - 1)) != 0);
+
+	e = ex;
+	if (sx == sy)
+	{
+		s = a + b;
+		if (s >> 116)
+		{
+			s = s >> 1 | (s & 1);
+			e++;
+		}
+	}
+	else
+	{
+		int lz;
+		s = a - b;
+		if (s == 0)
+			return 0;
+		lz = clz_u128(s) - 12;
+		s <<= lz;
+		e -= lz;
+	}
+	if (e < 1)
+		return x + y;
+
+	m = s >> 3;
+	rem = (unsigned int)s & 7;
+	if (rem > 4 || (rem == 4 && (m & 1)))
+	{
+		if (++m >> 113)
+		{
+			m >>= 1;
+			e++;
+		}
+	}
+	if (e >= F128_EXP_INF)
+		return x + y;
+	return f128_pack(sx, e, m);
+}
+
+__float128
+sub_q(__float128 x, __float128 y)
+{
+	/* -yはNaNの符号も反転させるので，NaNはコンパイラの演算子に任せる */
+	if (isnanq(x) || isnanq(y))
+		return x - y;
+	return add_q(x, -y);
+}
+
+/* 226ビットの積の上位113ビットを取り，下位のビットを上詰めにして丸めを決める */
+__float128
+mul_q(__float128 x, __float128 y)
+{
+	int sx, sy, ex, ey, e;
+	u128 mx, my, m, rest;
+	struct u256 p;
+	const u128 half = U128_ONE << 127;
+
+	if (!f128_unpack(x, &sx, &ex, &mx) || !f128_unpack(y, &sy, &ey, &my))
+		return x * y;
+	p = mul_113(mx, my);
+	if (p.hi >> 97)
+	{
+		m = p.hi << 15 | p.lo >> 113;
+		rest = p.lo << 15;
+		e = ex + ey - 16382;
+	}
+	else
+	{
+		m = p.hi << 16 | p.lo >> 112;
+		rest = p.lo << 16;
+		e = ex + ey - 16383;
+	}
+	if (e < 1)
+		return x * y;
+	if (rest > half || (rest == half && (m & 1)))
+	{
+		if (++m >> 113)
+		{
+			m >>= 1;
+			e++;
+		}
+	}
+	if (e >= F128_EXP_INF)
+		return x * y;
+	return f128_pack(sx ^ sy, e, m);
+}
+
+/*
+ * x y + zを一度だけ丸める．226ビットの積を正確に求め，zと大きいほうを最上位ビット252に置いて足す．
+ * 積が0になる場合は x y が正確なので x * y + z と同じである．
+ */
+__float128
+fma_q(__float128 x, __float128 y, __float128 z)
+{
+	int sx, sy, sz, ex, ey, ez, sp;
+	u128 mx, my, mz;
+	struct u256 p, c;
+	long tp, tz, lsb;
+	__float128 w;
+
+	if (!f128_unpack(x, &sx, &ex, &mx) || !f128_unpack(y, &sy, &ey, &my))
+	{
+		if (((x == 0 && finiteq(y)) || (y == 0 && finiteq(x))) && finiteq(z))
+			return x * y + z;
+		return fmaq(x, y, z);
+	}
+	if (!finiteq(z))
+		return fmaq(x, y, z);
+	if (!f128_unpack(z, &sz, &ez, &mz))
+	{
+		if (z == 0)
+			return mul_q(x, y);
+		return fmaq(x, y, z);
+	}
+
+	sp = sx ^ sy;
+	p = mul_113(mx, my);
+	/* 積の最上位ビットを225にそろえる．積の値は p × 2^(tp - 225 - F128_BIAS_LSB) */
+	tp = (long)ex + ey - F128_BIAS_LSB + 225;
+	if (!(p.hi >> 97))
+	{
+		p = u256_shl(p, 1);
+		tp--;
+	}
+	tz = (long)ez + 112;
+	c = (struct u256){ 0, mz };
+
+	if (tp > tz || (tp == tz && u256_cmp(p, u256_shl(c, 113)) >= 0))
+	{
+		const long k = 140 - (tp - tz);
+		lsb = tp - 252;
+		p = u256_shl(p, 27);
+		c = k >= 0 ? u256_shl(c, (int)k) : u256_shr_jam(c, k < -255 ? 256 : (int)-k);
+		if (!add_exact(sp, p, sz, c, lsb, &w))
+			return fmaq(x, y, z);
+	}
+	else
+	{
+		const long k = 27 - (tz - tp);
+		lsb = tz - 252;
+		c = u256_shl(c, 140);
+		p = k >= 0 ? u256_shl(p, (int)k) : u256_shr_jam(p, k < -255 ? 256 : (int)-k);
+		if (!add_exact(sz, c, sp, p, lsb, &w))
+			return fmaq(x, y, z);
+	}
+	return w;
+}
+
+enum ARITH_OPS {
+	ARITH_ADD,
+	ARITH_SUB,
+	ARITH_MUL,
+	ARITH_DIV,
+	ARITH_FMA
+};
+
+/*
+ * 要素ごとの演算．オペランドは詰めた要素の並びで，間隔が0ならばスカラーを繰り返す．
+ * 中断されたときは計算済みの位置をposに残す．
+ */
+struct arith_operand {
+	const void *ptr;
+	long stride;
+	union {
+		__float128 f128;
+		__complex128 c128;
+	} scalar;
+};
+
+struct arith_args {
+	enum ARITH_OPS op;
+	bool complex_p;
+	struct arith_operand opd[3];
+	void *out;
+	long n;
+	long pos;
+	int nthreads;
+};
+
+/* 並列に計算するときに一度に取り出す要素数 */
+#define ARITH_GRAIN 4096
+
+static void
+arith_range_f128(const struct arith_args *args, long i0, long i1)
+{
+	const __float128 *x = args->opd[0].ptr, *y = args->opd[1].ptr, *z = args->opd[2].ptr;
+	const long sx = args->opd[0].stride, sy = args->opd[1].stride, sz = args->opd[2].stride;
+	__float128 *w = args->out;
+
+	switch (args->op) {
+	case ARITH_ADD:
+		for (long i = i0; i < i1; i++)
+			w[i] = add_q(x[i * sx], y[i * sy]);
+		break;
+	case ARITH_SUB:
+		for (long i = i0; i < i1; i++)
+			w[i] = sub_q(x[i * sx], y[i * sy]);
+		break;
+	case ARITH_MUL:
+		for (long i = i0; i < i1; i++)
+			w[i] = mul_q(x[i * sx], y[i * sy]);
+		break;
+	case ARITH_DIV:
+		for (long i = i0; i < i1; i++)
+			w[i] = x[i * sx] / y[i * sy];
+		break;
+	case ARITH_FMA:
+		for (long i = i0; i < i1; i++)
+			w[i] = fma_q(x[i * sx], y[i * sy], z[i * sz]);
+		break;
+	}
+}
+
+/* 複素数はComplex128の演算子と同じくコンパイラの複素数演算を使う */
+static void
+arith_range_c128(const struct arith_args *args, long i0, long i1)
+{
+	const __complex128 *x = args->opd[0].ptr, *y = args->opd[1].ptr;
+	const long sx = args->opd[0].stride, sy = args->opd[1].stride;
+	__complex128 *w = args->out;
+
+	switch (args->op) {
+	case ARITH_ADD:
+		for (long i = i0; i < i1; i++)
+			w[i] = x[i * sx] + y[i * sy];
+		break;
+	case ARITH_SUB:
+		for (long i = i0; i < i1; i++)
+			w[i] = x[i * sx] - y[i * sy];
+		break;
+	case ARITH_MUL:
+		for (long i = i0; i < i1; i++)
+			w[i] = x[i * sx] * y[i * sy];
+		break;
+	case ARITH_DIV:
+		for (long i = i0; i < i1; i++)
+			w[i] = x[i * sx] / y[i * sy];
+		break;
+	case ARITH_FMA:
+		break;
+	}
+}
+
+static void
+arith_range(void *ptr, long i0, long i1)
+{
+	const struct arith_args *args = ptr;
+
+	if (args->complex_p)
+		arith_range_c128(args, i0, i1);
+	else
+		arith_range_f128(args, i0, i1);
+}
+
+static void *
+arith_nogvl(void *ptr)
+{
+	struct arith_args *args = ptr;
+
+	if (!quadmath_parallel_for_at(&args->pos, args->n, ARITH_GRAIN, args->nthreads, arith_range, args))
+		return QUADMATH_INTERRUPTED;
+	return NULL;
+}
+
+static inline bool
+arith_scalar_p(VALUE v)
+{
+	return !RB_TYPE_P(v, T_ARRAY) && !qvector_p(v);
+}
+
+/*
+ * オペランドのうちベクトルとArrayを要素ごとに，数はすべての要素に対して計算する．
+ * どれかが複素数ならば複素数のベクトルを返す．ベクトルどうしの長さは等しいこと．
+ */
+static VALUE
+arith_apply(enum ARITH_OPS op, int argc, VALUE *argv)
+{
+	struct arith_args args;
+	VALUE out;
+	long len = -1;
+
+	/* 遅延評価の式との演算は式を組み立てる */
+	if (argc == 2 && rb_obj_is_kind_of(argv[1], rb_cQuadVectorLazy))
+	{
+		static const char ope[] = { '+', '-', '*', '/' };
+		return rb_funcall(rb_qvector_lazy(rb_qvector_from(argv[0])), ope[op], 1, argv[1]);
+	}
+
+	args.op = op;
+	args.complex_p = false;
+	for (int k = 0; k < argc; k++)
+	{
+		if (arith_scalar_p(argv[k]))
+		{
+			switch (convertion_num_types(argv[k])) {
+			case NUM_COMPLEX:
+			case NUM_COMPLEX128:
+				args.complex_p = true;
+				break;
+			default:
+				break;
+			}
+			continue;
+		}
+		argv[k] = rb_qvector_from(argv[k]);
+		if (len >= 0 && GetQVector(argv[k])->len != len)
+			rb_raise(rb_eArgError,
+			  "length mismatch (%ld for %ld)", GetQVector(argv[k])->len, len);
+		len = GetQVector(argv[k])->len;
+		if (GetQVector(argv[k])->type == VEC_COMPLEX128)
+			args.complex_p = true;
+	}
+	if (args.complex_p && op == ARITH_FMA)
+		rb_raise(rb_eTypeError, "not a real vector");
+
+	for (int k = 0; k < 3; k++)
+	{
+		struct arith_operand *opd = &args.opd[k];
+
+		opd->ptr = NULL;
+		opd->stride = 0;
+		if (k >= argc)
+			continue;
+		if (arith_scalar_p(argv[k]))
+		{
+			if (args.complex_p)
+			{
+				opd->scalar.c128 = num_to_cc128(argv[k]);
+				opd->ptr = &opd->scalar.c128;
+			}
+			else
+			{
+				opd->scalar.f128 = num_to_cf128(argv[k]);
+				opd->ptr = &opd->scalar.f128;
+			}
+			continue;
+		}
+		if (args.complex_p)
+			argv[k] = rb_qvector_to_complex(argv[k]);
+		opd->ptr = GetQVector(argv[k])->data.ptr;
+		opd->stride = 1;
+	}
+
+	out = rb_qvector_new(args.complex_p ? VEC_COMPLEX128 : VEC_FLOAT128, len);
+	args.out = GetQVector(out)->data.ptr;
+	args.n = len;
+	args.pos = 0;
+	args.nthreads = len >= NOGVL_THRESHOLD ? quadmath_threads() : 1;
+	quadmath_call_nogvl(arith_nogvl, &args, len);
+	for (int k = 0; k < argc; k++)
+		RB_GC_GUARD(argv[k]);
+
+	return out;
+}
+
+/*
+ *  call-seq:
+ *    vec + other -> QuadMath::Vector
+ *
+ *  Returns the elementwise sum.
+ *  +other+ is a vector or an Array of the same length, or a number added to every element.
+ *  Real elements are added by an integer kernel that gives bit for bit the same result as Float128#+,
+ *  and long vectors are shared among QuadMath.threads native threads without the GVL.
+ *
+ *    QuadMath::Vector[1, 2] + QuadMath::Vector[3, 4] # => QuadMath::Vector[4.0, 6.0]
+ *    QuadMath::Vector[1, 2] + 1/3r # => QuadMath::Vector[1.333333333333333333333333333333333, 2.333333333333333333333333333333333]
+ */
+static VALUE
+qvector_plus(VALUE self, VALUE other)
+{
+	VALUE opds[2] = { self, other };
+	return arith_apply(ARITH_ADD, 2, opds);
+}
+
+/*
+ *  call-seq:
+ *    vec - other -> QuadMath::Vector
+ *
+ *  Returns the elementwise difference.  See QuadMath::Vector#+.
+ *
+ *    QuadMath::Vector[1, 2] - 1 # => QuadMath::Vector[0.0, 1.0]
+ */
+static VALUE
+qvector_minus(VALUE self, VALUE other)
+{
+	VALUE opds[2] = { self, other };
+	return arith_apply(ARITH_SUB, 2, opds);
+}
+
+/*
+ *  call-seq:
+ *    vec * other -> QuadMath::Vector
+ *
+ *  Returns the elementwise product.  See QuadMath::Vector#+.
+ *
+ *    QuadMath::Vector[1, 2] * QuadMath::Vector[3, 4] # => QuadMath::Vector[3.0, 8.0]
+ *    QuadMath::Vector[1, 2] * Complex(0, 1) # => QuadMath::Vector[(0.0+1.0i), (0.0+2.0i)]
+ */
+static VALUE
+qvector_mul(VALUE self, VALUE other)
+{
+	VALUE opds[2] = { self, other };
+	return arith_apply(ARITH_MUL, 2, opds);
+}
+
+/*
+ *  call-seq:
+ *    vec / other -> QuadMath::Vector
+ *
+ *  Returns the elementwise quotient.  See QuadMath::Vector#+.
+ *
+ *    QuadMath::Vector[1, 2] / 4 # => QuadMath::Vector[0.25, 0.5]
+ */
+static VALUE
+qvector_div(VALUE self, VALUE other)
+{
+	VALUE opds[2] = { self, other };
+	return arith_apply(ARITH_DIV, 2, opds);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.fma(x, y, z) -> Float128 | QuadMath::Vector
+ *
+ *  Returns <code>x * y + z</code> rounded once.
+ *  For numbers this is the same as Float128.fma.  If any argument is a vector or an Array,
+ *  the operation is applied elementwise and the numbers are repeated for every element.
+ *  The arguments must be real.
+ *  The kernel forms the exact 226-bit product with 64-bit integers and is many times faster than fmaq(),
+ *  while the result is bit for bit the same.
+ *
+ *    QuadMath.fma(0.1, 10, -1) # => 5.551115123125782702118158340454102e-17
+ *    QuadMath.fma([1, 2], 3, [4, 5]) # => QuadMath::Vector[7.0, 11.0]
+ */
+static VALUE
+quadmath_fma(VALUE unused_obj, VALUE x, VALUE y, VALUE z)
+{
+	VALUE opds[3] = { x, y, z };
+
+	if (arith_scalar_p(x) && arith_scalar_p(y) && arith_scalar_p(z))
+		return rb_float128_cf128(fma_q(num_to_cf128(x), num_to_cf128(y), num_to_cf128(z)));
+	return arith_apply(ARITH_FMA, 3, opds);
+}
+
+void
+InitVM_Arith(void)
+{
+	rb_define_method(rb_cQuadVector, "+", qvector_plus, 1);
+	rb_define_method(rb_cQuadVector, "-", qvector_minus, 1);
+	rb_define_method(rb_cQuadVector, "*", qvector_mul, 1);
+	rb_define_method(rb_cQuadVector, "/", qvector_div, 1);
+	rb_define_module_function(rb_mQuadMath, "fma", quadmath_fma, 3);
+}
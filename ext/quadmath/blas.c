@@ -0,0 +1,535 @@
+/*******************************************************************************
+    blas.c -- module QuadMath::BLAS
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <quadmath.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+enum BLAS_OPS {
+	BLAS_AXPY,
+	BLAS_SCAL,
+	BLAS_DOT,
+	BLAS_DOTC,
+	BLAS_NRM2,
+	BLAS_ASUM,
+	BLAS_IAMAX
+};
+
+struct blas_args {
+	enum BLAS_OPS op;
+	enum VECTOR_ELEM_TYPES type;
+	long n;
+	void *x;
+	void *y;
+	__complex128 alpha;
+	__complex128 result;
+	long index;
+	int nthreads;
+	long pos;       /* 計算済みの要素数．中断したところから再開する */
+	void *partial;  /* 総和や最大値のREDUCE_BLOCK個ごとの部分結果 */
+};
+
+/* 並列に計算するときに一度に取り出す要素数．ブロックの境目に合わせる */
+#define BLAS_GRAIN (4 * REDUCE_BLOCK)
+
+/*
+ * 実数カーネル．四つの独立な累積値に展開してfma_q()の依存連鎖を切る．
+ */
+static void
+axpy_f128(long n, __float128 a, const __float128 *x, __float128 *y)
+{
+	long i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		y[i]     = fma_q(a, x[i],     y[i]);
+		y[i + 1] = fma_q(a, x[i + 1], y[i + 1]);
+		y[i + 2] = fma_q(a, x[i + 2], y[i + 2]);
+		y[i + 3] = fma_q(a, x[i + 3], y[i + 3]);
+	}
+	for (; i < n; i++)
+		y[i] = fma_q(a, x[i], y[i]);
+}
+
+static void
+scal_f128(long n, __float128 a, __float128 *x)
+{
+	long i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		x[i]     *= a;
+		x[i + 1] *= a;
+		x[i + 2] *= a;
+		x[i + 3] *= a;
+	}
+	for (; i < n; i++)
+		x[i] *= a;
+}
+
+static __float128
+dot_f128(long n, const __float128 *x, const __float128 *y)
+{
+	__float128 s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	long i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		s0 = fma_q(x[i],     y[i],     s0);
+		s1 = fma_q(x[i + 1], y[i + 1], s1);
+		s2 = fma_q(x[i + 2], y[i + 2], s2);
+		s3 = fma_q(x[i + 3], y[i + 3], s3);
+	}
+	for (; i < n; i++)
+		s0 = fma_q(x[i], y[i], s0);
+	return (s0 + s1) + (s2 + s3);
+}
+
+static __float128
+asum_f128(long n, const __float128 *x)
+{
+	__float128 s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	long i = 0;
+	for (; i + 4 <= n; i += 4)
+	{
+		s0 += fabsq(x[i]);
+		s1 += fabsq(x[i + 1]);
+		s2 += fabsq(x[i + 2]);
+		s3 += fabsq(x[i + 3]);
+	}
+	for (; i < n; i++)
+		s0 += fabsq(x[i]);
+	return (s0 + s1) + (s2 + s3);
+}
+
+/* strideは実数なら1，複素数なら2．複素数の|re|+|im|も同じ走査で求まる */
+static long
+iamax_f128(long n, const __float128 *x, int stride)
+{
+	__float128 amax = -1;
+	long index = -1;
+	for (long i = 0; i < n; i++)
+	{
+		__float128 a = fabsq(x[i * stride]);
+		if (stride == 2)  a += fabsq(x[i * stride + 1]);
+		if (isnanq(a))
+			return i;
+		if (a > amax)
+		{
+			amax = a;
+			index = i;
+		}
+	}
+	return index;
+}
+
+/*
+ * 複素数カーネル．実部・虚部をfma_q()で個別に累積する．
+ */
+static inline void
+cfma(__float128 *re, __float128 *im, __complex128 a, __complex128 b)
+{
+	__float128 ar = crealq(a), ai = cimagq(a), br = crealq(b), bi = cimagq(b);
+	*re = fma_q(ar, br, fma_q(-ai, bi, *re));
+	*im = fma_q(ar, bi, fma_q(ai, br, *im));
+}
+
+static void
+axpy_c128(long n, __complex128 a, const __complex128 *x, __complex128 *y)
+{
+	for (long i = 0; i < n; i++)
+	{
+		__float128 re = crealq(y[i]), im = cimagq(y[i]);
+		cfma(&re, &im, a, x[i]);
+		__real__ y[i] = re;
+		__imag__ y[i] = im;
+	}
+}
+
+static void
+scal_c128(long n, __complex128 a, __complex128 *x)
+{
+	for (long i = 0; i < n; i++)
+		x[i] *= a;
+}
+
+static __complex128
+dot_c128(long n, const __complex128 *x, const __complex128 *y, bool conj_p)
+{
+	__float128 re0 = 0, im0 = 0, re1 = 0, im1 = 0;
+	__complex128 z;
+	long i = 0;
+	for (; i + 2 <= n; i += 2)
+	{
+		cfma(&re0, &im0, conj_p ? conjq(x[i])     : x[i],     y[i]);
+		cfma(&re1, &im1, conj_p ? conjq(x[i + 1]) : x[i + 1], y[i + 1]);
+	}
+	for (; i < n; i++)
+		cfma(&re0, &im0, conj_p ? conjq(x[i]) : x[i], y[i]);
+	__real__ z = re0 + re1;
+	__imag__ z = im0 + im1;
+	return z;
+}
+
+/*
+ * 要素[i0, i1)を計算する．axpyとscalはその場で書き換え，
+ * 総和と最大値はブロックごとの部分結果をpartialに置いてblas_run()でまとめる．
+ */
+static void
+blas_range(void *ptr, long i0, long i1)
+{
+	struct blas_args *args = ptr;
+	const bool real_p = args->type == VEC_FLOAT128;
+	const int w = real_p ? 1 : 2;    /* 一要素あたりの__float128の数 */
+	const __float128 *fx = args->x;
+
+	switch (args->op) {
+	case BLAS_AXPY:
+		if (real_p)
+			axpy_f128(i1 - i0, crealq(args->alpha), (__float128 *)args->x + i0, (__float128 *)args->y + i0);
+		else
+			axpy_c128(i1 - i0, args->alpha, (__complex128 *)args->x + i0, (__complex128 *)args->y + i0);
+		return;
+	case BLAS_SCAL:
+		if (real_p)
+			scal_f128(i1 - i0, crealq(args->alpha), (__float128 *)args->x + i0);
+		else
+			scal_c128(i1 - i0, args->alpha, (__complex128 *)args->x + i0);
+		return;
+	default:
+		break;
+	}
+
+	for (long b = i0 / REDUCE_BLOCK; b * REDUCE_BLOCK < i1; b++)
+	{
+		const long j0 = b * REDUCE_BLOCK, len = (j0 + REDUCE_BLOCK < i1 ? j0 + REDUCE_BLOCK : i1) - j0;
+		__float128 *partial = args->partial;
+		long k;
+
+		switch (args->op) {
+		case BLAS_DOT:
+		case BLAS_DOTC:
+			if (real_p)
+				partial[b] = dot_f128(len, fx + j0, (__float128 *)args->y + j0);
+			else
+				((__complex128 *)args->partial)[b] = dot_c128(len,
+					(__complex128 *)args->x + j0, (__complex128 *)args->y + j0, args->op == BLAS_DOTC);
+			break;
+		case BLAS_NRM2:
+			partial[b] = dot_f128(w * len, fx + w * j0, fx + w * j0);
+			break;
+		case BLAS_ASUM:
+			partial[b] = asum_f128(w * len, fx + w * j0);
+			break;
+		case BLAS_IAMAX:
+			k = iamax_f128(len, fx + w * j0, w);
+			((long *)args->partial)[b] = k < 0 ? -1 : j0 + k;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void *
+blas_kernel(void *ptr)
+{
+	struct blas_args *args = ptr;
+
+	if (!quadmath_parallel_for_at(&args->pos, args->n, BLAS_GRAIN, args->nthreads, blas_range, args))
+		return QUADMATH_INTERRUPTED;
+	return NULL;
+}
+
+/* ブロックごとの最大値から，最初に現れた最大の要素(NaNがあれば最初のNaN)を選ぶ */
+static long
+iamax_merge(const struct blas_args *args, const long *index, long nblocks)
+{
+	const int w = args->type == VEC_FLOAT128 ? 1 : 2;
+	const __float128 *x = args->x;
+	__float128 amax = -1;
+	long ans = -1;
+
+	for (long b = 0; b < nblocks; b++)
+	{
+		__float128 a = fabsq(x[index[b] * w]);
+		if (w == 2)  a += fabsq(x[index[b] * w + 1]);
+		if (isnanq(a))
+			return index[b];
+		if (a > amax)
+		{
+			amax = a;
+			ans = index[b];
+		}
+	}
+	return ans;
+}
+
+/*
+ * QuadMath.threads本のスレッドで計算する．部分和は固定した形の二分木でまとめるので，
+ * 結果はスレッド数によらない．
+ */
+static void
+blas_run(struct blas_args *args)
+{
+	const long nblocks = (args->n + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+	const int w = args->type == VEC_FLOAT128 ? 1 : 2;
+	VALUE tmp;
+
+	args->partial = rb_alloc_tmp_buffer2(&tmp, nblocks > 0 ? nblocks : 1, sizeof(__complex128));
+	args->pos = 0;
+	args->nthreads = args->n >= NOGVL_THRESHOLD ? quadmath_threads() : 1;
+	quadmath_call_nogvl(blas_kernel, args, args->n);
+
+	switch (args->op) {
+	case BLAS_DOT:
+	case BLAS_DOTC:
+		if (w == 1)
+			args->result = pairwise_sum_q(args->partial, nblocks, 1);
+		else
+		{
+			__real__ args->result = pairwise_sum_q(args->partial, nblocks, 2);
+			__imag__ args->result = pairwise_sum_q((__float128 *)args->partial + 1, nblocks, 2);
+		}
+		break;
+	case BLAS_NRM2:
+		{
+			__float128 ssq = pairwise_sum_q(args->partial, nblocks, 1);
+			if (finiteq(ssq) && ssq >= FLT128_MIN)
+				args->result = sqrtq(ssq);
+			else
+				args->result = l2norm_q(args->x, w * args->n);
+		}
+		break;
+	case BLAS_ASUM:
+		args->result = pairwise_sum_q(args->partial, nblocks, 1);
+		break;
+	case BLAS_IAMAX:
+		args->index = iamax_merge(args, args->partial, nblocks);
+		break;
+	default:
+		break;
+	}
+	ALLOCV_END(tmp);
+}
+
+static struct QVector *
+blas_vector(VALUE obj)
+{
+	if (!qvector_p(obj))
+		rb_raise(rb_eTypeError,
+		  "wrong argument type %"PRIsVALUE" (expected %"PRIsVALUE")",
+		  rb_obj_class(obj), rb_cQuadVector);
+	return GetQVector(obj);
+}
+
+static void
+blas_setup_pair(struct blas_args *args, VALUE x, VALUE y)
+{
+	struct QVector *vx = blas_vector(x), *vy = blas_vector(y);
+
+	if (vx->type != vy->type)
+		rb_raise(rb_eTypeError, "element types of vectors differ");
+	if (vx->len != vy->len)
+		rb_raise(rb_eArgError,
+		  "length mismatch (%ld for %ld)", vy->len, vx->len);
+
+	args->type = vx->type;
+	args->n = vx->len;
+	args->x = vx->data.ptr;
+	args->y = vy->data.ptr;
+}
+
+static void
+blas_setup_single(struct blas_args *args, VALUE x)
+{
+	struct QVector *vx = blas_vector(x);
+
+	args->type = vx->type;
+	args->n = vx->len;
+	args->x = vx->data.ptr;
+	args->y = NULL;
+}
+
+static __complex128
+blas_alpha(VALUE alpha, enum VECTOR_ELEM_TYPES type)
+{
+	if (type == VEC_FLOAT128)
+		return num_to_cf128(alpha);
+	else
+		return num_to_cc128(alpha);
+}
+
+static VALUE
+blas_scalar_result(const struct blas_args *args)
+{
+	if (args->type == VEC_COMPLEX128 &&
+	    (args->op == BLAS_DOT || args->op == BLAS_DOTC))
+		return rb_complex128_cc128(args->result);
+	else
+		return rb_float128_cf128(crealq(args->result));
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::BLAS.axpy(alpha, x, y) -> y
+ *
+ *  Overwrites the vector +y+ with <code>alpha * x + y</code> and returns +y+.
+ *  +x+ and +y+ are vectors of the same size and element type.
+ *  Real vectors are updated by a fused multiply-add, so each element is rounded once.
+ *
+ *    y = QuadMath::Vector[1, 1]
+ *    QuadMath::BLAS.axpy(2, QuadMath::Vector[3, 4], y) # => QuadMath::Vector[7.0, 9.0]
+ */
+static VALUE
+blas_s_axpy(VALUE unused_obj, VALUE alpha, VALUE x, VALUE y)
+{
+	struct blas_args args = { .op = BLAS_AXPY };
+
+	rb_check_frozen(y);
+	blas_setup_pair(&args, x, y);
+	args.alpha = blas_alpha(alpha, args.type);
+	blas_run(&args);
+	RB_GC_GUARD(x);
+
+	return y;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::BLAS.scal(alpha, x) -> x
+ *
+ *  Overwrites the vector +x+ with <code>alpha * x</code> and returns +x+.
+ *
+ *    QuadMath::BLAS.scal(1i, QuadMath::Vector[1, 1i]) # => QuadMath::Vector[(0.0+1.0i), (-1.0+0.0i)]
+ */
+static VALUE
+blas_s_scal(VALUE unused_obj, VALUE alpha, VALUE x)
+{
+	struct blas_args args = { .op = BLAS_SCAL };
+
+	rb_check_frozen(x);
+	blas_setup_single(&args, x);
+	args.alpha = blas_alpha(alpha, args.type);
+	blas_run(&args);
+
+	return x;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::BLAS.dot(x, y) -> Float128 | Complex128
+ *
+ *  Returns the unconjugated dot product of the vectors +x+ and +y+.
+ *
+ *    QuadMath::BLAS.dot(QuadMath::Vector[1, 2], QuadMath::Vector[3, 4]) # => 11.0
+ *    QuadMath::BLAS.dot(QuadMath::Vector[1i], QuadMath::Vector[1i]) # => (-1.0+0.0i)
+ */
+static VALUE
+blas_s_dot(VALUE unused_obj, VALUE x, VALUE y)
+{
+	struct blas_args args = { .op = BLAS_DOT };
+
+	blas_setup_pair(&args, x, y);
+	blas_run(&args);
+	RB_GC_GUARD(x);
+	RB_GC_GUARD(y);
+
+	return blas_scalar_result(&args);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::BLAS.dotc(x, y) -> Float128 | Complex128
+ *
+ *  Returns the dot product of the conjugate of +x+ and +y+. For real vectors this is the same as ::dot.
+ *
+ *    QuadMath::BLAS.dotc(QuadMath::Vector[1i], QuadMath::Vector[1i]) # => (1.0+0.0i)
+ */
+static VALUE
+blas_s_dotc(VALUE unused_obj, VALUE x, VALUE y)
+{
+	struct blas_args args = { .op = BLAS_DOTC };
+
+	blas_setup_pair(&args, x, y);
+	blas_run(&args);
+	RB_GC_GUARD(x);
+	RB_GC_GUARD(y);
+
+	return blas_scalar_result(&args);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::BLAS.nrm2(x) -> Float128
+ *
+ *  Returns the Euclidean norm of the vector +x+ without overflow or underflow on the way.
+ *
+ *    QuadMath::BLAS.nrm2(QuadMath::Vector[3, 4i]) # => 5.0
+ */
+static VALUE
+blas_s_nrm2(VALUE unused_obj, VALUE x)
+{
+	struct blas_args args = { .op = BLAS_NRM2 };
+
+	blas_setup_single(&args, x);
+	blas_run(&args);
+	RB_GC_GUARD(x);
+
+	return blas_scalar_result(&args);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::BLAS.asum(x) -> Float128
+ *
+ *  Returns the sum of absolute values of the vector +x+.
+ *  As in the reference BLAS, a complex element counts as <code>|re| + |im|</code>.
+ *
+ *    QuadMath::BLAS.asum(QuadMath::Vector[-1, 2]) # => 3.0
+ *    QuadMath::BLAS.asum(QuadMath::Vector[3+4i]) # => 7.0
+ */
+static VALUE
+blas_s_asum(VALUE unused_obj, VALUE x)
+{
+	struct blas_args args = { .op = BLAS_ASUM };
+
+	blas_setup_single(&args, x);
+	blas_run(&args);
+	RB_GC_GUARD(x);
+
+	return blas_scalar_result(&args);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::BLAS.iamax(x) -> Integer | nil
+ *
+ *  Returns the first index of the element of +x+ with the largest absolute value (<code>|re| + |im|</code> for complex).
+ *  Unlike the reference BLAS the index is 0-origin. If +x+ is empty, returns nil.
+ *
+ *    QuadMath::BLAS.iamax(QuadMath::Vector[1, -5, 5]) # => 1
+ */
+static VALUE
+blas_s_iamax(VALUE unused_obj, VALUE x)
+{
+	struct blas_args args = { .op = BLAS_IAMAX };
+
+	blas_setup_single(&args, x);
+	blas_run(&args);
+	RB_GC_GUARD(x);
+
+	return args.index < 0 ? Qnil : LONG2NUM(args.index);
+}
+
+void
+InitVM_BLAS(void)
+{
+	rb_define_module_function(rb_mQuadBLAS, "axpy", blas_s_axpy, 3);
+	rb_define_module_function(rb_mQuadBLAS, "scal", blas_s_scal, 2);
+	rb_define_module_function(rb_mQuadBLAS, "dot", blas_s_dot, 2);
+	rb_define_module_function(rb_mQuadBLAS, "dotc", blas_s_dotc, 2);
+	rb_define_module_function(rb_mQuadBLAS, "nrm2", blas_s_nrm2, 1);
+	rb_define_module_function(rb_mQuadBLAS, "asum", blas_s_asum, 1);
+	rb_define_module_function(rb_mQuadBLAS, "iamax", blas_s_iamax, 1);
+}
@@ -0,0 +1,427 @@
+/*******************************************************************************
+    chebyshev.c -- QuadMath::Chebyshev Class
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <quadmath.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+/* fitで次数を省いたときの既定値 */
+#define CHEB_DEFAULT_DEGREE 64
+
+/* 並列に評価するときの一区間の点数 */
+#define CHEB_GRAIN 256
+
+/*
+ * 区間[lo, hi]上のChebyshev級数 p(x) = Σ c[j] T_j(t)，t = (2x - lo - hi) / (hi - lo)．
+ * c[0]は半分にした値を持つので，和に係数1/2の例外はない．
+ * 作った後は書き換えないので，GVLを解放して評価してよい．
+ */
+struct QChebyshev {
+	long n;
+	__float128 lo;
+	__float128 hi;
+	__float128 max_error;
+	__float128 *c;
+};
+
+static void
+free_qchebyshev(void *v)
+{
+	struct QChebyshev *ch = v;
+	if (ch != NULL)
+	{
+		xfree(ch->c);
+		xfree(ch);
+	}
+}
+
+static size_t
+memsize_qchebyshev(const void *v)
+{
+	const struct QChebyshev *ch = v;
+	return sizeof(struct QChebyshev) + sizeof(__float128) * ch->n;
+}
+
+static const rb_data_type_t qchebyshev_data_type = {
+	"quadmath_chebyshev",
+	{0, free_qchebyshev, memsize_qchebyshev,},
+	0, 0,
+	RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static VALUE
+qchebyshev_allocate(VALUE klass)
+{
+	struct QChebyshev *ch;
+	VALUE obj = TypedData_Make_Struct(klass, struct QChebyshev, &qchebyshev_data_type, ch);
+	ch->n = 0;
+	ch->lo = ch->hi = ch->max_error = 0;
+	ch->c = NULL;
+	return obj;
+}
+
+static struct QChebyshev *
+GetQChebyshev(VALUE self)
+{
+	struct QChebyshev *ch;
+
+	TypedData_Get_Struct(self, struct QChebyshev, &qchebyshev_data_type, ch);
+
+	if (ch->c == NULL)
+		rb_raise(rb_eRuntimeError, "uninitialized Chebyshev series");
+
+	return ch;
+}
+
+/* Clenshawの漸化式 b_j = c[j] + 2t b_{j+1} - b_{j+2} */
+static inline __float128
+clenshaw(const struct QChebyshev *ch, __float128 x)
+{
+	const __float128 t = (2 * x - ch->lo - ch->hi) / (ch->hi - ch->lo), t2 = 2 * t;
+	__float128 b1 = 0, b2 = 0;
+
+	for (long j = ch->n - 1; j >= 1; j--)
+	{
+		__float128 b0 = t2 * b1 - b2 + ch->c[j];
+		b2 = b1;
+		b1 = b0;
+	}
+	return t * b1 - b2 + ch->c[0];
+}
+
+static inline bool
+qchebyshev_in_domain_p(const struct QChebyshev *ch, __float128 x)
+{
+	return ch->lo <= x && x <= ch->hi;
+}
+
+struct cheb_sample {
+	ID func;
+	VALUE block;
+};
+
+static __float128
+cheb_sample_at(const struct cheb_sample *smp, __float128 x)
+{
+	VALUE y;
+
+	if (smp->func)
+		y = rb_funcall(rb_mQuadMath, smp->func, 1, rb_float128_cf128(x));
+	else
+		y = rb_proc_call_with_block(smp->block, 1, (VALUE[]){rb_float128_cf128(x)}, Qnil);
+
+	switch (convertion_num_types(y)) {
+	case NUM_COMPLEX:
+	case NUM_COMPLEX128:
+		rb_raise(rb_eTypeError, "not a real value at %"PRIsVALUE": %"PRIsVALUE,
+		  rb_float128_cf128(x), y);
+	default:
+		return num_to_cf128(y);
+	}
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::Chebyshev.fit(func, range, degree: 64) -> QuadMath::Chebyshev
+ *    QuadMath::Chebyshev.fit(range, degree: 64) { |x| ... } -> QuadMath::Chebyshev
+ *
+ *  Interpolates a real function on the closed interval +range+ at the <code>degree + 1</code> Chebyshev points
+ *  and returns the Chebyshev series of degree +degree+.
+ *  Trailing coefficients that add up to less than the rounding error of the largest one are dropped, so #degree may be lower.
+ *  The function is the QuadMath module function named by the symbol +func+, or the block, which is called with a Float128.
+ *  The function is sampled again at <code>2 * degree + 4</code> other points, including the ends of the interval,
+ *  and the largest difference is kept as #max_error.
+ *
+ *    cheb = QuadMath::Chebyshev.fit(:exp, 0..1, degree: 30)
+ *    cheb.max_error < 1e-32 # => true
+ */
+static VALUE
+qchebyshev_s_fit(int argc, VALUE *argv, VALUE klass)
+{
+	static ID kwds[1];
+	VALUE func, range, opts, block, degree = Qundef, beg, end, obj, tmp;
+	struct cheb_sample smp;
+	struct QChebyshev *ch;
+	long n, m;
+	int excl;
+	__float128 *f, *cosv, mid, half, err = 0;
+
+	if (!kwds[0])  kwds[0] = rb_intern_const("degree");
+
+	rb_scan_args(argc, argv, "11:&", &func, &range, &opts, &block);
+	if (!NIL_P(opts))
+		rb_get_kwargs(opts, kwds, 0, 1, &degree);
+
+	if (argc == 1 || NIL_P(range))
+	{
+		range = func;
+		if (NIL_P(block))
+			rb_raise(rb_eArgError, "no function given");
+		smp.func = 0;
+		smp.block = block;
+	}
+	else
+	{
+		smp.func = rb_sym2id(func);
+		smp.block = Qnil;
+		if (!rb_respond_to(rb_mQuadMath, smp.func))
+			rb_raise(rb_eArgError, "undefined function QuadMath.%"PRIsVALUE, rb_sym2str(func));
+	}
+
+	if (!rb_range_values(range, &beg, &end, &excl))
+		rb_raise(rb_eTypeError, "not a range: %"PRIsVALUE, range);
+	if (excl)
+		rb_raise(rb_eArgError, "interval must include its end");
+	n = degree == Qundef || NIL_P(degree) ? CHEB_DEFAULT_DEGREE + 1 : NUM2LONG(degree) + 1;
+	if (n < 1)
+		rb_raise(rb_eArgError, "negative degree");
+	if (n > LONG_MAX / 8 / (long)sizeof(__float128))
+		rb_raise(rb_eArgError, "degree too big");
+
+	obj = qchebyshev_allocate(klass);
+	TypedData_Get_Struct(obj, struct QChebyshev, &qchebyshev_data_type, ch);
+	ch->lo = num_to_cf128(beg);
+	ch->hi = num_to_cf128(end);
+	if (!(ch->lo < ch->hi) || isinfq(ch->lo) || isinfq(ch->hi))
+		rb_raise(rb_eArgError, "bad interval");
+	mid = (ch->lo + ch->hi) / 2;
+	half = (ch->hi - ch->lo) / 2;
+
+	/*
+	 * 補間点は x_k = mid + half cos θ_k，θ_k = π(2k + 1) / 2n．
+	 * cos(jθ_k) は表cosv[i] = cos(πi / 2n)のi = j(2k + 1) mod 4nで引く．
+	 * 誤差の見積もりには補間点の間の θ = π(2k + 1) / 4n と両端を使う．
+	 */
+	m = 4 * n;
+	f = ALLOCV_N(__float128, tmp, n + m);
+	cosv = f + n;
+	for (long i = 0; i < m; i++)
+		cosv[i] = cosq(M_PIq * i / (2 * n));
+	for (long k = 0; k < n; k++)
+		f[k] = cheb_sample_at(&smp, mid + half * cosq(M_PIq * (2 * k + 1) / (2 * n)));
+
+	ch->c = ALLOC_N(__float128, n);
+	ch->n = n;
+	for (long j = 0; j < n; j++)
+	{
+		__float128 s = 0;
+		for (long k = 0; k < n; k++)
+			s += f[k] * cosv[(j * (2 * k + 1)) % m];
+		ch->c[j] = s * 2 / n;
+	}
+	ch->c[0] /= 2;
+
+	/* 末尾の係数は，和がn項の和で生じる最大の係数の丸め誤差に埋もれる分だけ落とす */
+	{
+		__float128 cmax = 0, tail = 0;
+		for (long j = 0; j < n; j++)
+			if (cmax < fabsq(ch->c[j]))
+				cmax = fabsq(ch->c[j]);
+		while (ch->n > 1 && (tail += fabsq(ch->c[ch->n - 1])) <= FLT128_EPSILON / 2 * n * cmax)
+			ch->n--;
+	}
+
+	for (long k = 0; k < 2 * n + 2; k++)
+	{
+		__float128 x, d;
+		if (k < 2 * n)
+			x = mid + half * cosq(M_PIq * (2 * k + 1) / (4 * n));
+		else
+			x = k == 2 * n ? ch->lo : ch->hi;
+		d = fabsq(cheb_sample_at(&smp, x) - clenshaw(ch, x));
+		if (d > err || isnanq(d))
+			err = d;
+	}
+	ch->max_error = err;
+	ALLOCV_END(tmp);
+
+	return obj;
+}
+
+struct cheb_eval_args {
+	const struct QChebyshev *ch;
+	const __float128 *x;
+	__float128 *y;
+	long len;
+	long bad;
+	int nthreads;
+	long done;
+};
+
+static void
+cheb_eval_range(void *ptr, long i0, long i1)
+{
+	const struct cheb_eval_args *args = ptr;
+
+	for (long i = i0; i < i1; i++)
+		args->y[i] = clenshaw(args->ch, args->x[i]);
+}
+
+static void *
+cheb_eval_nogvl(void *ptr)
+{
+	struct cheb_eval_args *args = ptr;
+
+	for (long i = 0; i < args->len; i++)
+	{
+		if (!qchebyshev_in_domain_p(args->ch, args->x[i]))
+		{
+			args->bad = i;
+			return NULL;
+		}
+	}
+	if (!quadmath_parallel_for_at(&args->done, args->len, CHEB_GRAIN, args->nthreads, cheb_eval_range, args))
+		return QUADMATH_INTERRUPTED;
+	return NULL;
+}
+
+static void
+qchebyshev_raise_domain(VALUE self, __float128 x)
+{
+	rb_raise(rb_eMathDomainError, "%"PRIsVALUE" is out of the domain of %"PRIsVALUE,
+	  rb_float128_cf128(x), self);
+}
+
+/*
+ *  call-seq:
+ *    call(x, threads: QuadMath.threads) -> Float128 | QuadMath::Vector
+ *    self[x] -> Float128 | QuadMath::Vector
+ *
+ *  Evaluates the series at +x+ by Clenshaw's recurrence.
+ *  +x+ is a real number, or a real vector or Array, which gives a vector of the values at each element.
+ *  A long vector is split among +threads+ native threads with the GVL released.
+ *  Raises Math::DomainError if +x+ is outside the interval of the fit.
+ *
+ *    QuadMath::Chebyshev.fit(0..1, degree: 2) { |x| x * x }.call(0.5) # => 0.25
+ */
+static VALUE
+qchebyshev_call(int argc, VALUE *argv, VALUE self)
+{
+	const struct QChebyshev *ch = GetQChebyshev(self);
+	struct cheb_eval_args args;
+	VALUE x, opts, y;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+
+	if (!RB_TYPE_P(x, T_ARRAY) && !qvector_p(x))
+	{
+		__float128 t = num_to_cf128(x);
+		if (!qchebyshev_in_domain_p(ch, t))
+			qchebyshev_raise_domain(self, t);
+		return rb_float128_cf128(clenshaw(ch, t));
+	}
+
+	x = rb_qvector_from(x);
+	if (GetQVector(x)->type != VEC_FLOAT128)
+		rb_raise(rb_eTypeError, "not a real vector");
+	args.ch = ch;
+	args.x = GetQVector(x)->data.f128;
+	args.len = GetQVector(x)->len;
+	y = rb_qvector_new(VEC_FLOAT128, args.len);
+	args.y = GetQVector(y)->data.f128;
+	args.bad = -1;
+	args.done = 0;
+	args.nthreads = args.len * ch->n >= NOGVL_THRESHOLD ? quadmath_opt_threads(opts) : 1;
+	quadmath_call_nogvl(cheb_eval_nogvl, &args, args.len * ch->n);
+	if (args.bad >= 0)
+		qchebyshev_raise_domain(self, args.x[args.bad]);
+	RB_GC_GUARD(x);
+	RB_GC_GUARD(self);
+
+	return y;
+}
+
+/*
+ *  call-seq:
+ *    degree -> Integer
+ *
+ *  Returns the degree of the series.
+ */
+static VALUE
+qchebyshev_degree(VALUE self)
+{
+	return LONG2NUM(GetQChebyshev(self)->n - 1);
+}
+
+/*
+ *  call-seq:
+ *    domain -> Range
+ *
+ *  Returns the interval of the fit as a Range of Float128.
+ */
+static VALUE
+qchebyshev_domain(VALUE self)
+{
+	const struct QChebyshev *ch = GetQChebyshev(self);
+	return rb_range_new(rb_float128_cf128(ch->lo), rb_float128_cf128(ch->hi), false);
+}
+
+/*
+ *  call-seq:
+ *    coefficients -> QuadMath::Vector
+ *
+ *  Returns the coefficients <code>c[j]</code> of <code>Σ c[j] T_j(t)</code>, where +t+ is +x+ mapped onto [-1, 1].
+ */
+static VALUE
+qchebyshev_coefficients(VALUE self)
+{
+	const struct QChebyshev *ch = GetQChebyshev(self);
+	VALUE v = rb_qvector_new(VEC_FLOAT128, ch->n);
+
+	memcpy(GetQVector(v)->data.f128, ch->c, sizeof(__float128) * ch->n);
+
+	return v;
+}
+
+/*
+ *  call-seq:
+ *    max_error -> Float128
+ *
+ *  Returns the largest difference between the function and the series found at the check points of the fit.
+ */
+static VALUE
+qchebyshev_max_error(VALUE self)
+{
+	return rb_float128_cf128(GetQChebyshev(self)->max_error);
+}
+
+/*
+ *  call-seq:
+ *    inspect -> String
+ *
+ *  Returns the degree, the interval and the error of the series.
+ */
+static VALUE
+qchebyshev_inspect(VALUE self)
+{
+	const struct QChebyshev *ch = GetQChebyshev(self);
+	char lo[48], hi[48], err[48];
+
+	quadmath_snprintf(lo, sizeof(lo), "%.6Qg", ch->lo);
+	quadmath_snprintf(hi, sizeof(hi), "%.6Qg", ch->hi);
+	quadmath_snprintf(err, sizeof(err), "%.3Qe", ch->max_error);
+
+	return rb_sprintf("#<%"PRIsVALUE" degree=%ld domain=%s..%s max_error=%s>",
+	  rb_obj_class(self), ch->n - 1, lo, hi, err);
+}
+
+void
+InitVM_Chebyshev(void)
+{
+	rb_define_alloc_func(rb_cQuadChebyshev, qchebyshev_allocate);
+	rb_undef_method(CLASS_OF(rb_cQuadChebyshev), "new");
+	rb_define_singleton_method(rb_cQuadChebyshev, "fit", qchebyshev_s_fit, -1);
+	rb_undef_method(rb_cQuadChebyshev, "initialize_copy");
+
+	rb_define_method(rb_cQuadChebyshev, "call", qchebyshev_call, -1);
+	rb_define_alias(rb_cQuadChebyshev, "[]", "call");
+	rb_define_method(rb_cQuadChebyshev, "degree", qchebyshev_degree, 0);
+	rb_define_method(rb_cQuadChebyshev, "domain", qchebyshev_domain, 0);
+	rb_define_method(rb_cQuadChebyshev, "coefficients", qchebyshev_coefficients, 0);
+	rb_define_method(rb_cQuadChebyshev, "max_error", qchebyshev_max_error, 0);
+	rb_define_method(rb_cQuadChebyshev, "inspect", qchebyshev_inspect, 0);
+	rb_define_alias(rb_cQuadChebyshev, "to_s", "inspect");
+}
@@ -300,14 +300,46 @@ complex128_to_c(VALUE self)
  *  call-seq:
  *    to_c128 -> Complex128
  *  
- *  常に+self+を返す．
+ *  +self+を返す．
+ *  QuadMath::Vector#each_valueが使い回す凍結していないオブジェクトならば，同じ値の新しいComplex128を返す．
  */
 static VALUE
 complex128_to_c128(VALUE self)
 {
+	if (!RB_OBJ_FROZEN(self))
+		return rb_complex128_cc128(GetC128(self));
 	return self;
 }
 
+/*
+ *  call-seq:
+ *    nonzero? -> self | nil
+ *  
+ *  +self+が0ならnilを，そうでないなら+self+を返す．
+ *  to_c128と同じく，使い回すオブジェクトならば新しいComplex128を返す．
+ */
+static VALUE
+complex128_nonzero_p(VALUE self)
+{
+	if (GetC128(self) == 0)
+		return Qnil;
+	return complex128_to_c128(self);
+}
+
+/*
+ *  call-seq:
+ *    clone(freeze: true) -> Complex128
+ *  
+ *  +self+を返す．to_c128と同じく，使い回すオブジェクトならば新しいComplex128を返す．
+ */
+static VALUE
+complex128_clone(int argc, VALUE *argv, VALUE self)
+{
+	if (!RB_OBJ_FROZEN(self))
+		return complex128_to_c128(self);
+	return rb_call_super(argc, argv);
+}
+
 /*
  *  call-seq:
  *    real -> Float128
@@ -470,6 +502,12 @@ InitVM_Complex128(void)
 	
 	rb_define_method(rb_cComplex128, "to_c", complex128_to_c, 0);
 	rb_define_method(rb_cComplex128, "to_c128", complex128_to_c128, 0);
+	/* NumericやKernelでselfを返すメソッドも，使い回すオブジェクトを外に出さないようto_c128に揃える */
+	rb_define_method(rb_cComplex128, "+@", complex128_to_c128, 0);
+	rb_define_method(rb_cComplex128, "itself", complex128_to_c128, 0);
+	rb_define_method(rb_cComplex128, "dup", complex128_to_c128, 0);
+	rb_define_method(rb_cComplex128, "clone", complex128_clone, -1);
+	rb_define_method(rb_cComplex128, "nonzero?", complex128_nonzero_p, 0);
 	
 	rb_define_method(rb_cComplex128, "to_c64", complex128_to_c64, 0);
 	rb_define_method(rb_cComplex, "to_c64", nucomp_to_c64, 0);
@@ -485,6 +523,17 @@ rb_complex128_cc128(__complex128 x)
 	return obj;
 }
 
+/*
+ * 要素を順に表すために使い回すComplex128．rb_float128_flyweight()を見よ．
+ */
+VALUE
+rb_complex128_flyweight(__complex128 **ptr)
+{
+	struct C128 *c128 = ruby_xcalloc(1, sizeof(struct C128));
+	*ptr = &c128->value;
+	return TypedData_Wrap_Struct(rb_cComplex128, &complex128_data_type, c128);
+}
+
 __complex128
 rb_complex128_value(VALUE x)
 {
@@ -0,0 +1,365 @@
+/*******************************************************************************
+    ddmath.c -- Double-Double Kernels of module QuadMath
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <math.h>
+#include <stdint.h>
+#include <quadmath.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+/*
+ * 初等関数の速い経路．引数の還元はbinary128のままfma_q()で行い，
+ * 還元した小さな引数から先をdouble-doubleの表と多項式で計算する．
+ * 誤差はbinary128の512ulp，相対誤差で2^-103以内である．
+ * doubleの範囲を外れる場合，0，非正規化数，無限大，NaNは扱わずfalseを返すので，呼び出し側はlibquadmathに任せる．
+ */
+
+/* 2^(j/256) と，Taylor級数の先頭の係数 1/n! */
+#define EXP_TABLE_SIZE 256
+#define DD_TERMS 6
+static struct ddouble exp2_table[EXP_TABLE_SIZE];
+static struct ddouble inv_fact[DD_TERMS];
+
+/* c = j/128 (j = 96, ..., 192) における log(c) と log2(c) */
+#define LOG_TABLE_MIN 96
+#define LOG_TABLE_MAX 192
+static struct ddouble log_table[LOG_TABLE_MAX - LOG_TABLE_MIN + 1];
+static struct ddouble log2_table[LOG_TABLE_MAX - LOG_TABLE_MIN + 1];
+/* atanhの級数の係数 1/3，1/5 */
+static struct ddouble inv_odd[6];
+
+/* sin(j/128)，cos(j/128) (j = 0, ..., 101) */
+#define SINCOS_TABLE_SIZE 102
+static struct ddouble sin_table[SINCOS_TABLE_SIZE];
+static struct ddouble cos_table[SINCOS_TABLE_SIZE];
+
+static struct ddouble dd_ln2, dd_inv_ln2, dd_inv_ln10;
+
+/* 還元に使う定数．binary128に丸めた ln2/256，π/2 と，その残り */
+#define LN2_256_LO -2.7375544822459318053e-38
+#define PIO2_LO 4.3359050650618902957e-35
+#define PIO2_LO2 2.1674168413243541218e-51
+
+static inline int
+f128_biased_exp(__float128 x)
+{
+	union dd_f128_bits u = { .f = x };
+	return (int)(u.w.hi >> 48 & 0x7fff);
+}
+
+/* 正規化数xの指数部を置き換える */
+static inline __float128
+f128_with_biased_exp(__float128 x, int e)
+{
+	union dd_f128_bits u = { .f = x };
+	u.w.hi = (u.w.hi & 0x8000ffffffffffffULL) | (uint64_t)e << 48;
+	return u.f;
+}
+
+/* |x| < 2^51 を最近接の整数に丸める．round_d()は浮動小数点環境を退避するので遅い */
+static inline double
+round_d(double x)
+{
+	const double c = 0x1.8p52;
+	return (x + c) - c;
+}
+
+/*
+ * exp(r)，|r| ≤ ln2/512．r^5/5! 以降は2^-54に満たないので，
+ * その部分はdoubleで計算し，先頭の五項だけdouble-doubleで足す．
+ */
+static inline struct ddouble
+dd_exp_reduced(struct ddouble r)
+{
+	const double t = r.hi;
+	double q = 1.0 / 362880;
+	struct ddouble p;
+
+	q = q * t + 1.0 / 40320;
+	q = q * t + 1.0 / 5040;
+	q = q * t + 1.0 / 720;
+	q = q * t + 1.0 / 120;
+	p = dd_add_d(inv_fact[4], q * t);
+	for (int n = 3; n >= 0; n--)
+		p = dd_sloppy_add(dd_mul(p, r), inv_fact[n]);
+	return p;
+}
+
+/* 2^(k/256) exp(r) をbinary128にする．結果はdoubleの正規化数の範囲にあること */
+static inline __float128
+dd_exp_scale(long k, struct ddouble r)
+{
+	const long j = k & (EXP_TABLE_SIZE - 1), m = (k - j) / EXP_TABLE_SIZE;
+	struct ddouble p = dd_mul(exp2_table[j], dd_exp_reduced(r));
+	const double s = dd_pow2((int)m);
+
+	return dd_to_f128((struct ddouble){ p.hi * s, p.lo * s });
+}
+
+bool
+dd_expq(__float128 x, __float128 *y)
+{
+	const double xd = dd_from_f128(x).hi;
+	double k;
+	__float128 r;
+
+	/* 結果の下位もdoubleの正規化数に収まる範囲 */
+	if (!(xd > -650 && xd < 709) || xd == 0)
+		return false;
+	k = round_d(xd * (EXP_TABLE_SIZE / M_LN2));
+	r = fma_q(-k, M_LN2q / EXP_TABLE_SIZE, x);
+	*y = dd_exp_scale((long)k, dd_add_d(dd_from_f128(r), -k * LN2_256_LO));
+	return true;
+}
+
+bool
+dd_exp2q(__float128 x, __float128 *y)
+{
+	const double xd = dd_from_f128(x).hi;
+	double k;
+
+	if (!(xd > -930 && xd < 1020) || xd == 0)
+		return false;
+	/* k/256 との差はbinary128で正確に求まる */
+	k = round_d(xd * EXP_TABLE_SIZE);
+	*y = dd_exp_scale((long)k, dd_mul(dd_from_f128(sub_q(x, k / EXP_TABLE_SIZE)), dd_ln2));
+	return true;
+}
+
+/*
+ * x = 2^e m (0.75 ≤ m < 1.5) と分け，c = j/128 を m に最も近くとって
+ * log m = log c + 2 atanh(s)，s = (m - c) / (m + c) とする．m - c はbinary128で正確に求まる．
+ * |s| < 2^-8.5 なので級数は s^13 までで足りる．
+ */
+static inline bool
+dd_log_reduce(__float128 x, int *e, int *j, struct ddouble *series)
+{
+	int b = f128_biased_exp(x);
+	__float128 m, d;
+	struct ddouble dd, s, z, p;
+	double q;
+
+	if (!(x > 0) || b == 0 || b == 0x7fff)
+		return false;
+	/* 仮数の最上位ビットが立っていれば m ≥ 1.5 */
+	*e = b - 0x3fff;
+	if (((union dd_f128_bits){ .f = x }).w.hi >> 47 & 1)
+	{
+		m = f128_with_biased_exp(x, 0x3ffe);
+		(*e)++;
+	}
+	else
+		m = f128_with_biased_exp(x, 0x3fff);
+	*j = (int)round_d(dd_from_f128(m).hi * 128);
+	d = sub_q(m, dd_double_to_f128(*j / 128.0));
+	dd = dd_from_f128(d);
+	s = dd_div(dd, dd_add_d(dd, 2.0 * *j / 128));
+	z = dd_mul(s, s);
+	/* z^3/7 以降はdoubleで足りる */
+	q = 1.0 / 13;
+	q = q * z.hi + 1.0 / 11;
+	q = q * z.hi + 1.0 / 9;
+	q = q * z.hi + 1.0 / 7;
+	p = dd_add_d(inv_odd[5], q * z.hi);
+	p = dd_sloppy_add(dd_mul(p, z), inv_odd[3]);
+	p = dd_add_d(dd_mul(p, z), 1);
+	*series = dd_mul_d(dd_mul(s, p), 2);
+	return true;
+}
+
+bool
+dd_logq(__float128 x, __float128 *y)
+{
+	int e, j;
+	struct ddouble series, r;
+
+	if (!dd_log_reduce(x, &e, &j, &series))
+		return false;
+	r = dd_add(log_table[j - LOG_TABLE_MIN], series);
+	if (e != 0)
+	{
+		struct ddouble el = dd_two_prod((double)e, dd_ln2.hi);
+		el = dd_quick_two_sum(el.hi, el.lo + e * dd_ln2.lo);
+		r = dd_add(el, r);
+	}
+	*y = dd_to_f128(r);
+	return true;
+}
+
+bool
+dd_log2q(__float128 x, __float128 *y)
+{
+	int e, j;
+	struct ddouble series, r;
+
+	if (!dd_log_reduce(x, &e, &j, &series))
+		return false;
+	r = dd_add(log2_table[j - LOG_TABLE_MIN], dd_mul(series, dd_inv_ln2));
+	*y = dd_to_f128(dd_add_d(r, (double)e));
+	return true;
+}
+
+bool
+dd_log10q(__float128 x, __float128 *y)
+{
+	__float128 l;
+
+	if (!dd_logq(x, &l))
+		return false;
+	*y = dd_to_f128(dd_mul(dd_from_f128(l), dd_inv_ln10));
+	return true;
+}
+
+/* x = 4^k m (1 ≤ m < 4) とし，sqrt(m) のdouble近似にNewton法を一回施す */
+bool
+dd_sqrtq(__float128 x, __float128 *y)
+{
+	int b = f128_biased_exp(x), k;
+	struct ddouble m, r;
+	double y0;
+
+	if (!(x > 0) || b == 0 || b == 0x7fff)
+		return false;
+	k = (b - 0x3fff) >> 1;
+	m = dd_from_f128(f128_with_biased_exp(x, b - 2 * k));
+	y0 = sqrt(m.hi);
+	r = dd_sub(m, dd_two_prod(y0, y0));
+	r = dd_quick_two_sum(y0, r.hi / (2 * y0));
+	*y = dd_to_f128(r);
+	*y = f128_with_biased_exp(*y, f128_biased_exp(*y) + k);
+	return true;
+}
+
+/*
+ * x = k π/2 + r (|r| ≤ π/4) と還元し，|r| = j/128 + t (|t| ≤ 1/256) として
+ * 表と Taylor級数から sin r，cos r を求める．kの下位2ビットが象限である．
+ */
+static inline bool
+dd_sincos(__float128 x, struct ddouble *s, struct ddouble *c)
+{
+	double xd, k, qs, qc;
+	int j;
+	bool neg;
+	struct ddouble kp, r, t, z, st, ct, sr, cr;
+
+	xd = dd_from_f128(x).hi;
+	/* 2^-900より小さいと下位のdoubleが非正規化数になって精度が落ちるので，0も含めて外す */
+	if (!(fabs(xd) < 1048576) || !(fabs(xd) >= 0x1p-900))
+		return false;
+	/* xがπ/2の倍数に近いときも相対誤差を保つように，π/2の残りはdouble-doubleで引く */
+	k = round_d(xd * M_2_PI);
+	kp = dd_two_prod(-k, PIO2_LO);
+	kp = dd_quick_two_sum(kp.hi, kp.lo - k * PIO2_LO2);
+	r = dd_add(dd_from_f128(fma_q(-k, M_PI_2q, x)), kp);
+	/* π/2の倍数のごく近くでは還元の桁落ちがπ/2の精度を超えるので，libquadmathに任せる */
+	if (k != 0 && fabs(r.hi) < 0x1p-30)
+		return false;
+	neg = r.hi < 0;
+	if (neg)
+		r = dd_neg(r);
+	j = (int)round_d(r.hi * 128);
+	t = dd_add_d(r, -j / 128.0);
+	z = dd_mul(t, t);
+
+	/* z^3 以降の項は2^-57に満たないのでdoubleで計算する */
+	qs = -1.0 / 39916800;
+	qs = qs * z.hi + 1.0 / 362880;
+	qs = qs * z.hi - 1.0 / 5040;
+	qc = 1.0 / 479001600;
+	qc = qc * z.hi - 1.0 / 3628800;
+	qc = qc * z.hi + 1.0 / 40320;
+	qc = qc * z.hi - 1.0 / 720;
+	st = dd_add_d(inv_fact[5], qs * z.hi);
+	st = dd_sloppy_add(dd_mul(st, z), dd_neg(inv_fact[3]));
+	st = dd_sloppy_add(t, dd_mul(t, dd_mul(st, z)));
+	ct = dd_add_d(inv_fact[4], qc * z.hi);
+	ct = dd_sloppy_add(dd_mul(ct, z), dd_neg(inv_fact[2]));
+	ct = dd_add_d(dd_mul(ct, z), 1);
+
+	sr = dd_add(dd_mul(sin_table[j], ct), dd_mul(cos_table[j], st));
+	cr = dd_sub(dd_mul(cos_table[j], ct), dd_mul(sin_table[j], st));
+	if (neg)
+		sr = dd_neg(sr);
+
+	switch ((long)k & 3) {
+	case 0:
+		*s = sr; *c = cr;
+		break;
+	case 1:
+		*s = cr; *c = dd_neg(sr);
+		break;
+	case 2:
+		*s = dd_neg(sr); *c = dd_neg(cr);
+		break;
+	default:
+		*s = dd_neg(cr); *c = sr;
+		break;
+	}
+	return true;
+}
+
+bool
+dd_sinq(__float128 x, __float128 *y)
+{
+	struct ddouble s, c;
+
+	if (!dd_sincos(x, &s, &c))
+		return false;
+	*y = dd_to_f128(s);
+	return true;
+}
+
+bool
+dd_cosq(__float128 x, __float128 *y)
+{
+	struct ddouble s, c;
+
+	if (!dd_sincos(x, &s, &c))
+		return false;
+	*y = dd_to_f128(c);
+	return true;
+}
+
+bool
+dd_tanq(__float128 x, __float128 *y)
+{
+	struct ddouble s, c;
+
+	if (!dd_sincos(x, &s, &c))
+		return false;
+	*y = dd_to_f128(dd_div(s, c));
+	return true;
+}
+
+void
+InitVM_DDMath(void)
+{
+	__float128 f = 1;
+
+	for (int n = 0; n < DD_TERMS; n++)
+	{
+		if (n > 0)
+			f *= n;
+		inv_fact[n] = dd_from_f128(1 / f);
+	}
+	for (int j = 0; j < EXP_TABLE_SIZE; j++)
+		exp2_table[j] = dd_from_f128(exp2q((__float128)j / EXP_TABLE_SIZE));
+	for (int j = LOG_TABLE_MIN; j <= LOG_TABLE_MAX; j++)
+	{
+		log_table[j - LOG_TABLE_MIN] = dd_from_f128(logq((__float128)j / 128));
+		log2_table[j - LOG_TABLE_MIN] = dd_from_f128(log2q((__float128)j / 128));
+	}
+	for (int n = 3; n <= 5; n += 2)
+		inv_odd[n] = dd_from_f128(1 / (__float128)n);
+	for (int j = 0; j < SINCOS_TABLE_SIZE; j++)
+	{
+		sin_table[j] = dd_from_f128(sinq((__float128)j / 128));
+		cos_table[j] = dd_from_f128(cosq((__float128)j / 128));
+	}
+	dd_ln2 = dd_from_f128(M_LN2q);
+	dd_inv_ln2 = dd_from_f128(1 / M_LN2q);
+	dd_inv_ln10 = dd_from_f128(1 / M_LN10q);
+}
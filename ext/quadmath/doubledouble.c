@@ -0,0 +1,903 @@
+/*******************************************************************************
+    doubledouble.c -- DoubleDouble Class
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <math.h>
+#include <float.h>
+#include <quadmath.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+#define DD_MANT_DIG  106
+#define DD_DIG        31
+
+#ifdef HAVE_CONST_RUBY_TYPED_EMBEDDABLE
+# define DD_TYPED_EMBEDDABLE RUBY_TYPED_EMBEDDABLE
+#else
+# define DD_TYPED_EMBEDDABLE 0
+#endif
+
+static ID id_to_r, id_cmp, id_floor, id_ceil, id_round, id_truncate, id_pow;
+
+static size_t
+memsize_doubledouble(const void *_)
+{
+	return sizeof(struct ddouble);
+}
+
+/*
+ * 値は二つのdoubleだけなので，埋め込みの使えるRubyではオブジェクト本体に持たせて
+ * mallocを省く．
+ */
+static const rb_data_type_t doubledouble_data_type = {
+	"doubledouble",
+	{0, RUBY_TYPED_DEFAULT_FREE, memsize_doubledouble,},
+	0, 0,
+	RUBY_TYPED_FREE_IMMEDIATELY | RUBY_TYPED_WB_PROTECTED | DD_TYPED_EMBEDDABLE,
+};
+
+VALUE
+rb_doubledouble_new(struct ddouble a)
+{
+	struct ddouble *ptr;
+	VALUE obj = TypedData_Make_Struct(rb_cDoubleDouble, struct ddouble, &doubledouble_data_type, ptr);
+	*ptr = a;
+	RB_OBJ_FREEZE(obj);
+	return obj;
+}
+
+struct ddouble
+GetDD(VALUE self)
+{
+	struct ddouble *ptr;
+
+	TypedData_Get_Struct(self, struct ddouble, &doubledouble_data_type, ptr);
+
+	return *ptr;
+}
+
+/*
+ * 無限大やあふれを含む演算では誤差のない変換がNaNを作るので，
+ * 上位のdoubleどうしの結果に置き換える．
+ */
+static inline struct ddouble
+dd_nonfinite_fix(struct ddouble r, double d)
+{
+	if (isfinite(r.hi))
+		return r;
+	return (struct ddouble){ d, 0.0 };
+}
+
+static inline struct ddouble
+dd_div_safe(struct ddouble a, struct ddouble b)
+{
+	if (b.hi == 0.0 || !isfinite(a.hi) || !isfinite(b.hi))
+		return (struct ddouble){ a.hi / b.hi, 0.0 };
+	return dd_nonfinite_fix(dd_div(a, b), a.hi / b.hi);
+}
+
+static inline struct ddouble
+dd_floor(struct ddouble a)
+{
+	double f = floor(a.hi);
+
+	if (f != a.hi)
+		return (struct ddouble){ f, 0.0 };
+	return dd_quick_two_sum(f, floor(a.lo));
+}
+
+static inline int
+dd_cmp(struct ddouble a, struct ddouble b)
+{
+	if (a.hi != b.hi)
+		return a.hi < b.hi ? -1 : 1;
+	if (a.lo != b.lo)
+		return a.lo < b.lo ? -1 : 1;
+	return 0;
+}
+
+/*
+ * 整数をdouble-doubleへ変換する．hiを最近接のdoubleとし，
+ * 残差を整数のまま求めてloとするので，106ビットに収まる整数は正確に変換される．
+ */
+static struct ddouble
+integer_to_cdd(VALUE x)
+{
+	double hi;
+
+	if (FIXNUM_P(x))
+	{
+		long n = FIX2LONG(x);
+		hi = (double)n;
+		return dd_quick_two_sum(hi, (double)(n - (long)hi));
+	}
+	hi = rb_big2dbl(x);
+	if (!isfinite(hi))
+		return (struct ddouble){ hi, 0.0 };
+	return dd_two_sum(hi, NUM2DBL(rb_big_minus(x, rb_dbl2big(hi))));
+}
+
+/*
+ * 有理数をdouble-doubleへ変換する．残差は有理数のまま正確に求める．
+ */
+static struct ddouble
+rational_to_cdd(VALUE x)
+{
+	double hi = NUM2DBL(x);
+	VALUE rem;
+
+	if (!isfinite(hi) || hi == 0.0)
+		return (struct ddouble){ hi, 0.0 };
+	rem = rb_funcall(x, '-', 1, rb_funcall(DBL2NUM(hi), id_to_r, 0));
+	return dd_two_sum(hi, NUM2DBL(rem));
+}
+
+static struct ddouble
+num_to_cdd(VALUE x)
+{
+	switch (convertion_num_types(x)) {
+	case NUM_FIXNUM:
+	case NUM_BIGNUM:
+		return integer_to_cdd(x);
+		break;
+	case NUM_RATIONAL:
+		return rational_to_cdd(x);
+		break;
+	case NUM_FLOAT:
+		return (struct ddouble){ RFLOAT_VALUE(x), 0.0 };
+		break;
+	case NUM_DOUBLEDOUBLE:
+		return GetDD(x);
+		break;
+	case NUM_FLOAT128:
+		return dd_from_f128(GetF128(x));
+		break;
+	case NUM_COMPLEX:
+	case NUM_COMPLEX128:
+	case NUM_OTHERTYPE:
+	default:
+		return dd_from_f128(num_to_cf128(x));
+		break;
+	}
+}
+
+static inline VALUE
+doubledouble_to_float128(VALUE self)
+{
+	return rb_float128_cf128(dd_to_f128(GetDD(self)));
+}
+
+enum DD_OPERAND {
+	DD_OPERAND_REAL,
+	DD_OPERAND_QUAD,
+	DD_OPERAND_OTHER
+};
+
+/*
+ * 右オペランドの扱いを決める．実数はdouble-doubleへ変換してyに入れ，
+ * Float128とComplex128は四倍精度で，そのほかは強制型変換で演算する．
+ */
+static inline enum DD_OPERAND
+dd_operand(VALUE other, struct ddouble *y)
+{
+	switch (convertion_num_types(other)) {
+	case NUM_FIXNUM:
+	case NUM_BIGNUM:
+	case NUM_RATIONAL:
+	case NUM_FLOAT:
+	case NUM_DOUBLEDOUBLE:
+		*y = num_to_cdd(other);
+		return DD_OPERAND_REAL;
+		break;
+	case NUM_FLOAT128:
+	case NUM_COMPLEX128:
+		return DD_OPERAND_QUAD;
+		break;
+	case NUM_COMPLEX:
+	case NUM_OTHERTYPE:
+	default:
+		return DD_OPERAND_OTHER;
+		break;
+	}
+}
+
+/*
+ *  call-seq:
+ *    hash -> Integer
+ *
+ *  +self+のHash値を返す．
+ *
+ */
+static VALUE
+doubledouble_hash(VALUE self)
+{
+	struct ddouble a = GetDD(self);
+	st_index_t hash;
+
+	if (a.hi == 0.0)
+		a = (struct ddouble){ 0.0, 0.0 };
+	hash = rb_memhash(&a, sizeof(struct ddouble));
+
+	return ST2FIX(hash);
+}
+
+/*
+ *  call-seq:
+ *    eql?(other) -> bool
+ *
+ *  +other+がDoubleDoubleで，+self+と等しければ真を返す．
+ */
+static VALUE
+doubledouble_eql_p(VALUE self, VALUE other)
+{
+	struct ddouble a, b;
+
+	if (CLASS_OF(other) != rb_cDoubleDouble)
+		return Qfalse;
+
+	a = GetDD(self);
+	b = GetDD(other);
+
+	return (a.hi == b.hi && a.lo == b.lo) ? Qtrue : Qfalse;
+}
+
+/*
+ *  call-seq:
+ *    finite? -> bool
+ *
+ *  +self+が有限ならtrueを，そうでないならfalseを返す．
+ */
+static VALUE
+doubledouble_finite_p(VALUE self)
+{
+	return isfinite(GetDD(self).hi) ? Qtrue : Qfalse;
+}
+
+/*
+ *  call-seq:
+ *    infinite? -> 1 | -1 | nil
+ *
+ *  +self+が無限大の場合，負であれば-1を，正であれば1を，そうでないならnilを返す．
+ */
+static VALUE
+doubledouble_infinite_p(VALUE self)
+{
+	double hi = GetDD(self).hi;
+
+	if (!isinf(hi))
+		return Qnil;
+	return INT2FIX(hi < 0 ? -1 : 1);
+}
+
+/*
+ *  call-seq:
+ *    nan? -> bool
+ *
+ *  +self+がNaN(Not a Number)ならtrueを，そうでないならfalseを返す．
+ */
+static VALUE
+doubledouble_nan_p(VALUE self)
+{
+	return isnan(GetDD(self).hi) ? Qtrue : Qfalse;
+}
+
+/*
+ *  call-seq:
+ *    hi -> Float
+ *
+ *  上位のdoubleを返す．+self+を最も近いFloatに丸めた値である．
+ *
+ *    '0.1'.to_dd.hi # => 0.1
+ */
+static VALUE
+doubledouble_hi(VALUE self)
+{
+	return DBL2NUM(GetDD(self).hi);
+}
+
+/*
+ *  call-seq:
+ *    lo -> Float
+ *
+ *  下位のdoubleを返す．+self+は hi + lo に等しい．
+ *
+ *    '0.1'.to_dd.lo # => -5.551115123125783e-18
+ */
+static VALUE
+doubledouble_lo(VALUE self)
+{
+	return DBL2NUM(GetDD(self).lo);
+}
+
+/*
+ *  call-seq:
+ *    to_s -> String
+ *    inspect -> String
+ *
+ *  +self+を文字列に変換する．再び読み込んで同じ値に戻る最短の桁数(31桁から33桁)で表す．
+ *
+ *    '0.1'.to_dd.to_s # => "0.1"
+ *    (1.to_dd / 3).to_s # => "0.333333333333333333333333333333332"
+ */
+static VALUE
+doubledouble_to_s(VALUE self)
+{
+	struct ddouble a = GetDD(self);
+	char buf[64], *e;
+	__float128 x;
+	int prec;
+	size_t len;
+
+	if (isnan(a.hi))
+		return rb_usascii_str_new_cstr("NaN");
+	if (isinf(a.hi))
+		return rb_usascii_str_new_cstr(a.hi > 0 ? "Infinity" : "-Infinity");
+
+	x = dd_to_f128(a);
+	for (prec = DD_DIG; prec < DD_DIG + 2; prec++)
+	{
+		struct ddouble b;
+		quadmath_snprintf(buf, sizeof(buf) - 2, "%.*Qg", prec, x);
+		b = dd_from_f128(strtoflt128(buf, NULL));
+		if (b.hi == a.hi && b.lo == a.lo)
+			break;
+	}
+	if (prec == DD_DIG + 2)
+		quadmath_snprintf(buf, sizeof(buf) - 2, "%.*Qg", prec, x);
+
+	/* Floatと同じく，整数値にも小数点以下を付ける */
+	if (strchr(buf, '.') == NULL)
+	{
+		e = strchr(buf, 'e');
+		len = strlen(buf);
+		if (e == NULL)
+			memcpy(buf + len, ".0", 3);
+		else
+		{
+			memmove(e + 2, e, len - (e - buf) + 1);
+			memcpy(e, ".0", 2);
+		}
+	}
+	return rb_usascii_str_new_cstr(buf);
+}
+
+/*
+ *  call-seq:
+ *    to_f -> Float
+ *
+ *  +self+をFloatへ丸める．
+ */
+static VALUE
+doubledouble_to_f(VALUE self)
+{
+	return DBL2NUM(GetDD(self).hi);
+}
+
+/*
+ *  call-seq:
+ *    to_f128 -> Float128
+ *
+ *  +self+をFloat128へ変換する．107ビット以上を要する値(hiとloの間に零の並ぶもの)を除いて正確である．
+ */
+static VALUE
+doubledouble_to_f128(VALUE self)
+{
+	return doubledouble_to_float128(self);
+}
+
+/*
+ *  call-seq:
+ *    to_c128 -> Complex128
+ *
+ *  +self+を実部とするComplex128へ変換する．精度はto_f128と同じである．
+ */
+static VALUE
+doubledouble_to_c128(VALUE self)
+{
+	return rb_complex128_cc128((__complex128)dd_to_f128(GetDD(self)));
+}
+
+/*
+ *  call-seq:
+ *    to_dd -> DoubleDouble
+ *
+ *  +self+を返す．
+ */
+static VALUE
+doubledouble_to_dd(VALUE self)
+{
+	return self;
+}
+
+/*
+ *  call-seq:
+ *    to_r -> Rational
+ *
+ *  +self+を正確に有理数へ変換する．無限大とNaNではFloatDomainErrorとなる．
+ *
+ *    '0.5'.to_dd.to_r # => (1/2)
+ */
+static VALUE
+doubledouble_to_r(VALUE self)
+{
+	struct ddouble a = GetDD(self);
+	VALUE hi = rb_funcall(DBL2NUM(a.hi), id_to_r, 0);
+
+	if (a.lo == 0.0)
+		return hi;
+	return rb_funcall(hi, '+', 1, rb_funcall(DBL2NUM(a.lo), id_to_r, 0));
+}
+
+/*
+ * 端数処理を有理数で正確に行う．桁数を指定して整数にならない場合はDoubleDoubleに戻す．
+ */
+static VALUE
+doubledouble_rounding(int argc, VALUE *argv, VALUE self, ID func)
+{
+	VALUE r = rb_funcallv_kw(doubledouble_to_r(self), func, argc, argv, rb_keyword_given_p());
+
+	if (RB_INTEGER_TYPE_P(r))
+		return r;
+	return rb_doubledouble_new(num_to_cdd(r));
+}
+
+/*
+ *  call-seq:
+ *    floor(ndigits = 0) -> Integer | DoubleDouble
+ *
+ *  +self+以下で最大の整数を返す．+ndigits+が正のときはその桁で切り下げたDoubleDoubleを返す．
+ */
+static VALUE
+doubledouble_floor(int argc, VALUE *argv, VALUE self)
+{
+	return doubledouble_rounding(argc, argv, self, id_floor);
+}
+
+/*
+ *  call-seq:
+ *    ceil(ndigits = 0) -> Integer | DoubleDouble
+ *
+ *  +self+以上で最小の整数を返す．+ndigits+が正のときはその桁で切り上げたDoubleDoubleを返す．
+ */
+static VALUE
+doubledouble_ceil(int argc, VALUE *argv, VALUE self)
+{
+	return doubledouble_rounding(argc, argv, self, id_ceil);
+}
+
+/*
+ *  call-seq:
+ *    round(ndigits = 0, half: :up) -> Integer | DoubleDouble
+ *
+ *  +self+に最も近い整数を返す．+ndigits+と+half+の意味はRational#roundと同じである．
+ */
+static VALUE
+doubledouble_round(int argc, VALUE *argv, VALUE self)
+{
+	return doubledouble_rounding(argc, argv, self, id_round);
+}
+
+/*
+ *  call-seq:
+ *    truncate(ndigits = 0) -> Integer | DoubleDouble
+ *    to_i -> Integer
+ *
+ *  +self+の小数部を切り捨てる．
+ */
+static VALUE
+doubledouble_truncate(int argc, VALUE *argv, VALUE self)
+{
+	return doubledouble_rounding(argc, argv, self, id_truncate);
+}
+
+/*
+ *  call-seq:
+ *    -self -> DoubleDouble
+ *
+ *  符号を反転する．
+ */
+static VALUE
+doubledouble_uminus(VALUE self)
+{
+	return rb_doubledouble_new(dd_neg(GetDD(self)));
+}
+
+/*
+ *  call-seq:
+ *    abs -> DoubleDouble
+ *
+ *  絶対値を返す．
+ */
+static VALUE
+doubledouble_abs(VALUE self)
+{
+	struct ddouble a = GetDD(self);
+
+	return signbit(a.hi) ? rb_doubledouble_new(dd_neg(a)) : self;
+}
+
+/*
+ *  call-seq:
+ *    DoubleDouble + Numeric -> DoubleDouble | Float128 | Complex128 | Complex
+ *
+ *  右オペランドを加算する．
+ *  実数(Integer，Rational，Float，DoubleDouble)とはDoubleDoubleで演算し，
+ *  Float128とComplex128とは+self+を四倍精度へ変換して演算する．
+ */
+static VALUE
+doubledouble_add(VALUE self, VALUE other)
+{
+	struct ddouble x, y;
+
+	switch (dd_operand(other, &y)) {
+	case DD_OPERAND_REAL:
+		x = GetDD(self);
+		return rb_doubledouble_new(dd_nonfinite_fix(dd_add(x, y), x.hi + y.hi));
+		break;
+	case DD_OPERAND_QUAD:
+		return rb_funcall(doubledouble_to_float128(self), '+', 1, other);
+		break;
+	default:
+		return rb_num_coerce_bin(self, other, '+');
+		break;
+	}
+}
+
+/*
+ *  call-seq:
+ *    DoubleDouble - Numeric -> DoubleDouble | Float128 | Complex128 | Complex
+ *
+ *  右オペランドを減算する．型の扱いはDoubleDouble#+と同じである．
+ */
+static VALUE
+doubledouble_sub(VALUE self, VALUE other)
+{
+	struct ddouble x, y;
+
+	switch (dd_operand(other, &y)) {
+	case DD_OPERAND_REAL:
+		x = GetDD(self);
+		return rb_doubledouble_new(dd_nonfinite_fix(dd_sub(x, y), x.hi - y.hi));
+		break;
+	case DD_OPERAND_QUAD:
+		return rb_funcall(doubledouble_to_float128(self), '-', 1, other);
+		break;
+	default:
+		return rb_num_coerce_bin(self, other, '-');
+		break;
+	}
+}
+
+/*
+ *  call-seq:
+ *    DoubleDouble * Numeric -> DoubleDouble | Float128 | Complex128 | Complex
+ *
+ *  右オペランドを乗算する．型の扱いはDoubleDouble#+と同じである．
+ */
+static VALUE
+doubledouble_mul(VALUE self, VALUE other)
+{
+	struct ddouble x, y;
+
+	switch (dd_operand(other, &y)) {
+	case DD_OPERAND_REAL:
+		x = GetDD(self);
+		return rb_doubledouble_new(dd_nonfinite_fix(dd_mul(x, y), x.hi * y.hi));
+		break;
+	case DD_OPERAND_QUAD:
+		return rb_funcall(doubledouble_to_float128(self), '*', 1, other);
+		break;
+	default:
+		return rb_num_coerce_bin(self, other, '*');
+		break;
+	}
+}
+
+/*
+ *  call-seq:
+ *    DoubleDouble / Numeric -> DoubleDouble | Float128 | Complex128 | Complex
+ *
+ *  右オペランドで除算する．型の扱いはDoubleDouble#+と同じである．
+ */
+static VALUE
+doubledouble_div(VALUE self, VALUE other)
+{
+	struct ddouble y;
+
+	switch (dd_operand(other, &y)) {
+	case DD_OPERAND_REAL:
+		return rb_doubledouble_new(dd_div_safe(GetDD(self), y));
+		break;
+	case DD_OPERAND_QUAD:
+		return rb_funcall(doubledouble_to_float128(self), '/', 1, other);
+		break;
+	default:
+		return rb_num_coerce_bin(self, other, '/');
+		break;
+	}
+}
+
+/*
+ *  call-seq:
+ *    DoubleDouble % Numeric -> DoubleDouble | Float128 | Complex128 | Complex
+ *
+ *  剰余を返す．Float#%と同じく，結果の符号は右オペランドに合わせる．
+ */
+static VALUE
+doubledouble_mod(VALUE self, VALUE other)
+{
+	struct ddouble x, y, r;
+	double m;
+
+	switch (dd_operand(other, &y)) {
+	case DD_OPERAND_REAL:
+		x = GetDD(self);
+		if (!isfinite(x.hi) || !isfinite(y.hi) || y.hi == 0.0)
+		{
+			m = fmod(x.hi, y.hi);
+			if (y.hi * m < 0)
+				m += y.hi;
+			return rb_doubledouble_new((struct ddouble){ m, 0.0 });
+		}
+		r = dd_sub(x, dd_mul(y, dd_floor(dd_div(x, y))));
+		if (r.hi != 0.0 && signbit(r.hi) != signbit(y.hi))
+			r = dd_add(r, y);
+		if (signbit(y.hi) ? dd_cmp(r, y) <= 0 : dd_cmp(r, y) >= 0)
+			r = dd_sub(r, y);
+		return rb_doubledouble_new(r);
+		break;
+	case DD_OPERAND_QUAD:
+		return rb_funcall(doubledouble_to_float128(self), '%', 1, other);
+		break;
+	default:
+		return rb_num_coerce_bin(self, other, '%');
+		break;
+	}
+}
+
+static struct ddouble
+dd_pow_long(struct ddouble x, long n)
+{
+	struct ddouble r = { 1.0, 0.0 }, b = x;
+	unsigned long e = n < 0 ? -(unsigned long)n : (unsigned long)n;
+
+	while (e)
+	{
+		if (e & 1)
+			r = dd_mul(r, b);
+		e >>= 1;
+		if (e)
+			b = dd_mul(b, b);
+	}
+	if (n < 0)
+		r = dd_div_safe((struct ddouble){ 1.0, 0.0 }, r);
+	return dd_nonfinite_fix(r, pow(x.hi, (double)n));
+}
+
+/*
+ *  call-seq:
+ *    DoubleDouble ** Numeric -> DoubleDouble | Float128 | Complex128 | Complex
+ *
+ *  冪乗を返す．指数がFixnumならDoubleDoubleの二進冪乗で，
+ *  そのほかの実数なら四倍精度のpowq()で求めてDoubleDoubleへ丸める．
+ */
+static VALUE
+doubledouble_pow(VALUE self, VALUE other)
+{
+	struct ddouble y;
+	VALUE r;
+
+	switch (dd_operand(other, &y)) {
+	case DD_OPERAND_REAL:
+		if (FIXNUM_P(other))
+			return rb_doubledouble_new(dd_pow_long(GetDD(self), FIX2LONG(other)));
+		r = rb_funcall(doubledouble_to_float128(self), id_pow, 1, other);
+		if (CLASS_OF(r) == rb_cFloat128)
+			return rb_doubledouble_new(dd_from_f128(GetF128(r)));
+		return r;
+		break;
+	case DD_OPERAND_QUAD:
+		return rb_funcall(doubledouble_to_float128(self), id_pow, 1, other);
+		break;
+	default:
+		return rb_num_coerce_bin(self, other, id_pow);
+		break;
+	}
+}
+
+/*
+ *  call-seq:
+ *    DoubleDouble <=> Numeric -> -1 | 0 | 1 | nil
+ *
+ *  比較する．IntegerとRationalとは有理数として正確に比べる．
+ */
+static VALUE
+doubledouble_cmp(VALUE self, VALUE other)
+{
+	struct ddouble x = GetDD(self), y;
+
+	switch (dd_operand(other, &y)) {
+	case DD_OPERAND_REAL:
+		if (isnan(x.hi) || isnan(y.hi))
+			return Qnil;
+		if (isfinite(x.hi) && (RB_TYPE_P(other, T_BIGNUM) || RB_TYPE_P(other, T_RATIONAL)))
+			return rb_funcall(doubledouble_to_r(self), id_cmp, 1, other);
+		return INT2FIX(dd_cmp(x, y));
+		break;
+	case DD_OPERAND_QUAD:
+		return rb_funcall(doubledouble_to_float128(self), id_cmp, 1, other);
+		break;
+	default:
+		return rb_num_coerce_cmp(self, other, id_cmp);
+		break;
+	}
+}
+
+/*
+ *  call-seq:
+ *    coerce(other) -> [DoubleDouble, DoubleDouble] | [Float128, Float128] | [Complex128, Complex128]
+ *
+ *  +other+との演算のために型を揃える．実数はDoubleDoubleへ，
+ *  Float128とComplex128との組では+self+を四倍精度へそれぞれ変換する．
+ */
+static VALUE
+doubledouble_coerce(VALUE self, VALUE other)
+{
+	struct ddouble y;
+
+	switch (dd_operand(other, &y)) {
+	case DD_OPERAND_REAL:
+		return rb_assoc_new(rb_doubledouble_new(y), self);
+		break;
+	case DD_OPERAND_QUAD:
+		if (CLASS_OF(other) == rb_cFloat128)
+			return rb_assoc_new(other, doubledouble_to_float128(self));
+		return rb_assoc_new(other, rb_complex128_cc128((__complex128)dd_to_f128(GetDD(self))));
+		break;
+	default:
+		return rb_call_super(1, &other);
+		break;
+	}
+}
+
+/*
+ *  call-seq:
+ *    to_dd -> DoubleDouble
+ *
+ *  IntegerをDoubleDoubleへ変換する．106ビットに収まる整数は正確である．
+ *
+ *    (2**100 + 1).to_dd.to_i == 2**100 + 1 # => true
+ */
+static VALUE
+integer_to_dd(VALUE self)
+{
+	return rb_doubledouble_new(integer_to_cdd(self));
+}
+
+/*
+ *  call-seq:
+ *    to_dd -> DoubleDouble
+ *
+ *  RationalをDoubleDoubleへ最近接に近く丸める．
+ *
+ *    (1/3r).to_dd # => 0.333333333333333333333333333333332
+ */
+static VALUE
+rational_to_dd(VALUE self)
+{
+	return rb_doubledouble_new(rational_to_cdd(self));
+}
+
+/*
+ *  call-seq:
+ *    to_dd -> DoubleDouble
+ *
+ *  FloatをDoubleDoubleへ正確に変換する．
+ *
+ *    0.1.to_dd # => 0.1000000000000000055511151231257827
+ */
+static VALUE
+float_to_dd(VALUE self)
+{
+	return rb_doubledouble_new((struct ddouble){ RFLOAT_VALUE(self), 0.0 });
+}
+
+/*
+ *  call-seq:
+ *    to_dd -> DoubleDouble
+ *
+ *  Float128をDoubleDoubleへ106ビットに丸める．
+ *
+ *    Float128('0.1').to_dd.to_f128 == Float128('0.1') # => false
+ */
+static VALUE
+float128_to_dd(VALUE self)
+{
+	return rb_doubledouble_new(dd_from_f128(GetF128(self)));
+}
+
+/*
+ *  call-seq:
+ *    to_dd -> DoubleDouble
+ *
+ *  文字列をDoubleDoubleへ変換する．10進数として四倍精度で読んでから106ビットに丸める．
+ *
+ *    '0.1'.to_dd # => 0.1
+ */
+static VALUE
+string_to_dd(VALUE self)
+{
+	return rb_doubledouble_new(dd_from_f128(rb_float128_value(rb_funcall(self, rb_intern("to_f128"), 0))));
+}
+
+void
+InitVM_DoubleDouble(void)
+{
+	id_to_r = rb_intern("to_r");
+	id_cmp = rb_intern("<=>");
+	id_floor = rb_intern("floor");
+	id_ceil = rb_intern("ceil");
+	id_round = rb_intern("round");
+	id_truncate = rb_intern("truncate");
+	id_pow = rb_intern("**");
+
+	/* Class methods */
+	rb_undef_alloc_func(rb_cDoubleDouble);
+	rb_undef_method(CLASS_OF(rb_cDoubleDouble), "new");
+
+	/* Object methods */
+	rb_define_method(rb_cDoubleDouble, "hash", doubledouble_hash, 0);
+	rb_define_method(rb_cDoubleDouble, "eql?", doubledouble_eql_p, 1);
+
+	/* The unique Methods */
+	rb_define_method(rb_cDoubleDouble, "infinite?", doubledouble_infinite_p, 0);
+	rb_define_method(rb_cDoubleDouble, "finite?", doubledouble_finite_p, 0);
+	rb_define_method(rb_cDoubleDouble, "nan?", doubledouble_nan_p, 0);
+	rb_define_method(rb_cDoubleDouble, "hi", doubledouble_hi, 0);
+	rb_define_method(rb_cDoubleDouble, "lo", doubledouble_lo, 0);
+
+	/* Operators */
+	rb_define_method(rb_cDoubleDouble, "-@", doubledouble_uminus, 0);
+	rb_define_method(rb_cDoubleDouble, "+", doubledouble_add, 1);
+	rb_define_method(rb_cDoubleDouble, "-", doubledouble_sub, 1);
+	rb_define_method(rb_cDoubleDouble, "*", doubledouble_mul, 1);
+	rb_define_method(rb_cDoubleDouble, "/", doubledouble_div, 1);
+	rb_define_method(rb_cDoubleDouble, "%", doubledouble_mod, 1);
+	rb_define_alias(rb_cDoubleDouble, "modulo", "%");
+	rb_define_method(rb_cDoubleDouble, "**", doubledouble_pow, 1);
+	rb_define_method(rb_cDoubleDouble, "<=>", doubledouble_cmp, 1);
+	rb_define_method(rb_cDoubleDouble, "coerce", doubledouble_coerce, 1);
+	rb_define_method(rb_cDoubleDouble, "abs", doubledouble_abs, 0);
+
+	/* Type convertion methods */
+	rb_define_method(rb_cDoubleDouble, "inspect", doubledouble_to_s, 0);
+	rb_define_method(rb_cDoubleDouble, "to_s", doubledouble_to_s, 0);
+	rb_define_method(rb_cDoubleDouble, "to_f", doubledouble_to_f, 0);
+	rb_define_method(rb_cDoubleDouble, "to_f128", doubledouble_to_f128, 0);
+	rb_define_method(rb_cDoubleDouble, "to_c128", doubledouble_to_c128, 0);
+	rb_define_method(rb_cDoubleDouble, "to_dd", doubledouble_to_dd, 0);
+	rb_define_method(rb_cDoubleDouble, "to_r", doubledouble_to_r, 0);
+	rb_define_method(rb_cDoubleDouble, "to_i", doubledouble_truncate, -1);
+
+	rb_define_method(rb_cInteger, "to_dd", integer_to_dd, 0);
+	rb_define_method(rb_cRational, "to_dd", rational_to_dd, 0);
+	rb_define_method(rb_cFloat, "to_dd", float_to_dd, 0);
+	rb_define_method(rb_cFloat128, "to_dd", float128_to_dd, 0);
+	rb_define_method(rb_cString, "to_dd", string_to_dd, 0);
+
+	/* Utilities */
+	rb_define_method(rb_cDoubleDouble, "floor", doubledouble_floor, -1);
+	rb_define_method(rb_cDoubleDouble, "ceil", doubledouble_ceil, -1);
+	rb_define_method(rb_cDoubleDouble, "round", doubledouble_round, -1);
+	rb_define_method(rb_cDoubleDouble, "truncate", doubledouble_truncate, -1);
+
+	/* Constants */
+	rb_define_const(rb_cDoubleDouble, "NAN", rb_doubledouble_new((struct ddouble){ NAN, 0.0 }));
+	rb_define_const(rb_cDoubleDouble, "INFINITY", rb_doubledouble_new((struct ddouble){ HUGE_VAL, 0.0 }));
+
+	rb_define_const(rb_cDoubleDouble, "EPSILON", rb_doubledouble_new((struct ddouble){ ldexp(1.0, 2 - DD_MANT_DIG), 0.0 }));
+	rb_define_const(rb_cDoubleDouble, "MANT_DIG", INT2NUM(DD_MANT_DIG));
+	rb_define_const(rb_cDoubleDouble, "DIG", INT2NUM(DD_DIG));
+}
@@ -7,6 +7,7 @@ if have_header('quadmath.h')
   have_func('clgammaq', 'quadmath.h')
   have_func('ctgammaq', 'quadmath.h')
   have_func('cl2norm2q', 'quadmath.h')
+  have_const('RUBY_TYPED_EMBEDDABLE', 'ruby.h')
 
   $libs << " -lquadmath"
   create_makefile('quadmath/quadmath')
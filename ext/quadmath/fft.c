@@ -0,0 +1,1008 @@
+/*******************************************************************************
+    fft.c -- QuadMath::FFT Class
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <quadmath.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+/* これより大きな素因数を含む長さはBluestein法で2の冪の変換に帰着させる */
+#define FFT_MAX_RADIX 31
+#define FFT_MAX_FACTORS 64
+
+/*
+ * 変換の計画．長さnの因数分解と回転因子W_n^k = exp(-2πik/n)を前もって作っておく．
+ * 計画は実行中に書き換えないので，GVLを解放して複数のスレッドから同時に使ってよい．
+ */
+struct fft_plan {
+	long n;
+	long factors[2 * FFT_MAX_FACTORS];
+	__complex128 *tw;
+	/* Bluestein法 */
+	struct fft_plan *sub;
+	__complex128 *chirp;
+	__complex128 *chirp_fft;
+	/* 実数入力用の半分の長さの計画 */
+	struct fft_plan *half;
+};
+
+static void
+fft_plan_free(struct fft_plan *pl)
+{
+	if (pl == NULL)  return;
+	xfree(pl->tw);
+	xfree(pl->chirp);
+	xfree(pl->chirp_fft);
+	fft_plan_free(pl->sub);
+	fft_plan_free(pl->half);
+	xfree(pl);
+}
+
+static size_t
+fft_plan_memsize(const struct fft_plan *pl)
+{
+	size_t size;
+
+	if (pl == NULL)  return 0;
+	size = sizeof(struct fft_plan) + sizeof(__complex128) * pl->n;
+	if (pl->sub != NULL)
+		size += sizeof(__complex128) * (pl->n + pl->sub->n) + fft_plan_memsize(pl->sub);
+	return size + fft_plan_memsize(pl->half);
+}
+
+/* W_n^k．対称性で[0, π/2]の角に帰着させてから三角関数を呼ぶ */
+static __complex128
+fft_twiddle(long k, long n)
+{
+	__complex128 w;
+	bool conj_p = false, neg_p = false;
+
+	k %= n;
+	if (2 * k > n)
+	{
+		k = n - k;
+		conj_p = true;
+	}
+	if (4 * k > n)
+	{
+		k = n - 2 * k;  /* 角π - θを2倍の分母で表す */
+		n *= 2;
+		neg_p = true;
+	}
+	{
+		__float128 theta = 2 * M_PIq * k / n;
+		__float128 c = cosq(theta), s = sinq(theta);
+		if (neg_p)  c = -c;
+		__real__ w = c;
+		__imag__ w = conj_p ? s : -s;
+	}
+	return w;
+}
+
+static void
+fft_factor(long n, long *facbuf)
+{
+	long p = 4;
+	long floor_sqrt = (long)floor(sqrt((double)n));
+
+	do {
+		while (n % p)
+		{
+			switch (p) {
+			case 4:
+				p = 2;
+				break;
+			case 2:
+				p = 3;
+				break;
+			default:
+				p += 2;
+				break;
+			}
+			if (p > floor_sqrt)
+				p = n;
+		}
+		n /= p;
+		*facbuf++ = p;
+		*facbuf++ = n;
+	} while (n > 1);
+}
+
+static void fft_exec(const struct fft_plan *pl, __complex128 *out, const __complex128 *in, __complex128 *work);
+
+static struct fft_plan *
+fft_plan_new(long n)
+{
+	struct fft_plan *pl = ZALLOC(struct fft_plan);
+	bool large_prime_p = false;
+
+	pl->n = n;
+	if (n <= 1)
+		return pl;
+
+	fft_factor(n, pl->factors);
+	for (long i = 0; ; i += 2)
+	{
+		if (pl->factors[i] > FFT_MAX_RADIX)
+			large_prime_p = true;
+		if (pl->factors[i + 1] == 1)
+			break;
+	}
+
+	if (!large_prime_p)
+	{
+		pl->tw = ALLOC_N(__complex128, n);
+		for (long k = 0; k < n; k++)
+			pl->tw[k] = fft_twiddle(k, n);
+	}
+	else
+	{
+		/* Bluestein: X[k] = c[k] Σ (x[j] c[j]) conj(c[k-j])，c[k] = exp(-πik²/n) */
+		long m = 1;
+		__complex128 *b, *work;
+
+		while (m < 2 * n - 1)
+			m *= 2;
+		pl->sub = fft_plan_new(m);
+		pl->chirp = ALLOC_N(__complex128, n);
+		pl->chirp_fft = ALLOC_N(__complex128, m);
+		for (long k = 0; k < n; k++)
+		{
+			/* k²はmod 2nで整数のまま縮めておく */
+			long k2 = (long)(((unsigned __int128)k * k) % (unsigned long)(2 * n));
+			pl->chirp[k] = fft_twiddle(k2, 2 * n);
+		}
+		b = ALLOC_N(__complex128, 2 * m);
+		work = b + m;
+		for (long k = 0; k < m; k++)
+			b[k] = 0;
+		b[0] = conjq(pl->chirp[0]);
+		for (long k = 1; k < n; k++)
+			b[k] = b[m - k] = conjq(pl->chirp[k]);
+		fft_exec(pl->sub, pl->chirp_fft, b, work);
+		xfree(b);
+	}
+	return pl;
+}
+
+static void
+fft_bfly2(__complex128 *out, long fstride, const struct fft_plan *pl, long m)
+{
+	const __complex128 *tw = pl->tw;
+
+	for (long k = 0; k < m; k++)
+	{
+		__complex128 t = out[k + m] * tw[k * fstride];
+		out[k + m] = out[k] - t;
+		out[k] += t;
+	}
+}
+
+static void
+fft_bfly4(__complex128 *out, long fstride, const struct fft_plan *pl, long m)
+{
+	const __complex128 *tw = pl->tw;
+
+	for (long k = 0; k < m; k++)
+	{
+		__complex128 s0 = out[k + m] * tw[k * fstride];
+		__complex128 s1 = out[k + 2 * m] * tw[2 * k * fstride];
+		__complex128 s2 = out[k + 3 * m] * tw[3 * k * fstride];
+		__complex128 s5 = out[k] - s1;
+		__complex128 s3 = s0 + s2;
+		__complex128 s4 = s0 - s2;
+		__complex128 t;
+
+		out[k] += s1;
+		out[k + 2 * m] = out[k] - s3;
+		out[k] += s3;
+		/* s5 ∓ i s4 */
+		__real__ t = crealq(s5) + cimagq(s4);
+		__imag__ t = cimagq(s5) - crealq(s4);
+		out[k + m] = t;
+		__real__ t = crealq(s5) - cimagq(s4);
+		__imag__ t = cimagq(s5) + crealq(s4);
+		out[k + 3 * m] = t;
+	}
+}
+
+static void
+fft_bfly_generic(__complex128 *out, long fstride, const struct fft_plan *pl, long m, long p)
+{
+	const __complex128 *tw = pl->tw;
+	const long n = pl->n;
+	__complex128 scratch[FFT_MAX_RADIX];
+
+	for (long u = 0; u < m; u++)
+	{
+		for (long q = 0, k = u; q < p; q++, k += m)
+			scratch[q] = out[k];
+		for (long q1 = 0, k = u; q1 < p; q1++, k += m)
+		{
+			long twidx = 0;
+			__complex128 s = scratch[0];
+			for (long q = 1; q < p; q++)
+			{
+				twidx += fstride * k;
+				if (twidx >= n)  twidx -= n;
+				s += scratch[q] * tw[twidx];
+			}
+			out[k] = s;
+		}
+	}
+}
+
+/* 時間間引きの再帰．inをfstride*in_stride刻みで読み，outへ順序どおりに書く */
+static void
+fft_work(const struct fft_plan *pl, __complex128 *out, const __complex128 *in,
+         long fstride, long in_stride, const long *factors)
+{
+	const long p = factors[0], m = factors[1];
+
+	if (m == 1)
+		for (long q = 0; q < p; q++)
+			out[q] = in[q * fstride * in_stride];
+	else
+		for (long q = 0; q < p; q++)
+			fft_work(pl, out + q * m, in + q * fstride * in_stride, fstride * p, in_stride, factors + 2);
+
+	switch (p) {
+	case 2:
+		fft_bfly2(out, fstride, pl, m);
+		break;
+	case 4:
+		fft_bfly4(out, fstride, pl, m);
+		break;
+	default:
+		fft_bfly_generic(out, fstride, pl, m, p);
+		break;
+	}
+}
+
+/*
+ * 順変換 out = DFT(in)．outとinは重なってはならない．
+ * workはBluestein法の計画なら2 * sub->n個，そうでなければ使わない．
+ */
+static void
+fft_exec(const struct fft_plan *pl, __complex128 *out, const __complex128 *in, __complex128 *work)
+{
+	const long n = pl->n;
+
+	if (n <= 1)
+	{
+		if (n == 1)  out[0] = in[0];
+		return;
+	}
+	if (pl->sub == NULL)
+	{
+		fft_work(pl, out, in, 1, 1, pl->factors);
+		return;
+	}
+	else
+	{
+		const long m = pl->sub->n;
+		__complex128 *a = work, *fa = work + m;
+
+		for (long k = 0; k < n; k++)
+			a[k] = in[k] * pl->chirp[k];
+		for (long k = n; k < m; k++)
+			a[k] = 0;
+		fft_exec(pl->sub, fa, a, NULL);
+		/* 畳み込み定理．逆変換は共役を挟んだ順変換で行う */
+		for (long k = 0; k < m; k++)
+			fa[k] = conjq(fa[k] * pl->chirp_fft[k]);
+		fft_exec(pl->sub, a, fa, NULL);
+		for (long k = 0; k < n; k++)
+			out[k] = conjq(a[k]) / m * pl->chirp[k];
+	}
+}
+
+static long
+fft_work_size(const struct fft_plan *pl)
+{
+	return pl->sub != NULL ? 2 * pl->sub->n : 0;
+}
+
+static void
+free_qfft(void *v)
+{
+	struct fft_plan **plp = v;
+	if (plp != NULL)
+	{
+		fft_plan_free(*plp);
+		xfree(plp);
+	}
+}
+
+static size_t
+memsize_qfft(const void *v)
+{
+	struct fft_plan *const *plp = v;
+	return sizeof(struct fft_plan *) + fft_plan_memsize(*plp);
+}
+
+static const rb_data_type_t qfft_data_type = {
+	"quadmath_fft",
+	{0, free_qfft, memsize_qfft,},
+	0, 0,
+	RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static VALUE
+qfft_allocate(VALUE klass)
+{
+	struct fft_plan **plp;
+	VALUE obj = TypedData_Make_Struct(klass, struct fft_plan *, &qfft_data_type, plp);
+	*plp = NULL;
+	return obj;
+}
+
+static struct fft_plan *
+GetFFTPlan(VALUE self)
+{
+	struct fft_plan **plp;
+
+	TypedData_Get_Struct(self, struct fft_plan *, &qfft_data_type, plp);
+
+	if (*plp == NULL)
+		rb_raise(rb_eRuntimeError, "uninitialized FFT plan");
+
+	return *plp;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::FFT.new(n) -> QuadMath::FFT
+ *    QuadMath::FFT.plan(n) -> QuadMath::FFT
+ *
+ *  Returns a plan of discrete Fourier transforms of length +n+.
+ *  The length is factored into radices 4, 2 and small odd primes, and the twiddle factors are computed once in __float128.
+ *  A length with a prime factor larger than 31 is handled by Bluestein's algorithm on a power-of-two length.
+ *  A plan can be used repeatedly, and from several threads at once.
+ *
+ *    QuadMath::FFT.plan(8).size # => 8
+ */
+static VALUE
+qfft_initialize(VALUE self, VALUE size)
+{
+	struct fft_plan **plp;
+	long n = NUM2LONG(size);
+
+	TypedData_Get_Struct(self, struct fft_plan *, &qfft_data_type, plp);
+	if (*plp != NULL)
+		rb_raise(rb_eRuntimeError, "FFT plan already initialized");
+	if (n < 0)
+		rb_raise(rb_eArgError, "negative length");
+	if (n > LONG_MAX / 4 / (long)sizeof(__complex128))
+		rb_raise(rb_eArgError, "length too big");
+
+	*plp = fft_plan_new(n);
+
+	return self;
+}
+
+/*
+ *  call-seq:
+ *    size -> Integer
+ *
+ *  Returns the length of the transform.
+ */
+static VALUE
+qfft_size(VALUE self)
+{
+	return LONG2NUM(GetFFTPlan(self)->n);
+}
+
+struct fft_args {
+	const struct fft_plan *pl;
+	__complex128 *out;
+	const __complex128 *in;
+	__complex128 *work;
+	bool inverse_p;
+};
+
+static void *
+fft_nogvl(void *ptr)
+{
+	struct fft_args *args = ptr;
+	const long n = args->pl->n;
+
+	if (!args->inverse_p)
+		fft_exec(args->pl, args->out, args->in, args->work);
+	else
+	{
+		/* IDFT(x) = conj(DFT(conj(x))) / n */
+		__complex128 *tmp = args->work + fft_work_size(args->pl);
+		for (long k = 0; k < n; k++)
+			tmp[k] = conjq(args->in[k]);
+		fft_exec(args->pl, args->out, tmp, args->work);
+		for (long k = 0; k < n; k++)
+			args->out[k] = conjq(args->out[k]) / n;
+	}
+	return NULL;
+}
+
+static VALUE
+qfft_transform(VALUE self, VALUE x, bool inverse_p)
+{
+	const struct fft_plan *pl = GetFFTPlan(self);
+	struct fft_args args;
+	struct QVector *vx;
+	VALUE y, tmp;
+
+	x = rb_qvector_to_complex(rb_qvector_from(x));
+	vx = GetQVector(x);
+	if (vx->len != pl->n)
+		rb_raise(rb_eArgError, "size mismatch (%ld for %ld)", vx->len, pl->n);
+
+	y = rb_qvector_new(VEC_COMPLEX128, pl->n);
+	args.pl = pl;
+	args.in = vx->data.c128;
+	args.out = GetQVector(y)->data.c128;
+	args.work = ALLOCV_N(__complex128, tmp, fft_work_size(pl) + pl->n + 1);
+	args.inverse_p = inverse_p;
+	quadmath_call_nogvl(fft_nogvl, &args, 16 * pl->n);
+	ALLOCV_END(tmp);
+	RB_GC_GUARD(x);
+	RB_GC_GUARD(self);
+
+	return y;
+}
+
+/*
+ *  call-seq:
+ *    forward(x) -> QuadMath::Vector
+ *
+ *  Returns the discrete Fourier transform <code>X[k] = Σ x[j] exp(-2πijk/n)</code> of +x+ as a complex vector.
+ *  +x+ is a vector or an Array of length #size; a real input is promoted to complex.
+ *
+ *    QuadMath::FFT.plan(4).forward([1, 2, 3, 4]) # => QuadMath::Vector[(10.0+0.0i), (-2.0+2.0i), (-2.0+0.0i), (-2.0-2.0i)]
+ */
+static VALUE
+qfft_forward(VALUE self, VALUE x)
+{
+	return qfft_transform(self, x, false);
+}
+
+/*
+ *  call-seq:
+ *    inverse(x) -> QuadMath::Vector
+ *
+ *  Returns the inverse transform <code>x[j] = Σ X[k] exp(2πijk/n) / n</code>, so that <code>inverse(forward(x))</code> restores +x+.
+ */
+static VALUE
+qfft_inverse(VALUE self, VALUE x)
+{
+	return qfft_transform(self, x, true);
+}
+
+/* 実数入力の変換に使う半分の長さの計画．偶数長のときだけ作る */
+static const struct fft_plan *
+qfft_half_plan(struct fft_plan *pl)
+{
+	if (pl->n % 2 != 0 || pl->n < 2)
+		return NULL;
+	if (pl->half == NULL)
+		pl->half = fft_plan_new(pl->n / 2);
+	return pl->half;
+}
+
+struct rfft_args {
+	const struct fft_plan *pl;
+	const struct fft_plan *half;
+	const __float128 *x;
+	__complex128 *spec;
+	__complex128 *work;
+};
+
+/* 偶数長の実数列を長さn/2の複素数列に詰めて変換し，スペクトルを分離する */
+static void *
+rfft_forward_nogvl(void *ptr)
+{
+	struct rfft_args *args = ptr;
+	const long n = args->pl->n;
+
+	if (args->half == NULL)
+	{
+		__complex128 *z = args->work + fft_work_size(args->pl), *out = z + n;
+		for (long k = 0; k < n; k++)
+			z[k] = args->x[k];
+		fft_exec(args->pl, out, z, args->work);
+		for (long k = 0; k <= n / 2; k++)
+			args->spec[k] = out[k];
+	}
+	else
+	{
+		const long h = n / 2;
+		__complex128 *z = args->work + fft_work_size(args->half), *zf = z + h;
+		for (long j = 0; j < h; j++)
+		{
+			__real__ z[j] = args->x[2 * j];
+			__imag__ z[j] = args->x[2 * j + 1];
+		}
+		fft_exec(args->half, zf, z, args->work);
+		for (long k = 0; k <= h; k++)
+		{
+			__complex128 a = zf[k % h], b = conjq(zf[(h - k) % h]);
+			__complex128 e = (a + b) / 2, o = (a - b) / 2, t;
+			/* o / i */
+			__real__ t = cimagq(o);
+			__imag__ t = -crealq(o);
+			args->spec[k] = e + fft_twiddle(k, n) * t;
+		}
+	}
+	return NULL;
+}
+
+static void *
+rfft_inverse_nogvl(void *ptr)
+{
+	struct rfft_args *args = ptr;
+	const long n = args->pl->n;
+	__float128 *x = (__float128 *)args->x;
+
+	if (args->half == NULL)
+	{
+		/* エルミート対称に広げて逆変換する */
+		__complex128 *z = args->work + fft_work_size(args->pl), *out = z + n;
+		for (long k = 0; k <= n / 2; k++)
+			z[k] = conjq(args->spec[k]);
+		for (long k = n / 2 + 1; k < n; k++)
+			z[k] = args->spec[n - k];
+		fft_exec(args->pl, out, z, args->work);
+		for (long k = 0; k < n; k++)
+			x[k] = crealq(out[k]) / n;
+	}
+	else
+	{
+		const long h = n / 2;
+		__complex128 *z = args->work + fft_work_size(args->half), *zt = z + h;
+		for (long k = 0; k < h; k++)
+		{
+			__complex128 a = args->spec[k], b = conjq(args->spec[h - k]);
+			__complex128 e = (a + b) / 2, o = (a - b) / 2 * conjq(fft_twiddle(k, n)), t;
+			/* Z = E + iO を共役にして順変換に渡す */
+			__real__ t = crealq(e) - cimagq(o);
+			__imag__ t = cimagq(e) + crealq(o);
+			z[k] = conjq(t);
+		}
+		fft_exec(args->half, zt, z, args->work);
+		for (long j = 0; j < h; j++)
+		{
+			x[2 * j] = crealq(zt[j]) / h;
+			x[2 * j + 1] = -cimagq(zt[j]) / h;
+		}
+	}
+	return NULL;
+}
+
+/*
+ *  call-seq:
+ *    rforward(x) -> QuadMath::Vector
+ *
+ *  Returns the first <code>n / 2 + 1</code> terms of the transform of the real sequence +x+ of length #size;
+ *  the rest follows from the Hermitian symmetry.
+ *  For an even length, the input is packed into a complex transform of half the length.
+ *
+ *    QuadMath::FFT.plan(4).rforward([1, 2, 3, 4]) # => QuadMath::Vector[(10.0+0.0i), (-2.0+2.0i), (-2.0+0.0i)]
+ */
+static VALUE
+qfft_rforward(VALUE self, VALUE x)
+{
+	struct fft_plan *pl = GetFFTPlan(self);
+	struct rfft_args args;
+	struct QVector *vx;
+	VALUE y, tmp;
+
+	x = rb_qvector_from(x);
+	vx = GetQVector(x);
+	if (vx->type != VEC_FLOAT128)
+		rb_raise(rb_eTypeError, "not a real vector");
+	if (vx->len != pl->n)
+		rb_raise(rb_eArgError, "size mismatch (%ld for %ld)", vx->len, pl->n);
+
+	y = rb_qvector_new(VEC_COMPLEX128, pl->n / 2 + (pl->n > 0));
+	args.pl = pl;
+	args.half = qfft_half_plan(pl);
+	args.x = vx->data.f128;
+	args.spec = GetQVector(y)->data.c128;
+	args.work = ALLOCV_N(__complex128, tmp, fft_work_size(args.half ? args.half : pl) + 2 * pl->n + 1);
+	if (pl->n > 0)
+		quadmath_call_nogvl(rfft_forward_nogvl, &args, 8 * pl->n);
+	ALLOCV_END(tmp);
+	RB_GC_GUARD(x);
+
+	return y;
+}
+
+/*
+ *  call-seq:
+ *    rinverse(spec) -> QuadMath::Vector
+ *
+ *  Returns the real sequence of length #size whose transform begins with +spec+ of <code>n / 2 + 1</code> terms.
+ *  This is the inverse of #rforward.
+ *
+ *    QuadMath::FFT.plan(4).rinverse([10, -2+2i, -2]) # => QuadMath::Vector[1.0, 2.0, 3.0, 4.0]
+ */
+static VALUE
+qfft_rinverse(VALUE self, VALUE spec)
+{
+	struct fft_plan *pl = GetFFTPlan(self);
+	struct rfft_args args;
+	struct QVector *vs;
+	long len = pl->n / 2 + (pl->n > 0);
+	VALUE y, tmp;
+
+	spec = rb_qvector_to_complex(rb_qvector_from(spec));
+	vs = GetQVector(spec);
+	if (vs->len != len)
+		rb_raise(rb_eArgError, "size mismatch (%ld for %ld)", vs->len, len);
+
+	y = rb_qvector_new(VEC_FLOAT128, pl->n);
+	args.pl = pl;
+	args.half = qfft_half_plan(pl);
+	args.x = GetQVector(y)->data.f128;
+	args.spec = vs->data.c128;
+	args.work = ALLOCV_N(__complex128, tmp, fft_work_size(args.half ? args.half : pl) + 2 * pl->n + 1);
+	if (pl->n > 0)
+		quadmath_call_nogvl(rfft_inverse_nogvl, &args, 8 * pl->n);
+	ALLOCV_END(tmp);
+	RB_GC_GUARD(spec);
+
+	return y;
+}
+
+/*
+ *  call-seq:
+ *    inspect -> String
+ *
+ *  Returns the length and the factorization of the plan.
+ */
+static VALUE
+qfft_inspect(VALUE self)
+{
+	const struct fft_plan *pl = GetFFTPlan(self);
+	VALUE str = rb_sprintf("#<%"PRIsVALUE" n=%ld", rb_obj_class(self), pl->n);
+
+	if (pl->sub != NULL)
+		rb_str_catf(str, " bluestein=%ld", pl->sub->n);
+	else if (pl->n > 1)
+	{
+		rb_str_cat2(str, " radix=");
+		for (long i = 0; ; i += 2)
+		{
+			rb_str_catf(str, i ? "x%ld" : "%ld", pl->factors[i]);
+			if (pl->factors[i + 1] == 1)
+				break;
+		}
+	}
+	rb_str_cat2(str, ">");
+
+	return str;
+}
+
+/*
+ * 畳み込み．全長na + nb - 1の結果のうち[lo, lo + len)の区間を求める．
+ * 短い列は定義どおり直接和をとり，長い列は零を詰めてFFTで積をとる．
+ */
+enum CONVOLVE_METHODS {
+	CONV_AUTO,
+	CONV_DIRECT,
+	CONV_FFT
+};
+
+struct conv_args {
+	bool complex_p;
+	long na, nb;
+	const void *a, *b;
+	long lo, len;
+	void *out;
+	const struct fft_plan *pl;
+	__complex128 *work;
+	long pos;
+};
+
+/* FFTによる畳み込みの一点あたりの手間を直接和の積和何回分とみるか */
+#define FFT_CONVOLVE_COST 12.0
+
+/*
+ * n以上で2^k，3 * 2^k，5 * 2^kのいずれかの形の最小の長さ．
+ * 3と5は汎用のバタフライで遅いので，高々一段に留める．
+ */
+static long
+fft_good_size(long n)
+{
+	long best = 1;
+
+	while (best < n)
+		best *= 2;
+	for (long p = 3; p <= 5; p += 2)
+	{
+		long m = p;
+		while (m < n)
+			m *= 2;
+		if (m < best)
+			best = m;
+	}
+	return best;
+}
+
+static void *
+convolve_direct_nogvl(void *ptr)
+{
+	struct conv_args *args = ptr;
+	const long na = args->na, nb = args->nb;
+
+	for (; args->pos < args->len; args->pos++)
+	{
+		const long i = args->pos, k = args->lo + i;
+		if (i % NOGVL_POLL_STRIDE == 0 && quadmath_interrupted_p())
+			return QUADMATH_INTERRUPTED;
+		const long j0 = k - nb + 1 > 0 ? k - nb + 1 : 0, j1 = k < na - 1 ? k : na - 1;
+		if (!args->complex_p)
+		{
+			const __float128 *a = args->a, *b = args->b;
+			__float128 s = 0;
+			for (long j = j0; j <= j1; j++)
+				s += a[j] * b[k - j];
+			((__float128 *)args->out)[i] = s;
+		}
+		else
+		{
+			const __complex128 *a = args->a, *b = args->b;
+			__complex128 s = 0;
+			for (long j = j0; j <= j1; j++)
+				s += a[j] * b[k - j];
+			((__complex128 *)args->out)[i] = s;
+		}
+	}
+	return NULL;
+}
+
+static void *
+convolve_fft_nogvl(void *ptr)
+{
+	struct conv_args *args = ptr;
+	const struct fft_plan *pl = args->pl;
+	const long m = pl->n, na = args->na, nb = args->nb;
+	/* fft_good_sizeの長さはBluestein法を使わないので，作業領域は要らない */
+	__complex128 *z = args->work, *zf = z + m;
+
+	if (!args->complex_p)
+	{
+		/* 二つの実数列を実部と虚部に詰めて一度に変換する */
+		const __float128 *a = args->a, *b = args->b;
+		__float128 *out = args->out;
+
+		for (long k = 0; k < m; k++)
+		{
+			__real__ z[k] = k < na ? a[k] : 0;
+			__imag__ z[k] = k < nb ? b[k] : 0;
+		}
+		fft_exec(pl, zf, z, NULL);
+		/* A[k] B[k] = (Z[k]² - conj(Z[-k])²) / 4i．逆変換のため共役をとっておく */
+		for (long k = 0; k < m; k++)
+		{
+			__complex128 p = zf[k], q = conjq(zf[(m - k) % m]), t = (p * p - q * q) / 4;
+			__real__ z[k] = cimagq(t);
+			__imag__ z[k] = crealq(t);
+		}
+		fft_exec(pl, zf, z, NULL);
+		for (long i = 0; i < args->len; i++)
+			out[i] = crealq(zf[args->lo + i]) / m;
+	}
+	else
+	{
+		const __complex128 *a = args->a, *b = args->b;
+		__complex128 *out = args->out, *bf = zf + m;
+
+		for (long k = 0; k < m; k++)
+			z[k] = k < nb ? b[k] : 0;
+		fft_exec(pl, bf, z, NULL);
+		for (long k = 0; k < m; k++)
+			z[k] = k < na ? a[k] : 0;
+		fft_exec(pl, zf, z, NULL);
+		for (long k = 0; k < m; k++)
+			z[k] = conjq(zf[k] * bf[k]);
+		fft_exec(pl, zf, z, NULL);
+		for (long i = 0; i < args->len; i++)
+			out[i] = conjq(zf[args->lo + i]) / m;
+	}
+	return NULL;
+}
+
+static VALUE
+quadmath_convolve_common(VALUE a, VALUE b, VALUE opts, bool correlate_p)
+{
+	static ID kwds[2];
+	VALUE vals[2] = {Qundef, Qundef}, y, tmp = 0;
+	enum CONVOLVE_METHODS meth = CONV_AUTO;
+	struct QVector *va, *vb;
+	struct conv_args args;
+	long na, nb, nmin, nmax, m = 0;
+	ID id;
+
+	if (!kwds[0])
+	{
+		kwds[0] = rb_intern_const("mode");
+		kwds[1] = rb_intern_const("method");
+	}
+	if (!NIL_P(opts))
+		rb_get_kwargs(opts, kwds, 0, 2, vals);
+
+	a = rb_qvector_from(a);
+	b = rb_qvector_from(b);
+	if (GetQVector(a)->type == VEC_COMPLEX128 || GetQVector(b)->type == VEC_COMPLEX128)
+	{
+		a = rb_qvector_to_complex(a);
+		b = rb_qvector_to_complex(b);
+	}
+	va = GetQVector(a);
+	vb = GetQVector(b);
+	na = va->len;
+	nb = vb->len;
+	if (na == 0 || nb == 0)
+		rb_raise(rb_eArgError, "empty sequence");
+	if (na > LONG_MAX / 8 / (long)sizeof(__complex128) - nb)
+		rb_raise(rb_eArgError, "sequence too long");
+	nmin = na < nb ? na : nb;
+	nmax = na < nb ? nb : na;
+
+	if (correlate_p)
+	{
+		/* c[k] = Σ a[j + k] conj(b[j]) は共役を反転した列との畳み込み */
+		VALUE rb = rb_qvector_new(vb->type, nb);
+		struct QVector *vr = GetQVector(rb);
+		for (long j = 0; j < nb; j++)
+		{
+			if (vb->type == VEC_FLOAT128)
+				vr->data.f128[j] = vb->data.f128[nb - 1 - j];
+			else
+				vr->data.c128[j] = conjq(vb->data.c128[nb - 1 - j]);
+		}
+		b = rb;
+		vb = GetQVector(b);
+	}
+
+	id = vals[0] == Qundef ? (correlate_p ? rb_intern("valid") : rb_intern("full")) : rb_sym2id(vals[0]);
+	if (id == rb_intern("full"))
+	{
+		args.lo = 0;
+		args.len = na + nb - 1;
+	}
+	else if (id == rb_intern("same"))
+	{
+		args.lo = (nmin - 1) / 2;
+		args.len = nmax;
+	}
+	else if (id == rb_intern("valid"))
+	{
+		args.lo = nmin - 1;
+		args.len = nmax - nmin + 1;
+	}
+	else
+		rb_raise(rb_eArgError, "unknown mode: %"PRIsVALUE, vals[0]);
+
+	if (vals[1] != Qundef)
+	{
+		id = rb_sym2id(vals[1]);
+		if (id == rb_intern("direct"))
+			meth = CONV_DIRECT;
+		else if (id == rb_intern("fft"))
+			meth = CONV_FFT;
+		else if (id != rb_intern("auto"))
+			rb_raise(rb_eArgError, "unknown method: %"PRIsVALUE, vals[1]);
+	}
+	if (meth == CONV_AUTO)
+	{
+		/*
+		 * 直接和は出力一項あたり高々nmin回の積和で，複素数ではその4倍．
+		 * FFTは実数なら長さmの変換が2回，複素数なら3回．
+		 */
+		const bool complex_p = va->type == VEC_COMPLEX128;
+		double direct = (double)nmin * args.len * (complex_p ? 4 : 1);
+		double fast;
+		m = fft_good_size(na + nb - 1);
+		fast = FFT_CONVOLVE_COST * m * log2((double)m) * (complex_p ? 1.5 : 1);
+		meth = nmin > 16 && fast < direct ? CONV_FFT : CONV_DIRECT;
+	}
+
+	args.complex_p = va->type == VEC_COMPLEX128;
+	args.na = na;
+	args.nb = nb;
+	args.a = va->data.ptr;
+	args.b = vb->data.ptr;
+	y = rb_qvector_new(va->type, args.len);
+	args.out = GetQVector(y)->data.ptr;
+	args.pl = NULL;
+	args.work = NULL;
+	args.pos = 0;
+
+	if (meth == CONV_DIRECT)
+		quadmath_call_nogvl(convolve_direct_nogvl, &args, nmin * args.len);
+	else
+	{
+		VALUE plan;
+		if (m == 0)
+			m = fft_good_size(na + nb - 1);
+		args.work = ALLOCV_N(__complex128, tmp, 3 * m);
+		/* 割り込みで例外になってもGCが解放するように，計画はオブジェクトに包んでおく */
+		plan = rb_class_new_instance(1, (VALUE []){LONG2NUM(m)}, rb_cQuadFFT);
+		args.pl = GetFFTPlan(plan);
+		quadmath_call_nogvl(convolve_fft_nogvl, &args, 16 * m);
+		ALLOCV_END(tmp);
+		RB_GC_GUARD(plan);
+	}
+	RB_GC_GUARD(a);
+	RB_GC_GUARD(b);
+
+	return y;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.convolve(a, b, mode: :full, method: :auto) -> QuadMath::Vector
+ *
+ *  Returns the discrete convolution <code>c[k] = Σ a[j] b[k - j]</code> of two sequences.
+ *  +a+ and +b+ are vectors or Arrays; the result is complex if either of them is complex.
+ *  +mode+ selects the part of the full result of length <code>a.size + b.size - 1</code>:
+ *  +:full+, +:same+ (the centered <code>max(a.size, b.size)</code> terms) or +:valid+ (the terms where the sequences overlap completely).
+ *  With <code>method: :auto</code>, short kernels are summed directly and long ones are multiplied in the frequency domain by QuadMath::FFT;
+ *  +:direct+ or +:fft+ forces either way.
+ *  The error of the FFT method is bounded relative to the norms of the inputs rather than to each term.
+ *
+ *    QuadMath.convolve([1, 2, 3], [0, 1, 0.5]) # => QuadMath::Vector[0.0, 1.0, 2.5, 4.0, 1.5]
+ *    QuadMath.convolve([1, 2, 3], [0, 1, 0.5], mode: :same) # => QuadMath::Vector[1.0, 2.5, 4.0]
+ */
+static VALUE
+quadmath_convolve(int argc, VALUE *argv, VALUE unused_obj)
+{
+	VALUE a, b, opts;
+
+	rb_scan_args(argc, argv, "2:", &a, &b, &opts);
+
+	return quadmath_convolve_common(a, b, opts, false);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.correlate(a, v, mode: :valid, method: :auto) -> QuadMath::Vector
+ *
+ *  Returns the cross-correlation <code>c[k] = Σ a[j + k] conj(v[j])</code> of two sequences,
+ *  which is the convolution of +a+ with +v+ reversed and conjugated.
+ *  The keywords are the same as QuadMath.convolve, except that +mode+ defaults to +:valid+.
+ *
+ *    QuadMath.correlate([1, 2, 3], [0, 1, 0.5]) # => QuadMath::Vector[3.5]
+ *    QuadMath.correlate([1, 2, 3], [0, 1, 0.5], mode: :full) # => QuadMath::Vector[0.5, 2.0, 3.5, 3.0, 0.0]
+ */
+static VALUE
+quadmath_correlate(int argc, VALUE *argv, VALUE unused_obj)
+{
+	VALUE a, v, opts;
+
+	rb_scan_args(argc, argv, "2:", &a, &v, &opts);
+
+	return quadmath_convolve_common(a, v, opts, true);
+}
+
+void
+InitVM_FFT(void)
+{
+	rb_define_alloc_func(rb_cQuadFFT, qfft_allocate);
+	rb_define_singleton_method(rb_cQuadFFT, "plan", rb_class_new_instance_pass_kw, -1);
+	rb_define_method(rb_cQuadFFT, "initialize", qfft_initialize, 1);
+	rb_undef_method(rb_cQuadFFT, "initialize_copy");
+
+	rb_define_method(rb_cQuadFFT, "size", qfft_size, 0);
+	rb_define_method(rb_cQuadFFT, "forward", qfft_forward, 1);
+	rb_define_method(rb_cQuadFFT, "inverse", qfft_inverse, 1);
+	rb_define_method(rb_cQuadFFT, "rforward", qfft_rforward, 1);
+	rb_define_method(rb_cQuadFFT, "rinverse", qfft_rinverse, 1);
+	rb_define_method(rb_cQuadFFT, "inspect", qfft_inspect, 0);
+	rb_define_alias(rb_cQuadFFT, "to_s", "inspect");
+
+	rb_define_module_function(rb_mQuadMath, "convolve", quadmath_convolve, -1);
+	rb_define_module_function(rb_mQuadMath, "correlate", quadmath_correlate, -1);
+}
@@ -345,14 +345,46 @@ float128_to_f(VALUE self)
  *  call-seq:
  *    to_f128 -> Float128
  *  
- *  常に+self+を返す．
+ *  +self+を返す．
+ *  QuadMath::Vector#each_valueが使い回す凍結していないオブジェクトならば，同じ値の新しいFloat128を返す．
  */
 static VALUE
 float128_to_f128(VALUE self)
 {
+	if (!RB_OBJ_FROZEN(self))
+		return rb_float128_cf128(GetF128(self));
 	return self;
 }
 
+/*
+ *  call-seq:
+ *    nonzero? -> self | nil
+ *  
+ *  +self+が0ならnilを，そうでないなら+self+を返す．
+ *  to_f128と同じく，使い回すオブジェクトならば新しいFloat128を返す．
+ */
+static VALUE
+float128_nonzero_p(VALUE self)
+{
+	if (GetF128(self) == 0)
+		return Qnil;
+	return float128_to_f128(self);
+}
+
+/*
+ *  call-seq:
+ *    clone(freeze: true) -> Float128
+ *  
+ *  +self+を返す．to_f128と同じく，使い回すオブジェクトならば新しいFloat128を返す．
+ */
+static VALUE
+float128_clone(int argc, VALUE *argv, VALUE self)
+{
+	if (!RB_OBJ_FROZEN(self))
+		return float128_to_f128(self);
+	return rb_call_super(argc, argv);
+}
+
 /*
  *  call-seq:
  *    to_c128 -> Complex128
@@ -588,6 +620,15 @@ InitVM_Float128(void)
 
 	rb_define_method(rb_cFloat128, "to_f", float128_to_f, 0);
 	rb_define_method(rb_cFloat128, "to_f128", float128_to_f128, 0);
+	/* NumericやKernelでselfを返すメソッドも，使い回すオブジェクトを外に出さないようto_f128に揃える */
+	rb_define_method(rb_cFloat128, "+@", float128_to_f128, 0);
+	rb_define_method(rb_cFloat128, "real", float128_to_f128, 0);
+	rb_define_method(rb_cFloat128, "conj", float128_to_f128, 0);
+	rb_define_method(rb_cFloat128, "conjugate", float128_to_f128, 0);
+	rb_define_method(rb_cFloat128, "itself", float128_to_f128, 0);
+	rb_define_method(rb_cFloat128, "dup", float128_to_f128, 0);
+	rb_define_method(rb_cFloat128, "clone", float128_clone, -1);
+	rb_define_method(rb_cFloat128, "nonzero?", float128_nonzero_p, 0);
 
 	rb_define_method(rb_cFloat128, "to_i", float128_to_i, 0);
 	
@@ -629,6 +670,18 @@ rb_float128_cf128(const __float128 x)
 	return obj;
 }
 
+/*
+ * 要素を順に表すために使い回すFloat128．凍結せずに返し，値の置き場所を*ptrに返す．
+ * 呼び出し側はその場所を書き換えてからyieldする．
+ */
+VALUE
+rb_float128_flyweight(__float128 **ptr)
+{
+	struct F128 *f128 = ruby_xcalloc(1, sizeof(struct F128));
+	*ptr = &f128->value;
+	return TypedData_Wrap_Struct(rb_cFloat128, &float128_data_type, f128);
+}
+
 __float128
 rb_float128_value(VALUE x)
 {
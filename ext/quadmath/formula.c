@@ -0,0 +1,1624 @@
+/*******************************************************************************
+    formula.c -- QuadMath::Formula and QuadMath::Vector::Lazy Classes
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <ctype.h>
+#include <quadmath.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+/* 評価の作業域の深さの上限．作業域は評価するスレッドのスタックに置く */
+#define FORMULA_MAX_DEPTH 256
+
+/* 遅延評価の式の命令数の上限．部分式は共有せずに複製するので，式どうしの演算を重ねると倍々に増える */
+#define LAZY_MAX_INSNS 65536
+
+/* 並列に評価するときの一区間の要素数 */
+#define FORMULA_GRAIN 1024
+
+/*
+ * ベクトルで評価するときは，命令ごとにFORMULA_BLOCK個の要素をまとめて計算する．
+ * 中間の値はスタックの段ごとに作業域の一行に置き，作業域全体がL1に収まるようにする．
+ */
+#define FORMULA_BLOCK 256
+#define FORMULA_BLOCK_WORK (FORMULA_BLOCK * 8)
+
+/*
+ * 後置記法の命令列．値は__float128のスタックに積み，中間の結果にRubyのオブジェクトを作らない．
+ * 作った後は書き換えないので，GVLを解放して評価してよい．
+ */
+enum FORMULA_OPS {
+	FOP_CONST,
+	FOP_VAR,
+	FOP_NEG,
+	FOP_ADD,
+	FOP_SUB,
+	FOP_MUL,
+	FOP_DIV,
+	FOP_MOD,
+	FOP_POW,
+	FOP_SQUARE,
+	FOP_FUNC1,
+	FOP_FUNC2,
+	FOP_FMA
+};
+
+struct formula_insn {
+	enum FORMULA_OPS op;
+	int arg;
+};
+
+struct QFormula {
+	long ninsns;
+	struct formula_insn *code;
+	long nconsts;
+	__float128 *consts;
+	long nvars;
+	ID *vars;
+	int depth;
+	char *source;
+};
+
+static const struct {
+	const char *name;
+	__float128 (*func)(__float128);
+} formula_func1[] = {
+	{ "exp", expq }, { "exp2", exp2q }, { "expm1", expm1q },
+	{ "log", logq }, { "log2", log2q }, { "log10", log10q }, { "log1p", log1pq },
+	{ "sqrt", sqrtq }, { "cbrt", cbrtq },
+	{ "sin", sinq }, { "cos", cosq }, { "tan", tanq },
+	{ "asin", asinq }, { "acos", acosq }, { "atan", atanq },
+	{ "sinh", sinhq }, { "cosh", coshq }, { "tanh", tanhq },
+	{ "asinh", asinhq }, { "acosh", acoshq }, { "atanh", atanhq },
+	{ "erf", erfq }, { "erfc", erfcq }, { "lgamma", lgammaq }, { "gamma", tgammaq },
+	{ "j0", j0q }, { "j1", j1q }, { "y0", y0q }, { "y1", y1q },
+	{ "abs", fabsq },
+};
+
+static const struct {
+	const char *name;
+	__float128 (*func)(__float128, __float128);
+} formula_func2[] = {
+	{ "atan2", atan2q }, { "hypot", hypotq }, { "pow", powq },
+};
+
+#define numberof(ary) ((int)(sizeof(ary) / sizeof((ary)[0])))
+
+static void
+free_qformula(void *v)
+{
+	struct QFormula *f = v;
+	if (f != NULL)
+	{
+		xfree(f->code);
+		xfree(f->consts);
+		xfree(f->vars);
+		xfree(f->source);
+		xfree(f);
+	}
+}
+
+static size_t
+memsize_qformula(const void *v)
+{
+	const struct QFormula *f = v;
+	return sizeof(struct QFormula) + sizeof(struct formula_insn) * f->ninsns +
+		sizeof(__float128) * f->nconsts + sizeof(ID) * f->nvars;
+}
+
+static const rb_data_type_t qformula_data_type = {
+	"quadmath_formula",
+	{0, free_qformula, memsize_qformula,},
+	0, 0,
+	RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static VALUE
+qformula_allocate(VALUE klass)
+{
+	struct QFormula *f;
+	VALUE obj = TypedData_Make_Struct(klass, struct QFormula, &qformula_data_type, f);
+	f->ninsns = f->nconsts = f->nvars = 0;
+	f->code = NULL;
+	f->consts = NULL;
+	f->vars = NULL;
+	f->depth = 0;
+	f->source = NULL;
+	return obj;
+}
+
+static struct QFormula *
+GetQFormula(VALUE self)
+{
+	struct QFormula *f;
+
+	TypedData_Get_Struct(self, struct QFormula, &qformula_data_type, f);
+
+	if (f->code == NULL)
+		rb_raise(rb_eRuntimeError, "uninitialized formula");
+
+	return f;
+}
+
+/* Float#%と同じく，剰余の符号は除数に合わせる */
+static inline __float128
+formula_modulo(__float128 x, __float128 y)
+{
+	__float128 r = fmodq(x, y);
+
+	if (r != 0 && signbitq(r) != signbitq(y))
+		r += y;
+	return r;
+}
+
+/*
+ * 定数と変数を除く命令を実行する．spは積まれた値の次を指し，実行後のspを返す．
+ * 加減乗算はFloat128の演算子とビット単位で同じ整数のカーネルで行う．
+ */
+static inline __float128 *
+formula_apply(const struct formula_insn *in, __float128 *sp)
+{
+	switch (in->op) {
+	case FOP_NEG:
+		sp[-1] = -sp[-1];
+		break;
+	case FOP_ADD:
+		sp[-2] = add_q(sp[-2], sp[-1]);
+		sp--;
+		break;
+	case FOP_SUB:
+		sp[-2] = sub_q(sp[-2], sp[-1]);
+		sp--;
+		break;
+	case FOP_MUL:
+		sp[-2] = mul_q(sp[-2], sp[-1]);
+		sp--;
+		break;
+	case FOP_DIV:
+		sp[-2] = sp[-2] / sp[-1];
+		sp--;
+		break;
+	case FOP_MOD:
+		sp[-2] = formula_modulo(sp[-2], sp[-1]);
+		sp--;
+		break;
+	case FOP_POW:
+		sp[-2] = powq(sp[-2], sp[-1]);
+		sp--;
+		break;
+	case FOP_SQUARE:
+		sp[-1] = mul_q(sp[-1], sp[-1]);
+		break;
+	case FOP_FUNC1:
+		sp[-1] = formula_func1[in->arg].func(sp[-1]);
+		break;
+	case FOP_FUNC2:
+		sp[-2] = formula_func2[in->arg].func(sp[-2], sp[-1]);
+		sp--;
+		break;
+	case FOP_FMA:
+		sp[-3] = fma_q(sp[-3], sp[-2], sp[-1]);
+		sp -= 2;
+		break;
+	case FOP_CONST:
+	case FOP_VAR:
+		break;
+	}
+	return sp;
+}
+
+/*
+ * 変数に束縛する値．数ならばscalarを指してstrideを0とし，ベクトルならば要素を順に指す．
+ */
+struct formula_binding {
+	VALUE val;
+	const __float128 *ptr;
+	long stride;
+	__float128 scalar;
+};
+
+static inline int
+formula_nargs(enum FORMULA_OPS op)
+{
+	switch (op) {
+	case FOP_CONST:
+	case FOP_VAR:
+		return 0;
+	case FOP_NEG:
+	case FOP_SQUARE:
+	case FOP_FUNC1:
+		return 1;
+	case FOP_FMA:
+		return 3;
+	default:
+		return 2;
+	}
+}
+
+/*
+ * i番目の要素について命令列codeを評価する．変数kの値は b[k].ptr[i * b[k].stride] である．
+ */
+static __float128
+formula_exec(const struct formula_insn *code, long ninsns, const __float128 *consts,
+             const struct formula_binding *b, long i)
+{
+	__float128 stack[FORMULA_MAX_DEPTH], *sp = stack;
+
+	for (long pc = 0; pc < ninsns; pc++)
+	{
+		const struct formula_insn *in = &code[pc];
+		switch (in->op) {
+		case FOP_CONST:
+			*sp++ = consts[in->arg];
+			break;
+		case FOP_VAR:
+			*sp++ = b[in->arg].ptr[i * b[in->arg].stride];
+			break;
+		default:
+			sp = formula_apply(in, sp);
+			break;
+		}
+	}
+	return stack[0];
+}
+
+struct formula_operand {
+	const __float128 *ptr;
+	long stride;
+};
+
+/*
+ * 定数と変数を除く命令をn個の要素について実行し，wに書く．引数はa[0]から順に並ぶ．
+ * wは引数と同じ場所でもよい．計算はformula_apply()と同じである．
+ */
+static void
+formula_apply_block(const struct formula_insn *in, const struct formula_operand *a, __float128 *w, long n)
+{
+#define OPD(k) a[k].ptr[i * a[k].stride]
+	switch (in->op) {
+	case FOP_NEG:
+		for (long i = 0; i < n; i++)
+			w[i] = -OPD(0);
+		break;
+	case FOP_ADD:
+		for (long i = 0; i < n; i++)
+			w[i] = add_q(OPD(0), OPD(1));
+		break;
+	case FOP_SUB:
+		for (long i = 0; i < n; i++)
+			w[i] = sub_q(OPD(0), OPD(1));
+		break;
+	case FOP_MUL:
+		for (long i = 0; i < n; i++)
+			w[i] = mul_q(OPD(0), OPD(1));
+		break;
+	case FOP_DIV:
+		for (long i = 0; i < n; i++)
+			w[i] = OPD(0) / OPD(1);
+		break;
+	case FOP_MOD:
+		for (long i = 0; i < n; i++)
+			w[i] = formula_modulo(OPD(0), OPD(1));
+		break;
+	case FOP_POW:
+		for (long i = 0; i < n; i++)
+			w[i] = powq(OPD(0), OPD(1));
+		break;
+	case FOP_SQUARE:
+		for (long i = 0; i < n; i++)
+			w[i] = mul_q(OPD(0), OPD(0));
+		break;
+	case FOP_FUNC1:
+		for (long i = 0; i < n; i++)
+			w[i] = formula_func1[in->arg].func(OPD(0));
+		break;
+	case FOP_FUNC2:
+		for (long i = 0; i < n; i++)
+			w[i] = formula_func2[in->arg].func(OPD(0), OPD(1));
+		break;
+	case FOP_FMA:
+		for (long i = 0; i < n; i++)
+			w[i] = fma_q(OPD(0), OPD(1), OPD(2));
+		break;
+	case FOP_CONST:
+	case FOP_VAR:
+		break;
+	}
+#undef OPD
+}
+
+/*
+ * i0番目からn個の要素について命令列codeを評価し，yに書く．depthは命令列のスタックの深さである．
+ * FORMULA_BLOCK個ずつ命令を順に実行するので，命令の解釈は要素ごとでなくブロックごとに一度で済む．
+ * スタックの最下段はyに直接書き，他の段には作業域の一行を当てる．変数と定数は元の場所を指すだけで写さない．
+ */
+static void
+formula_exec_block(const struct formula_insn *code, long ninsns, const __float128 *consts,
+                   const struct formula_binding *b, int depth, long i0, long n, __float128 *y)
+{
+	__float128 work[FORMULA_BLOCK_WORK];
+	struct formula_operand st[FORMULA_MAX_DEPTH];
+	const long m = depth - 1 <= FORMULA_BLOCK_WORK / FORMULA_BLOCK ?
+		FORMULA_BLOCK : FORMULA_BLOCK_WORK / (depth - 1);
+
+	for (long j = 0; j < n; j += m)
+	{
+		const long len = n - j < m ? n - j : m;
+		int sp = 0;
+
+		for (long pc = 0; pc < ninsns; pc++)
+		{
+			const struct formula_insn *in = &code[pc];
+			switch (in->op) {
+			case FOP_CONST:
+				st[sp].ptr = &consts[in->arg];
+				st[sp++].stride = 0;
+				break;
+			case FOP_VAR:
+				st[sp].ptr = b[in->arg].ptr + (i0 + j) * b[in->arg].stride;
+				st[sp++].stride = b[in->arg].stride;
+				break;
+			default:
+			{
+				const int k = sp - formula_nargs(in->op);
+				__float128 *w = k == 0 ? y + j : work + (k - 1) * m;
+				formula_apply_block(in, st + k, w, len);
+				st[k].ptr = w;
+				st[k].stride = 1;
+				sp = k + 1;
+				break;
+			}
+			}
+		}
+		if (st[0].ptr != y + j)
+			for (long i = 0; i < len; i++)
+				y[j + i] = st[0].ptr[i * st[0].stride];
+	}
+}
+
+/*
+ * ベクトルで評価する前に，数だけに束縛された変数と定数からなる部分式を一度だけ計算して定数に置き換える．
+ * 後置記法では部分式は連続した命令の並びなので，スタックの各値がどこから始まるか(start)と
+ * 要素によらないか(uniform)を追い，要素による値と組み合わされるところで要素によらない側を畳む．
+ * codeとconstsには元の命令と定数を写して使い，増えた定数の数をnconstsに返す．命令数を返す．
+ */
+static long
+formula_hoist(const struct QFormula *f, const struct formula_binding *b,
+              struct formula_insn *code, __float128 *consts, long *nconsts,
+              long *start, bool *uniform)
+{
+	long n = 0;
+	int sp = 0;
+
+	memcpy(consts, f->consts, sizeof(__float128) * f->nconsts);
+	*nconsts = f->nconsts;
+	for (long pc = 0; pc < f->ninsns; pc++)
+	{
+		const struct formula_insn in = f->code[pc];
+		const int nargs = formula_nargs(in.op);
+		bool all = true;
+
+		for (int k = sp - nargs; k < sp; k++)
+			all = all && uniform[k];
+		if (nargs == 0)
+			all = in.op == FOP_CONST || b[in.arg].stride == 0;
+		else if (!all)
+		{
+			for (int k = sp - 1; k >= sp - nargs; k--)
+			{
+				const long end = k == sp - 1 ? n : start[k + 1], shrink = end - start[k] - 1;
+				if (!uniform[k] || shrink == 0)
+					continue;
+				consts[*nconsts] = formula_exec(code + start[k], end - start[k], consts, b, 0);
+				code[start[k]] = (struct formula_insn){ FOP_CONST, (int)(*nconsts)++ };
+				memmove(code + start[k] + 1, code + end, sizeof(struct formula_insn) * (n - end));
+				n -= shrink;
+				for (int j = k + 1; j < sp; j++)
+					start[j] -= shrink;
+			}
+		}
+		sp -= nargs;
+		if (nargs == 0)
+			start[sp] = n;
+		uniform[sp++] = all;
+		code[n++] = in;
+	}
+	if (uniform[0] && n > 1)
+	{
+		consts[*nconsts] = formula_exec(code, n, consts, b, 0);
+		code[0] = (struct formula_insn){ FOP_CONST, (int)(*nconsts)++ };
+		n = 1;
+	}
+	return n;
+}
+
+/*
+ * 再帰下降の構文解析器．文法はRubyの式に合わせる．
+ *
+ *   expr    := term (('+' | '-') term)*
+ *   term    := unary (('*' | '/' | '%') unary)*
+ *   unary   := ('-' | '+') unary | power
+ *   power   := primary ('**' unary)?
+ *   primary := number | constant | variable | function '(' expr (',' expr)* ')' | '(' expr ')'
+ *
+ * 大文字で始まる名前はQuadMathの定数 (PI，Eなど)，小文字で始まる名前は変数である．
+ * 定数だけの部分式は解析しながら畳み込む．
+ */
+struct formula_parser {
+	struct QFormula *f;
+	const char *src;
+	const char *p;
+	long capa_insns;
+	long capa_consts;
+	long capa_vars;
+	int sp;
+	int nest;
+};
+
+static void parse_expr(struct formula_parser *ps);
+
+NORETURN(static void parse_error(struct formula_parser *ps, const char *msg));
+
+static void
+parse_error(struct formula_parser *ps, const char *msg)
+{
+	rb_raise(rb_eArgError, "%s at %ld in formula: %s", msg, (long)(ps->p - ps->src), ps->src);
+}
+
+static inline void
+skip_space(struct formula_parser *ps)
+{
+	while (isspace((unsigned char)*ps->p))
+		ps->p++;
+}
+
+static void
+emit(struct formula_parser *ps, enum FORMULA_OPS op, int arg, int pops, int pushes)
+{
+	struct QFormula *f = ps->f;
+
+	if (f->ninsns == ps->capa_insns)
+	{
+		ps->capa_insns *= 2;
+		REALLOC_N(f->code, struct formula_insn, ps->capa_insns);
+	}
+	f->code[f->ninsns++] = (struct formula_insn){ op, arg };
+	ps->sp += pushes - pops;
+	if (ps->sp > f->depth)
+	{
+		if (ps->sp > FORMULA_MAX_DEPTH)
+			parse_error(ps, "formula nested too deeply");
+		f->depth = ps->sp;
+	}
+}
+
+static void
+emit_const(struct formula_parser *ps, __float128 x)
+{
+	struct QFormula *f = ps->f;
+
+	if (f->nconsts == ps->capa_consts)
+	{
+		ps->capa_consts *= 2;
+		REALLOC_N(f->consts, __float128, ps->capa_consts);
+	}
+	f->consts[f->nconsts] = x;
+	emit(ps, FOP_CONST, (int)f->nconsts++, 0, 1);
+}
+
+/*
+ * 直前のnargs個の命令がすべて定数なら，opをその場で計算して一つの定数に置き換える．
+ */
+static void
+emit_op(struct formula_parser *ps, enum FORMULA_OPS op, int arg, int nargs)
+{
+	struct QFormula *f = ps->f;
+	__float128 stack[3] = { 0 };
+	struct formula_insn in = { op, arg };
+
+	if (f->ninsns >= nargs)
+	{
+		int k;
+		for (k = 0; k < nargs; k++)
+			if (f->code[f->ninsns - nargs + k].op != FOP_CONST)
+				break;
+		if (k == nargs)
+		{
+			/* 引数は作業域の末尾に詰める */
+			for (k = 0; k < nargs; k++)
+				stack[3 - nargs + k] = f->consts[f->code[f->ninsns - nargs + k].arg];
+			formula_apply(&in, stack + 3);
+			f->ninsns -= nargs;
+			f->nconsts -= nargs;
+			ps->sp -= nargs;
+			emit_const(ps, stack[3 - nargs]);
+			return;
+		}
+	}
+	emit(ps, op, arg, nargs, 1);
+}
+
+static void
+emit_var(struct formula_parser *ps, ID id)
+{
+	struct QFormula *f = ps->f;
+	long k;
+
+	for (k = 0; k < f->nvars; k++)
+		if (f->vars[k] == id)
+			break;
+	if (k == f->nvars)
+	{
+		if (f->nvars == ps->capa_vars)
+		{
+			ps->capa_vars *= 2;
+			REALLOC_N(f->vars, ID, ps->capa_vars);
+		}
+		f->vars[f->nvars++] = id;
+	}
+	emit(ps, FOP_VAR, (int)k, 0, 1);
+}
+
+static int
+parse_args(struct formula_parser *ps)
+{
+	int n = 0;
+
+	skip_space(ps);
+	if (*ps->p != '(')
+		parse_error(ps, "'(' expected");
+	ps->p++;
+	for (;;)
+	{
+		parse_expr(ps);
+		n++;
+		skip_space(ps);
+		if (*ps->p == ',')
+			ps->p++;
+		else if (*ps->p == ')')
+		{
+			ps->p++;
+			return n;
+		}
+		else
+			parse_error(ps, "',' or ')' expected");
+	}
+}
+
+static void
+call_function(struct formula_parser *ps, const char *name, long len, const char *at)
+{
+	int argc = parse_args(ps), k;
+
+	for (k = 0; k < numberof(formula_func1); k++)
+	{
+		if ((long)strlen(formula_func1[k].name) == len && !strncmp(formula_func1[k].name, name, len))
+		{
+			if (argc != 1)
+				goto wrong_number;
+			emit_op(ps, FOP_FUNC1, k, 1);
+			return;
+		}
+	}
+	for (k = 0; k < numberof(formula_func2); k++)
+	{
+		if ((long)strlen(formula_func2[k].name) == len && !strncmp(formula_func2[k].name, name, len))
+		{
+			if (argc != 2)
+				goto wrong_number;
+			emit_op(ps, FOP_FUNC2, k, 2);
+			return;
+		}
+	}
+	if (len == 3 && !strncmp("fma", name, 3))
+	{
+		if (argc != 3)
+			goto wrong_number;
+		emit_op(ps, FOP_FMA, 0, 3);
+		return;
+	}
+	ps->p = at;
+	rb_raise(rb_eArgError, "undefined function %.*s at %ld in formula: %s",
+	  (int)len, name, (long)(at - ps->src), ps->src);
+
+  wrong_number:
+	ps->p = at;
+	rb_raise(rb_eArgError, "wrong number of arguments for %.*s (given %d) at %ld in formula: %s",
+	  (int)len, name, argc, (long)(at - ps->src), ps->src);
+}
+
+static void
+parse_primary(struct formula_parser *ps)
+{
+	const char *at;
+
+	skip_space(ps);
+	at = ps->p;
+	if (isdigit((unsigned char)*ps->p) || (*ps->p == '.' && isdigit((unsigned char)ps->p[1])))
+	{
+		char *end;
+		__float128 x = strtoflt128(ps->p, &end);
+		ps->p = end;
+		emit_const(ps, x);
+	}
+	else if (isalpha((unsigned char)*ps->p) || *ps->p == '_')
+	{
+		long len;
+		while (isalnum((unsigned char)*ps->p) || *ps->p == '_')
+			ps->p++;
+		len = ps->p - at;
+		skip_space(ps);
+		if (*ps->p == '(')
+			call_function(ps, at, len, at);
+		else if (isupper((unsigned char)*at))
+		{
+			ID id = rb_intern2(at, len);
+			VALUE c;
+			if (!rb_const_defined(rb_mQuadMath, id) ||
+			    CLASS_OF(c = rb_const_get(rb_mQuadMath, id)) != rb_cFloat128)
+			{
+				ps->p = at;
+				rb_raise(rb_eArgError, "undefined constant %.*s at %ld in formula: %s",
+				  (int)len, at, (long)(at - ps->src), ps->src);
+			}
+			emit_const(ps, GetF128(c));
+		}
+		else
+			emit_var(ps, rb_intern2(at, len));
+	}
+	else if (*ps->p == '(')
+	{
+		ps->p++;
+		parse_expr(ps);
+		skip_space(ps);
+		if (*ps->p != ')')
+			parse_error(ps, "')' expected");
+		ps->p++;
+	}
+	else if (*ps->p == '\0')
+		parse_error(ps, "unexpected end");
+	else
+		parse_error(ps, "unexpected character");
+}
+
+static void parse_unary(struct formula_parser *ps);
+
+static void
+parse_power(struct formula_parser *ps)
+{
+	parse_primary(ps);
+	skip_space(ps);
+	if (ps->p[0] == '*' && ps->p[1] == '*')
+	{
+		ps->p += 2;
+		if (++ps->nest > FORMULA_MAX_DEPTH)
+			parse_error(ps, "formula nested too deeply");
+		parse_unary(ps);
+		ps->nest--;
+		/* 指数が2ならばpowq()を呼ばずに二乗する．丸めは一回なので結果は同じ */
+		if (ps->f->code[ps->f->ninsns - 1].op == FOP_CONST &&
+		    ps->f->consts[ps->f->code[ps->f->ninsns - 1].arg] == 2)
+		{
+			ps->f->ninsns--;
+			ps->f->nconsts--;
+			ps->sp--;
+			emit_op(ps, FOP_SQUARE, 0, 1);
+		}
+		else
+			emit_op(ps, FOP_POW, 0, 2);
+	}
+}
+
+static void
+parse_unary(struct formula_parser *ps)
+{
+	bool neg = false;
+
+	for (;;)
+	{
+		skip_space(ps);
+		if (*ps->p == '-')
+			neg = !neg;
+		else if (*ps->p != '+')
+			break;
+		ps->p++;
+	}
+	parse_power(ps);
+	if (neg)
+		emit_op(ps, FOP_NEG, 0, 1);
+}
+
+static void
+parse_term(struct formula_parser *ps)
+{
+	parse_unary(ps);
+	for (;;)
+	{
+		enum FORMULA_OPS op;
+		skip_space(ps);
+		if (ps->p[0] == '*' && ps->p[1] != '*')
+			op = FOP_MUL;
+		else if (ps->p[0] == '/')
+			op = FOP_DIV;
+		else if (ps->p[0] == '%')
+			op = FOP_MOD;
+		else
+			return;
+		ps->p++;
+		parse_unary(ps);
+		emit_op(ps, op, 0, 2);
+	}
+}
+
+static void
+parse_expr(struct formula_parser *ps)
+{
+	if (++ps->nest > FORMULA_MAX_DEPTH)
+		parse_error(ps, "formula nested too deeply");
+	parse_term(ps);
+	for (;;)
+	{
+		enum FORMULA_OPS op;
+		skip_space(ps);
+		if (ps->p[0] == '+')
+			op = FOP_ADD;
+		else if (ps->p[0] == '-')
+			op = FOP_SUB;
+		else
+			break;
+		ps->p++;
+		parse_term(ps);
+		emit_op(ps, op, 0, 2);
+	}
+	ps->nest--;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.compile(source) -> QuadMath::Formula
+ *
+ *  Compiles the arithmetic formula +source+ into a QuadMath::Formula.
+ *  The formula uses Ruby's operators <code>+ - * / % **</code> and parentheses,
+ *  decimal numbers, which are read exactly as Float128('...') does, QuadMath constants such as +PI+ and +E+,
+ *  and the real functions +exp+, +exp2+, +expm1+, +log+, +log2+, +log10+, +log1p+, +sqrt+, +cbrt+,
+ *  +sin+, +cos+, +tan+, +asin+, +acos+, +atan+, +sinh+, +cosh+, +tanh+, +asinh+, +acosh+, +atanh+,
+ *  +erf+, +erfc+, +lgamma+, +gamma+, +j0+, +j1+, +y0+, +y1+, +abs+, +atan2+, +hypot+, +pow+ and +fma+.
+ *  Any other name that starts with a lower case letter is a variable.
+ *  Subexpressions of constants are folded at compile time.
+ *  Raises ArgumentError with the position of the error if +source+ cannot be parsed.
+ *
+ *    f = QuadMath.compile("a*x**2 + b*sin(x)")
+ *    f.variables # => [:a, :x, :b]
+ */
+static VALUE
+quadmath_compile(VALUE unused_obj, VALUE source)
+{
+	struct formula_parser ps;
+	struct QFormula *f;
+	VALUE obj;
+	long len;
+
+	StringValueCStr(source);
+	len = RSTRING_LEN(source);
+
+	obj = qformula_allocate(rb_cQuadFormula);
+	TypedData_Get_Struct(obj, struct QFormula, &qformula_data_type, f);
+	f->source = ALLOC_N(char, len + 1);
+	memcpy(f->source, RSTRING_PTR(source), len + 1);
+
+	ps.f = f;
+	ps.src = ps.p = f->source;
+	ps.capa_insns = ps.capa_consts = ps.capa_vars = 16;
+	ps.sp = 0;
+	ps.nest = 0;
+	f->code = ALLOC_N(struct formula_insn, ps.capa_insns);
+	f->consts = ALLOC_N(__float128, ps.capa_consts);
+	f->vars = ALLOC_N(ID, ps.capa_vars);
+
+	parse_expr(&ps);
+	skip_space(&ps);
+	if (*ps.p != '\0')
+		parse_error(&ps, "unexpected character");
+
+	return obj;
+}
+
+struct formula_eval_args {
+	const struct formula_insn *code;
+	long ninsns;
+	const __float128 *consts;
+	const struct formula_binding *b;
+	int depth;
+	__float128 *y;
+	long len;
+	long done;
+	int nthreads;
+};
+
+static void
+formula_eval_range(void *ptr, long i0, long i1)
+{
+	const struct formula_eval_args *args = ptr;
+
+	formula_exec_block(args->code, args->ninsns, args->consts, args->b, args->depth,
+	                   i0, i1 - i0, args->y + i0);
+}
+
+static void *
+formula_eval_nogvl(void *ptr)
+{
+	struct formula_eval_args *args = ptr;
+
+	if (!quadmath_parallel_for_at(&args->done, args->len, FORMULA_GRAIN, args->nthreads, formula_eval_range, args))
+		return QUADMATH_INTERRUPTED;
+	return NULL;
+}
+
+struct formula_bind_arg {
+	const struct QFormula *f;
+	struct formula_binding *b;
+};
+
+static int
+formula_bind_i(VALUE key, VALUE val, VALUE ptr)
+{
+	const struct formula_bind_arg *arg = (const struct formula_bind_arg *)ptr;
+	ID id = rb_sym2id(key);
+
+	for (long k = 0; k < arg->f->nvars; k++)
+	{
+		if (arg->f->vars[k] == id)
+		{
+			arg->b[k].val = val;
+			return ST_CONTINUE;
+		}
+	}
+	rb_raise(rb_eArgError, "unknown variable: %"PRIsVALUE, key);
+	return ST_STOP;
+}
+
+/*
+ *  call-seq:
+ *    call(*values) -> Float128 | QuadMath::Vector
+ *    call(**bindings) -> Float128 | QuadMath::Vector
+ *    self[*values] -> Float128 | QuadMath::Vector
+ *
+ *  Evaluates the formula in binary128 without creating intermediate Ruby objects.
+ *  The variables are bound by name, or by position in the order of #variables.
+ *  A value is a real number, or a real vector or an Array.
+ *  If any value is a vector or an Array, the formula is evaluated for each element, with numbers repeated
+ *  for every element, and a vector is returned; the vectors must have the same length.
+ *  A long vector is split among QuadMath.threads native threads with the GVL released.
+ *  Functions are evaluated in the real domain, so an argument outside the domain gives NaN.
+ *
+ *    f = QuadMath.compile("a*x**2 + b*sin(x)")
+ *    f.call(a: 2, x: 3, b: 0) # => 18.0
+ *    f.call(2, QuadMath::Vector[1, 2, 3], 0) # => QuadMath::Vector[2.0, 8.0, 18.0]
+ */
+static VALUE
+qformula_call(int argc, VALUE *argv, VALUE self)
+{
+	const struct QFormula *f = GetQFormula(self);
+	struct formula_eval_args args;
+	struct formula_binding *b;
+	struct formula_insn *code;
+	__float128 *consts;
+	long *start, nconsts;
+	bool *uniform;
+	VALUE rest, opts, tmp, tmp_code, tmp_consts, tmp_start, tmp_uniform, y;
+	long len = -1;
+
+	rb_scan_args(argc, argv, "*:", &rest, &opts);
+
+	b = ALLOCV_N(struct formula_binding, tmp, f->nvars);
+	for (long k = 0; k < f->nvars; k++)
+		b[k].val = Qundef;
+
+	if (!NIL_P(opts))
+	{
+		struct formula_bind_arg arg = { f, b };
+		if (RARRAY_LEN(rest) > 0)
+			rb_raise(rb_eArgError, "variables must be given either by name or by position");
+		rb_hash_foreach(opts, formula_bind_i, (VALUE)&arg);
+		for (long k = 0; k < f->nvars; k++)
+			if (b[k].val == Qundef)
+				rb_raise(rb_eArgError, "missing variable: %"PRIsVALUE, rb_id2str(f->vars[k]));
+	}
+	else
+	{
+		if (RARRAY_LEN(rest) != f->nvars)
+			rb_raise(rb_eArgError, "wrong number of arguments (given %ld, expected %ld)",
+			  RARRAY_LEN(rest), f->nvars);
+		for (long k = 0; k < f->nvars; k++)
+			b[k].val = RARRAY_AREF(rest, k);
+	}
+
+	for (long k = 0; k < f->nvars; k++)
+	{
+		if (!RB_TYPE_P(b[k].val, T_ARRAY) && !qvector_p(b[k].val))
+		{
+			switch (convertion_num_types(b[k].val)) {
+			case NUM_COMPLEX:
+			case NUM_COMPLEX128:
+				rb_raise(rb_eTypeError, "not a real value: %"PRIsVALUE, b[k].val);
+			default:
+				b[k].scalar = num_to_cf128(b[k].val);
+				break;
+			}
+			b[k].ptr = &b[k].scalar;
+			b[k].stride = 0;
+			continue;
+		}
+		b[k].val = rb_qvector_from(b[k].val);
+		if (GetQVector(b[k].val)->type != VEC_FLOAT128)
+			rb_raise(rb_eTypeError, "not a real vector");
+		if (len >= 0 && GetQVector(b[k].val)->len != len)
+			rb_raise(rb_eArgError,
+			  "length mismatch (%ld for %ld)", GetQVector(b[k].val)->len, len);
+		len = GetQVector(b[k].val)->len;
+		b[k].ptr = GetQVector(b[k].val)->data.f128;
+		b[k].stride = 1;
+	}
+
+	if (len < 0)
+	{
+		y = rb_float128_cf128(formula_exec(f->code, f->ninsns, f->consts, b, 0));
+		ALLOCV_END(tmp);
+		return y;
+	}
+
+	code = ALLOCV_N(struct formula_insn, tmp_code, f->ninsns);
+	consts = ALLOCV_N(__float128, tmp_consts, f->nconsts + f->ninsns);
+	start = ALLOCV_N(long, tmp_start, f->depth);
+	uniform = ALLOCV_N(bool, tmp_uniform, f->depth);
+	args.ninsns = formula_hoist(f, b, code, consts, &nconsts, start, uniform);
+	args.code = code;
+	args.consts = consts;
+	args.depth = f->depth;
+
+	y = rb_qvector_new(VEC_FLOAT128, len);
+	args.b = b;
+	args.y = GetQVector(y)->data.f128;
+	args.len = len;
+	args.done = 0;
+	args.nthreads = len * args.ninsns >= NOGVL_THRESHOLD ? quadmath_threads() : 1;
+	quadmath_call_nogvl(formula_eval_nogvl, &args, len * args.ninsns);
+	for (long k = 0; k < f->nvars; k++)
+		RB_GC_GUARD(b[k].val);
+	RB_GC_GUARD(self);
+	ALLOCV_END(tmp_uniform);
+	ALLOCV_END(tmp_start);
+	ALLOCV_END(tmp_consts);
+	ALLOCV_END(tmp_code);
+	ALLOCV_END(tmp);
+
+	return y;
+}
+
+/*
+ *  call-seq:
+ *    variables -> Array
+ *
+ *  Returns the names of the variables as Symbols, in the order in which they first appear.
+ *  This is the order of the positional arguments of #call.
+ */
+static VALUE
+qformula_variables(VALUE self)
+{
+	const struct QFormula *f = GetQFormula(self);
+	VALUE ary = rb_ary_new_capa(f->nvars);
+
+	for (long k = 0; k < f->nvars; k++)
+		rb_ary_push(ary, ID2SYM(f->vars[k]));
+
+	return ary;
+}
+
+/*
+ *  call-seq:
+ *    source -> String
+ *
+ *  Returns the source of the formula.
+ */
+static VALUE
+qformula_source(VALUE self)
+{
+	return rb_str_new_cstr(GetQFormula(self)->source);
+}
+
+/*
+ *  call-seq:
+ *    inspect -> String
+ *
+ *  Returns the source and the number of instructions of the formula.
+ */
+static VALUE
+qformula_inspect(VALUE self)
+{
+	const struct QFormula *f = GetQFormula(self);
+
+	return rb_sprintf("#<%"PRIsVALUE" %s (%ld insns)>", rb_obj_class(self), f->source, f->ninsns);
+}
+
+/*
+ * 遅延評価するベクトルの式．命令列はQuadMath::Formulaと同じで，変数k番をベクトルleaves[k]に束縛する．
+ * 演算のたびに命令列をつないだ新しいオブジェクトを作り，作った後は書き換えない．
+ */
+struct QLazy {
+	long ninsns;
+	struct formula_insn *code;
+	long nconsts;
+	__float128 *consts;
+	long nleaves;
+	VALUE *leaves;
+	int depth;
+	long len;  /* ベクトルを含まない式ならば-1 */
+};
+
+static void
+mark_qlazy(void *v)
+{
+	struct QLazy *l = v;
+	for (long k = 0; k < l->nleaves; k++)
+		rb_gc_mark(l->leaves[k]);
+}
+
+static void
+free_qlazy(void *v)
+{
+	struct QLazy *l = v;
+	if (l != NULL)
+	{
+		xfree(l->code);
+		xfree(l->consts);
+		xfree(l->leaves);
+		xfree(l);
+	}
+}
+
+static size_t
+memsize_qlazy(const void *v)
+{
+	const struct QLazy *l = v;
+	return sizeof(struct QLazy) + sizeof(struct formula_insn) * l->ninsns +
+		sizeof(__float128) * l->nconsts + sizeof(VALUE) * l->nleaves;
+}
+
+static const rb_data_type_t qlazy_data_type = {
+	"quadmath_vector_lazy",
+	{mark_qlazy, free_qlazy, memsize_qlazy,},
+	0, 0,
+	RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static VALUE
+qlazy_allocate(VALUE klass)
+{
+	struct QLazy *l;
+	VALUE obj = TypedData_Make_Struct(klass, struct QLazy, &qlazy_data_type, l);
+	l->ninsns = l->nconsts = l->nleaves = 0;
+	l->code = NULL;
+	l->consts = NULL;
+	l->leaves = NULL;
+	l->depth = 0;
+	l->len = -1;
+	return obj;
+}
+
+static struct QLazy *
+GetQLazy(VALUE self)
+{
+	struct QLazy *l;
+
+	TypedData_Get_Struct(self, struct QLazy, &qlazy_data_type, l);
+
+	if (l->code == NULL)
+		rb_raise(rb_eRuntimeError, "uninitialized lazy vector");
+
+	return l;
+}
+
+static VALUE
+qlazy_new(long ninsns, long nconsts, long nleaves, struct QLazy **lp)
+{
+	VALUE obj = qlazy_allocate(rb_cQuadVectorLazy);
+	struct QLazy *l;
+
+	TypedData_Get_Struct(obj, struct QLazy, &qlazy_data_type, l);
+	l->code = ALLOC_N(struct formula_insn, ninsns);
+	l->consts = ALLOC_N(__float128, nconsts > 0 ? nconsts : 1);
+	l->leaves = ALLOC_N(VALUE, nleaves > 0 ? nleaves : 1);
+	*lp = l;
+
+	return obj;
+}
+
+VALUE
+rb_qvector_lazy(VALUE vec)
+{
+	struct QLazy *l;
+	VALUE obj;
+
+	if (GetQVector(vec)->type != VEC_FLOAT128)
+		rb_raise(rb_eTypeError, "not a real vector");
+	obj = qlazy_new(1, 0, 1, &l);
+	l->code[0] = (struct formula_insn){ FOP_VAR, 0 };
+	l->ninsns = 1;
+	l->leaves[0] = vec;
+	l->nleaves = 1;
+	l->depth = 1;
+	l->len = GetQVector(vec)->len;
+
+	return obj;
+}
+
+/* 演算の相手を式にする．ベクトルとArrayは変数に，実数は定数にする */
+static VALUE
+qlazy_operand(VALUE x)
+{
+	struct QLazy *l;
+	VALUE obj;
+
+	if (rb_typeddata_is_kind_of(x, &qlazy_data_type))
+		return x;
+	if (RB_TYPE_P(x, T_ARRAY) || qvector_p(x))
+		return rb_qvector_lazy(rb_qvector_from(x));
+	switch (convertion_num_types(x)) {
+	case NUM_COMPLEX:
+	case NUM_COMPLEX128:
+		rb_raise(rb_eTypeError, "not a real value: %"PRIsVALUE, x);
+	case NUM_OTHERTYPE:
+		rb_raise(rb_eTypeError, "%"PRIsVALUE" can't be coerced into %"PRIsVALUE,
+		  rb_obj_class(x), rb_cQuadVectorLazy);
+	default:
+		break;
+	}
+	obj = qlazy_new(1, 1, 0, &l);
+	l->consts[0] = num_to_cf128(x);
+	l->nconsts = 1;
+	l->code[0] = (struct formula_insn){ FOP_CONST, 0 };
+	l->ninsns = 1;
+	l->depth = 1;
+
+	return obj;
+}
+
+/*
+ * 式xとyの命令列をつなぎ，最後にopを置く．yがQnilならば一引数の命令である．
+ * yの変数の番号はxの後に続け，同じベクトルはxの変数を使う．
+ */
+static VALUE
+qlazy_combine(enum FORMULA_OPS op, int arg, VALUE x, VALUE y)
+{
+	const struct QLazy *a = GetQLazy(x), *c = NIL_P(y) ? NULL : GetQLazy(y);
+	struct QLazy *l;
+	long ninsns = a->ninsns + 1, nconsts = a->nconsts, nleaves = a->nleaves, *map = NULL;
+	int depth = a->depth;
+	VALUE obj, tmp = 0;
+
+	if (c)
+	{
+		if (a->len >= 0 && c->len >= 0 && a->len != c->len)
+			rb_raise(rb_eArgError, "length mismatch (%ld for %ld)", c->len, a->len);
+		if (c->depth + 1 > depth)
+			depth = c->depth + 1;
+		ninsns += c->ninsns;
+		nconsts += c->nconsts;
+		nleaves += c->nleaves;
+	}
+	if (depth > FORMULA_MAX_DEPTH)
+		rb_raise(rb_eArgError, "expression nested too deeply");
+	if (ninsns > LAZY_MAX_INSNS)
+		rb_raise(rb_eArgError, "expression too large (%ld instructions)", ninsns);
+
+	obj = qlazy_new(ninsns, nconsts, nleaves, &l);
+	MEMCPY(l->code, a->code, struct formula_insn, a->ninsns);
+	MEMCPY(l->consts, a->consts, __float128, a->nconsts);
+	MEMCPY(l->leaves, a->leaves, VALUE, a->nleaves);
+	l->ninsns = a->ninsns;
+	l->nconsts = a->nconsts;
+	l->nleaves = a->nleaves;
+	l->depth = depth;
+	l->len = a->len;
+	if (c)
+	{
+		map = ALLOCV_N(long, tmp, c->nleaves > 0 ? c->nleaves : 1);
+		for (long k = 0; k < c->nleaves; k++)
+		{
+			long j;
+			for (j = 0; j < l->nleaves; j++)
+				if (l->leaves[j] == c->leaves[k])
+					break;
+			if (j == l->nleaves)
+				l->leaves[l->nleaves++] = c->leaves[k];
+			map[k] = j;
+		}
+		for (long pc = 0; pc < c->ninsns; pc++)
+		{
+			struct formula_insn in = c->code[pc];
+			if (in.op == FOP_CONST)
+				in.arg += (int)a->nconsts;
+			else if (in.op == FOP_VAR)
+				in.arg = (int)map[in.arg];
+			l->code[l->ninsns++] = in;
+		}
+		MEMCPY(l->consts + l->nconsts, c->consts, __float128, c->nconsts);
+		l->nconsts += c->nconsts;
+		if (l->len < 0)
+			l->len = c->len;
+		ALLOCV_END(tmp);
+	}
+	l->code[l->ninsns++] = (struct formula_insn){ op, arg };
+	RB_GC_GUARD(x);
+	RB_GC_GUARD(y);
+
+	return obj;
+}
+
+/*
+ *  call-seq:
+ *    lazy -> QuadMath::Vector::Lazy
+ *
+ *  Returns a lazy view of the real vector, on which arithmetic builds an expression instead of new vectors.
+ *  See QuadMath::Vector::Lazy.
+ *
+ *    v = QuadMath::Vector[1, 2, 3]
+ *    (v.lazy * v + 1).exp.sum # => 22182.268010008223770606246652785372
+ */
+static VALUE
+qvector_lazy(VALUE self)
+{
+	return rb_qvector_lazy(self);
+}
+
+/*
+ *  call-seq:
+ *    lazy + other -> QuadMath::Vector::Lazy
+ *    lazy - other -> QuadMath::Vector::Lazy
+ *    lazy * other -> QuadMath::Vector::Lazy
+ *    lazy / other -> QuadMath::Vector::Lazy
+ *    lazy % other -> QuadMath::Vector::Lazy
+ *    lazy ** other -> QuadMath::Vector::Lazy
+ *
+ *  Returns the expression that applies the operator elementwise.
+ *  +other+ is a lazy expression, a real vector or an Array of the same length, or a real number used for every element.
+ *  Nothing is computed until the expression is evaluated, and the operators give bit for bit the same elements
+ *  as the QuadMath::Vector operators.  <code>** 2</code> multiplies instead of calling powq().
+ */
+static VALUE
+qlazy_plus(VALUE self, VALUE other)
+{
+	return qlazy_combine(FOP_ADD, 0, self, qlazy_operand(other));
+}
+
+static VALUE
+qlazy_minus(VALUE self, VALUE other)
+{
+	return qlazy_combine(FOP_SUB, 0, self, qlazy_operand(other));
+}
+
+static VALUE
+qlazy_mul(VALUE self, VALUE other)
+{
+	return qlazy_combine(FOP_MUL, 0, self, qlazy_operand(other));
+}
+
+static VALUE
+qlazy_div(VALUE self, VALUE other)
+{
+	return qlazy_combine(FOP_DIV, 0, self, qlazy_operand(other));
+}
+
+static VALUE
+qlazy_modulo(VALUE self, VALUE other)
+{
+	return qlazy_combine(FOP_MOD, 0, self, qlazy_operand(other));
+}
+
+static VALUE
+qlazy_pow(VALUE self, VALUE other)
+{
+	VALUE y = qlazy_operand(other);
+	const struct QLazy *c = GetQLazy(y);
+
+	if (c->ninsns == 1 && c->code[0].op == FOP_CONST && c->consts[0] == 2)
+		return qlazy_combine(FOP_SQUARE, 0, self, Qnil);
+	return qlazy_combine(FOP_POW, 0, self, y);
+}
+
+/*
+ *  call-seq:
+ *    -lazy -> QuadMath::Vector::Lazy
+ *
+ *  Returns the expression that negates every element.
+ */
+static VALUE
+qlazy_uminus(VALUE self)
+{
+	return qlazy_combine(FOP_NEG, 0, self, Qnil);
+}
+
+/*
+ *  call-seq:
+ *    exp -> QuadMath::Vector::Lazy
+ *    log -> QuadMath::Vector::Lazy
+ *    sqrt -> QuadMath::Vector::Lazy
+ *    ...
+ *
+ *  Returns the expression that applies the real function to every element.
+ *  The functions are those of QuadMath.compile that take one argument:
+ *  +exp+, +exp2+, +expm1+, +log+, +log2+, +log10+, +log1p+, +sqrt+, +cbrt+,
+ *  +sin+, +cos+, +tan+, +asin+, +acos+, +atan+, +sinh+, +cosh+, +tanh+, +asinh+, +acosh+, +atanh+,
+ *  +erf+, +erfc+, +lgamma+, +gamma+, +j0+, +j1+, +y0+, +y1+ and +abs+.
+ *  They are evaluated in full binary128 accuracy, whatever QuadMath.with_accuracy says.
+ */
+static VALUE
+qlazy_func1(VALUE self)
+{
+	const char *name = rb_id2name(rb_frame_this_func());
+
+	for (int k = 0; k < numberof(formula_func1); k++)
+		if (!strcmp(formula_func1[k].name, name))
+			return qlazy_combine(FOP_FUNC1, k, self, Qnil);
+	rb_raise(rb_eNotImpError, "%s is not a lazy function", name);
+}
+
+/*
+ *  call-seq:
+ *    coerce(number) -> [QuadMath::Vector::Lazy, QuadMath::Vector::Lazy]
+ *
+ *  Makes <code>2 * lazy</code> and the like build an expression.
+ */
+static VALUE
+qlazy_coerce(VALUE self, VALUE other)
+{
+	return rb_assoc_new(qlazy_operand(other), self);
+}
+
+/*
+ *  call-seq:
+ *    lazy -> self
+ */
+static VALUE
+qlazy_lazy(VALUE self)
+{
+	return self;
+}
+
+/*
+ *  call-seq:
+ *    size -> Integer
+ *    length -> Integer
+ *
+ *  Returns the number of elements of the expression.
+ */
+static VALUE
+qlazy_size(VALUE self)
+{
+	const struct QLazy *l = GetQLazy(self);
+
+	return l->len < 0 ? Qnil : LONG2NUM(l->len);
+}
+
+/*
+ * 変数をベクトルの要素に束縛する．式を作った後にベクトルが変わっていないかを確かめる．
+ */
+static void
+qlazy_bind(const struct QLazy *l, struct formula_binding *b)
+{
+	for (long k = 0; k < l->nleaves; k++)
+	{
+		const struct QVector *vec = GetQVector(l->leaves[k]);
+		if (vec->type != VEC_FLOAT128)
+			rb_raise(rb_eTypeError, "not a real vector");
+		if (vec->len != l->len)
+			rb_raise(rb_eArgError, "length mismatch (%ld for %ld)", vec->len, l->len);
+		b[k].val = l->leaves[k];
+		b[k].ptr = vec->data.f128;
+		b[k].stride = 1;
+	}
+}
+
+static void
+qlazy_sum_gen(void *ptr, long i0, long n, __float128 *y)
+{
+	const struct formula_eval_args *args = ptr;
+
+	formula_exec_block(args->code, args->ninsns, args->consts, args->b, args->depth, i0, n, y);
+}
+
+/*
+ *  call-seq:
+ *    force -> QuadMath::Vector
+ *    to_v -> QuadMath::Vector
+ *
+ *  Evaluates the expression into a new real vector in one pass over the elements.
+ *  The elements are computed in blocks of 256 that stay in the L1 cache, so no intermediate vector is made,
+ *  and a long vector is split among QuadMath.threads native threads with the GVL released.
+ *  The vectors of the expression are read now, not when the expression was built.
+ *
+ *    a = QuadMath::Vector[1, 2, 3]
+ *    (a.lazy * a + 1).force # => QuadMath::Vector[2.0, 5.0, 10.0]
+ */
+static VALUE
+qlazy_force(VALUE self)
+{
+	const struct QLazy *l = GetQLazy(self);
+	struct formula_eval_args args;
+	struct formula_binding *b;
+	VALUE tmp, y;
+
+	if (l->len < 0)
+		rb_raise(rb_eArgError, "no vector in the expression");
+	b = ALLOCV_N(struct formula_binding, tmp, l->nleaves);
+	qlazy_bind(l, b);
+	args.b = b;
+	args.code = l->code;
+	args.ninsns = l->ninsns;
+	args.consts = l->consts;
+	args.depth = l->depth;
+	y = rb_qvector_new(VEC_FLOAT128, l->len);
+	args.y = GetQVector(y)->data.f128;
+	args.len = l->len;
+	args.done = 0;
+	args.nthreads = l->len * l->ninsns >= NOGVL_THRESHOLD ? quadmath_threads() : 1;
+	quadmath_call_nogvl(formula_eval_nogvl, &args, l->len * l->ninsns);
+	RB_GC_GUARD(self);
+	ALLOCV_END(tmp);
+
+	return y;
+}
+
+/*
+ *  call-seq:
+ *    to_a -> Array
+ *
+ *  Returns the elements of #force as an Array of Float128.
+ */
+static VALUE
+qlazy_to_a(VALUE self)
+{
+	return rb_funcall(qlazy_force(self), rb_intern("to_a"), 0);
+}
+
+/*
+ *  call-seq:
+ *    sum(reproducible: false) -> Float128
+ *
+ *  Returns the sum of the elements of the expression without making any vector.
+ *  The elements are computed in blocks that stay in the cache and added as they are made,
+ *  in the same order as QuadMath.sum, so the result is bit for bit <code>QuadMath.sum(force, reproducible:)</code>.
+ *
+ *    a = QuadMath::Vector[1, 2, 3]
+ *    b = QuadMath::Vector[4, 5, 6]
+ *    (a.lazy * b + 1).exp.sum # => 178542323.518061561239968781390095
+ */
+static VALUE
+qlazy_sum(int argc, VALUE *argv, VALUE self)
+{
+	const struct QLazy *l = GetQLazy(self);
+	struct formula_eval_args args;
+	VALUE opts, tmp;
+	struct formula_binding *b;
+	__float128 s;
+
+	rb_scan_args(argc, argv, "0:", &opts);
+	if (l->len < 0)
+		rb_raise(rb_eArgError, "no vector in the expression");
+	b = ALLOCV_N(struct formula_binding, tmp, l->nleaves);
+	qlazy_bind(l, b);
+	args.b = b;
+	args.code = l->code;
+	args.ninsns = l->ninsns;
+	args.consts = l->consts;
+	args.depth = l->depth;
+	s = generated_sum_q(l->len, qlazy_sum_gen, &args, l->len * l->ninsns, opt_reproducible(opts));
+	RB_GC_GUARD(self);
+	ALLOCV_END(tmp);
+
+	return rb_float128_cf128(s);
+}
+
+/*
+ *  call-seq:
+ *    inspect -> String
+ *
+ *  Returns the expression, with v0, v1, ... standing for its vectors, and its size.
+ *
+ *    a = QuadMath::Vector[1, 2, 3]
+ *    (a.lazy * a + 1).exp # => #<QuadMath::Vector::Lazy exp((v0 * v0) + 1.0) size=3>
+ */
+static VALUE
+qlazy_inspect(VALUE self)
+{
+	static const char *const binop[] = {
+		[FOP_ADD] = "+", [FOP_SUB] = "-", [FOP_MUL] = "*", [FOP_DIV] = "/", [FOP_MOD] = "%", [FOP_POW] = "**",
+	};
+	const struct QLazy *l = GetQLazy(self);
+	VALUE st = rb_ary_new_capa(l->depth), tmp;
+	bool *paren = ALLOCV_N(bool, tmp, l->depth);
+	long sp = 0;
+
+	for (long pc = 0; pc < l->ninsns; pc++)
+	{
+		const struct formula_insn *in = &l->code[pc];
+		const int nargs = formula_nargs(in->op);
+		VALUE s[2];
+
+		for (int k = 0; k < nargs; k++)
+		{
+			s[k] = rb_ary_entry(st, sp - nargs + k);
+			if (in->op != FOP_FUNC1 && paren[sp - nargs + k])
+				s[k] = rb_sprintf("(%"PRIsVALUE")", s[k]);
+		}
+		sp -= nargs;
+		switch (in->op) {
+		case FOP_CONST:
+			s[0] = rb_inspect(rb_float128_cf128(l->consts[in->arg]));
+			break;
+		case FOP_VAR:
+			s[0] = rb_sprintf("v%d", in->arg);
+			break;
+		case FOP_NEG:
+			s[0] = rb_sprintf("-%"PRIsVALUE, s[0]);
+			break;
+		case FOP_SQUARE:
+			s[0] = rb_sprintf("%"PRIsVALUE"**2", s[0]);
+			break;
+		case FOP_FUNC1:
+			s[0] = rb_sprintf("%s(%"PRIsVALUE")", formula_func1[in->arg].name, s[0]);
+			break;
+		default:
+			s[0] = rb_sprintf("%"PRIsVALUE" %s %"PRIsVALUE, s[0], binop[in->op], s[1]);
+			break;
+		}
+		rb_ary_store(st, sp, s[0]);
+		paren[sp++] = nargs == 2;
+	}
+	ALLOCV_END(tmp);
+
+	if (l->len < 0)
+		return rb_sprintf("#<%"PRIsVALUE" %"PRIsVALUE">", rb_obj_class(self), rb_ary_entry(st, 0));
+	return rb_sprintf("#<%"PRIsVALUE" %"PRIsVALUE" size=%ld>", rb_obj_class(self), rb_ary_entry(st, 0), l->len);
+}
+
+void
+InitVM_Formula(void)
+{
+	rb_define_alloc_func(rb_cQuadFormula, qformula_allocate);
+	rb_undef_method(CLASS_OF(rb_cQuadFormula), "new");
+	rb_undef_method(rb_cQuadFormula, "initialize_copy");
+	rb_define_module_function(rb_mQuadMath, "compile", quadmath_compile, 1);
+
+	rb_define_method(rb_cQuadFormula, "call", qformula_call, -1);
+	rb_define_alias(rb_cQuadFormula, "[]", "call");
+	rb_define_method(rb_cQuadFormula, "variables", qformula_variables, 0);
+	rb_define_method(rb_cQuadFormula, "source", qformula_source, 0);
+	rb_define_alias(rb_cQuadFormula, "to_s", "source");
+	rb_define_method(rb_cQuadFormula, "inspect", qformula_inspect, 0);
+
+	rb_define_method(rb_cQuadVector, "lazy", qvector_lazy, 0);
+	rb_define_alloc_func(rb_cQuadVectorLazy, qlazy_allocate);
+	rb_undef_method(CLASS_OF(rb_cQuadVectorLazy), "new");
+	rb_undef_method(rb_cQuadVectorLazy, "initialize_copy");
+	rb_define_method(rb_cQuadVectorLazy, "+", qlazy_plus, 1);
+	rb_define_method(rb_cQuadVectorLazy, "-", qlazy_minus, 1);
+	rb_define_method(rb_cQuadVectorLazy, "*", qlazy_mul, 1);
+	rb_define_method(rb_cQuadVectorLazy, "/", qlazy_div, 1);
+	rb_define_method(rb_cQuadVectorLazy, "%", qlazy_modulo, 1);
+	rb_define_method(rb_cQuadVectorLazy, "**", qlazy_pow, 1);
+	rb_define_method(rb_cQuadVectorLazy, "-@", qlazy_uminus, 0);
+	for (int k = 0; k < numberof(formula_func1); k++)
+		rb_define_method(rb_cQuadVectorLazy, formula_func1[k].name, qlazy_func1, 0);
+	rb_define_method(rb_cQuadVectorLazy, "coerce", qlazy_coerce, 1);
+	rb_define_method(rb_cQuadVectorLazy, "lazy", qlazy_lazy, 0);
+	rb_define_method(rb_cQuadVectorLazy, "size", qlazy_size, 0);
+	rb_define_alias(rb_cQuadVectorLazy, "length", "size");
+	rb_define_method(rb_cQuadVectorLazy, "force", qlazy_force, 0);
+	rb_define_alias(rb_cQuadVectorLazy, "to_v", "force");
+	rb_define_method(rb_cQuadVectorLazy, "to_a", qlazy_to_a, 0);
+	rb_define_method(rb_cQuadVectorLazy, "sum", qlazy_sum, -1);
+	rb_define_method(rb_cQuadVectorLazy, "inspect", qlazy_inspect, 0);
+}
@@ -1,15 +1,307 @@
 #ifndef RB_QUADMATH_INTERNAL_TYPES_H
 #define RB_QUADMATH_INTERNAL_TYPES_H
 
+#include <ruby/thread.h>
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
 
 __float128 GetF128(VALUE);
 __complex128 GetC128(VALUE);
+VALUE rb_float128_flyweight(__float128 **ptr);
+VALUE rb_complex128_flyweight(__complex128 **ptr);
 
 VALUE float128_nucomp_pow(VALUE x, VALUE y);
 VALUE float128_to_s(int argc, VALUE *argv, VALUE self);
+__float128 num_to_cf128(VALUE);
+__complex128 num_to_cc128(VALUE);
+__float128 l2norm_q(const __float128 *x, long n);
+
+/*
+ * 整数演算によるbinary128の加減乗算と積和．コンパイラの演算子およびfmaq()とビット単位で同じ結果を返す．
+ * fma_q()はfmaq()より一桁以上速いので，積和のループではこちらを使う．
+ */
+__float128 add_q(__float128 x, __float128 y);
+__float128 sub_q(__float128 x, __float128 y);
+__float128 mul_q(__float128 x, __float128 y);
+__float128 fma_q(__float128 x, __float128 y, __float128 z);
+
+/*
+ * double-double．値は hi + lo で，|lo| ≤ ulp(hi)/2 に正規化しておく．
+ * 誤差のない変換 (two-sum，two-product) をハードウェアのdoubleで行うので，
+ * 精度は約106ビットで軟浮動小数点のbinary128より一桁速い．
+ */
+struct ddouble {
+	double hi;
+	double lo;
+};
+
+static inline struct ddouble
+dd_quick_two_sum(double a, double b)
+{
+	const double s = a + b;
+	return (struct ddouble){ s, b - (s - a) };
+}
+
+static inline struct ddouble
+dd_two_sum(double a, double b)
+{
+	const double s = a + b, bb = s - a;
+	return (struct ddouble){ s, (a - (s - bb)) + (b - bb) };
+}
+
+static inline struct ddouble
+dd_two_prod(double a, double b)
+{
+	const double p = a * b;
+#if defined(__FMA__)
+	return (struct ddouble){ p, __builtin_fma(a, b, -p) };
+#else
+	/* Dekkerの分割．27ビットずつに分ければ部分積は正確である */
+	const double ca = 134217729.0 * a, cb = 134217729.0 * b;
+	const double ah = ca - (ca - a), al = a - ah, bh = cb - (cb - b), bl = b - bh;
+	return (struct ddouble){ p, ((ah * bh - p) + ah * bl + al * bh) + al * bl };
+#endif
+}
+
+static inline struct ddouble
+dd_add(struct ddouble a, struct ddouble b)
+{
+	struct ddouble s = dd_two_sum(a.hi, b.hi), t = dd_two_sum(a.lo, b.lo);
+
+	s = dd_quick_two_sum(s.hi, s.lo + t.hi);
+	return dd_quick_two_sum(s.hi, s.lo + t.lo);
+}
+
+/* 打ち消しの起きない和 (|b| ≪ |a| など) に限って使う速い加算．Hornerの計算向け */
+static inline struct ddouble
+dd_sloppy_add(struct ddouble a, struct ddouble b)
+{
+	struct ddouble s = dd_two_sum(a.hi, b.hi);
+
+	return dd_quick_two_sum(s.hi, s.lo + (a.lo + b.lo));
+}
+
+static inline struct ddouble
+dd_neg(struct ddouble a)
+{
+	return (struct ddouble){ -a.hi, -a.lo };
+}
+
+static inline struct ddouble
+dd_sub(struct ddouble a, struct ddouble b)
+{
+	return dd_add(a, dd_neg(b));
+}
+
+static inline struct ddouble
+dd_add_d(struct ddouble a, double b)
+{
+	struct ddouble s = dd_two_sum(a.hi, b);
+
+	return dd_quick_two_sum(s.hi, s.lo + a.lo);
+}
+
+static inline struct ddouble
+dd_mul(struct ddouble a, struct ddouble b)
+{
+	struct ddouble p = dd_two_prod(a.hi, b.hi);
+
+	return dd_quick_two_sum(p.hi, p.lo + (a.hi * b.lo + a.lo * b.hi));
+}
+
+static inline struct ddouble
+dd_mul_d(struct ddouble a, double b)
+{
+	struct ddouble p = dd_two_prod(a.hi, b);
+
+	return dd_quick_two_sum(p.hi, p.lo + a.lo * b);
+}
+
+static inline struct ddouble
+dd_div(struct ddouble a, struct ddouble b)
+{
+	const double q1 = a.hi / b.hi;
+	struct ddouble r = dd_sub(a, dd_mul_d(b, q1));
+	const double q2 = r.hi / b.hi;
+	double q3;
+
+	r = dd_sub(r, dd_mul_d(b, q2));
+	q3 = r.hi / b.hi;
+	return dd_add_d(dd_quick_two_sum(q1, q2), q3);
+}
+
+/* binary128とdoubleのビット列．軟浮動小数点の変換を避けるために使う */
+union dd_f128_bits {
+	__float128 f;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	struct { uint64_t hi, lo; } w;
+#else
+	struct { uint64_t lo, hi; } w;
+#endif
+};
+
+static inline double
+dd_pow2(int e)
+{
+	union { uint64_t u; double d; } p = { .u = (uint64_t)(e + 1023) << 52 };
+	return p.d;
+}
+
+/*
+ * doubleの範囲にあるbinary128を106ビットに丸める．仮数の上位53ビットを最近接に丸めてhiとし，
+ * 残りをloとする．指数がdoubleの正規化数に収まらない場合は軟浮動小数点で変換する．
+ */
+static inline struct ddouble
+dd_from_f128(__float128 x)
+{
+	union dd_f128_bits u = { .f = x };
+	const int e = (int)(u.w.hi >> 48 & 0x7fff) - 0x3fff;
+	uint64_t h;
+	int64_t r;
+	double hi, lo;
+
+	if (e < -900 || e > 1000)
+	{
+		hi = (double)x;
+		return (struct ddouble){ hi, isfinite(hi) ? (double)(x - hi) : 0.0 };
+	}
+	/* 仮数113ビットの上位53ビットと下位60ビット */
+	h = (u.w.hi & 0xffffffffffffULL) << 4 | u.w.lo >> 60 | 1ULL << 52;
+	r = (int64_t)(u.w.lo & 0x0fffffffffffffffULL);
+	if (r >= 1LL << 59)
+	{
+		h++;
+		r -= 1LL << 60;
+	}
+	hi = (double)h * dd_pow2(e - 52);
+	lo = (double)r * dd_pow2(e - 112);
+	if (u.w.hi >> 63)
+		return (struct ddouble){ -hi, -lo };
+	return (struct ddouble){ hi, lo };
+}
+
+static inline __float128
+dd_double_to_f128(double d)
+{
+	union { double d; uint64_t u; } b = { .d = d };
+	const uint64_t e = b.u >> 52 & 0x7ff;
+	union dd_f128_bits u;
+
+	if (e == 0 || e == 0x7ff)
+		return (__float128)d;
+	u.w.hi = (b.u & 0x8000000000000000ULL) | (e + 0x3fff - 0x3ff) << 48 | (b.u & 0xfffffffffffffULL) >> 4;
+	u.w.lo = b.u << 60;
+	return u.f;
+}
+
+static inline __float128
+dd_to_f128(struct ddouble a)
+{
+	if (a.lo == 0.0)
+		return dd_double_to_f128(a.hi);
+	return add_q(dd_double_to_f128(a.hi), dd_double_to_f128(a.lo));
+}
+
+/*
+ * QuadMath::DoubleDoubleオブジェクトとの相互変換．
+ */
+VALUE rb_doubledouble_new(struct ddouble);
+struct ddouble GetDD(VALUE);
+
+/*
+ * double-doubleによる初等関数の速い経路．相対誤差は2^-103以内で，libquadmathの数倍速い．
+ * 扱わない引数 (0，doubleの範囲外，非正規化数，無限大，NaN，定義域外など) では偽を返す．
+ */
+bool dd_expq(__float128 x, __float128 *y);
+bool dd_exp2q(__float128 x, __float128 *y);
+bool dd_logq(__float128 x, __float128 *y);
+bool dd_log2q(__float128 x, __float128 *y);
+bool dd_log10q(__float128 x, __float128 *y);
+bool dd_sqrtq(__float128 x, __float128 *y);
+bool dd_sinq(__float128 x, __float128 *y);
+bool dd_cosq(__float128 x, __float128 *y);
+bool dd_tanq(__float128 x, __float128 *y);
+
+/*
+ * 並列にしても和が変わらないように，総和はREDUCE_BLOCK個ずつの部分和を
+ * 固定した形の二分木で足し合わせる．strideは部分和の並びの間隔である．
+ */
+#define REDUCE_BLOCK 1024
+__float128 pairwise_sum_q(const __float128 *x, long n, long stride);
+
+/*
+ * 要素をgenで少しずつ作りながら総和を求める．genは i0 から n 個 (REDUCE_CHUNK個以下) の要素をyに書く．
+ * 全長の作業域を作らずに，同じ要素のベクトルをQuadMath.sumに渡したのと同じ順序で足す．
+ * genはワーカースレッドからも呼ばれるので，RubyのAPIを使ってはならない．
+ * workはGVLを解放するかとスレッド数を決める計算量である．
+ */
+#define REDUCE_CHUNK 256
+typedef void (*reduce_gen_t)(void *arg, long i0, long n, __float128 *y);
+__float128 generated_sum_q(long len, reduce_gen_t gen, void *arg, long work, bool reproducible);
+bool opt_reproducible(VALUE opts);
+
+/*
+ * QuadMath::Vectorの実体．要素は__float128か__complex128で詰めて格納する．
+ */
+enum VECTOR_ELEM_TYPES {
+	VEC_FLOAT128,
+	VEC_COMPLEX128
+};
+
+struct QVector {
+	enum VECTOR_ELEM_TYPES type;
+	long len;
+	union {
+		__float128 *f128;
+		__complex128 *c128;
+		void *ptr;
+	} data;
+};
+
+VALUE rb_qvector_new(enum VECTOR_ELEM_TYPES type, long len);
+VALUE rb_qvector_from(VALUE);
+VALUE rb_qvector_to_complex(VALUE);
+struct QVector *GetQVector(VALUE);
+bool qvector_p(VALUE);
+VALUE rb_qvector_lazy(VALUE);
+
+/*
+ * QuadMath::Matrixの実体．行優先で詰めて格納する．要素型はQVectorと共通．
+ */
+struct QMatrix {
+	enum VECTOR_ELEM_TYPES type;
+	long rows;
+	long cols;
+	union {
+		__float128 *f128;
+		__complex128 *c128;
+		void *ptr;
+	} data;
+};
+
+VALUE rb_qmatrix_new(enum VECTOR_ELEM_TYPES type, long rows, long cols);
+VALUE rb_qmatrix_from(VALUE);
+VALUE rb_qmatrix_to_complex(VALUE);
+struct QMatrix *GetQMatrix(VALUE);
+bool qmatrix_p(VALUE);
+
+/*
+ * データ並列の実行．[0, n)をgrain個ずつの区間に分けてnthreads本のスレッドでfnを呼ぶ．
+ * 各区間の計算はスレッド数によらず同じであるから，区間ごとに結果が閉じていれば決定的である．
+ * nthreadsが2以上ならfnは常駐するワーカースレッドからも呼ばれるので，RubyのAPIを使ってはならない．
+ * 1ならば呼び出したスレッドだけで計算する．
+ */
+typedef void (*parallel_func_t)(void *arg, long begin, long end);
+void quadmath_parallel_for(long n, long grain, int nthreads, parallel_func_t fn, void *arg);
+/*
+ * *posから始め，中断の要求があれば区間の取り出しをやめる．
+ * 取り出した区間は最後まで計算するので，[0, *pos)は計算済みである．すべて終えればtrueを返す．
+ */
+bool quadmath_parallel_for_at(long *pos, long n, long grain, int nthreads, parallel_func_t fn, void *arg);
+int quadmath_threads(void);
+int quadmath_opt_threads(VALUE opts);
 
 enum NUMERIC_SUBCLASSES {
 	NUM_FIXNUM,
@@ -19,6 +311,7 @@ enum NUMERIC_SUBCLASSES {
 	NUM_COMPLEX,
 	NUM_FLOAT128,
 	NUM_COMPLEX128,
+	NUM_DOUBLEDOUBLE,
 	NUM_OTHERTYPE
 };
 
@@ -53,6 +346,8 @@ convertion_num_types(VALUE obj)
 			return NUM_FLOAT128;
 		else if (CLASS_OF(obj) == rb_cComplex128)
 			return NUM_COMPLEX128;
+		else if (CLASS_OF(obj) == rb_cDoubleDouble)
+			return NUM_DOUBLEDOUBLE;
 		else
 		{
 			VALUE num_subclasses = rb_class_subclasses(rb_cNumeric);
@@ -68,6 +363,113 @@ convertion_num_types(VALUE obj)
 	}
 }
 
+/*
+ * 要素数がこの値以上のカーネルはGVLを解放して実行する．
+ * 軟浮動小数点の演算は一要素あたり数十ナノ秒かかるため，
+ * これより短い列では解放の手間のほうが大きい．
+ */
+#define NOGVL_THRESHOLD 4096
+
+/*
+ * GVLを解放した計算の中断．
+ * Thread#raise，Thread#killやシグナルが届くと，unblock関数が計算中のスレッドに中断を要求する．
+ * 長いカーネルは区切りごとにquadmath_interrupted_p()を見て，要求があれば進み具合を
+ * 引数の構造体に残してQUADMATH_INTERRUPTEDを返す．quadmath_call_nogvl()はGVLを取り戻して
+ * 割り込みを処理し，例外にならなければ(trapの処理だけで済んだ場合など)同じカーネルを続きから呼び直す．
+ * 要求を見ないカーネルは最後まで計算してから割り込みを処理する．
+ */
+#define QUADMATH_INTERRUPTED ((void *)-1)
+
+/* 要素ごとのループで中断の要求を見る間隔．一要素が数マイクロ秒でも応答は数ミリ秒に収まる */
+#define NOGVL_POLL_STRIDE 1024
+
+bool quadmath_interrupted_p(void);
+void quadmath_call_nogvl(void *(*func)(void *), void *data, long n);
+
+/*
+ * 実数列の読み出し元．
+ * RubyのArray (要素はFloat, Integer, Rational, Float128等) と
+ * pack('d*')で得られるdouble型のバイナリ文字列，実数のQuadMath::Vectorを
+ * 要素ごとに__float128で読む．
+ */
+enum REAL_SOURCE_TYPES {
+	SRC_ARRAY,
+	SRC_BINARY_DOUBLE,
+	SRC_VECTOR
+};
+
+struct real_source {
+	enum REAL_SOURCE_TYPES type;
+	VALUE obj;
+	long len;
+	const __float128 *f128;
+};
+
+static inline void
+real_source_init(struct real_source *src, VALUE obj)
+{
+	src->obj = obj;
+	src->f128 = NULL;
+	switch (TYPE(obj)) {
+	case T_ARRAY:
+		src->type = SRC_ARRAY;
+		src->len = RARRAY_LEN(obj);
+		break;
+	case T_STRING:
+		if (RSTRING_LEN(obj) % sizeof(double) != 0)
+			rb_raise(rb_eArgError, 
+			  "binary string length must be a multiple of %d", 
+			  (int)sizeof(double));
+		/* 凍結した複製から読み，読む間に元の文字列が縮んだり作り直されたりしてもかまわないようにする */
+		src->obj = rb_str_new_frozen(obj);
+		src->type = SRC_BINARY_DOUBLE;
+		src->len = RSTRING_LEN(src->obj) / (long)sizeof(double);
+		break;
+	default:
+		if (qvector_p(obj))
+		{
+			struct QVector *vec = GetQVector(obj);
+			if (vec->type != VEC_FLOAT128)
+				rb_raise(rb_eTypeError, "not a real vector");
+			src->type = SRC_VECTOR;
+			src->len = vec->len;
+			src->f128 = vec->data.f128;
+			break;
+		}
+		rb_raise(rb_eTypeError, 
+		  "can't convert %"PRIsVALUE" into sequence of %s", 
+		  rb_obj_class(obj), rb_class2name(rb_cFloat128));
+		break;
+	}
+}
+
+static inline __float128
+real_source_at(const struct real_source *src, long i)
+{
+	VALUE v;
+	double x;
+	
+	switch (src->type) {
+	case SRC_VECTOR:
+		return src->f128[i];
+		break;
+	case SRC_BINARY_DOUBLE:
+		memcpy(&x, RSTRING_PTR(src->obj) + i * sizeof(double), sizeof(double));
+		return (__float128)x;
+		break;
+	case SRC_ARRAY:
+	default:
+		v = rb_ary_entry(src->obj, i);
+		if (RB_FLOAT_TYPE_P(v))
+			return (__float128)RFLOAT_VALUE(v);
+		else if (FIXNUM_P(v))
+			return (__float128)FIX2LONG(v);
+		else
+			return num_to_cf128(v);
+		break;
+	}
+}
+
 #if defined(__cplusplus)
 }
 #endif
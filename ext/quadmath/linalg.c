@@ -0,0 +1,1929 @@
+/*******************************************************************************
+    linalg.c -- Linear Algebra of QuadMath::Matrix
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <quadmath.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+/* LU分解のパネル幅．パネル内は列ごとに消去し，右下の残りはパネル幅の階数で一度に更新する */
+#define LU_NB 32
+
+/* LAPACKのcabs1に同じ．ピボット選択には|re|+|im|で十分である */
+static inline __float128
+cabs1q(__complex128 z)
+{
+	return fabsq(crealq(z)) + fabsq(cimagq(z));
+}
+
+/* 右下の更新 A22 -= L21 U12 は行ごとに独立なので，行の区間に分けてスレッドで分け合う */
+struct lu_update {
+	void *a;
+	long n, jb, je;
+};
+
+/* parallel_forの区間は0始まりなので，je行目からの相対位置として受け取る */
+static void
+lu_update_rows_f128(void *ptr, long i0, long i1)
+{
+	const struct lu_update *up = ptr;
+	__float128 *a = up->a;
+	const long n = up->n;
+
+	for (long i = up->je + i0; i < up->je + i1; i++)
+		for (long p = up->jb; p < up->je; p++)
+		{
+			__float128 l = a[i * n + p];
+			for (long k = up->je; k < n; k++)
+				a[i * n + k] -= l * a[p * n + k];
+		}
+}
+
+static void
+lu_update_rows_c128(void *ptr, long i0, long i1)
+{
+	const struct lu_update *up = ptr;
+	__complex128 *a = up->a;
+	const long n = up->n;
+
+	for (long i = up->je + i0; i < up->je + i1; i++)
+		for (long p = up->jb; p < up->je; p++)
+		{
+			__complex128 l = a[i * n + p];
+			for (long k = up->je; k < n; k++)
+				a[i * n + k] -= l * a[p * n + k];
+		}
+}
+
+/*
+ * 行優先n x n行列aをその場でPA = LUに分解する．Lの単位対角は格納しない．
+ * piv[j]はj行目と交換した行である．特異ならば零となったピボットの列番号+1を，そうでなければ0を返す．
+ * *posの列のパネルから始め，中断の要求があれば次のパネルの位置を*posに残して-1を返す．
+ * 右下の更新はnthreads本のスレッドで行う．
+ */
+static long
+lu_factor_f128(__float128 *a, long n, long *piv, long *pos, int nthreads)
+{
+	for (long jb = *pos; jb < n; jb += LU_NB)
+	{
+		long je = jb + LU_NB < n ? jb + LU_NB : n;
+
+		if (quadmath_interrupted_p())
+		{
+			*pos = jb;
+			return -1;
+		}
+
+		/* パネルの分解 */
+		for (long j = jb; j < je; j++)
+		{
+			long p = j;
+			__float128 amax = fabsq(a[j * n + j]), pivot;
+			for (long i = j + 1; i < n; i++)
+				if (fabsq(a[i * n + j]) > amax)
+				{
+					amax = fabsq(a[i * n + j]);
+					p = i;
+				}
+			piv[j] = p;
+			if (p != j)
+				for (long k = 0; k < n; k++)
+				{
+					__float128 t = a[j * n + k];
+					a[j * n + k] = a[p * n + k];
+					a[p * n + k] = t;
+				}
+			pivot = a[j * n + j];
+			if (pivot == 0)
+				return j + 1;
+			for (long i = j + 1; i < n; i++)
+			{
+				__float128 l = a[i * n + j] /= pivot;
+				for (long k = j + 1; k < je; k++)
+					a[i * n + k] -= l * a[j * n + k];
+			}
+		}
+
+		/* U12 = L11^-1 A12 */
+		for (long j = jb; j < je; j++)
+			for (long i = j + 1; i < je; i++)
+			{
+				__float128 l = a[i * n + j];
+				for (long k = je; k < n; k++)
+					a[i * n + k] -= l * a[j * n + k];
+			}
+
+		/* A22 -= L21 U12 */
+		{
+			struct lu_update up = { a, n, jb, je };
+			quadmath_parallel_for(n - je, LU_NB, nthreads, lu_update_rows_f128, &up);
+		}
+	}
+	*pos = n;
+	return 0;
+}
+
+static long
+lu_factor_c128(__complex128 *a, long n, long *piv, long *pos, int nthreads)
+{
+	for (long jb = *pos; jb < n; jb += LU_NB)
+	{
+		long je = jb + LU_NB < n ? jb + LU_NB : n;
+
+		if (quadmath_interrupted_p())
+		{
+			*pos = jb;
+			return -1;
+		}
+
+		for (long j = jb; j < je; j++)
+		{
+			long p = j;
+			__float128 amax = cabs1q(a[j * n + j]);
+			__complex128 pivot;
+			for (long i = j + 1; i < n; i++)
+				if (cabs1q(a[i * n + j]) > amax)
+				{
+					amax = cabs1q(a[i * n + j]);
+					p = i;
+				}
+			piv[j] = p;
+			if (p != j)
+				for (long k = 0; k < n; k++)
+				{
+					__complex128 t = a[j * n + k];
+					a[j * n + k] = a[p * n + k];
+					a[p * n + k] = t;
+				}
+			pivot = a[j * n + j];
+			if (pivot == 0)
+				return j + 1;
+			for (long i = j + 1; i < n; i++)
+			{
+				__complex128 l = a[i * n + j] /= pivot;
+				for (long k = j + 1; k < je; k++)
+					a[i * n + k] -= l * a[j * n + k];
+			}
+		}
+
+		for (long j = jb; j < je; j++)
+			for (long i = j + 1; i < je; i++)
+			{
+				__complex128 l = a[i * n + j];
+				for (long k = je; k < n; k++)
+					a[i * n + k] -= l * a[j * n + k];
+			}
+
+		{
+			struct lu_update up = { a, n, jb, je };
+			quadmath_parallel_for(n - je, LU_NB, nthreads, lu_update_rows_c128, &up);
+		}
+	}
+	*pos = n;
+	return 0;
+}
+
+/*
+ * 分解済みのlu(n x n)で，行優先n x nrhsの右辺bをその場で解く．
+ */
+static void
+lu_solve_f128(const __float128 *lu, long n, const long *piv, __float128 *b, long nrhs)
+{
+	for (long i = 0; i < n; i++)
+		if (piv[i] != i)
+			for (long k = 0; k < nrhs; k++)
+			{
+				__float128 t = b[i * nrhs + k];
+				b[i * nrhs + k] = b[piv[i] * nrhs + k];
+				b[piv[i] * nrhs + k] = t;
+			}
+	for (long i = 1; i < n; i++)
+		for (long p = 0; p < i; p++)
+		{
+			__float128 l = lu[i * n + p];
+			for (long k = 0; k < nrhs; k++)
+				b[i * nrhs + k] -= l * b[p * nrhs + k];
+		}
+	for (long i = n - 1; i >= 0; i--)
+	{
+		for (long p = i + 1; p < n; p++)
+		{
+			__float128 u = lu[i * n + p];
+			for (long k = 0; k < nrhs; k++)
+				b[i * nrhs + k] -= u * b[p * nrhs + k];
+		}
+		for (long k = 0; k < nrhs; k++)
+			b[i * nrhs + k] /= lu[i * n + i];
+	}
+}
+
+static void
+lu_solve_c128(const __complex128 *lu, long n, const long *piv, __complex128 *b, long nrhs)
+{
+	for (long i = 0; i < n; i++)
+		if (piv[i] != i)
+			for (long k = 0; k < nrhs; k++)
+			{
+				__complex128 t = b[i * nrhs + k];
+				b[i * nrhs + k] = b[piv[i] * nrhs + k];
+				b[piv[i] * nrhs + k] = t;
+			}
+	for (long i = 1; i < n; i++)
+		for (long p = 0; p < i; p++)
+		{
+			__complex128 l = lu[i * n + p];
+			for (long k = 0; k < nrhs; k++)
+				b[i * nrhs + k] -= l * b[p * nrhs + k];
+		}
+	for (long i = n - 1; i >= 0; i--)
+	{
+		for (long p = i + 1; p < n; p++)
+		{
+			__complex128 u = lu[i * n + p];
+			for (long k = 0; k < nrhs; k++)
+				b[i * nrhs + k] -= u * b[p * nrhs + k];
+		}
+		for (long k = 0; k < nrhs; k++)
+			b[i * nrhs + k] /= lu[i * n + i];
+	}
+}
+
+struct lu_args {
+	enum VECTOR_ELEM_TYPES type;
+	long n;
+	void *a;
+	long *piv;
+	void *b;
+	long nrhs;
+	long singular;
+	long jb;
+	int nthreads;
+};
+
+static void *
+lu_nogvl(void *ptr)
+{
+	struct lu_args *args = ptr;
+
+	if (args->jb < args->n)
+	{
+		if (args->type == VEC_FLOAT128)
+			args->singular = lu_factor_f128(args->a, args->n, args->piv, &args->jb, args->nthreads);
+		else
+			args->singular = lu_factor_c128(args->a, args->n, args->piv, &args->jb, args->nthreads);
+		if (args->singular < 0)
+			return QUADMATH_INTERRUPTED;
+	}
+	else
+		args->singular = 0;
+
+	if (!args->singular && args->b != NULL)
+	{
+		if (args->type == VEC_FLOAT128)
+			lu_solve_f128(args->a, args->n, args->piv, args->b, args->nrhs);
+		else
+			lu_solve_c128(args->a, args->n, args->piv, args->b, args->nrhs);
+	}
+	return NULL;
+}
+
+static struct QMatrix *
+check_square(VALUE self)
+{
+	struct QMatrix *mat = GetQMatrix(self);
+
+	if (mat->rows != mat->cols)
+		rb_raise(rb_eArgError,
+		  "not a square matrix (%ldx%ld)", mat->rows, mat->cols);
+
+	return mat;
+}
+
+static void
+raise_singular(long col)
+{
+	rb_raise(rb_eZeroDivError, "singular matrix (zero pivot at column %ld)", col - 1);
+}
+
+/*
+ *  call-seq:
+ *    lu -> [QuadMath::Matrix, QuadMath::Matrix, Array]
+ *
+ *  Returns the LU factorization with partial pivoting as <code>[l, u, perm]</code>,
+ *  where +l+ is unit lower triangular, +u+ is upper triangular and
+ *  +perm+ is the row permutation such that row +i+ of <code>l * u</code> is row <code>perm[i]</code> of +self+.
+ *  The factorization runs in panels on packed storage without the GVL.
+ *  If a pivot is exactly zero, a ZeroDivisionError is raised.
+ *
+ *    l, u, perm = QuadMath::Matrix[[1, 2], [3, 4]].lu
+ *    u # => QuadMath::Matrix[[3.0, 4.0], [0.0, 0.6666666666666666666666666666666667]]
+ *    perm # => [1, 0]
+ */
+static VALUE
+qmatrix_lu(VALUE self)
+{
+	struct QMatrix *mat = check_square(self), *l, *u;
+	long n = mat->rows;
+	VALUE lu = rb_obj_dup(self), vl, vu, perm, tmp;
+	struct lu_args args;
+	long *piv = ALLOCV_N(long, tmp, n > 0 ? n : 1);
+
+	args.type = mat->type;
+	args.n = n;
+	args.a = GetQMatrix(lu)->data.ptr;
+	args.piv = piv;
+	args.b = NULL;
+	args.nrhs = 0;
+	args.jb = 0;
+	args.nthreads = n >= 2 * LU_NB ? quadmath_threads() : 1;
+	quadmath_call_nogvl(lu_nogvl, &args, n * n * n / 3);
+	if (args.singular)
+	{
+		ALLOCV_END(tmp);
+		raise_singular(args.singular);
+	}
+
+	vl = rb_qmatrix_new(mat->type, n, n);
+	vu = rb_qmatrix_new(mat->type, n, n);
+	l = GetQMatrix(vl);
+	u = GetQMatrix(vu);
+	mat = GetQMatrix(lu);
+	for (long i = 0; i < n; i++)
+		for (long j = 0; j < n; j++)
+		{
+			if (mat->type == VEC_FLOAT128)
+			{
+				__float128 x = mat->data.f128[i * n + j];
+				if (j < i)
+					l->data.f128[i * n + j] = x;
+				else
+					u->data.f128[i * n + j] = x;
+				if (j == i)
+					l->data.f128[i * n + j] = 1;
+			}
+			else
+			{
+				__complex128 z = mat->data.c128[i * n + j];
+				if (j < i)
+					l->data.c128[i * n + j] = z;
+				else
+					u->data.c128[i * n + j] = z;
+				if (j == i)
+					l->data.c128[i * n + j] = 1;
+			}
+		}
+
+	perm = rb_ary_new_capa(n);
+	for (long i = 0; i < n; i++)
+		rb_ary_push(perm, LONG2FIX(i));
+	for (long i = 0; i < n; i++)
+		if (piv[i] != i)
+		{
+			VALUE t = RARRAY_AREF(perm, i);
+			rb_ary_store(perm, i, RARRAY_AREF(perm, piv[i]));
+			rb_ary_store(perm, piv[i], t);
+		}
+	ALLOCV_END(tmp);
+
+	return rb_ary_new_from_args(3, vl, vu, perm);
+}
+
+/*
+ *  call-seq:
+ *    solve(b) -> QuadMath::Vector | QuadMath::Matrix
+ *
+ *  Solves <code>self * x = b</code> by LU factorization with partial pivoting and returns +x+.
+ *  If +b+ is a QuadMath::Matrix, each column is a right-hand side and a matrix is returned;
+ *  otherwise +b+ is converted by QuadMath::Vector.from and a vector is returned.
+ *  A real operand is promoted when the other is complex.
+ *  If the matrix is singular, a ZeroDivisionError is raised.
+ *
+ *    QuadMath::Matrix[[2, 1], [1, 3]].solve([3, 5]) # => QuadMath::Vector[0.8, 1.4]
+ */
+static VALUE
+qmatrix_solve(VALUE self, VALUE b)
+{
+	struct QMatrix *mat = check_square(self);
+	enum VECTOR_ELEM_TYPES type;
+	struct lu_args args;
+	VALUE lu, x, tmp;
+	long n = mat->rows, rows, nrhs;
+
+	if (qmatrix_p(b))
+	{
+		struct QMatrix *mb = GetQMatrix(b);
+		type = mat->type == VEC_COMPLEX128 || mb->type == VEC_COMPLEX128 ?
+			VEC_COMPLEX128 : VEC_FLOAT128;
+		x = rb_obj_dup(type == VEC_COMPLEX128 ? rb_qmatrix_to_complex(b) : b);
+		rows = mb->rows;
+		nrhs = mb->cols;
+		args.b = GetQMatrix(x)->data.ptr;
+	}
+	else
+	{
+		struct QVector *vb;
+		b = rb_qvector_from(b);
+		vb = GetQVector(b);
+		type = mat->type == VEC_COMPLEX128 || vb->type == VEC_COMPLEX128 ?
+			VEC_COMPLEX128 : VEC_FLOAT128;
+		x = rb_obj_dup(type == VEC_COMPLEX128 ? rb_qvector_to_complex(b) : b);
+		rows = vb->len;
+		nrhs = 1;
+		args.b = GetQVector(x)->data.ptr;
+	}
+	if (rows != n)
+		rb_raise(rb_eArgError, "size mismatch (%ld for %ld)", rows, n);
+
+	lu = rb_obj_dup(type == VEC_COMPLEX128 ? rb_qmatrix_to_complex(self) : self);
+	args.type = type;
+	args.n = n;
+	args.a = GetQMatrix(lu)->data.ptr;
+	args.piv = ALLOCV_N(long, tmp, n > 0 ? n : 1);
+	args.nrhs = nrhs;
+	args.jb = 0;
+	args.nthreads = n >= 2 * LU_NB ? quadmath_threads() : 1;
+	quadmath_call_nogvl(lu_nogvl, &args, n * n * (n / 3 + nrhs));
+	ALLOCV_END(tmp);
+	RB_GC_GUARD(lu);
+
+	if (args.singular)
+		raise_singular(args.singular);
+
+	return x;
+}
+
+/*
+ * 混合精度の反復改良．分解はdoubleで行い，残差r = b - Axだけを__float128で求める．
+ * 条件数がdoubleの逆機械イプシロンより十分小さければ，一反復ごとに約16桁ずつ改良される．
+ */
+#define REFINE_MAX_ITER 20
+
+static long
+lu_factor_d(double *a, long n, long *piv)
+{
+	for (long j = 0; j < n; j++)
+	{
+		long p = j;
+		double amax = fabs(a[j * n + j]), pivot;
+		for (long i = j + 1; i < n; i++)
+			if (fabs(a[i * n + j]) > amax)
+			{
+				amax = fabs(a[i * n + j]);
+				p = i;
+			}
+		piv[j] = p;
+		if (p != j)
+			for (long k = 0; k < n; k++)
+			{
+				double t = a[j * n + k];
+				a[j * n + k] = a[p * n + k];
+				a[p * n + k] = t;
+			}
+		pivot = a[j * n + j];
+		if (pivot == 0)
+			return j + 1;
+		for (long i = j + 1; i < n; i++)
+		{
+			double l = a[i * n + j] /= pivot;
+			for (long k = j + 1; k < n; k++)
+				a[i * n + k] -= l * a[j * n + k];
+		}
+	}
+	return 0;
+}
+
+static void
+lu_solve_d(const double *lu, long n, const long *piv, double *b)
+{
+	for (long i = 0; i < n; i++)
+		if (piv[i] != i)
+		{
+			double t = b[i];
+			b[i] = b[piv[i]];
+			b[piv[i]] = t;
+		}
+	for (long i = 1; i < n; i++)
+		for (long p = 0; p < i; p++)
+			b[i] -= lu[i * n + p] * b[p];
+	for (long i = n - 1; i >= 0; i--)
+	{
+		for (long p = i + 1; p < n; p++)
+			b[i] -= lu[i * n + p] * b[p];
+		b[i] /= lu[i * n + i];
+	}
+}
+
+struct refine_args {
+	long n;
+	const __float128 *a;
+	const __float128 *b;
+	__float128 *x;
+	double *ad;
+	double *rd;
+	long *piv;
+	int max_iter;
+	long singular;
+	int iter;
+	bool converged;
+};
+
+static void *
+refine_nogvl(void *ptr)
+{
+	struct refine_args *args = ptr;
+	const long n = args->n;
+	__float128 prev = HUGE_VALQ;
+
+	for (long i = 0; i < n * n; i++)
+		args->ad[i] = (double)args->a[i];
+	args->singular = lu_factor_d(args->ad, n, args->piv);
+	if (args->singular)
+		return NULL;
+
+	for (long i = 0; i < n; i++)
+		args->rd[i] = (double)args->b[i];
+	lu_solve_d(args->ad, n, args->piv, args->rd);
+	for (long i = 0; i < n; i++)
+		args->x[i] = args->rd[i];
+
+	args->converged = false;
+	for (args->iter = 0; args->iter < args->max_iter; args->iter++)
+	{
+		__float128 dxmax = 0, xmax = 0;
+
+		for (long i = 0; i < n; i++)
+		{
+			__float128 r = args->b[i];
+			for (long j = 0; j < n; j++)
+				r = fma_q(-args->a[i * n + j], args->x[j], r);
+			args->rd[i] = (double)r;
+		}
+		lu_solve_d(args->ad, n, args->piv, args->rd);
+		for (long i = 0; i < n; i++)
+		{
+			args->x[i] += args->rd[i];
+			if (dxmax < fabsq(args->rd[i]))  dxmax = fabsq(args->rd[i]);
+			if (xmax < fabsq(args->x[i]))  xmax = fabsq(args->x[i]);
+		}
+		if (dxmax <= FLT128_EPSILON * xmax)
+		{
+			args->converged = true;
+			args->iter++;
+			break;
+		}
+		/* 補正量が半分にも減らなければ，条件数が大きすぎて収束しない */
+		if (!(dxmax < prev / 2))
+			break;
+		prev = dxmax;
+	}
+	return NULL;
+}
+
+static VALUE
+refine_matrix_source(VALUE a, long n, __float128 *aq)
+{
+	struct real_source src;
+
+	if (qmatrix_p(a))
+	{
+		struct QMatrix *mat = GetQMatrix(a);
+		if (mat->type != VEC_FLOAT128)
+			rb_raise(rb_eTypeError, "not a real matrix");
+		if (mat->rows != n || mat->cols != n)
+			rb_raise(rb_eArgError, "size mismatch (%ldx%ld for %ldx%ld)",
+			  mat->rows, mat->cols, n, n);
+		memcpy(aq, mat->data.f128, sizeof(__float128) * n * n);
+	}
+	else if (RB_TYPE_P(a, T_ARRAY))
+	{
+		if (RARRAY_LEN(a) != n)
+			rb_raise(rb_eArgError, "size mismatch (%ld rows for %ld)", RARRAY_LEN(a), n);
+		for (long i = 0; i < n; i++)
+		{
+			real_source_init(&src, RARRAY_AREF(a, i));
+			if (src.len != n)
+				rb_raise(rb_eArgError, "row size differs (%ld should be %ld)", src.len, n);
+			for (long j = 0; j < n; j++)
+				aq[i * n + j] = real_source_at(&src, j);
+		}
+	}
+	else
+	{
+		real_source_init(&src, a);
+		if (src.len != n * n)
+			rb_raise(rb_eArgError, "size mismatch (%ld for %ld)", src.len, n * n);
+		for (long i = 0; i < n * n; i++)
+			aq[i] = real_source_at(&src, i);
+	}
+	return a;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.refine_solve(a, b, max_iter: 20) -> QuadMath::Vector
+ *
+ *  Solves the real system <code>a * x = b</code> by mixed-precision iterative refinement.
+ *  +a+ is factorized once in hardware double; residuals <code>b - a * x</code> are accumulated in __float128 by fused multiply-adds,
+ *  and corrections are added until they are below the Float128 epsilon relative to +x+.
+ *  +a+ is a real QuadMath::Matrix, an Array of rows, or a binary String of <code>n * n</code> doubles in row order;
+ *  +b+ is any real sequence accepted by QuadMath.dot.
+ *  The result is nearly as accurate as a quad solve when +a+ is well conditioned for double.
+ *  If the refinement stagnates, a warning is issued and the last iterate is returned.
+ *
+ *    QuadMath.refine_solve([[3, 1], [1, 3]], [1, 0]) # => QuadMath::Vector[0.375, -0.125]
+ */
+static VALUE
+quadmath_refine_solve(int argc, VALUE *argv, VALUE unused_obj)
+{
+	static ID kwds[1];
+	VALUE a, b, opts, max_iter = Qundef, x, tmp;
+	struct real_source src;
+	struct refine_args args;
+	long n;
+	char *buf;
+
+	if (!kwds[0])  kwds[0] = rb_intern_const("max_iter");
+
+	rb_scan_args(argc, argv, "2:", &a, &b, &opts);
+	if (!NIL_P(opts))
+		rb_get_kwargs(opts, kwds, 0, 1, &max_iter);
+
+	real_source_init(&src, b);
+	n = src.len;
+	if (n > 0 && n > LONG_MAX / n / (long)sizeof(__float128))
+		rb_raise(rb_eArgError, "system too big");
+
+	x = rb_qvector_new(VEC_FLOAT128, n);
+	buf = ALLOCV(tmp, (sizeof(__float128) * (n * n + n)) + sizeof(double) * (n * n + n) + sizeof(long) * n + 1);
+	args.n = n;
+	args.a = (__float128 *)buf;
+	args.b = (__float128 *)buf + n * n;
+	args.ad = (double *)(buf + sizeof(__float128) * (n * n + n));
+	args.rd = args.ad + n * n;
+	args.piv = (long *)(args.rd + n);
+	args.x = GetQVector(x)->data.f128;
+	args.max_iter = max_iter == Qundef || NIL_P(max_iter) ? REFINE_MAX_ITER : NUM2INT(max_iter);
+
+	refine_matrix_source(a, n, (__float128 *)args.a);
+	for (long i = 0; i < n; i++)
+		((__float128 *)args.b)[i] = real_source_at(&src, i);
+
+	quadmath_call_nogvl(refine_nogvl, &args, n * n * n / 3);
+	ALLOCV_END(tmp);
+	RB_GC_GUARD(b);
+	RB_GC_GUARD(src.obj);
+
+	if (args.singular)
+		raise_singular(args.singular);
+	if (!args.converged && n > 0)
+		rb_warn("refine_solve did not converge in %d iterations", args.iter);
+
+	return x;
+}
+
+/*
+ * Householder QR．列をQR_NB本ずつのパネルにまとめ，パネル内は一本ずつ反射を当て，
+ * 右側の残りにはコンパクトWY表現 I - V T V^H でまとめて当てる．
+ * 行優先の格納を行方向に二度なめるだけで済むよう，W = V^H A22，A22 -= V (T^H W)の順に計算する．
+ */
+#define QR_NB 32
+
+/* 刻み幅strideで並ぶlen個の要素(一要素あたりwidth個の__float128)のユークリッドノルム */
+static __float128
+strided_nrm2(const __float128 *x, long len, long stride, int width)
+{
+	__float128 ssq = 0, scale = 0;
+
+	for (long i = 0; i < len; i++)
+		for (int w = 0; w < width; w++)
+			ssq = fma_q(x[i * stride + w], x[i * stride + w], ssq);
+	if (finiteq(ssq) && ssq >= FLT128_MIN)
+		return sqrtq(ssq);
+
+	for (long i = 0; i < len; i++)
+		for (int w = 0; w < width; w++)
+		{
+			__float128 ax = fabsq(x[i * stride + w]);
+			if (isinfq(ax))
+				return HUGE_VALQ;
+			if (scale < ax)
+				scale = ax;
+		}
+	if (scale == 0 || isnanq(ssq))
+		return scale == 0 ? 0 : nanq("");
+
+	ssq = 0;
+	for (long i = 0; i < len; i++)
+		for (int w = 0; w < width; w++)
+		{
+			__float128 t = x[i * stride + w] / scale;
+			ssq = fma_q(t, t, ssq);
+		}
+	return scale * sqrtq(ssq);
+}
+
+/* a[j][j]以下の列から反射ベクトルを作り，a[j+1:][j]にvを，a[j][j]にbetaを書く(LAPACKのlarfg) */
+static __float128
+house_f128(__float128 *a, long m, long n, long j)
+{
+	__float128 alpha = a[j * n + j], xnorm, beta, tau, scale;
+
+	xnorm = strided_nrm2(a + (j + 1) * n + j, m - j - 1, n, 1);
+	if (xnorm == 0)
+		return 0;
+
+	beta = -copysignq(hypotq(alpha, xnorm), alpha);
+	tau = (beta - alpha) / beta;
+	scale = 1 / (alpha - beta);
+	for (long i = j + 1; i < m; i++)
+		a[i * n + j] *= scale;
+	a[j * n + j] = beta;
+
+	return tau;
+}
+
+static __complex128
+house_c128(__complex128 *a, long m, long n, long j)
+{
+	__complex128 alpha = a[j * n + j], tau, scale;
+	__float128 xnorm, beta;
+
+	xnorm = strided_nrm2((__float128 *)(a + (j + 1) * n + j), m - j - 1, 2 * n, 2);
+	if (xnorm == 0 && cimagq(alpha) == 0)
+		return 0;
+
+	beta = -copysignq(hypotq(hypotq(crealq(alpha), cimagq(alpha)), xnorm), crealq(alpha));
+	tau = (beta - alpha) / beta;
+	scale = 1 / (alpha - beta);
+	for (long i = j + 1; i < m; i++)
+		a[i * n + j] *= scale;
+	a[j * n + j] = beta;
+
+	return tau;
+}
+
+/*
+ * 反射 I - tau v v^T (vはa[j:][j]，v[0] = 1)を，列c0..c1-1の行j以降へ当てる．wは作業域．
+ */
+static void
+house_apply_f128(__float128 *a, long m, long n, long j, __float128 tau,
+                 __float128 *c, long ldc, long c0, long c1, __float128 *w)
+{
+	if (tau == 0)  return;
+
+	for (long k = c0; k < c1; k++)
+		w[k] = c[j * ldc + k];
+	for (long i = j + 1; i < m; i++)
+	{
+		__float128 v = a[i * n + j];
+		for (long k = c0; k < c1; k++)
+			w[k] += v * c[i * ldc + k];
+	}
+	for (long k = c0; k < c1; k++)
+		c[j * ldc + k] -= tau * w[k];
+	for (long i = j + 1; i < m; i++)
+	{
+		__float128 tv = tau * a[i * n + j];
+		for (long k = c0; k < c1; k++)
+			c[i * ldc + k] -= tv * w[k];
+	}
+}
+
+/* 反射 I - tau v v^H を当てる */
+static void
+house_apply_c128(__complex128 *a, long m, long n, long j, __complex128 tau,
+                 __complex128 *c, long ldc, long c0, long c1, __complex128 *w)
+{
+	if (tau == 0)  return;
+
+	for (long k = c0; k < c1; k++)
+		w[k] = c[j * ldc + k];
+	for (long i = j + 1; i < m; i++)
+	{
+		__complex128 v = conjq(a[i * n + j]);
+		for (long k = c0; k < c1; k++)
+			w[k] += v * c[i * ldc + k];
+	}
+	for (long k = c0; k < c1; k++)
+		c[j * ldc + k] -= tau * w[k];
+	for (long i = j + 1; i < m; i++)
+	{
+		__complex128 tv = tau * a[i * n + j];
+		for (long k = c0; k < c1; k++)
+			c[i * ldc + k] -= tv * w[k];
+	}
+}
+
+/* パネルjb..je-1の反射の積の上三角因子T(nb x nb)を作る(LAPACKのlarft) */
+static void
+qr_larft_f128(const __float128 *a, long m, long n, long jb, long je, const __float128 *tau, __float128 *t)
+{
+	long nb = je - jb;
+
+	for (long p = 0; p < nb; p++)
+	{
+		long jp = jb + p;
+		for (long r = 0; r < p; r++)
+		{
+			/* z_r = V[:,r]^T v_p */
+			__float128 z = a[jp * n + jb + r];
+			for (long i = jp + 1; i < m; i++)
+				z += a[i * n + jb + r] * a[i * n + jp];
+			t[r * nb + p] = -tau[jp] * z;
+		}
+		/* T[0:p, p] = T[0:p, 0:p] * (-tau_p z) */
+		for (long r = 0; r < p; r++)
+		{
+			__float128 s = 0;
+			for (long q = r; q < p; q++)
+				s += t[r * nb + q] * t[q * nb + p];
+			t[r * nb + p] = s;
+		}
+		t[p * nb + p] = tau[jp];
+		for (long r = p + 1; r < nb; r++)
+			t[r * nb + p] = 0;
+	}
+}
+
+static void
+qr_larft_c128(const __complex128 *a, long m, long n, long jb, long je, const __complex128 *tau, __complex128 *t)
+{
+	long nb = je - jb;
+
+	for (long p = 0; p < nb; p++)
+	{
+		long jp = jb + p;
+		for (long r = 0; r < p; r++)
+		{
+			__complex128 z = conjq(a[jp * n + jb + r]);
+			for (long i = jp + 1; i < m; i++)
+				z += conjq(a[i * n + jb + r]) * a[i * n + jp];
+			t[r * nb + p] = -tau[jp] * z;
+		}
+		for (long r = 0; r < p; r++)
+		{
+			__complex128 s = 0;
+			for (long q = r; q < p; q++)
+				s += t[r * nb + q] * t[q * nb + p];
+			t[r * nb + p] = s;
+		}
+		t[p * nb + p] = tau[jp];
+		for (long r = p + 1; r < nb; r++)
+			t[r * nb + p] = 0;
+	}
+}
+
+/* 反射ベクトルの要素V[i][p]．対角は1，その上は0 */
+#define QR_V(a, n, jb, i, p) \
+	((i) < (jb) + (p) ? 0 : (i) == (jb) + (p) ? 1 : (a)[(i) * (n) + (jb) + (p)])
+
+/* A22 = (I - V T V^T)^T A22．wは(nb x n)の作業域 */
+static void
+qr_larfb_f128(__float128 *a, long m, long n, long jb, long je, const __float128 *t, __float128 *w)
+{
+	long nb = je - jb;
+
+	for (long p = 0; p < nb; p++)
+		for (long k = je; k < n; k++)
+			w[p * n + k] = 0;
+	for (long i = jb; i < m; i++)
+		for (long p = 0; p < nb; p++)
+		{
+			__float128 v = QR_V(a, n, jb, i, p);
+			if (v == 0)  continue;
+			for (long k = je; k < n; k++)
+				w[p * n + k] += v * a[i * n + k];
+		}
+	/* W = T^T W．Tは上三角なので下の行から上書きできる */
+	for (long p = nb - 1; p >= 0; p--)
+		for (long k = je; k < n; k++)
+		{
+			__float128 s = 0;
+			for (long q = 0; q <= p; q++)
+				s += t[q * nb + p] * w[q * n + k];
+			w[p * n + k] = s;
+		}
+	for (long i = jb; i < m; i++)
+		for (long p = 0; p < nb; p++)
+		{
+			__float128 v = QR_V(a, n, jb, i, p);
+			if (v == 0)  continue;
+			for (long k = je; k < n; k++)
+				a[i * n + k] -= v * w[p * n + k];
+		}
+}
+
+static void
+qr_larfb_c128(__complex128 *a, long m, long n, long jb, long je, const __complex128 *t, __complex128 *w)
+{
+	long nb = je - jb;
+
+	for (long p = 0; p < nb; p++)
+		for (long k = je; k < n; k++)
+			w[p * n + k] = 0;
+	for (long i = jb; i < m; i++)
+		for (long p = 0; p < nb; p++)
+		{
+			__complex128 v = conjq(QR_V(a, n, jb, i, p));
+			if (v == 0)  continue;
+			for (long k = je; k < n; k++)
+				w[p * n + k] += v * a[i * n + k];
+		}
+	for (long p = nb - 1; p >= 0; p--)
+		for (long k = je; k < n; k++)
+		{
+			__complex128 s = 0;
+			for (long q = 0; q <= p; q++)
+				s += conjq(t[q * nb + p]) * w[q * n + k];
+			w[p * n + k] = s;
+		}
+	for (long i = jb; i < m; i++)
+		for (long p = 0; p < nb; p++)
+		{
+			__complex128 v = QR_V(a, n, jb, i, p);
+			if (v == 0)  continue;
+			for (long k = je; k < n; k++)
+				a[i * n + k] -= v * w[p * n + k];
+		}
+}
+
+/*
+ * 行優先m x n行列aをその場でQRに分解する．上三角にR，対角より下に反射ベクトルが残る．
+ * tauはmin(m, n)個，workは(QR_NB + 1) * n + QR_NB * QR_NB個の作業域．
+ * *posの列のパネルから始め，中断の要求があれば次のパネルの位置を*posに残してfalseを返す．
+ */
+static bool
+qr_factor_f128(__float128 *a, long m, long n, __float128 *tau, __float128 *work, long *pos)
+{
+	long k = m < n ? m : n;
+	__float128 *w = work, *t = work + QR_NB * n;
+
+	for (long jb = *pos; jb < k; jb += QR_NB)
+	{
+		long je = jb + QR_NB < k ? jb + QR_NB : k;
+
+		if (quadmath_interrupted_p())
+		{
+			*pos = jb;
+			return false;
+		}
+
+		for (long j = jb; j < je; j++)
+		{
+			tau[j] = house_f128(a, m, n, j);
+			house_apply_f128(a, m, n, j, tau[j], a, n, j + 1, je, w);
+		}
+		if (je < n)
+		{
+			qr_larft_f128(a, m, n, jb, je, tau, t);
+			qr_larfb_f128(a, m, n, jb, je, t, w);
+		}
+	}
+	*pos = k;
+	return true;
+}
+
+static bool
+qr_factor_c128(__complex128 *a, long m, long n, __complex128 *tau, __complex128 *work, long *pos)
+{
+	long k = m < n ? m : n;
+	__complex128 *w = work, *t = work + QR_NB * n;
+
+	for (long jb = *pos; jb < k; jb += QR_NB)
+	{
+		long je = jb + QR_NB < k ? jb + QR_NB : k;
+
+		if (quadmath_interrupted_p())
+		{
+			*pos = jb;
+			return false;
+		}
+
+		for (long j = jb; j < je; j++)
+		{
+			tau[j] = house_c128(a, m, n, j);
+			house_apply_c128(a, m, n, j, conjq(tau[j]), a, n, j + 1, je, w);
+		}
+		if (je < n)
+		{
+			qr_larft_c128(a, m, n, jb, je, tau, t);
+			qr_larfb_c128(a, m, n, jb, je, t, w);
+		}
+	}
+	*pos = k;
+	return true;
+}
+
+enum QR_JOBS {
+	QR_JOB_FACTOR,
+	QR_JOB_LSTSQ
+};
+
+struct qr_args {
+	enum VECTOR_ELEM_TYPES type;
+	enum QR_JOBS job;
+	long m, n;
+	void *a;
+	void *tau;
+	void *work;
+	void *q;     /* QR_JOB_FACTOR: m x k のQ */
+	void *b;     /* QR_JOB_LSTSQ: m x nrhs の右辺．解は先頭n行に入る */
+	long nrhs;
+	long singular;
+	long jb;
+};
+
+static void *
+qr_nogvl(void *ptr)
+{
+	struct qr_args *args = ptr;
+	const long m = args->m, n = args->n, k = m < n ? m : n;
+
+	if (args->type == VEC_FLOAT128)
+	{
+		__float128 *a = args->a, *tau = args->tau, *w = args->work;
+		if (!qr_factor_f128(a, m, n, tau, w, &args->jb))
+			return QUADMATH_INTERRUPTED;
+		if (args->job == QR_JOB_FACTOR)
+		{
+			/* Q = H_0 H_1 ... H_{k-1} I */
+			__float128 *q = args->q;
+			for (long i = 0; i < k; i++)
+				q[i * k + i] = 1;
+			for (long j = k - 1; j >= 0; j--)
+				house_apply_f128(a, m, n, j, tau[j], q, k, j, k, w);
+		}
+		else
+		{
+			__float128 *b = args->b;
+			const long nrhs = args->nrhs;
+			for (long j = 0; j < n; j++)
+				house_apply_f128(a, m, n, j, tau[j], b, nrhs, 0, nrhs, w);
+			for (long i = n - 1; i >= 0; i--)
+			{
+				if (a[i * n + i] == 0)
+				{
+					args->singular = i + 1;
+					return NULL;
+				}
+				for (long p = i + 1; p < n; p++)
+					for (long c = 0; c < nrhs; c++)
+						b[i * nrhs + c] -= a[i * n + p] * b[p * nrhs + c];
+				for (long c = 0; c < nrhs; c++)
+					b[i * nrhs + c] /= a[i * n + i];
+			}
+		}
+	}
+	else
+	{
+		__complex128 *a = args->a, *tau = args->tau, *w = args->work;
+		if (!qr_factor_c128(a, m, n, tau, w, &args->jb))
+			return QUADMATH_INTERRUPTED;
+		if (args->job == QR_JOB_FACTOR)
+		{
+			__complex128 *q = args->q;
+			for (long i = 0; i < k; i++)
+				q[i * k + i] = 1;
+			for (long j = k - 1; j >= 0; j--)
+				house_apply_c128(a, m, n, j, tau[j], q, k, j, k, w);
+		}
+		else
+		{
+			__complex128 *b = args->b;
+			const long nrhs = args->nrhs;
+			for (long j = 0; j < n; j++)
+				house_apply_c128(a, m, n, j, conjq(tau[j]), b, nrhs, 0, nrhs, w);
+			for (long i = n - 1; i >= 0; i--)
+			{
+				if (a[i * n + i] == 0)
+				{
+					args->singular = i + 1;
+					return NULL;
+				}
+				for (long p = i + 1; p < n; p++)
+					for (long c = 0; c < nrhs; c++)
+						b[i * nrhs + c] -= a[i * n + p] * b[p * nrhs + c];
+				for (long c = 0; c < nrhs; c++)
+					b[i * nrhs + c] /= a[i * n + i];
+			}
+		}
+	}
+	return NULL;
+}
+
+static void *
+qr_alloc_work(struct qr_args *args, VALUE *tmp)
+{
+	size_t elem_size = args->type == VEC_FLOAT128 ? sizeof(__float128) : sizeof(__complex128);
+	long k = args->m < args->n ? args->m : args->n;
+	long width = args->n > args->nrhs ? args->n : args->nrhs;
+	long size = (k + 1) + (QR_NB + 1) * (width + 1) + QR_NB * QR_NB;
+	char *buf = rb_alloc_tmp_buffer2(tmp, size, elem_size);
+
+	args->tau = buf;
+	args->work = buf + elem_size * (k + 1);
+	return buf;
+}
+
+/*
+ *  call-seq:
+ *    qr -> [QuadMath::Matrix, QuadMath::Matrix]
+ *
+ *  Returns the thin QR decomposition <code>[q, r]</code> by Householder reflections,
+ *  where +q+ is m x k with orthonormal columns, +r+ is k x n upper triangular and k is the smaller of m and n.
+ *  Reflections are applied to the trailing columns in blocks, and the decomposition runs without the GVL.
+ *
+ *    q, r = QuadMath::Matrix[[3, 1], [4, 2]].qr
+ *    r # => QuadMath::Matrix[[-5.0, -2.2], [0.0, 0.4]]
+ */
+static VALUE
+qmatrix_qr(VALUE self)
+{
+	struct QMatrix *mat = GetQMatrix(self), *r;
+	long m = mat->rows, n = mat->cols, k = m < n ? m : n;
+	VALUE a = rb_obj_dup(self), q, vr, tmp;
+	struct qr_args args;
+
+	args.type = mat->type;
+	args.job = QR_JOB_FACTOR;
+	args.m = m;
+	args.n = n;
+	args.a = GetQMatrix(a)->data.ptr;
+	args.nrhs = 0;
+	args.b = NULL;
+	args.singular = 0;
+	args.jb = 0;
+	q = rb_qmatrix_new(mat->type, m, k);
+	args.q = GetQMatrix(q)->data.ptr;
+	qr_alloc_work(&args, &tmp);
+	quadmath_call_nogvl(qr_nogvl, &args, m * n * k);
+	ALLOCV_END(tmp);
+
+	vr = rb_qmatrix_new(mat->type, k, n);
+	r = GetQMatrix(vr);
+	mat = GetQMatrix(a);
+	for (long i = 0; i < k; i++)
+		for (long j = i; j < n; j++)
+			if (mat->type == VEC_FLOAT128)
+				r->data.f128[i * n + j] = mat->data.f128[i * n + j];
+			else
+				r->data.c128[i * n + j] = mat->data.c128[i * n + j];
+
+	return rb_assoc_new(q, vr);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.lstsq(a, b) -> QuadMath::Vector | QuadMath::Matrix
+ *
+ *  Returns +x+ minimizing the 2-norm of <code>a * x - b</code> by Householder QR.
+ *  +a+ is a QuadMath::Matrix or an Array of rows with at least as many rows as columns and full column rank.
+ *  If +b+ is a QuadMath::Matrix, each column is fitted and a matrix is returned; otherwise a vector is returned.
+ *  Q is never formed; the reflections are applied to +b+ directly.
+ *  If +a+ is rank deficient, a ZeroDivisionError is raised.
+ *
+ *    QuadMath.lstsq([[1, 0], [1, 1], [1, 2]], [1, 2, 4]) # => QuadMath::Vector[0.8333333333333333333333333333333333, 1.5]
+ */
+static VALUE
+quadmath_lstsq(VALUE unused_obj, VALUE a, VALUE b)
+{
+	struct QMatrix *mat;
+	enum VECTOR_ELEM_TYPES type;
+	struct qr_args args;
+	VALUE x, tmp, work;
+	long m, n, rows, nrhs;
+	bool matrix_p = qmatrix_p(b);
+
+	a = rb_qmatrix_from(a);
+	mat = GetQMatrix(a);
+	m = mat->rows;
+	n = mat->cols;
+	if (m < n)
+		rb_raise(rb_eArgError, "fewer rows than columns (%ldx%ld)", m, n);
+
+	if (!matrix_p)
+		b = rb_qvector_from(b);
+	type = mat->type == VEC_COMPLEX128 ||
+	       (matrix_p ? GetQMatrix(b)->type : GetQVector(b)->type) == VEC_COMPLEX128 ?
+		VEC_COMPLEX128 : VEC_FLOAT128;
+	if (type == VEC_COMPLEX128)
+	{
+		a = rb_qmatrix_to_complex(a);
+		b = matrix_p ? rb_qmatrix_to_complex(b) : rb_qvector_to_complex(b);
+	}
+	work = rb_obj_dup(b);
+	rows = matrix_p ? GetQMatrix(b)->rows : GetQVector(b)->len;
+	nrhs = matrix_p ? GetQMatrix(b)->cols : 1;
+	if (rows != m)
+		rb_raise(rb_eArgError, "size mismatch (%ld for %ld)", rows, m);
+
+	a = rb_obj_dup(a);
+	args.type = type;
+	args.job = QR_JOB_LSTSQ;
+	args.m = m;
+	args.n = n;
+	args.a = GetQMatrix(a)->data.ptr;
+	args.q = NULL;
+	args.b = matrix_p ? GetQMatrix(work)->data.ptr : GetQVector(work)->data.ptr;
+	args.nrhs = nrhs;
+	args.singular = 0;
+	args.jb = 0;
+	qr_alloc_work(&args, &tmp);
+	quadmath_call_nogvl(qr_nogvl, &args, m * n * (n + nrhs));
+	ALLOCV_END(tmp);
+	RB_GC_GUARD(a);
+
+	if (args.singular)
+		rb_raise(rb_eZeroDivError, "rank deficient matrix (zero diagonal at column %ld)", args.singular - 1);
+
+	if (matrix_p)
+	{
+		size_t elem_size = type == VEC_FLOAT128 ? sizeof(__float128) : sizeof(__complex128);
+		x = rb_qmatrix_new(type, n, nrhs);
+		memcpy(GetQMatrix(x)->data.ptr, GetQMatrix(work)->data.ptr, elem_size * n * nrhs);
+	}
+	else
+	{
+		size_t elem_size = type == VEC_FLOAT128 ? sizeof(__float128) : sizeof(__complex128);
+		x = rb_qvector_new(type, n);
+		memcpy(GetQVector(x)->data.ptr, GetQVector(work)->data.ptr, elem_size * n);
+	}
+	return x;
+}
+
+/*
+ * Cholesky分解 A = L L^H．下三角だけを読み，右向きのブロック算法で書き換える．
+ * 対角ブロックの分解は逐次に，L21の計算とA22の更新は行ごとに独立なのでスレッドに分ける．
+ */
+#define CHOL_NB 32
+
+struct chol_args {
+	enum VECTOR_ELEM_TYPES type;
+	long n;
+	void *a;
+	long jb, je;
+	void *b;
+	long nrhs;
+	int nthreads;
+	long failed;
+};
+
+/* L21 = A21 L11^-H の行i0..i1-1 */
+static void
+chol_trsm_rows(void *ptr, long i0, long i1)
+{
+	const struct chol_args *args = ptr;
+	const long n = args->n, jb = args->jb, je = args->je;
+
+	if (args->type == VEC_FLOAT128)
+	{
+		__float128 *a = args->a;
+		for (long i = i0; i < i1; i++)
+			for (long j = jb; j < je; j++)
+			{
+				__float128 s = a[i * n + j];
+				for (long p = jb; p < j; p++)
+					s -= a[i * n + p] * a[j * n + p];
+				a[i * n + j] = s / a[j * n + j];
+			}
+	}
+	else
+	{
+		__complex128 *a = args->a;
+		for (long i = i0; i < i1; i++)
+			for (long j = jb; j < je; j++)
+			{
+				__complex128 s = a[i * n + j];
+				for (long p = jb; p < j; p++)
+					s -= a[i * n + p] * conjq(a[j * n + p]);
+				a[i * n + j] = s / crealq(a[j * n + j]);
+			}
+	}
+}
+
+/* A22 -= L21 L21^H の行i0..i1-1(下三角のみ) */
+static void
+chol_syrk_rows(void *ptr, long i0, long i1)
+{
+	const struct chol_args *args = ptr;
+	const long n = args->n, jb = args->jb, je = args->je;
+
+	if (args->type == VEC_FLOAT128)
+	{
+		__float128 *a = args->a;
+		for (long i = i0; i < i1; i++)
+			for (long k = je; k <= i; k++)
+			{
+				__float128 s = 0;
+				for (long p = jb; p < je; p++)
+					s += a[i * n + p] * a[k * n + p];
+				a[i * n + k] -= s;
+			}
+	}
+	else
+	{
+		__complex128 *a = args->a;
+		for (long i = i0; i < i1; i++)
+			for (long k = je; k <= i; k++)
+			{
+				__complex128 s = 0;
+				for (long p = jb; p < je; p++)
+					s += a[i * n + p] * conjq(a[k * n + p]);
+				a[i * n + k] -= s;
+			}
+	}
+}
+
+/* parallel_forの区間は0始まりなので，je行目からの相対位置として受け取る */
+static void
+chol_trsm_rows_off(void *ptr, long i0, long i1)
+{
+	const struct chol_args *args = ptr;
+	chol_trsm_rows(ptr, args->je + i0, args->je + i1);
+}
+
+static void
+chol_syrk_rows_off(void *ptr, long i0, long i1)
+{
+	const struct chol_args *args = ptr;
+	chol_syrk_rows(ptr, args->je + i0, args->je + i1);
+}
+
+/* 対角ブロックの分解．正定値でなければ失敗した列番号+1を返す */
+static long
+chol_diag_block(struct chol_args *args)
+{
+	const long n = args->n, jb = args->jb, je = args->je;
+
+	for (long j = jb; j < je; j++)
+	{
+		__float128 d;
+		if (args->type == VEC_FLOAT128)
+		{
+			__float128 *a = args->a;
+			d = a[j * n + j];
+			for (long p = jb; p < j; p++)
+				d -= a[j * n + p] * a[j * n + p];
+			if (!(d > 0))
+				return j + 1;
+			a[j * n + j] = sqrtq(d);
+			for (long i = j + 1; i < je; i++)
+			{
+				__float128 s = a[i * n + j];
+				for (long p = jb; p < j; p++)
+					s -= a[i * n + p] * a[j * n + p];
+				a[i * n + j] = s / a[j * n + j];
+			}
+		}
+		else
+		{
+			__complex128 *a = args->a;
+			d = crealq(a[j * n + j]);
+			for (long p = jb; p < j; p++)
+			{
+				__float128 re = crealq(a[j * n + p]), im = cimagq(a[j * n + p]);
+				d -= re * re + im * im;
+			}
+			if (!(d > 0))
+				return j + 1;
+			a[j * n + j] = sqrtq(d);
+			for (long i = j + 1; i < je; i++)
+			{
+				__complex128 s = a[i * n + j];
+				for (long p = jb; p < j; p++)
+					s -= a[i * n + p] * conjq(a[j * n + p]);
+				a[i * n + j] = s / crealq(a[j * n + j]);
+			}
+		}
+	}
+	return 0;
+}
+
+/* L y = b，L^H x = yの順に解く */
+static void
+chol_solve(const struct chol_args *args)
+{
+	const long n = args->n, nrhs = args->nrhs;
+
+	if (args->type == VEC_FLOAT128)
+	{
+		const __float128 *a = args->a;
+		__float128 *b = args->b;
+		for (long i = 0; i < n; i++)
+		{
+			for (long p = 0; p < i; p++)
+				for (long k = 0; k < nrhs; k++)
+					b[i * nrhs + k] -= a[i * n + p] * b[p * nrhs + k];
+			for (long k = 0; k < nrhs; k++)
+				b[i * nrhs + k] /= a[i * n + i];
+		}
+		for (long i = n - 1; i >= 0; i--)
+		{
+			for (long k = 0; k < nrhs; k++)
+				b[i * nrhs + k] /= a[i * n + i];
+			for (long p = 0; p < i; p++)
+				for (long k = 0; k < nrhs; k++)
+					b[p * nrhs + k] -= a[i * n + p] * b[i * nrhs + k];
+		}
+	}
+	else
+	{
+		const __complex128 *a = args->a;
+		__complex128 *b = args->b;
+		for (long i = 0; i < n; i++)
+		{
+			for (long p = 0; p < i; p++)
+				for (long k = 0; k < nrhs; k++)
+					b[i * nrhs + k] -= a[i * n + p] * b[p * nrhs + k];
+			for (long k = 0; k < nrhs; k++)
+				b[i * nrhs + k] /= crealq(a[i * n + i]);
+		}
+		for (long i = n - 1; i >= 0; i--)
+		{
+			for (long k = 0; k < nrhs; k++)
+				b[i * nrhs + k] /= crealq(a[i * n + i]);
+			for (long p = 0; p < i; p++)
+				for (long k = 0; k < nrhs; k++)
+					b[p * nrhs + k] -= conjq(a[i * n + p]) * b[i * nrhs + k];
+		}
+	}
+}
+
+static void *
+chol_nogvl(void *ptr)
+{
+	struct chol_args *args = ptr;
+	const long n = args->n;
+
+	for (; args->jb < n; args->jb += CHOL_NB)
+	{
+		if (quadmath_interrupted_p())
+			return QUADMATH_INTERRUPTED;
+		args->je = args->jb + CHOL_NB < n ? args->jb + CHOL_NB : n;
+		if ((args->failed = chol_diag_block(args)) != 0)
+			return NULL;
+		if (args->je < n)
+		{
+			quadmath_parallel_for(n - args->je, CHOL_NB, args->nthreads, chol_trsm_rows_off, args);
+			quadmath_parallel_for(n - args->je, CHOL_NB, args->nthreads, chol_syrk_rows_off, args);
+		}
+	}
+	if (args->b != NULL)
+		chol_solve(args);
+	return NULL;
+}
+
+static VALUE
+chol_factor(VALUE self, VALUE opts, struct chol_args *args)
+{
+	struct QMatrix *mat = check_square(self);
+	VALUE a = rb_obj_dup(self);
+
+	args->type = mat->type;
+	args->n = mat->rows;
+	args->a = GetQMatrix(a)->data.ptr;
+	args->nthreads = quadmath_opt_threads(opts);
+	args->failed = 0;
+	args->jb = 0;
+	return a;
+}
+
+static void
+raise_not_posdef(long col)
+{
+	rb_raise(rb_eMathDomainError, "not positive definite (at column %ld)", col - 1);
+}
+
+/*
+ *  call-seq:
+ *    cholesky(threads: QuadMath.threads) -> QuadMath::Matrix
+ *
+ *  Returns the lower triangular +l+ such that +l+ times its conjugate transpose is +self+.
+ *  Only the lower triangle of +self+ is read, and it is assumed to be symmetric (or Hermitian).
+ *  The factorization is blocked and right-looking; with +threads+ greater than 1, the trailing updates are shared by native threads.
+ *  If the matrix is not positive definite, a Math::DomainError is raised.
+ *
+ *    QuadMath::Matrix[[4, 2], [2, 5]].cholesky # => QuadMath::Matrix[[2.0, 0.0], [1.0, 2.0]]
+ */
+static VALUE
+qmatrix_cholesky(int argc, VALUE *argv, VALUE self)
+{
+	VALUE opts, a;
+	struct chol_args args;
+	struct QMatrix *mat;
+	long n;
+
+	rb_scan_args(argc, argv, "0:", &opts);
+	a = chol_factor(self, opts, &args);
+	args.b = NULL;
+	args.nrhs = 0;
+	n = args.n;
+	quadmath_call_nogvl(chol_nogvl, &args, n * n * n / 6);
+	if (args.failed)
+		raise_not_posdef(args.failed);
+
+	mat = GetQMatrix(a);
+	for (long i = 0; i < n; i++)
+		for (long j = i + 1; j < n; j++)
+			if (mat->type == VEC_FLOAT128)
+				mat->data.f128[i * n + j] = 0;
+			else
+				mat->data.c128[i * n + j] = 0;
+
+	return a;
+}
+
+/*
+ *  call-seq:
+ *    cholesky_solve(b, threads: QuadMath.threads) -> QuadMath::Vector | QuadMath::Matrix
+ *
+ *  Solves <code>self * x = b</code> for a symmetric (or Hermitian) positive definite matrix by Cholesky factorization.
+ *  +b+ is handled as in #solve.
+ *  If the matrix is not positive definite, a Math::DomainError is raised.
+ *
+ *    QuadMath::Matrix[[4, 2], [2, 5]].cholesky_solve([6, 7]) # => QuadMath::Vector[1.0, 1.0]
+ */
+static VALUE
+qmatrix_cholesky_solve(int argc, VALUE *argv, VALUE self)
+{
+	VALUE b, opts, a, x;
+	struct chol_args args;
+	struct QMatrix *mat = check_square(self);
+	bool complex_p;
+	long rows;
+
+	rb_scan_args(argc, argv, "1:", &b, &opts);
+	if (qmatrix_p(b))
+		complex_p = mat->type == VEC_COMPLEX128 || GetQMatrix(b)->type == VEC_COMPLEX128;
+	else
+		complex_p = mat->type == VEC_COMPLEX128 || GetQVector(b = rb_qvector_from(b))->type == VEC_COMPLEX128;
+	if (complex_p)
+	{
+		self = rb_qmatrix_to_complex(self);
+		b = qmatrix_p(b) ? rb_qmatrix_to_complex(b) : rb_qvector_to_complex(b);
+	}
+	x = rb_obj_dup(b);
+	if (qmatrix_p(x))
+	{
+		rows = GetQMatrix(x)->rows;
+		args.nrhs = GetQMatrix(x)->cols;
+		args.b = GetQMatrix(x)->data.ptr;
+	}
+	else
+	{
+		rows = GetQVector(x)->len;
+		args.nrhs = 1;
+		args.b = GetQVector(x)->data.ptr;
+	}
+	if (rows != mat->rows)
+		rb_raise(rb_eArgError, "size mismatch (%ld for %ld)", rows, mat->rows);
+
+	a = chol_factor(self, opts, &args);
+	quadmath_call_nogvl(chol_nogvl, &args, args.n * args.n * (args.n / 6 + args.nrhs));
+	RB_GC_GUARD(a);
+	if (args.failed)
+		raise_not_posdef(args.failed);
+
+	return x;
+}
+
+/*
+ * 対称固有値問題．Householder法で三重対角化し(tred2)，陰的シフト付きQL法(tql2)で対角化する．
+ * EISPACKの同名ルーチン(JAMA版)を__float128に移したもの．vは固有ベクトルを列に持つ．
+ */
+#define EIGH_MAX_ITER 64
+
+/*
+ * 途中で中断できるように，外側のループの位置と持ち越す値を引数の構造体に置く．
+ * phaseは三重対角化(EIGH_TRED2)，変換の累積(EIGH_ACCUM)，QL法(EIGH_TQL2)の順に進む．
+ */
+enum EIGH_PHASES {
+	EIGH_START,
+	EIGH_TRED2,
+	EIGH_ACCUM,
+	EIGH_TQL2,
+	EIGH_DONE
+};
+
+struct eigh_args {
+	long n;
+	__float128 *v;
+	__float128 *d;
+	__float128 *e;
+	int failed;
+	enum EIGH_PHASES phase;
+	long pos;
+	__float128 f, tst1;
+};
+
+/* 中断されればfalseを返す */
+static bool
+eigh_tred2(struct eigh_args *args)
+{
+	__float128 *v = args->v, *d = args->d, *e = args->e;
+	const long n = args->n;
+
+	if (args->phase == EIGH_START)
+	{
+		for (long j = 0; j < n; j++)
+			d[j] = v[(n - 1) * n + j];
+		args->phase = EIGH_TRED2;
+		args->pos = n - 1;
+	}
+
+	if (args->phase == EIGH_TRED2)
+	{
+		for (long i = args->pos; i > 0; i--)
+		{
+			__float128 scale = 0, h = 0;
+			if (quadmath_interrupted_p())
+			{
+				args->pos = i;
+				return false;
+			}
+			for (long k = 0; k < i; k++)
+				scale += fabsq(d[k]);
+			if (scale == 0)
+			{
+				e[i] = d[i - 1];
+				for (long j = 0; j < i; j++)
+				{
+					d[j] = v[(i - 1) * n + j];
+					v[i * n + j] = 0;
+					v[j * n + i] = 0;
+				}
+			}
+			else
+			{
+				__float128 f, g, hh;
+				for (long k = 0; k < i; k++)
+				{
+					d[k] /= scale;
+					h += d[k] * d[k];
+				}
+				f = d[i - 1];
+				g = sqrtq(h);
+				if (f > 0)  g = -g;
+				e[i] = scale * g;
+				h -= f * g;
+				d[i - 1] = f - g;
+				for (long j = 0; j < i; j++)
+					e[j] = 0;
+				for (long j = 0; j < i; j++)
+				{
+					f = d[j];
+					v[j * n + i] = f;
+					g = e[j] + v[j * n + j] * f;
+					for (long k = j + 1; k <= i - 1; k++)
+					{
+						g += v[k * n + j] * d[k];
+						e[k] += v[k * n + j] * f;
+					}
+					e[j] = g;
+				}
+				f = 0;
+				for (long j = 0; j < i; j++)
+				{
+					e[j] /= h;
+					f += e[j] * d[j];
+				}
+				hh = f / (h + h);
+				for (long j = 0; j < i; j++)
+					e[j] -= hh * d[j];
+				for (long j = 0; j < i; j++)
+				{
+					f = d[j];
+					g = e[j];
+					for (long k = j; k <= i - 1; k++)
+						v[k * n + j] -= f * e[k] + g * d[k];
+					d[j] = v[(i - 1) * n + j];
+					v[i * n + j] = 0;
+				}
+			}
+			d[i] = h;
+		}
+		args->phase = EIGH_ACCUM;
+		args->pos = 0;
+	}
+
+	/* 変換の累積 */
+	for (long i = args->pos; i < n - 1; i++)
+	{
+		__float128 h = d[i + 1];
+		if (quadmath_interrupted_p())
+		{
+			args->pos = i;
+			return false;
+		}
+		v[(n - 1) * n + i] = v[i * n + i];
+		v[i * n + i] = 1;
+		if (h != 0)
+		{
+			for (long k = 0; k <= i; k++)
+				d[k] = v[k * n + i + 1] / h;
+			for (long j = 0; j <= i; j++)
+			{
+				__float128 g = 0;
+				for (long k = 0; k <= i; k++)
+					g += v[k * n + i + 1] * v[k * n + j];
+				for (long k = 0; k <= i; k++)
+					v[k * n + j] -= g * d[k];
+			}
+		}
+		for (long k = 0; k <= i; k++)
+			v[k * n + i + 1] = 0;
+	}
+	for (long j = 0; j < n; j++)
+	{
+		d[j] = v[(n - 1) * n + j];
+		v[(n - 1) * n + j] = 0;
+	}
+	v[(n - 1) * n + n - 1] = 1;
+	e[0] = 0;
+
+	for (long i = 1; i < n; i++)
+		e[i - 1] = e[i];
+	e[n - 1] = 0;
+	args->phase = EIGH_TQL2;
+	args->pos = 0;
+	args->f = 0;
+	args->tst1 = 0;
+	return true;
+}
+
+/* 中断されればfalseを返す．収束しなければfailedを立てる */
+static bool
+eigh_tql2(struct eigh_args *args)
+{
+	__float128 *v = args->v, *d = args->d, *e = args->e;
+	const long n = args->n;
+	__float128 f = args->f, tst1 = args->tst1;
+
+	for (long l = args->pos; l < n; l++)
+	{
+		long m = l;
+		if (quadmath_interrupted_p())
+		{
+			args->pos = l;
+			args->f = f;
+			args->tst1 = tst1;
+			return false;
+		}
+		if (tst1 < fabsq(d[l]) + fabsq(e[l]))
+			tst1 = fabsq(d[l]) + fabsq(e[l]);
+		while (m < n - 1 && fabsq(e[m]) > FLT128_EPSILON * tst1)
+			m++;
+		if (m > l)
+		{
+			int iter = 0;
+			do {
+				__float128 g = d[l], p, r, dl1, h, c = 1, c2 = 1, c3 = 1, el1, s = 0, s2 = 0;
+
+				if (++iter > EIGH_MAX_ITER)
+				{
+					args->failed = 1;
+					return true;
+				}
+				p = (d[l + 1] - g) / (2 * e[l]);
+				r = hypotq(p, 1);
+				if (p < 0)  r = -r;
+				d[l] = e[l] / (p + r);
+				d[l + 1] = e[l] * (p + r);
+				dl1 = d[l + 1];
+				h = g - d[l];
+				for (long i = l + 2; i < n; i++)
+					d[i] -= h;
+				f += h;
+
+				p = d[m];
+				el1 = e[l + 1];
+				for (long i = m - 1; i >= l; i--)
+				{
+					c3 = c2;
+					c2 = c;
+					s2 = s;
+					g = c * e[i];
+					h = c * p;
+					r = hypotq(p, e[i]);
+					e[i + 1] = s * r;
+					s = e[i] / r;
+					c = p / r;
+					p = c * d[i] - s * g;
+					d[i + 1] = h + s * (c * g + s * d[i]);
+					for (long k = 0; k < n; k++)
+					{
+						h = v[k * n + i + 1];
+						v[k * n + i + 1] = s * v[k * n + i] + c * h;
+						v[k * n + i] = c * v[k * n + i] - s * h;
+					}
+				}
+				p = -s * s2 * c3 * el1 * e[l] / dl1;
+				e[l] = s * p;
+				d[l] = c * p;
+			} while (fabsq(e[l]) > FLT128_EPSILON * tst1);
+		}
+		d[l] += f;
+		e[l] = 0;
+	}
+
+	/* 昇順に並べ替える */
+	for (long i = 0; i < n - 1; i++)
+	{
+		long k = i;
+		__float128 p = d[i];
+		for (long j = i + 1; j < n; j++)
+			if (d[j] < p)
+			{
+				k = j;
+				p = d[j];
+			}
+		if (k != i)
+		{
+			d[k] = d[i];
+			d[i] = p;
+			for (long j = 0; j < n; j++)
+			{
+				p = v[j * n + i];
+				v[j * n + i] = v[j * n + k];
+				v[j * n + k] = p;
+			}
+		}
+	}
+	args->phase = EIGH_DONE;
+	return true;
+}
+
+static void *
+eigh_nogvl(void *ptr)
+{
+	struct eigh_args *args = ptr;
+
+	if (args->phase < EIGH_TQL2 && !eigh_tred2(args))
+		return QUADMATH_INTERRUPTED;
+	if (args->phase == EIGH_TQL2 && !eigh_tql2(args))
+		return QUADMATH_INTERRUPTED;
+
+	return NULL;
+}
+
+/*
+ *  call-seq:
+ *    eigh -> [QuadMath::Vector, QuadMath::Matrix]
+ *
+ *  Returns the eigenvalues in ascending order and the orthonormal eigenvectors (as columns) of a real symmetric matrix.
+ *  Only the lower triangle of +self+ is read.
+ *  The matrix is reduced to tridiagonal form by Householder reflections and diagonalized by the implicit QL method
+ *  with sqrtq() and hypotq(), all in __float128.
+ *  A complex matrix raises TypeError.
+ *
+ *    w, v = QuadMath::Matrix[[2, 1], [1, 2]].eigh
+ *    w # => QuadMath::Vector[1.0, 3.0]
+ */
+static VALUE
+qmatrix_eigh(VALUE self)
+{
+	struct QMatrix *mat = check_square(self);
+	long n = mat->rows;
+	VALUE w, v, tmp;
+	struct eigh_args args;
+
+	if (mat->type != VEC_FLOAT128)
+		rb_raise(rb_eTypeError, "not a real matrix");
+
+	w = rb_qvector_new(VEC_FLOAT128, n);
+	v = rb_qmatrix_new(VEC_FLOAT128, n, n);
+	args.n = n;
+	args.v = GetQMatrix(v)->data.f128;
+	args.d = GetQVector(w)->data.f128;
+	args.e = ALLOCV_N(__float128, tmp, n > 0 ? n : 1);
+	args.failed = 0;
+	args.phase = EIGH_START;
+	for (long i = 0; i < n; i++)
+		for (long j = 0; j <= i; j++)
+			args.v[i * n + j] = args.v[j * n + i] = mat->data.f128[i * n + j];
+
+	if (n > 0)
+		quadmath_call_nogvl(eigh_nogvl, &args, 3 * n * n * n);
+	ALLOCV_END(tmp);
+
+	if (args.failed)
+		rb_raise(rb_eRuntimeError, "eigenvalues did not converge");
+
+	return rb_assoc_new(w, v);
+}
+
+void
+InitVM_LinAlg(void)
+{
+	rb_define_method(rb_cQuadMatrix, "lu", qmatrix_lu, 0);
+	rb_define_method(rb_cQuadMatrix, "solve", qmatrix_solve, 1);
+	rb_define_method(rb_cQuadMatrix, "qr", qmatrix_qr, 0);
+	rb_define_method(rb_cQuadMatrix, "cholesky", qmatrix_cholesky, -1);
+	rb_define_method(rb_cQuadMatrix, "cholesky_solve", qmatrix_cholesky_solve, -1);
+	rb_define_method(rb_cQuadMatrix, "eigh", qmatrix_eigh, 0);
+
+	rb_define_module_function(rb_mQuadMath, "refine_solve", quadmath_refine_solve, -1);
+	rb_define_module_function(rb_mQuadMath, "lstsq", quadmath_lstsq, 2);
+}
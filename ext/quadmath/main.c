@@ -12,8 +12,23 @@
 
 void InitVM_Float128(void);
 void InitVM_Complex128(void);
+void InitVM_DoubleDouble(void);
 void InitVM_Numerable(void);
 void InitVM_QuadMath(void);
+void InitVM_DDMath(void);
+void InitVM_Parallel(void);
+void InitVM_Reduction(void);
+void InitVM_Vector(void);
+void InitVM_Arith(void);
+void InitVM_Stats(void);
+void InitVM_BLAS(void);
+void InitVM_Matrix(void);
+void InitVM_LinAlg(void);
+void InitVM_Sparse(void);
+void InitVM_FFT(void);
+void InitVM_Poly(void);
+void InitVM_Chebyshev(void);
+void InitVM_Formula(void);
 
 // EntryPoint
 void
@@ -22,10 +37,35 @@ Init_quadmath(void)
 	rb_cFloat128 = rb_define_class("Float128", rb_cNumeric);
 	rb_cComplex128 = rb_define_class("Complex128", rb_cNumeric);
 	rb_mQuadMath = rb_define_module("QuadMath");
+	rb_cDoubleDouble = rb_define_class_under(rb_mQuadMath, "DoubleDouble", rb_cNumeric);
+	rb_cQuadVector = rb_define_class_under(rb_mQuadMath, "Vector", rb_cObject);
+	rb_cQuadVectorLazy = rb_define_class_under(rb_cQuadVector, "Lazy", rb_cObject);
+	rb_cQuadStats = rb_define_class_under(rb_mQuadMath, "Stats", rb_cObject);
+	rb_mQuadBLAS = rb_define_module_under(rb_mQuadMath, "BLAS");
+	rb_cQuadMatrix = rb_define_class_under(rb_mQuadMath, "Matrix", rb_cObject);
+	rb_cQuadSparseMatrix = rb_define_class_under(rb_mQuadMath, "SparseMatrix", rb_cObject);
+	rb_cQuadFFT = rb_define_class_under(rb_mQuadMath, "FFT", rb_cObject);
+	rb_cQuadChebyshev = rb_define_class_under(rb_mQuadMath, "Chebyshev", rb_cObject);
+	rb_cQuadFormula = rb_define_class_under(rb_mQuadMath, "Formula", rb_cObject);
 	
 	InitVM(Float128);
 	InitVM(Complex128);
+	InitVM(DoubleDouble);
 	InitVM(Numerable);
 	InitVM(QuadMath);
+	InitVM(DDMath);
+	InitVM(Parallel);
+	InitVM(Reduction);
+	InitVM(Vector);
+	InitVM(Arith);
+	InitVM(Stats);
+	InitVM(BLAS);
+	InitVM(Matrix);
+	InitVM(LinAlg);
+	InitVM(Sparse);
+	InitVM(FFT);
+	InitVM(Poly);
+	InitVM(Chebyshev);
+	InitVM(Formula);
 }
 
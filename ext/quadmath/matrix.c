@@ -0,0 +1,1035 @@
+/*******************************************************************************
+    matrix.c -- QuadMath::Matrix Class
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <quadmath.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+/*
+ * GEMMのブロック寸法(要素数)．要素が16バイトあるので，
+ * Bのブロック(KC x NC)がL2に，Aの行断片(KC)とCの2x2タイルがL1とレジスタに収まる程度にする．
+ * MCは一つのスレッドが受け持つ行パネルの高さである．
+ */
+#define GEMM_MC 32
+#define GEMM_KC 64
+#define GEMM_NC 128
+
+static void
+free_qmatrix(void *v)
+{
+	struct QMatrix *mat = v;
+	if (mat != NULL)
+	{
+		xfree(mat->data.ptr);
+		xfree(mat);
+	}
+}
+
+static size_t
+memsize_qmatrix(const void *v)
+{
+	const struct QMatrix *mat = v;
+	size_t elem_size = mat->type == VEC_FLOAT128 ?
+		sizeof(__float128) : sizeof(__complex128);
+	return sizeof(struct QMatrix) + elem_size * mat->rows * mat->cols;
+}
+
+static const rb_data_type_t qmatrix_data_type = {
+	"quadmath_matrix",
+	{0, free_qmatrix, memsize_qmatrix,},
+	0, 0,
+	RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static inline size_t
+qmatrix_elem_size(enum VECTOR_ELEM_TYPES type)
+{
+	return type == VEC_FLOAT128 ? sizeof(__float128) : sizeof(__complex128);
+}
+
+static void
+qmatrix_setup(struct QMatrix *mat, enum VECTOR_ELEM_TYPES type, long rows, long cols)
+{
+	long size;
+
+	if (rows < 0 || cols < 0)
+		rb_raise(rb_eArgError, "negative matrix size");
+	if (cols != 0 && rows > LONG_MAX / cols)
+		rb_raise(rb_eArgError, "matrix size too big");
+	size = rows * cols;
+
+	mat->type = type;
+	mat->rows = rows;
+	mat->cols = cols;
+	mat->data.ptr = ruby_xcalloc(size ? size : 1, qmatrix_elem_size(type));
+}
+
+static VALUE
+qmatrix_allocate(VALUE klass)
+{
+	struct QMatrix *mat;
+	VALUE obj = TypedData_Make_Struct(klass, struct QMatrix, &qmatrix_data_type, mat);
+	mat->type = VEC_FLOAT128;
+	mat->rows = mat->cols = 0;
+	mat->data.ptr = NULL;
+	return obj;
+}
+
+VALUE
+rb_qmatrix_new(enum VECTOR_ELEM_TYPES type, long rows, long cols)
+{
+	struct QMatrix *mat;
+	VALUE obj = qmatrix_allocate(rb_cQuadMatrix);
+	TypedData_Get_Struct(obj, struct QMatrix, &qmatrix_data_type, mat);
+	qmatrix_setup(mat, type, rows, cols);
+	return obj;
+}
+
+struct QMatrix *
+GetQMatrix(VALUE self)
+{
+	struct QMatrix *mat;
+
+	TypedData_Get_Struct(self, struct QMatrix, &qmatrix_data_type, mat);
+
+	if (mat->data.ptr == NULL)
+		rb_raise(rb_eRuntimeError, "uninitialized matrix");
+
+	return mat;
+}
+
+bool
+qmatrix_p(VALUE obj)
+{
+	return rb_typeddata_is_kind_of(obj, &qmatrix_data_type);
+}
+
+static inline bool
+num_nucomp_p(VALUE x)
+{
+	switch (convertion_num_types(x)) {
+	case NUM_COMPLEX:
+	case NUM_COMPLEX128:
+		return true;
+		break;
+	case NUM_OTHERTYPE:
+		return !RTEST(rb_funcall(x, rb_intern("real?"), 0));
+		break;
+	default:
+		return false;
+		break;
+	}
+}
+
+static inline VALUE
+qmatrix_fetch(const struct QMatrix *mat, long i, long j)
+{
+	if (mat->type == VEC_FLOAT128)
+		return rb_float128_cf128(mat->data.f128[i * mat->cols + j]);
+	else
+		return rb_complex128_cc128(mat->data.c128[i * mat->cols + j]);
+}
+
+static inline void
+qmatrix_store(struct QMatrix *mat, long i, long j, VALUE x)
+{
+	if (mat->type == VEC_FLOAT128)
+		mat->data.f128[i * mat->cols + j] = num_to_cf128(x);
+	else
+		mat->data.c128[i * mat->cols + j] = num_to_cc128(x);
+}
+
+static VALUE
+qmatrix_dup_as(const struct QMatrix *src, enum VECTOR_ELEM_TYPES type)
+{
+	VALUE obj = rb_qmatrix_new(type, src->rows, src->cols);
+	struct QMatrix *dst = GetQMatrix(obj);
+	long size = src->rows * src->cols;
+
+	if (src->type == type)
+		memcpy(dst->data.ptr, src->data.ptr, qmatrix_elem_size(type) * size);
+	else /* 実数から複素数への昇格 */
+		for (long i = 0; i < size; i++)
+			dst->data.c128[i] = src->data.f128[i];
+
+	return obj;
+}
+
+/* 実数行列を複素数行列に昇格する．すでに複素数ならばそのまま返す */
+VALUE
+rb_qmatrix_to_complex(VALUE obj)
+{
+	struct QMatrix *mat = GetQMatrix(obj);
+
+	if (mat->type == VEC_COMPLEX128)
+		return obj;
+
+	return qmatrix_dup_as(mat, VEC_COMPLEX128);
+}
+
+static bool
+opt_complex_p(VALUE opts)
+{
+	static ID kwds[1];
+	VALUE complex_p = Qfalse;
+
+	if (!kwds[0])  kwds[0] = rb_intern_const("complex");
+
+	if (!NIL_P(opts))
+	{
+		rb_get_kwargs(opts, kwds, 0, 1, &complex_p);
+		if (complex_p == Qundef)  complex_p = Qfalse;
+	}
+	return RTEST(complex_p);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::Matrix.new(rows, cols, complex: false) -> QuadMath::Matrix
+ *
+ *  Returns a zero-filled matrix of +rows+ x +cols+.
+ *  The elements are packed row by row as __float128, or as __complex128 if +complex+ is true.
+ *
+ *    QuadMath::Matrix.new(2, 3) # => QuadMath::Matrix[[0.0, 0.0, 0.0], [0.0, 0.0, 0.0]]
+ */
+static VALUE
+qmatrix_initialize(int argc, VALUE *argv, VALUE self)
+{
+	VALUE rows, cols, opts;
+	struct QMatrix *mat;
+
+	rb_scan_args(argc, argv, "2:", &rows, &cols, &opts);
+
+	TypedData_Get_Struct(self, struct QMatrix, &qmatrix_data_type, mat);
+	if (mat->data.ptr != NULL)
+		rb_raise(rb_eRuntimeError, "matrix already initialized");
+
+	qmatrix_setup(mat, opt_complex_p(opts) ? VEC_COMPLEX128 : VEC_FLOAT128,
+	              NUM2LONG(rows), NUM2LONG(cols));
+
+	return self;
+}
+
+static VALUE
+qmatrix_from_rows(VALUE ary)
+{
+	long rows = RARRAY_LEN(ary), cols = 0;
+	enum VECTOR_ELEM_TYPES type = VEC_FLOAT128;
+	VALUE obj;
+	struct QMatrix *mat;
+
+	for (long i = 0; i < rows; i++)
+	{
+		VALUE row = rb_convert_type(RARRAY_AREF(ary, i), T_ARRAY, "Array", "to_ary");
+		rb_ary_store(ary, i, row);
+		if (i == 0)
+			cols = RARRAY_LEN(row);
+		else if (RARRAY_LEN(row) != cols)
+			rb_raise(rb_eArgError,
+			  "row size differs (%ld should be %ld)", RARRAY_LEN(row), cols);
+		for (long j = 0; j < cols && type == VEC_FLOAT128; j++)
+			if (num_nucomp_p(RARRAY_AREF(row, j)))
+				type = VEC_COMPLEX128;
+	}
+
+	obj = rb_qmatrix_new(type, rows, cols);
+	mat = GetQMatrix(obj);
+	for (long i = 0; i < rows; i++)
+		for (long j = 0; j < cols; j++)
+			qmatrix_store(mat, i, j, rb_ary_entry(RARRAY_AREF(ary, i), j));
+
+	return obj;
+}
+
+VALUE
+rb_qmatrix_from(VALUE obj)
+{
+	if (qmatrix_p(obj))
+		return obj;
+
+	return qmatrix_from_rows(rb_ary_dup(rb_convert_type(obj, T_ARRAY, "Array", "to_ary")));
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::Matrix[*rows] -> QuadMath::Matrix
+ *
+ *  Returns a matrix of +rows+, each of which is an Array of numerics of the same length.
+ *  If any element is a complex number, the matrix holds Complex128 elements.
+ *
+ *    QuadMath::Matrix[[1, 2], [3, 4]] # => QuadMath::Matrix[[1.0, 2.0], [3.0, 4.0]]
+ */
+static VALUE
+qmatrix_s_aref(int argc, VALUE *argv, VALUE klass)
+{
+	return qmatrix_from_rows(rb_ary_new_from_values(argc, argv));
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::Matrix.identity(n, complex: false) -> QuadMath::Matrix
+ *
+ *  Returns the identity matrix of +n+ x +n+.
+ */
+static VALUE
+qmatrix_s_identity(int argc, VALUE *argv, VALUE klass)
+{
+	VALUE size, opts, obj;
+	struct QMatrix *mat;
+	long n;
+
+	rb_scan_args(argc, argv, "1:", &size, &opts);
+	n = NUM2LONG(size);
+	obj = rb_qmatrix_new(opt_complex_p(opts) ? VEC_COMPLEX128 : VEC_FLOAT128, n, n);
+	mat = GetQMatrix(obj);
+	for (long i = 0; i < n; i++)
+		if (mat->type == VEC_FLOAT128)
+			mat->data.f128[i * n + i] = 1;
+		else
+			mat->data.c128[i * n + i] = 1;
+
+	return obj;
+}
+
+/* :nodoc: */
+static VALUE
+qmatrix_initialize_copy(VALUE self, VALUE other)
+{
+	struct QMatrix *dst, *src;
+
+	if (self == other)  return self;
+
+	TypedData_Get_Struct(self, struct QMatrix, &qmatrix_data_type, dst);
+	src = GetQMatrix(other);
+
+	if (dst->data.ptr != NULL)
+		rb_raise(rb_eRuntimeError, "matrix already initialized");
+
+	qmatrix_setup(dst, src->type, src->rows, src->cols);
+	memcpy(dst->data.ptr, src->data.ptr,
+	       qmatrix_elem_size(src->type) * src->rows * src->cols);
+
+	return self;
+}
+
+/*
+ *  call-seq:
+ *    row_count -> Integer
+ *
+ *  Returns the number of rows.
+ */
+static VALUE
+qmatrix_row_count(VALUE self)
+{
+	return LONG2NUM(GetQMatrix(self)->rows);
+}
+
+/*
+ *  call-seq:
+ *    column_count -> Integer
+ *
+ *  Returns the number of columns.
+ */
+static VALUE
+qmatrix_column_count(VALUE self)
+{
+	return LONG2NUM(GetQMatrix(self)->cols);
+}
+
+/*
+ *  call-seq:
+ *    shape -> [Integer, Integer]
+ *
+ *  Returns the pair of the number of rows and columns.
+ */
+static VALUE
+qmatrix_shape(VALUE self)
+{
+	struct QMatrix *mat = GetQMatrix(self);
+
+	return rb_assoc_new(LONG2NUM(mat->rows), LONG2NUM(mat->cols));
+}
+
+/*
+ *  call-seq:
+ *    complex? -> bool
+ *
+ *  Returns true if the elements are Complex128.
+ */
+static VALUE
+qmatrix_complex_p(VALUE self)
+{
+	return GetQMatrix(self)->type == VEC_COMPLEX128 ? Qtrue : Qfalse;
+}
+
+static inline bool
+qmatrix_index(const struct QMatrix *mat, VALUE vi, VALUE vj, long *i, long *j)
+{
+	*i = NUM2LONG(vi);
+	*j = NUM2LONG(vj);
+	if (*i < 0)  *i += mat->rows;
+	if (*j < 0)  *j += mat->cols;
+	return 0 <= *i && *i < mat->rows && 0 <= *j && *j < mat->cols;
+}
+
+/*
+ *  call-seq:
+ *    self[i, j] -> Float128 | Complex128 | nil
+ *
+ *  Returns the element at row +i+ and column +j+. A negative index counts from the end.
+ *  If the index is out of range, returns nil.
+ */
+static VALUE
+qmatrix_aref(VALUE self, VALUE vi, VALUE vj)
+{
+	struct QMatrix *mat = GetQMatrix(self);
+	long i, j;
+
+	if (!qmatrix_index(mat, vi, vj, &i, &j))
+		return Qnil;
+
+	return qmatrix_fetch(mat, i, j);
+}
+
+/*
+ *  call-seq:
+ *    self[i, j] = x -> x
+ *
+ *  Stores +x+ at row +i+ and column +j+. If the index is out of range, an IndexError is raised.
+ */
+static VALUE
+qmatrix_aset(VALUE self, VALUE vi, VALUE vj, VALUE x)
+{
+	struct QMatrix *mat = GetQMatrix(self);
+	long i, j;
+
+	rb_check_frozen(self);
+
+	if (!qmatrix_index(mat, vi, vj, &i, &j))
+		rb_raise(rb_eIndexError, "index [%"PRIsVALUE", %"PRIsVALUE"] out of matrix", vi, vj);
+
+	qmatrix_store(mat, i, j, x);
+
+	return x;
+}
+
+/*
+ *  call-seq:
+ *    to_a -> Array
+ *
+ *  Returns the rows as an Array of Arrays.
+ */
+static VALUE
+qmatrix_to_a(VALUE self)
+{
+	struct QMatrix *mat = GetQMatrix(self);
+	VALUE ary = rb_ary_new_capa(mat->rows);
+
+	for (long i = 0; i < mat->rows; i++)
+	{
+		VALUE row = rb_ary_new_capa(mat->cols);
+		for (long j = 0; j < mat->cols; j++)
+			rb_ary_push(row, qmatrix_fetch(mat, i, j));
+		rb_ary_push(ary, row);
+	}
+	return ary;
+}
+
+/*
+ *  call-seq:
+ *    self == other -> bool
+ *
+ *  Returns true if +other+ is a matrix of the same shape and every pair of elements compares equal.
+ */
+static VALUE
+qmatrix_eq(VALUE self, VALUE other)
+{
+	struct QMatrix *x, *y;
+	long size;
+
+	if (!qmatrix_p(other))
+		return Qfalse;
+
+	x = GetQMatrix(self);
+	y = GetQMatrix(other);
+	if (x->rows != y->rows || x->cols != y->cols)
+		return Qfalse;
+
+	size = x->rows * x->cols;
+	for (long i = 0; i < size; i++)
+	{
+		__complex128 z = x->type == VEC_FLOAT128 ?
+			(__complex128)x->data.f128[i] : x->data.c128[i];
+		__complex128 w = y->type == VEC_FLOAT128 ?
+			(__complex128)y->data.f128[i] : y->data.c128[i];
+		if (z != w)
+			return Qfalse;
+	}
+	return Qtrue;
+}
+
+/*
+ *  call-seq:
+ *    inspect -> String
+ *
+ *  Returns the matrix in the form of QuadMath::Matrix[[...], ...].
+ */
+static VALUE
+qmatrix_inspect(VALUE self)
+{
+	VALUE str = rb_str_new_cstr("QuadMath::Matrix");
+
+	rb_str_append(str, rb_inspect(qmatrix_to_a(self)));
+
+	return str;
+}
+
+/*
+ *  call-seq:
+ *    transpose -> QuadMath::Matrix
+ *
+ *  Returns the transposed matrix.
+ */
+static VALUE
+qmatrix_transpose(VALUE self)
+{
+	struct QMatrix *src = GetQMatrix(self), *dst;
+	VALUE obj = rb_qmatrix_new(src->type, src->cols, src->rows);
+	long m = src->rows, n = src->cols;
+
+	dst = GetQMatrix(obj);
+	if (src->type == VEC_FLOAT128)
+		for (long i = 0; i < m; i++)
+			for (long j = 0; j < n; j++)
+				dst->data.f128[j * m + i] = src->data.f128[i * n + j];
+	else
+		for (long i = 0; i < m; i++)
+			for (long j = 0; j < n; j++)
+				dst->data.c128[j * m + i] = src->data.c128[i * n + j];
+
+	return obj;
+}
+
+/*
+ * GEMM: C = alpha * A * B + beta * C  (A: m x k, B: k x n, C: m x n, 行優先)
+ */
+struct gemm_args {
+	enum VECTOR_ELEM_TYPES type;
+	long m, n, k;
+	__complex128 alpha, beta;
+	const void *a;
+	const void *b;
+	void *c;
+	int nthreads;
+	long row;    /* 計算済みの行数．中断したところから再開する */
+};
+
+static inline void
+cmuladd(__float128 *re, __float128 *im, __complex128 a, __complex128 b)
+{
+	__float128 ar = crealq(a), ai = cimagq(a), br = crealq(b), bi = cimagq(b);
+	*re += ar * br - ai * bi;
+	*im += ar * bi + ai * br;
+}
+
+static void
+gemm_panel_f128(void *ptr, long i0, long i1)
+{
+	const struct gemm_args *args = ptr;
+	const __float128 *A = args->a, *B = args->b;
+	__float128 *C = args->c;
+	const long n = args->n, k = args->k;
+	const __float128 alpha = crealq(args->alpha), beta = crealq(args->beta);
+
+	for (long i = i0; i < i1; i++)
+		for (long j = 0; j < n; j++)
+			C[i * n + j] = beta == 0 ? 0 : beta * C[i * n + j];
+
+	for (long kk = 0; kk < k; kk += GEMM_KC)
+	{
+		long ke = kk + GEMM_KC < k ? kk + GEMM_KC : k;
+		for (long jj = 0; jj < n; jj += GEMM_NC)
+		{
+			long je = jj + GEMM_NC < n ? jj + GEMM_NC : n;
+			long i = i0;
+			for (; i + 2 <= i1; i += 2)
+			{
+				const __float128 *a0 = A + i * k, *a1 = a0 + k;
+				long j = jj;
+				/* 2x2のレジスタブロック */
+				for (; j + 2 <= je; j += 2)
+				{
+					__float128 c00 = 0, c01 = 0, c10 = 0, c11 = 0;
+					for (long p = kk; p < ke; p++)
+					{
+						__float128 b0 = B[p * n + j], b1 = B[p * n + j + 1];
+						c00 += a0[p] * b0;
+						c01 += a0[p] * b1;
+						c10 += a1[p] * b0;
+						c11 += a1[p] * b1;
+					}
+					C[i * n + j] += alpha * c00;
+					C[i * n + j + 1] += alpha * c01;
+					C[(i + 1) * n + j] += alpha * c10;
+					C[(i + 1) * n + j + 1] += alpha * c11;
+				}
+				for (; j < je; j++)
+				{
+					__float128 c0 = 0, c1 = 0;
+					for (long p = kk; p < ke; p++)
+					{
+						c0 += a0[p] * B[p * n + j];
+						c1 += a1[p] * B[p * n + j];
+					}
+					C[i * n + j] += alpha * c0;
+					C[(i + 1) * n + j] += alpha * c1;
+				}
+			}
+			for (; i < i1; i++)
+			{
+				const __float128 *a0 = A + i * k;
+				for (long j = jj; j < je; j++)
+				{
+					__float128 c0 = 0;
+					for (long p = kk; p < ke; p++)
+						c0 += a0[p] * B[p * n + j];
+					C[i * n + j] += alpha * c0;
+				}
+			}
+		}
+	}
+}
+
+static void
+gemm_panel_c128(void *ptr, long i0, long i1)
+{
+	const struct gemm_args *args = ptr;
+	const __complex128 *A = args->a, *B = args->b;
+	__complex128 *C = args->c;
+	const long n = args->n, k = args->k;
+	const __complex128 alpha = args->alpha, beta = args->beta;
+
+	for (long i = i0; i < i1; i++)
+		for (long j = 0; j < n; j++)
+			C[i * n + j] = beta == 0 ? 0 : beta * C[i * n + j];
+
+	for (long kk = 0; kk < k; kk += GEMM_KC)
+	{
+		long ke = kk + GEMM_KC < k ? kk + GEMM_KC : k;
+		for (long jj = 0; jj < n; jj += GEMM_NC)
+		{
+			long je = jj + GEMM_NC < n ? jj + GEMM_NC : n;
+			for (long i = i0; i < i1; i++)
+			{
+				const __complex128 *a0 = A + i * k;
+				long j = jj;
+				/* 1x2のレジスタブロック(実部・虚部で四本の累積値) */
+				for (; j + 2 <= je; j += 2)
+				{
+					__float128 r0 = 0, m0 = 0, r1 = 0, m1 = 0;
+					__complex128 c0, c1;
+					for (long p = kk; p < ke; p++)
+					{
+						cmuladd(&r0, &m0, a0[p], B[p * n + j]);
+						cmuladd(&r1, &m1, a0[p], B[p * n + j + 1]);
+					}
+					__real__ c0 = r0;  __imag__ c0 = m0;
+					__real__ c1 = r1;  __imag__ c1 = m1;
+					C[i * n + j]     += alpha * c0;
+					C[i * n + j + 1] += alpha * c1;
+				}
+				for (; j < je; j++)
+				{
+					__float128 r0 = 0, m0 = 0;
+					__complex128 c0;
+					for (long p = kk; p < ke; p++)
+						cmuladd(&r0, &m0, a0[p], B[p * n + j]);
+					__real__ c0 = r0;  __imag__ c0 = m0;
+					C[i * n + j] += alpha * c0;
+				}
+			}
+		}
+	}
+}
+
+static void *
+gemm_nogvl(void *ptr)
+{
+	struct gemm_args *args = ptr;
+
+	if (!quadmath_parallel_for_at(&args->row, args->m, GEMM_MC, args->nthreads,
+		args->type == VEC_FLOAT128 ? gemm_panel_f128 : gemm_panel_c128, args))
+		return QUADMATH_INTERRUPTED;
+
+	return NULL;
+}
+
+/*
+ * GEMV: y = alpha * A * x + beta * y
+ */
+struct gemv_args {
+	enum VECTOR_ELEM_TYPES type;
+	long m, n;
+	__complex128 alpha, beta;
+	const void *a;
+	const void *x;
+	void *y;
+	int nthreads;
+	long row;
+};
+
+static void
+gemv_rows_f128(void *ptr, long i0, long i1)
+{
+	const struct gemv_args *args = ptr;
+	const __float128 *A = args->a, *x = args->x;
+	__float128 *y = args->y;
+	const long n = args->n;
+	const __float128 alpha = crealq(args->alpha), beta = crealq(args->beta);
+
+	for (long i = i0; i < i1; i++)
+	{
+		const __float128 *a = A + i * n;
+		__float128 s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+		long j = 0;
+		for (; j + 4 <= n; j += 4)
+		{
+			s0 += a[j] *     x[j];
+			s1 += a[j + 1] * x[j + 1];
+			s2 += a[j + 2] * x[j + 2];
+			s3 += a[j + 3] * x[j + 3];
+		}
+		for (; j < n; j++)
+			s0 += a[j] * x[j];
+		y[i] = alpha * ((s0 + s1) + (s2 + s3)) + (beta == 0 ? 0 : beta * y[i]);
+	}
+}
+
+static void
+gemv_rows_c128(void *ptr, long i0, long i1)
+{
+	const struct gemv_args *args = ptr;
+	const __complex128 *A = args->a, *x = args->x;
+	__complex128 *y = args->y;
+	const long n = args->n;
+
+	for (long i = i0; i < i1; i++)
+	{
+		const __complex128 *a = A + i * n;
+		__float128 re = 0, im = 0;
+		__complex128 s;
+		for (long j = 0; j < n; j++)
+			cmuladd(&re, &im, a[j], x[j]);
+		__real__ s = re;  __imag__ s = im;
+		y[i] = args->alpha * s + (args->beta == 0 ? 0 : args->beta * y[i]);
+	}
+}
+
+static void *
+gemv_nogvl(void *ptr)
+{
+	struct gemv_args *args = ptr;
+
+	if (!quadmath_parallel_for_at(&args->row, args->m, GEMM_MC, args->nthreads,
+		args->type == VEC_FLOAT128 ? gemv_rows_f128 : gemv_rows_c128, args))
+		return QUADMATH_INTERRUPTED;
+
+	return NULL;
+}
+
+/* threads:キーワードの値．省略時はQuadMath.threads */
+int
+quadmath_opt_threads(VALUE opts)
+{
+	static ID kwds[1];
+	VALUE threads = Qundef;
+	int n;
+
+	if (!kwds[0])  kwds[0] = rb_intern_const("threads");
+
+	if (NIL_P(opts))
+		return quadmath_threads();
+	rb_get_kwargs(opts, kwds, 0, 1, &threads);
+	if (threads == Qundef || NIL_P(threads))
+		return quadmath_threads();
+	n = NUM2INT(threads);
+	if (n < 1)
+		rb_raise(rb_eArgError, "threads must be positive");
+	return n;
+}
+
+static struct QMatrix *
+check_qmatrix(VALUE obj)
+{
+	if (!qmatrix_p(obj))
+		rb_raise(rb_eTypeError,
+		  "wrong argument type %"PRIsVALUE" (expected %"PRIsVALUE")",
+		  rb_obj_class(obj), rb_cQuadMatrix);
+	return GetQMatrix(obj);
+}
+
+static struct QVector *
+check_qvector(VALUE obj)
+{
+	if (!qvector_p(obj))
+		rb_raise(rb_eTypeError,
+		  "wrong argument type %"PRIsVALUE" (expected %"PRIsVALUE")",
+		  rb_obj_class(obj), rb_cQuadVector);
+	return GetQVector(obj);
+}
+
+static __complex128
+scalar_of(VALUE x, enum VECTOR_ELEM_TYPES type)
+{
+	if (type == VEC_FLOAT128)
+		return num_to_cf128(x);
+	else
+		return num_to_cc128(x);
+}
+
+static void
+gemm_run(VALUE alpha, VALUE a, VALUE b, VALUE beta, VALUE c, int nthreads)
+{
+	struct QMatrix *ma = check_qmatrix(a), *mb = check_qmatrix(b), *mc = check_qmatrix(c);
+	struct gemm_args args;
+
+	if (ma->type != mb->type || ma->type != mc->type)
+		rb_raise(rb_eTypeError, "element types of matrices differ");
+	if (ma->cols != mb->rows || ma->rows != mc->rows || mb->cols != mc->cols)
+		rb_raise(rb_eArgError,
+		  "shape mismatch (%ldx%ld * %ldx%ld -> %ldx%ld)",
+		  ma->rows, ma->cols, mb->rows, mb->cols, mc->rows, mc->cols);
+	/* cは読みながら書き換えるので，aやbと同じ場所ではいけない */
+	if (mc->data.ptr == ma->data.ptr || mc->data.ptr == mb->data.ptr)
+		rb_raise(rb_eArgError, "output matrix must not be an input");
+
+	args.type = ma->type;
+	args.m = ma->rows;
+	args.n = mb->cols;
+	args.k = ma->cols;
+	args.alpha = scalar_of(alpha, args.type);
+	args.beta = scalar_of(beta, args.type);
+	args.a = ma->data.ptr;
+	args.b = mb->data.ptr;
+	args.c = mc->data.ptr;
+	args.nthreads = nthreads;
+	args.row = 0;
+
+	quadmath_call_nogvl(gemm_nogvl, &args, args.m * args.n * (args.k + 1));
+	RB_GC_GUARD(a);
+	RB_GC_GUARD(b);
+	RB_GC_GUARD(c);
+}
+
+static void
+gemv_run(VALUE alpha, VALUE a, VALUE x, VALUE beta, VALUE y, int nthreads)
+{
+	struct QMatrix *ma = check_qmatrix(a);
+	struct QVector *vx = check_qvector(x), *vy = check_qvector(y);
+	struct gemv_args args;
+
+	if (ma->type != vx->type || ma->type != vy->type)
+		rb_raise(rb_eTypeError, "element types of matrix and vectors differ");
+	if (ma->cols != vx->len || ma->rows != vy->len)
+		rb_raise(rb_eArgError,
+		  "shape mismatch (%ldx%ld * %ld -> %ld)",
+		  ma->rows, ma->cols, vx->len, vy->len);
+	if (vy->data.ptr == vx->data.ptr)
+		rb_raise(rb_eArgError, "output vector must not be an input");
+
+	args.type = ma->type;
+	args.m = ma->rows;
+	args.n = ma->cols;
+	args.alpha = scalar_of(alpha, args.type);
+	args.beta = scalar_of(beta, args.type);
+	args.a = ma->data.ptr;
+	args.x = vx->data.ptr;
+	args.y = vy->data.ptr;
+	args.nthreads = nthreads;
+	args.row = 0;
+
+	quadmath_call_nogvl(gemv_nogvl, &args, args.m * (args.n + 1));
+	RB_GC_GUARD(a);
+	RB_GC_GUARD(x);
+	RB_GC_GUARD(y);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::BLAS.gemm(alpha, a, b, beta, c, threads: QuadMath.threads) -> c
+ *
+ *  Overwrites the matrix +c+ with <code>alpha * a * b + beta * c</code> and returns +c+.
+ *  The matrices must have the same element type.
+ *  The product is computed in cache blocks with 2x2 register tiles.
+ *  With +threads+ greater than 1, panels of rows are shared by native threads; the answer does not depend on the number of threads.
+ *  +c+ must be a different matrix from +a+ and +b+; otherwise an ArgumentError is raised.
+ *
+ *    c = QuadMath::Matrix.new(2, 2)
+ *    QuadMath::BLAS.gemm(1, QuadMath::Matrix[[1, 2], [3, 4]], QuadMath::Matrix.identity(2), 0, c)
+ *    # => QuadMath::Matrix[[1.0, 2.0], [3.0, 4.0]]
+ */
+static VALUE
+blas_s_gemm(int argc, VALUE *argv, VALUE unused_obj)
+{
+	VALUE alpha, a, b, beta, c, opts;
+
+	rb_scan_args(argc, argv, "5:", &alpha, &a, &b, &beta, &c, &opts);
+	rb_check_frozen(c);
+	gemm_run(alpha, a, b, beta, c, quadmath_opt_threads(opts));
+
+	return c;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::BLAS.gemv(alpha, a, x, beta, y, threads: QuadMath.threads) -> y
+ *
+ *  Overwrites the vector +y+ with <code>alpha * a * x + beta * y</code> and returns +y+.
+ *  With +threads+ greater than 1, rows are shared by native threads.
+ *  +y+ must be a different vector from +x+; otherwise an ArgumentError is raised.
+ *
+ *    y = QuadMath::Vector.new(2)
+ *    QuadMath::BLAS.gemv(1, QuadMath::Matrix[[1, 2], [3, 4]], QuadMath::Vector[1, 1], 0, y)
+ *    # => QuadMath::Vector[3.0, 7.0]
+ */
+static VALUE
+blas_s_gemv(int argc, VALUE *argv, VALUE unused_obj)
+{
+	VALUE alpha, a, x, beta, y, opts;
+
+	rb_scan_args(argc, argv, "5:", &alpha, &a, &x, &beta, &y, &opts);
+	rb_check_frozen(y);
+	gemv_run(alpha, a, x, beta, y, quadmath_opt_threads(opts));
+
+	return y;
+}
+
+/*
+ *  call-seq:
+ *    gemv(x, threads: QuadMath.threads) -> QuadMath::Vector
+ *
+ *  Returns the product of +self+ and the vector +x+. See QuadMath::BLAS.gemv.
+ */
+static VALUE
+qmatrix_gemv(int argc, VALUE *argv, VALUE self)
+{
+	VALUE x, opts, y;
+	struct QMatrix *mat = GetQMatrix(self);
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	x = rb_qvector_from(x);
+	y = rb_qvector_new(mat->type, mat->rows);
+	gemv_run(INT2FIX(1), self, x, INT2FIX(0), y, quadmath_opt_threads(opts));
+
+	return y;
+}
+
+/*
+ *  call-seq:
+ *    gemm(b, threads: QuadMath.threads) -> QuadMath::Matrix
+ *
+ *  Returns the product of +self+ and the matrix +b+. See QuadMath::BLAS.gemm.
+ */
+static VALUE
+qmatrix_gemm(int argc, VALUE *argv, VALUE self)
+{
+	VALUE b, opts, c;
+	struct QMatrix *ma = GetQMatrix(self), *mb;
+
+	rb_scan_args(argc, argv, "1:", &b, &opts);
+	mb = check_qmatrix(b);
+	c = rb_qmatrix_new(ma->type, ma->rows, mb->cols);
+	gemm_run(INT2FIX(1), self, b, INT2FIX(0), c, quadmath_opt_threads(opts));
+
+	return c;
+}
+
+/*
+ *  call-seq:
+ *    self * other -> QuadMath::Matrix | QuadMath::Vector
+ *
+ *  Multiplies by a matrix, a vector (or an Array) or a scalar.
+ *  A real operand is promoted when the other is complex.
+ *
+ *    QuadMath::Matrix[[1, 2], [3, 4]] * QuadMath::Matrix[[1], [1]] # => QuadMath::Matrix[[3.0], [7.0]]
+ *    QuadMath::Matrix[[1, 2], [3, 4]] * [1, 1] # => QuadMath::Vector[3.0, 7.0]
+ *    QuadMath::Matrix[[1, 2]] * 1i # => QuadMath::Matrix[[(0.0+1.0i), (0.0+2.0i)]]
+ */
+static VALUE
+qmatrix_mul(VALUE self, VALUE other)
+{
+	struct QMatrix *ma = GetQMatrix(self);
+
+	if (qmatrix_p(other))
+	{
+		if (ma->type != GetQMatrix(other)->type)
+		{
+			self = rb_qmatrix_to_complex(self);
+			other = rb_qmatrix_to_complex(other);
+		}
+		return qmatrix_gemm(1, &other, self);
+	}
+	else if (qvector_p(other) || RB_TYPE_P(other, T_ARRAY))
+	{
+		other = rb_qvector_from(other);
+		if (ma->type != GetQVector(other)->type)
+		{
+			self = rb_qmatrix_to_complex(self);
+			other = rb_qvector_to_complex(other);
+		}
+		return qmatrix_gemv(1, &other, self);
+	}
+	else
+	{
+		bool nucomp_p = ma->type == VEC_COMPLEX128 || num_nucomp_p(other);
+		VALUE obj = qmatrix_dup_as(ma, nucomp_p ? VEC_COMPLEX128 : VEC_FLOAT128);
+		struct QMatrix *mc = GetQMatrix(obj);
+		long size = mc->rows * mc->cols;
+		if (nucomp_p)
+		{
+			__complex128 s = num_to_cc128(other);
+			for (long i = 0; i < size; i++)
+				mc->data.c128[i] *= s;
+		}
+		else
+		{
+			__float128 s = num_to_cf128(other);
+			for (long i = 0; i < size; i++)
+				mc->data.f128[i] *= s;
+		}
+		return obj;
+	}
+}
+
+void
+InitVM_Matrix(void)
+{
+	rb_define_alloc_func(rb_cQuadMatrix, qmatrix_allocate);
+	rb_define_singleton_method(rb_cQuadMatrix, "[]", qmatrix_s_aref, -1);
+	rb_define_singleton_method(rb_cQuadMatrix, "identity", qmatrix_s_identity, -1);
+
+	rb_define_method(rb_cQuadMatrix, "initialize", qmatrix_initialize, -1);
+	rb_define_method(rb_cQuadMatrix, "initialize_copy", qmatrix_initialize_copy, 1);
+
+	rb_define_method(rb_cQuadMatrix, "row_count", qmatrix_row_count, 0);
+	rb_define_method(rb_cQuadMatrix, "column_count", qmatrix_column_count, 0);
+	rb_define_method(rb_cQuadMatrix, "shape", qmatrix_shape, 0);
+	rb_define_method(rb_cQuadMatrix, "complex?", qmatrix_complex_p, 0);
+	rb_define_method(rb_cQuadMatrix, "[]", qmatrix_aref, 2);
+	rb_define_method(rb_cQuadMatrix, "[]=", qmatrix_aset, 3);
+	rb_define_method(rb_cQuadMatrix, "to_a", qmatrix_to_a, 0);
+	rb_define_method(rb_cQuadMatrix, "==", qmatrix_eq, 1);
+	rb_define_method(rb_cQuadMatrix, "inspect", qmatrix_inspect, 0);
+	rb_define_alias(rb_cQuadMatrix, "to_s", "inspect");
+	rb_define_method(rb_cQuadMatrix, "transpose", qmatrix_transpose, 0);
+
+	rb_define_method(rb_cQuadMatrix, "gemv", qmatrix_gemv, -1);
+	rb_define_method(rb_cQuadMatrix, "gemm", qmatrix_gemm, -1);
+	rb_define_method(rb_cQuadMatrix, "*", qmatrix_mul, 1);
+
+	rb_define_module_function(rb_mQuadBLAS, "gemm", blas_s_gemm, -1);
+	rb_define_module_function(rb_mQuadBLAS, "gemv", blas_s_gemv, -1);
+}
@@ -475,9 +475,16 @@ f_Float128(int argc, VALUE *argv, VALUE self)
 		val = string_to_f128_inline(val, exception);
 		break;
 	default:
-		if (CLASS_OF(val) == rb_cFloat128);
+		/* QuadMath::Vector#each_valueが使い回すオブジェクトは写してから返す */
+		if (CLASS_OF(val) == rb_cFloat128)
+		{
+			if (!RB_OBJ_FROZEN(val))
+				val = rb_float128_cf128(rb_float128_value(val));
+		}
 		else if (CLASS_OF(val) == rb_cComplex128)
 			val = complex128_to_f128_inline(val, exception);
+		else if (CLASS_OF(val) == rb_cDoubleDouble)
+			val = rb_float128_cf128(dd_to_f128(GetDD(val)));
 		else
 			val = numeric_to_f128_inline(val, exception);
 		break;
@@ -497,6 +504,7 @@ f_Float128(int argc, VALUE *argv, VALUE self)
  *    Complex128(2/3r) # => (0.666666666666666666666666666666667+0.0i)
  *    Complex128(1+2i) # => (1.0+2.0i)
  *    Complex128(Float128('1.3')) # => (1.3+0.0i)
+ *    Complex128(1.3.to_dd) # => (1.3000000000000000444089209850062+0.0i)
  *    Complex128(1.3) # => (1.3000000000000000444089209850062+0.0i)
  *    Complex128('1.3') # => (1.3+0.0i)
  *    Complex128('5i') #=> (0.0+5.0i)
@@ -527,9 +535,15 @@ f_Complex128(int argc, VALUE *argv, VALUE self)
 		val = string_to_c128_inline(val, exception);
 		break;
 	default:
-		if (CLASS_OF(val) == rb_cComplex128);
+		if (CLASS_OF(val) == rb_cComplex128)
+		{
+			if (!RB_OBJ_FROZEN(val))
+				val = rb_complex128_cc128(rb_complex128_value(val));
+		}
 		else if (CLASS_OF(val) == rb_cFloat128)
 			val = float128_to_c128_inline(val);
+		else if (CLASS_OF(val) == rb_cDoubleDouble)
+			val = rb_complex128_cc128((__complex128)dd_to_f128(GetDD(val)));
 		else
 			val = numeric_to_c128_inline(val, exception);
 		break;
@@ -631,6 +645,15 @@ f128_modulo(__float128 x, __float128 y)
 	}
 }
 
+/*
+ * DoubleDoubleとの演算では，DoubleDoubleをFloat128へ変換して四倍精度で行う．
+ */
+static inline VALUE
+doubledouble_to_f128_inline(VALUE x)
+{
+	return rb_float128_cf128(dd_to_f128(GetDD(x)));
+}
+
 static inline __float128
 get_real(VALUE num)
 {
@@ -656,6 +679,9 @@ get_real(VALUE num)
 	case NUM_FLOAT128:
 		real = rb_float128_value(num);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		real = dd_to_f128(GetDD(num));
+		break;
 	case NUM_COMPLEX128:
 		nucomp = complex128_to_f128_inline(num, false);
 		if (NIL_P(nucomp))  goto not_a_real;
@@ -680,6 +706,40 @@ not_a_real:
 
 }
 
+__float128
+num_to_cf128(VALUE num)
+{
+	return get_real(num);
+}
+
+__complex128
+num_to_cc128(VALUE num)
+{
+	__complex128 z = 0+0i;
+	
+	switch (convertion_num_types(num)) {
+	case NUM_COMPLEX:
+		__real__ z = get_real(rb_complex_real(num));
+		__imag__ z = get_real(rb_complex_imag(num));
+		break;
+	case NUM_COMPLEX128:
+		z = rb_complex128_value(num);
+		break;
+	case NUM_OTHERTYPE:
+		if (!RTEST(rb_funcall(num, rb_intern("real?"), 0)))
+		{
+			VALUE val = numeric_to_c128_inline(num, true);
+			z = rb_complex128_value(val);
+			break;
+		}
+		/* fall through */
+	default:
+		__real__ z = get_real(num);
+		break;
+	}
+	return z;
+}
+
 static inline void
 unknown_opecode(void)
 {
@@ -1021,6 +1081,9 @@ float128_add(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return float128_ope_float128(self, other, OPE_ADD);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return float128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_ADD);
+		break;
 	case NUM_COMPLEX128:
 	case NUM_OTHERTYPE:
 	default:
@@ -1056,6 +1119,9 @@ float128_sub(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return float128_ope_float128(self, other, OPE_SUB);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return float128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_SUB);
+		break;
 	case NUM_COMPLEX128:
 	case NUM_OTHERTYPE:
 	default:
@@ -1091,6 +1157,9 @@ float128_mul(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return float128_ope_float128(self, other, OPE_MUL);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return float128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_MUL);
+		break;
 	case NUM_COMPLEX128:
 	case NUM_OTHERTYPE:
 	default:
@@ -1126,6 +1195,9 @@ float128_div(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return float128_ope_float128(self, other, OPE_DIV);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return float128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_DIV);
+		break;
 	case NUM_COMPLEX128:
 	case NUM_OTHERTYPE:
 	default:
@@ -1161,6 +1233,9 @@ float128_mod(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return float128_ope_float128(self, other, OPE_MOD);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return float128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_MOD);
+		break;
 	case NUM_COMPLEX128:
 	case NUM_OTHERTYPE:
 	default:
@@ -1195,6 +1270,9 @@ float128_pow(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return float128_ope_float128(self, other, OPE_POW);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return float128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_POW);
+		break;
 	case NUM_COMPLEX128:
 	case NUM_OTHERTYPE:
 	default:
@@ -1230,6 +1308,9 @@ float128_cmp(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return float128_ope_float128(self, other, OPE_CMP);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return float128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_CMP);
+		break;
 	case NUM_COMPLEX128:
 		return float128_ope_complex128(self, other, OPE_CMP);
 		break;
@@ -1271,6 +1352,9 @@ float128_coerce(int argc, VALUE *argv, VALUE self)
 	case NUM_FLOAT128:
 		return float128_ope_float128(self, other, OPE_COERCE);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return float128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_COERCE);
+		break;
 	case NUM_COMPLEX128:
 		return float128_ope_complex128(self, other, OPE_COERCE);
 		break;
@@ -1288,7 +1372,7 @@ float128_fused_multiply_add(VALUE xhs, VALUE yhs, VALUE zhs)
 	           y = get_real(yhs),
 	           z = get_real(zhs);
 	
-	return rb_float128_cf128(fmaq(x, y, z));
+	return rb_float128_cf128(fma_q(x, y, z));
 }
 
 /*
@@ -1850,6 +1934,9 @@ complex128_add(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return complex128_ope_float128(self, other, OPE_ADD);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return complex128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_ADD);
+		break;
 	case NUM_COMPLEX128:
 		return complex128_ope_complex128(self, other, OPE_ADD);
 		break;
@@ -1887,6 +1974,9 @@ complex128_sub(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return complex128_ope_float128(self, other, OPE_SUB);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return complex128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_SUB);
+		break;
 	case NUM_COMPLEX128:
 		return complex128_ope_complex128(self, other, OPE_SUB);
 		break;
@@ -1924,6 +2014,9 @@ complex128_mul(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return complex128_ope_float128(self, other, OPE_MUL);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return complex128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_MUL);
+		break;
 	case NUM_COMPLEX128:
 		return complex128_ope_complex128(self, other, OPE_MUL);
 		break;
@@ -1961,6 +2054,9 @@ complex128_div(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return complex128_ope_float128(self, other, OPE_DIV);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return complex128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_DIV);
+		break;
 	case NUM_COMPLEX128:
 		return complex128_ope_complex128(self, other, OPE_DIV);
 		break;
@@ -1998,6 +2094,9 @@ complex128_mod(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return complex128_ope_float128(self, other, OPE_MOD);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return complex128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_MOD);
+		break;
 	case NUM_COMPLEX128:
 		return complex128_ope_complex128(self, other, OPE_MOD);
 		break;
@@ -2035,6 +2134,9 @@ complex128_pow(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return complex128_ope_float128(self, other, OPE_POW);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return complex128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_POW);
+		break;
 	case NUM_COMPLEX128:
 		return complex128_ope_complex128(self, other, OPE_POW);
 		break;
@@ -2071,6 +2173,9 @@ complex128_cmp(VALUE self, VALUE other)
 	case NUM_FLOAT128:
 		return complex128_ope_float128(self, other, OPE_CMP);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return complex128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_CMP);
+		break;
 	case NUM_COMPLEX128:
 		return complex128_ope_complex128(self, other, OPE_CMP);
 		break;
@@ -2109,6 +2214,9 @@ complex128_coerce(int argc, VALUE *argv, VALUE self)
 	case NUM_FLOAT128:
 		return complex128_ope_float128(self, other, OPE_COERCE);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return complex128_ope_float128(self, doubledouble_to_f128_inline(other), OPE_COERCE);
+		break;
 	case NUM_COMPLEX128:
 		return complex128_ope_complex128(self, other, OPE_COERCE);
 		break;
@@ -2266,9 +2374,82 @@ xsnprintf(char *buf, size_t sz, char *format, int width, int prec, __float128 x)
 	return n;
 }
 
+/* 一度にGVLを解放して書式化する要素数 */
+#define SPRINTF_BATCH 4096
+
+struct sprintf_vector_args {
+	char *format;
+	int width;
+	int prec;
+	const __float128 *x;
+	long len;
+	char *buf;
+	int *n;
+};
+
+/* 各要素をbufのBUF_SIZ文字ずつの枠に書き，書式化した長さをnに残す */
+static void *
+sprintf_vector_nogvl(void *ptr)
+{
+	struct sprintf_vector_args *args = ptr;
+
+	for (long i = 0; i < args->len; i++)
+		args->n[i] = xsnprintf(args->buf + i * BUF_SIZ, BUF_SIZ,
+		                       args->format, args->width, args->prec, args->x[i]);
+	return NULL;
+}
+
+/*
+ * 実数の列を要素ごとに書式化してStringのArrayを返す．
+ * SPRINTF_BATCH個ずつGVLを解放して書式化し，枠に収まらなかった要素はGVLを持って書き直す．
+ */
+static VALUE
+sprintf_vector(char *format, int width, int prec, VALUE obj)
+{
+	VALUE x = rb_qvector_from(obj), ary, tmp;
+	struct QVector *vec = GetQVector(x);
+	struct sprintf_vector_args args;
+
+	if (vec->type != VEC_FLOAT128)
+		rb_raise(rb_eTypeError, "not a real vector");
+
+	ary = rb_ary_new_capa(vec->len);
+	args.format = format;
+	args.width = width;
+	args.prec = prec;
+	args.buf = ALLOCV(tmp, (BUF_SIZ + sizeof(int)) * SPRINTF_BATCH);
+	args.n = (int *)(args.buf + BUF_SIZ * SPRINTF_BATCH);
+
+	for (long k = 0; k < vec->len; k += SPRINTF_BATCH)
+	{
+		args.x = vec->data.f128 + k;
+		args.len = vec->len - k < SPRINTF_BATCH ? vec->len - k : SPRINTF_BATCH;
+		quadmath_call_nogvl(sprintf_vector_nogvl, &args, 32 * args.len);
+		for (long i = 0; i < args.len; i++)
+		{
+			VALUE str;
+			if (args.n[i] < 0)
+				str = rb_str_new(0, 0);
+			else if (args.n[i] < BUF_SIZ)
+				str = rb_str_new(args.buf + i * BUF_SIZ, args.n[i]);
+			else
+			{
+				str = rb_str_new(NULL, args.n[i]);
+				xsnprintf(RSTRING_PTR(str), args.n[i] + 1, format, width, prec, args.x[i]);
+			}
+			rb_ary_push(ary, str);
+		}
+	}
+	ALLOCV_END(tmp);
+	RB_GC_GUARD(x);
+
+	return ary;
+}
+
 /*
  *  call-seq:
  *    quadmath_sprintf(format, *arg) -> String
+ *    quadmath_sprintf(format, *arg, vector) -> Array
  *  
  *  A front end that provides access to the quadmath_snprintf() library function.  
  *  Notice that the method name and argument count are slightly different from the library's.  
@@ -2280,6 +2461,10 @@ xsnprintf(char *buf, size_t sz, char *format, int width, int prec, __float128 x)
  *  The string is stored in an internal buffer and provided to the user level.  
  *  If the function throws an error because the internal buffer is insufficient, it will automatically allocate memory and pass it.  
  *  
+ *  If the value to be converted is a real QuadMath::Vector or an Array, each element is formatted and an Array of Strings is returned.
+ *  The format must then be a single conversion without other text, and the vector must be the last argument; otherwise an ArgumentError is raised.
+ *  The elements are formatted in batches without the GVL, so other threads keep running.
+ *  
  *    quadmath_sprintf("%Qf", 2) # => "2.000000"
  *    quadmath_sprintf("%Qf", 7/10r) # => "0.700000"
  *    quadmath_sprintf("%.*Qf", Float128::DIG, 1/3r) # => "0.333333333333333333333333333333333"
@@ -2287,6 +2472,7 @@ xsnprintf(char *buf, size_t sz, char *format, int width, int prec, __float128 x)
  *    quadmath_sprintf("%.*Qf", Float128::DIG, 1.to_f128 / 3) # => "0.333333333333333333333333333333333"
  *    width = 46; prec = 20;
  *    quadmath_sprintf("%+-#*.*Qe", width, prec, QuadMath.sqrt(2)) # => "+1.41421356237309504880e+00                   "
+ *    quadmath_sprintf("%.3Qf", QuadMath::Vector[1, 2.5]) # => ["1.000", "2.500"]
  */
 static VALUE
 f_quadmath_sprintf(int argc, VALUE *argv, VALUE self)
@@ -2294,7 +2480,7 @@ f_quadmath_sprintf(int argc, VALUE *argv, VALUE self)
 	VALUE vformat, arg, apptd, retval;
 	char *format;
 	int fmt_stat = FMT_EMPTY, flags = 0, width = 0, prec = 0, float_type = FT_FLT;
-	long arg_offset = 0;
+	long arg_offset = 0, directive = -1;
 	char notation = 'f';
 	
 	rb_scan_args(argc, argv, "1*", &vformat, &arg);
@@ -2312,7 +2498,10 @@ f_quadmath_sprintf(int argc, VALUE *argv, VALUE self)
 		switch (c) {
 		case '%':
 			if (fmt_stat == FMT_EMPTY)
+			{
 				fmt_stat = FMT_DRCTV;
+				directive = i;
+			}
 			else
 				goto fmt_error;
 			break;
@@ -2450,7 +2639,8 @@ f_quadmath_sprintf(int argc, VALUE *argv, VALUE self)
 					goto too_few_arguments;
 				else
 				{
-					__float128 x = get_real(rb_ary_entry(arg, arg_offset));
+					VALUE item = rb_ary_entry(arg, arg_offset);
+					__float128 x;
 					int n;
 					char buf[BUF_SIZ];
 					apptd = rb_usascii_str_new_cstr("%");
@@ -2466,6 +2656,17 @@ f_quadmath_sprintf(int argc, VALUE *argv, VALUE self)
 					                         rb_str_concat(apptd, CHR2FIX('Q'));
 					                         rb_str_concat(apptd, CHR2FIX(notation));
 					
+					if (RB_TYPE_P(item, T_ARRAY) || qvector_p(item))
+					{
+						/* 要素ごとの文字列にするので，前後の文字や残りの引数は置き場所がない */
+						if (directive != 0 || i != RSTRING_LEN(vformat) - 1)
+							rb_raise(rb_eArgError, "format for a vector must be a single conversion");
+						if (RARRAY_LEN(arg) > arg_offset + 1)
+							rb_raise(rb_eArgError, "too many arguments");
+						retval = sprintf_vector(StringValuePtr(apptd), width, prec, item);
+						goto return_value;
+					}
+					x = get_real(item);
 					n = xsnprintf(buf, BUF_SIZ, StringValuePtr(apptd), width, prec, x);
 					
 					if ((size_t)n < sizeof(buf))
@@ -2637,6 +2838,7 @@ InitVM_Numerable(void)
 	rb_define_alias(rb_cComplex128, "angle", "arg");
 	rb_define_alias(rb_cComplex128, "phase", "arg");
 	rb_define_method(rb_cComplex128, "conj", complex128_conj, 0);
+	rb_define_alias(rb_cComplex128, "conjugate", "conj");
 	
 	rb_define_method(rb_cComplex128, "+", complex128_add, 1);
 	rb_define_method(rb_cComplex128, "-", complex128_sub, 1);
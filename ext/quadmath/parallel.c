@@ -0,0 +1,306 @@
+/*******************************************************************************
+    parallel.c -- Data Parallel Execution
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <quadmath.h>
+#include <pthread.h>
+#include <signal.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+#define PARALLEL_MAX_THREADS 256
+
+/* GVLを解放して計算しているスレッドへの中断の要求．unblock関数が他のスレッドから立てる */
+static __thread bool interrupt_requested;
+
+static void
+nogvl_ubf(void *ptr)
+{
+	__atomic_store_n((bool *)ptr, true, __ATOMIC_RELAXED);
+}
+
+bool
+quadmath_interrupted_p(void)
+{
+	return __atomic_load_n(&interrupt_requested, __ATOMIC_RELAXED);
+}
+
+void
+quadmath_call_nogvl(void *(*func)(void *), void *data, long n)
+{
+	if (n < NOGVL_THRESHOLD)
+	{
+		func(data);
+		return;
+	}
+	for (;;)
+	{
+		void *ret;
+
+		interrupt_requested = false;
+		ret = rb_thread_call_without_gvl(func, data, nogvl_ubf, &interrupt_requested);
+		interrupt_requested = false;
+		if (ret != QUADMATH_INTERRUPTED)
+			break;
+		/* 例外になる割り込みならここで抜ける．GVLを解放する前に確保したものはGCが回収する */
+		rb_thread_check_ints();
+	}
+}
+
+/* 省略時のスレッド数．QuadMath.threads= と環境変数QUADMATH_NUM_THREADSで決める */
+static int default_threads = 1;
+
+int
+quadmath_threads(void)
+{
+	return default_threads;
+}
+
+struct parallel_job {
+	long n;
+	long grain;
+	long next;
+	parallel_func_t fn;
+	void *arg;
+	const bool *interrupt;
+};
+
+/*
+ * 区間を先着順に取り出す．手の空いたスレッドが次の区間を取るので，
+ * 重い区間があっても他のスレッドが残りを引き受ける．
+ * どの区間をどのスレッドが担当しても結果は変わらず，取り出した区間は必ず最後まで計算するから，
+ * 計算済みの区間はいつも先頭からの連続した範囲になる．
+ */
+static void *
+parallel_worker(void *ptr)
+{
+	struct parallel_job *job = ptr;
+	long begin;
+
+	while (!(job->interrupt && __atomic_load_n(job->interrupt, __ATOMIC_RELAXED)) &&
+	       (begin = __atomic_fetch_add(&job->next, job->grain, __ATOMIC_RELAXED)) < job->n)
+	{
+		long end = begin + job->grain < job->n ? begin + job->grain : job->n;
+		job->fn(job->arg, begin, end);
+	}
+	return NULL;
+}
+
+/*
+ * 常駐するワーカースレッドの集まり．必要な本数まで初めて使うときに起こし，以後は待機させる．
+ * 同時に受け持つジョブは一つで，使用中に別のスレッドから来たジョブは呼び出したスレッドだけで計算する．
+ */
+static struct {
+	pthread_mutex_t lock;
+	pthread_cond_t wake;
+	pthread_cond_t idle;
+	int nworkers;
+	struct parallel_job *job;
+	int want;                 /* このジョブに加わるワーカーの数 */
+	int joined;
+	int running;
+	unsigned long generation;
+} pool = {
+	PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER
+};
+
+static void *
+pool_worker(void *unused)
+{
+	unsigned long seen = 0;
+
+	pthread_mutex_lock(&pool.lock);
+	for (;;)
+	{
+		if (pool.job != NULL && pool.generation != seen && pool.joined < pool.want)
+		{
+			struct parallel_job *job = pool.job;
+
+			seen = pool.generation;
+			pool.joined++;
+			pool.running++;
+			pthread_mutex_unlock(&pool.lock);
+			parallel_worker(job);
+			pthread_mutex_lock(&pool.lock);
+			if (--pool.running == 0)
+				pthread_cond_signal(&pool.idle);
+		}
+		else
+			pthread_cond_wait(&pool.wake, &pool.lock);
+	}
+	return NULL;
+}
+
+/* シグナルはRubyのスレッドで受けるので，ワーカーではすべて塞いでおく */
+static bool
+pool_spawn(void)
+{
+	pthread_t th;
+	pthread_attr_t attr;
+	sigset_t all, old;
+	int ret;
+
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	ret = pthread_create(&th, &attr, pool_worker, NULL);
+	pthread_attr_destroy(&attr);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	return ret == 0;
+}
+
+/* helpers本までのワーカーをjobに呼ぶ．使用中か一本も起こせなければfalseを返す */
+static bool
+pool_enter(struct parallel_job *job, int helpers)
+{
+	pthread_mutex_lock(&pool.lock);
+	if (pool.job != NULL)
+	{
+		pthread_mutex_unlock(&pool.lock);
+		return false;
+	}
+	while (pool.nworkers < helpers && pool_spawn())
+		pool.nworkers++;
+	if (pool.nworkers == 0)
+	{
+		pthread_mutex_unlock(&pool.lock);
+		return false;
+	}
+	pool.job = job;
+	pool.want = helpers < pool.nworkers ? helpers : pool.nworkers;
+	pool.joined = 0;
+	pool.running = 0;
+	pool.generation++;
+	pthread_cond_broadcast(&pool.wake);
+	pthread_mutex_unlock(&pool.lock);
+
+	return true;
+}
+
+/* まだ加わっていないワーカーを締め出し，加わったワーカーが抜けるのを待つ */
+static void
+pool_leave(void)
+{
+	pthread_mutex_lock(&pool.lock);
+	pool.want = pool.joined;
+	while (pool.running > 0)
+		pthread_cond_wait(&pool.idle, &pool.lock);
+	pool.job = NULL;
+	pthread_mutex_unlock(&pool.lock);
+}
+
+/* fork()した子プロセスにワーカーはいない */
+static void
+pool_atfork_child(void)
+{
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.wake, NULL);
+	pthread_cond_init(&pool.idle, NULL);
+	pool.nworkers = 0;
+	pool.job = NULL;
+	pool.want = pool.joined = pool.running = 0;
+}
+
+static void
+parallel_run(struct parallel_job *job, int nthreads)
+{
+	long nchunks = (job->n - job->next + job->grain - 1) / job->grain;
+
+	if (nthreads > PARALLEL_MAX_THREADS)  nthreads = PARALLEL_MAX_THREADS;
+	if (nthreads > nchunks)  nthreads = (int)nchunks;
+
+	if (nthreads > 1 && pool_enter(job, nthreads - 1))
+	{
+		parallel_worker(job);
+		pool_leave();
+	}
+	else
+		parallel_worker(job);
+}
+
+void
+quadmath_parallel_for(long n, long grain, int nthreads, parallel_func_t fn, void *arg)
+{
+	struct parallel_job job = { n, grain > 0 ? grain : 1, 0, fn, arg, NULL };
+
+	parallel_run(&job, nthreads);
+}
+
+bool
+quadmath_parallel_for_at(long *pos, long n, long grain, int nthreads, parallel_func_t fn, void *arg)
+{
+	struct parallel_job job = { n, grain > 0 ? grain : 1, *pos, fn, arg, &interrupt_requested };
+
+	if (job.next >= n)
+		return true;
+	parallel_run(&job, nthreads);
+	*pos = job.next < n ? job.next : n;
+	return *pos == n;
+}
+
+static int
+threads_value(VALUE n)
+{
+	int nthreads = NUM2INT(n);
+
+	if (nthreads < 1)
+		rb_raise(rb_eArgError, "threads must be positive");
+	return nthreads < PARALLEL_MAX_THREADS ? nthreads : PARALLEL_MAX_THREADS;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.threads -> Integer
+ *
+ *  Returns the number of native threads that data-parallel kernels use when the +threads+ keyword is omitted.
+ *  The initial value is taken from the environment variable +QUADMATH_NUM_THREADS+, or 1 if it is not set.
+ *
+ *    QuadMath.threads # => 1
+ */
+static VALUE
+quadmath_get_threads(VALUE unused_obj)
+{
+	return INT2FIX(default_threads);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.threads = n
+ *
+ *  Sets the default number of native threads, at most 256.
+ *  The vector functions, reductions, level-1 BLAS, matrix products and factorizations
+ *  split their work into chunks that idle threads take in turn.
+ *  The worker threads are started on first use and wait between calls, and the results do not depend on +n+.
+ *
+ *    QuadMath.threads = 8
+ */
+static VALUE
+quadmath_set_threads(VALUE unused_obj, VALUE n)
+{
+	default_threads = threads_value(n);
+	return n;
+}
+
+void
+InitVM_Parallel(void)
+{
+	const char *env = getenv("QUADMATH_NUM_THREADS");
+
+	if (env != NULL)
+	{
+		char *end;
+		long n = strtol(env, &end, 10);
+		if (end != env && *end == '\0' && n >= 1)
+			default_threads = n < PARALLEL_MAX_THREADS ? (int)n : PARALLEL_MAX_THREADS;
+		else
+			rb_warn("QUADMATH_NUM_THREADS is ignored: %s", env);
+	}
+	pthread_atfork(NULL, NULL, pool_atfork_child);
+
+	rb_define_module_function(rb_mQuadMath, "threads", quadmath_get_threads, 0);
+	rb_define_module_function(rb_mQuadMath, "threads=", quadmath_set_threads, 1);
+}
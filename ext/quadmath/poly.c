@@ -0,0 +1,313 @@
+/*******************************************************************************
+    poly.c -- Polynomial Functions of module QuadMath
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <quadmath.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+/* Aberth法の既定の反復回数の上限 */
+#define ROOTS_MAX_ITER 500
+
+/*
+ * 係数c[0], ..., c[n] (最高次から) の多項式をHornerの方法で評価する．
+ */
+static inline __float128
+horner_f128(const __float128 *c, long n, __float128 x)
+{
+	__float128 p = c[0];
+	for (long k = 1; k <= n; k++)
+		p = p * x + c[k];
+	return p;
+}
+
+static inline __complex128
+horner_c128(const __complex128 *c, long n, __complex128 z)
+{
+	__complex128 p = c[0];
+	for (long k = 1; k <= n; k++)
+		p = p * z + c[k];
+	return p;
+}
+
+struct polyval_args {
+	long deg;
+	bool complex_p;
+	struct QVector *c;
+	struct QVector *x;
+	struct QVector *y;
+	long i;
+};
+
+static void *
+polyval_nogvl(void *ptr)
+{
+	struct polyval_args *args = ptr;
+	const long n = args->x->len, deg = args->deg;
+
+	for (; args->i < n; args->i++)
+	{
+		const long i = args->i;
+		if (i % NOGVL_POLL_STRIDE == 0 && quadmath_interrupted_p())
+			return QUADMATH_INTERRUPTED;
+		if (!args->complex_p)
+			args->y->data.f128[i] = horner_f128(args->c->data.f128, deg, args->x->data.f128[i]);
+		else
+			args->y->data.c128[i] = horner_c128(args->c->data.c128, deg, args->x->data.c128[i]);
+	}
+	return NULL;
+}
+
+static bool
+complex_scalar_p(VALUE x)
+{
+	switch (convertion_num_types(x)) {
+	case NUM_COMPLEX:
+	case NUM_COMPLEX128:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.polyval(coeffs, x) -> Float128 | Complex128 | QuadMath::Vector
+ *
+ *  Evaluates the polynomial with coefficients +coeffs+, from the highest degree down to the constant term, at +x+ by Horner's method in __float128.
+ *  +coeffs+ is a vector or an Array, real or complex.
+ *  +x+ is a number, which gives a Float128 or Complex128, or a vector or Array, which gives a vector of the values at each element.
+ *  No Ruby object is allocated per term.
+ *
+ *    QuadMath.polyval([1, -3, 2], 3) # => 2.0
+ *    QuadMath.polyval([1, 0, 1], Complex(0, 1)) # => (0.0+0.0i)
+ *    QuadMath.polyval([1, -3, 2], [0, 1, 2]) # => QuadMath::Vector[2.0, 0.0, 0.0]
+ */
+static VALUE
+quadmath_polyval(VALUE unused_obj, VALUE coeffs, VALUE x)
+{
+	struct polyval_args args;
+	VALUE c = rb_qvector_from(coeffs), y;
+	bool scalar_p = !RB_TYPE_P(x, T_ARRAY) && !qvector_p(x);
+
+	args.complex_p = GetQVector(c)->type == VEC_COMPLEX128;
+	if (scalar_p)
+	{
+		struct QVector *vc = GetQVector(c);
+		const long deg = vc->len - 1;
+
+		if (!args.complex_p && !complex_scalar_p(x))
+			return rb_float128_cf128(deg < 0 ? 0 : horner_f128(vc->data.f128, deg, num_to_cf128(x)));
+		c = rb_qvector_to_complex(c);
+		vc = GetQVector(c);
+		y = rb_complex128_cc128(deg < 0 ? 0 : horner_c128(vc->data.c128, deg, num_to_cc128(x)));
+		RB_GC_GUARD(c);
+		return y;
+	}
+
+	x = rb_qvector_from(x);
+	if (args.complex_p || GetQVector(x)->type == VEC_COMPLEX128)
+	{
+		args.complex_p = true;
+		c = rb_qvector_to_complex(c);
+		x = rb_qvector_to_complex(x);
+	}
+	args.c = GetQVector(c);
+	args.x = GetQVector(x);
+	args.deg = args.c->len - 1;
+	args.i = 0;
+	y = rb_qvector_new(args.complex_p ? VEC_COMPLEX128 : VEC_FLOAT128, args.x->len);
+	args.y = GetQVector(y);
+	if (args.deg < 0)
+	{
+		for (long i = 0; i < args.x->len; i++)
+		{
+			if (args.complex_p)
+				args.y->data.c128[i] = 0;
+			else
+				args.y->data.f128[i] = 0;
+		}
+	}
+	else
+		quadmath_call_nogvl(polyval_nogvl, &args, args.x->len * (args.deg + 1));
+	RB_GC_GUARD(c);
+	RB_GC_GUARD(x);
+
+	return y;
+}
+
+/*
+ * Aberth-Ehrlich法．n個の近似根を同時に更新する．
+ * 各根についてNewton補正 N = p(z_i) / p'(z_i) を求め，
+ * 他の根からの反発項で z_i -= N / (1 - N Σ_{j≠i} 1 / (z_i - z_j)) とする．
+ * 一反復の間はすべての補正を古い近似根から計算し，その後まとめて反映する．
+ */
+struct roots_args {
+	long n;
+	const __complex128 *c;
+	__complex128 *z;
+	__complex128 *w;
+	__float128 *ac;
+	bool *done;
+	int max_iter;
+	int iter;
+	long remain;
+	bool converged;
+};
+
+/*
+ * p(z)，p'(z)と，Hornerの方法の丸め誤差の目安 Σ|c_k||z|^(n-k) を求める．
+ */
+static inline void
+horner_c128_deriv(const struct roots_args *args, __complex128 z, __complex128 *pp, __complex128 *dp, __float128 *bound)
+{
+	const __float128 az = cabsq(z);
+	__complex128 p = args->c[0], d = 0;
+	__float128 s = args->ac[0];
+
+	for (long k = 1; k <= args->n; k++)
+	{
+		d = d * z + p;
+		p = p * z + args->c[k];
+		s = s * az + args->ac[k];
+	}
+	*pp = p;
+	*dp = d;
+	*bound = s;
+}
+
+static void *
+roots_nogvl(void *ptr)
+{
+	struct roots_args *args = ptr;
+	const long n = args->n;
+	long remain = args->remain;
+
+	/* 初期値は根の絶対値の幾何平均を半径とする円周上に，実軸を避けて並べる */
+	if (args->iter == 0 && remain == n)
+	{
+		const __float128 r = powq(args->ac[n] / args->ac[0], 1 / (__float128)n);
+		for (long i = 0; i < n; i++)
+		{
+			__float128 theta = 2 * M_PIq * i / n + 0.4Q;
+			__real__ args->z[i] = r * cosq(theta);
+			__imag__ args->z[i] = r * sinq(theta);
+			args->done[i] = false;
+		}
+	}
+
+	/* 中断は反復の切れ目で受け付ける */
+	for (; args->iter < args->max_iter && remain > 0; args->iter++)
+	{
+		if (quadmath_interrupted_p())
+		{
+			args->remain = remain;
+			return QUADMATH_INTERRUPTED;
+		}
+		for (long i = 0; i < n; i++)
+		{
+			__complex128 p, d, ratio, s = 0;
+			__float128 bound;
+
+			args->w[i] = 0;
+			if (args->done[i])
+				continue;
+			horner_c128_deriv(args, args->z[i], &p, &d, &bound);
+			/* 値がHornerの方法の誤差限界 2n eps Σ|c_k||z|^(n-k) を下回れば，これ以上は精度が上がらない */
+			if (cabsq(p) <= 2 * n * FLT128_EPSILON * bound)
+			{
+				args->done[i] = true;
+				remain--;
+				continue;
+			}
+			ratio = p / d;
+			for (long j = 0; j < n; j++)
+				if (j != i)
+					s += 1 / (args->z[i] - args->z[j]);
+			/* 補正が小さいことは収束の判定に使えない．二つの近似根が近づくとsが大きくなり補正は0に近づく */
+			args->w[i] = ratio / (1 - ratio * s);
+		}
+		for (long i = 0; i < n; i++)
+			args->z[i] -= args->w[i];
+	}
+	args->converged = remain == 0;
+	return NULL;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.roots(coeffs, max_iter: 500) -> QuadMath::Vector
+ *
+ *  Returns the complex roots of the polynomial with coefficients +coeffs+, from the highest degree down to the constant term.
+ *  All roots are refined simultaneously by the Aberth-Ehrlich iteration in __complex128,
+ *  and a root is accepted when the polynomial value there falls to the rounding error of Horner's method.
+ *  Leading zero coefficients are ignored, and trailing ones give roots at zero.
+ *  If some roots are not accepted in +max_iter+ iterations, a warning is issued and the last approximations are returned.
+ *
+ *    QuadMath.roots([1, -3, 2]) # => QuadMath::Vector[(2.0+0.0i), (1.0+0.0i)]
+ */
+static VALUE
+quadmath_roots(int argc, VALUE *argv, VALUE unused_obj)
+{
+	static ID kwds[1];
+	VALUE coeffs, opts, max_iter = Qundef, c, y, tmp;
+	struct roots_args args;
+	struct QVector *vc;
+	long head = 0, tail, n, zeros;
+	char *buf;
+
+	if (!kwds[0])  kwds[0] = rb_intern_const("max_iter");
+
+	rb_scan_args(argc, argv, "1:", &coeffs, &opts);
+	if (!NIL_P(opts))
+		rb_get_kwargs(opts, kwds, 0, 1, &max_iter);
+
+	c = rb_qvector_to_complex(rb_qvector_from(coeffs));
+	vc = GetQVector(c);
+	tail = vc->len;
+	while (head < tail && vc->data.c128[head] == 0)
+		head++;
+	while (tail > head && vc->data.c128[tail - 1] == 0)
+		tail--;
+	if (head == tail)
+		return rb_qvector_new(VEC_COMPLEX128, 0);
+	n = tail - head - 1;
+	zeros = vc->len - tail;
+
+	y = rb_qvector_new(VEC_COMPLEX128, n + zeros);
+	buf = ALLOCV(tmp, sizeof(__complex128) * n + sizeof(__float128) * (n + 1) + sizeof(bool) * n + 1);
+	args.n = n;
+	args.c = vc->data.c128 + head;
+	args.z = GetQVector(y)->data.c128;
+	args.w = (__complex128 *)buf;
+	args.ac = (__float128 *)(args.w + n);
+	args.done = (bool *)(args.ac + n + 1);
+	args.max_iter = max_iter == Qundef || NIL_P(max_iter) ? ROOTS_MAX_ITER : NUM2INT(max_iter);
+	args.converged = true;
+	args.iter = 0;
+	args.remain = n;
+	for (long k = 0; k <= n; k++)
+		args.ac[k] = cabsq(args.c[k]);
+
+	if (n > 0)
+		quadmath_call_nogvl(roots_nogvl, &args, n * n);
+	ALLOCV_END(tmp);
+	RB_GC_GUARD(c);
+
+	for (long i = n; i < n + zeros; i++)
+		args.z[i] = 0;
+
+	if (!args.converged)
+		rb_warn("roots did not converge in %d iterations", args.iter);
+
+	return y;
+}
+
+void
+InitVM_Poly(void)
+{
+	rb_define_module_function(rb_mQuadMath, "polyval", quadmath_polyval, 2);
+	rb_define_module_function(rb_mQuadMath, "roots", quadmath_roots, -1);
+}
@@ -118,21 +118,310 @@ complex128_to_nucomp(VALUE self)
 		rb_float128_cf128(cimagq(z)));
 }
 
+/*
+ * 一変数関数の核．スカラーのrealsolve，nucompsolveとベクトルの要素ごとの計算で共有する．
+ * realは実数解を*yに書いて真を返すか，実数の範囲に解がなければ複素数解を*wに書いて偽を返す．
+ * compは複素数解を*wに書いて真を返す．複素数を受け付けない関数では偽を返す．
+ * fastはaccuracy: :fastで使うdouble-doubleの経路で，扱えない引数では偽を返してrealに任せる．
+ */
+struct unary_kernel {
+	bool (*real)(__float128 x, __float128 *y, __complex128 *w);
+	bool (*comp)(__complex128 z, __complex128 *w);
+	bool (*fast)(__float128 x, __float128 *y);
+};
+
+static ID id_accuracy, id_accuracy_key, id_full, id_fast;
+
+static bool
+accuracy_fast_p(VALUE accuracy)
+{
+	if (accuracy == ID2SYM(id_fast))
+		return true;
+	if (accuracy != ID2SYM(id_full))
+		rb_raise(rb_eArgError, "unknown accuracy: %+"PRIsVALUE, accuracy);
+	return false;
+}
+
+/*
+ * 精度の指定．accuracy:があればそれに，なければQuadMath.with_accuracyで
+ * ファイバーごとに決めた既定値に従う．
+ */
+static bool
+unary_fast_p(VALUE opts)
+{
+	VALUE accuracy = Qundef;
+
+	if (!NIL_P(opts))
+	{
+		ID kwds[1] = { id_accuracy };
+		rb_get_kwargs(opts, kwds, 0, -2, &accuracy);
+	}
+	if (accuracy == Qundef)
+	{
+		accuracy = rb_thread_local_aref(rb_thread_current(), id_accuracy_key);
+		if (NIL_P(accuracy))
+			return false;
+	}
+	return accuracy_fast_p(accuracy);
+}
+
+/* FloatとFloat128のスカラーに速い経路を試みる．整数や有理数の引数は常にrealsolveで計算する */
+static bool
+unary_fastsolve(const struct unary_kernel *k, VALUE x, VALUE opts, VALUE *result)
+{
+	__float128 y;
+
+	if (!unary_fast_p(opts))
+		return false;
+	switch (convertion_num_types(x)) {
+	case NUM_FLOAT:
+		if (!k->fast(float_to_cf128(x), &y))
+			return false;
+		break;
+	case NUM_FLOAT128:
+		if (!k->fast(GetF128(x), &y))
+			return false;
+		break;
+	case NUM_DOUBLEDOUBLE:
+		if (!k->fast(dd_to_f128(GetDD(x)), &y))
+			return false;
+		break;
+	default:
+		return false;
+	}
+	*result = rb_float128_cf128(y);
+	return true;
+}
+
 static VALUE
-quadmath_exp_realsolve(__float128 x)
+unary_realsolve(const struct unary_kernel *k, __float128 x)
 {
-	return rb_float128_cf128(expq(x));
+	__float128 y;
+	__complex128 w;
+
+	if (k->real(x, &y, &w))
+		return rb_float128_cf128(y);
+	else
+		return rb_complex128_cc128(w);
 }
 
 static VALUE
+unary_nucompsolve(const struct unary_kernel *k, __complex128 z)
+{
+	__complex128 w;
+
+	if (!k->comp(z, &w))
+		rb_raise(rb_eTypeError, "not a real");
+	return rb_complex128_cc128(w);
+}
+
+struct unary_map_args {
+	const struct unary_kernel *k;
+	const struct QVector *x;
+	struct QVector *y;
+	long begin;
+	long stop;
+	int nthreads;
+	bool fast;
+};
+
+/* 並列に計算するときに一度に取り出す要素数 */
+#define UNARY_MAP_GRAIN 256
+
+/*
+ * x[i0, i1)を計算してyに書く．実数のyに複素数解が出たところ，
+ * または複素数を受け付けない関数で虚部のある要素に当たったところで止め，
+ * その位置がstopより前ならstopを置き換える．stopより後ろの区間は計算しない．
+ */
+static void
+unary_map_range(void *ptr, long i0, long i1)
+{
+	struct unary_map_args *args = ptr;
+	const struct unary_kernel *k = args->k;
+
+	for (long i = i0; i < i1; i++)
+	{
+		__float128 y;
+		__complex128 w;
+		bool ok = true;
+
+		if (i % UNARY_MAP_GRAIN == 0 && i >= __atomic_load_n(&args->stop, __ATOMIC_RELAXED))
+			return;
+		if (args->x->type == VEC_FLOAT128)
+		{
+			bool real_p = (args->fast && k->fast(args->x->data.f128[i], &y)) ||
+			              k->real(args->x->data.f128[i], &y, &w);
+			if (args->y->type == VEC_FLOAT128)
+			{
+				if (real_p)
+					args->y->data.f128[i] = y;
+				else
+					ok = false;
+			}
+			else
+				args->y->data.c128[i] = real_p ? y : w;
+		}
+		else
+		{
+			if (k->comp(args->x->data.c128[i], &w))
+				args->y->data.c128[i] = w;
+			else
+				ok = false;
+		}
+		if (!ok)
+		{
+			long stop = __atomic_load_n(&args->stop, __ATOMIC_RELAXED);
+			while (i < stop &&
+			       !__atomic_compare_exchange_n(&args->stop, &stop, i, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				;
+			return;
+		}
+	}
+}
+
+/*
+ * x[begin]から計算する．stopは呼ぶ前に要素数にしておく．
+ * 中断されたときは計算済みの位置をbeginに残す．
+ */
+static void *
+unary_map_nogvl(void *ptr)
+{
+	struct unary_map_args *args = ptr;
+
+	if (!quadmath_parallel_for_at(&args->begin, args->x->len, UNARY_MAP_GRAIN, args->nthreads, unary_map_range, args))
+		return QUADMATH_INTERRUPTED;
+	return NULL;
+}
+
+/* 一要素あたりの手間を積和何回分とみるか．GVLを解放するかどうかの目安 */
+#define UNARY_MAP_COST 16
+
+static inline bool
+unary_map_p(VALUE x, VALUE opts)
+{
+	if (RB_TYPE_P(x, T_ARRAY) || qvector_p(x))
+		return true;
+	if (!NIL_P(opts))
+	{
+		VALUE accuracy = rb_hash_lookup2(opts, ID2SYM(id_accuracy), Qundef);
+
+		/* スカラーに付けられるのはaccuracy:だけ */
+		if (accuracy == Qundef || RHASH_SIZE(opts) > 1)
+			rb_raise(rb_eArgError, "keywords are only for vectors");
+		accuracy_fast_p(accuracy);
+	}
+	return false;
+}
+
+/*
+ * QuadMath::VectorかArrayの要素ごとに関数を適用する．結果の型はスカラーの場合に合わせ，
+ * 実数の入力でも一つでも複素数解があれば複素数のベクトルを返す．
+ * out:にベクトルを渡せばそこに書き込む．
+ */
+static VALUE
+unary_map(const struct unary_kernel *k, VALUE x, VALUE opts)
+{
+	static ID kwds[1];
+	VALUE out = Qundef, y;
+	struct unary_map_args args;
+
+	if (!kwds[0])  kwds[0] = rb_intern_const("out");
+	args.fast = unary_fast_p(opts) && k->fast;
+	if (!NIL_P(opts))
+		rb_get_kwargs(opts, kwds, 0, 1, &out);
+
+	x = rb_qvector_from(x);
+	args.k = k;
+	args.x = GetQVector(x);
+	if (out == Qundef || NIL_P(out))
+	{
+		out = Qundef;
+		y = rb_qvector_new(args.x->type, args.x->len);
+	}
+	else
+	{
+		if (!qvector_p(out))
+			rb_raise(rb_eTypeError, "out must be a QuadMath::Vector");
+		rb_check_frozen(out);
+		y = out;
+		if (GetQVector(y)->len != args.x->len)
+			rb_raise(rb_eArgError, "size mismatch (%ld for %ld)", GetQVector(y)->len, args.x->len);
+		if (args.x->type == VEC_COMPLEX128 && GetQVector(y)->type == VEC_FLOAT128)
+			rb_raise(rb_eTypeError, "complex input into real out");
+	}
+	/* 入力そのものに書き込むときは，途中で例外になっても入力が残るよう別に計算して最後に写す */
+	if (out != Qundef && GetQVector(out)->data.ptr == args.x->data.ptr)
+		y = rb_qvector_new(args.x->type, args.x->len);
+	args.y = GetQVector(y);
+	args.begin = 0;
+	args.stop = args.x->len;
+	args.nthreads = UNARY_MAP_COST * args.x->len >= NOGVL_THRESHOLD ? quadmath_threads() : 1;
+	quadmath_call_nogvl(unary_map_nogvl, &args, UNARY_MAP_COST * args.x->len);
+
+	if (args.stop < args.x->len)
+	{
+		struct QVector *vz;
+		VALUE z;
+
+		if (args.x->type == VEC_COMPLEX128)
+			rb_raise(rb_eTypeError, "not a real");
+		if (out != Qundef)
+			rb_raise(rb_eMathDomainError, "complex result into real out (at %ld)", args.stop);
+
+		/* 実数の定義域を外れた要素があったので，複素数のベクトルに移して続きを計算する */
+		z = rb_qvector_new(VEC_COMPLEX128, args.x->len);
+		vz = GetQVector(z);
+		for (long i = 0; i < args.stop; i++)
+			vz->data.c128[i] = args.y->data.f128[i];
+		args.y = vz;
+		args.begin = args.stop;
+		args.stop = args.x->len;
+		quadmath_call_nogvl(unary_map_nogvl, &args, UNARY_MAP_COST * (args.x->len - args.begin));
+		y = z;
+	}
+	else if (out != Qundef && y != out)
+	{
+		size_t elem_size = args.x->type == VEC_FLOAT128 ? sizeof(__float128) : sizeof(__complex128);
+		memcpy(GetQVector(out)->data.ptr, args.y->data.ptr, elem_size * args.x->len);
+		y = out;
+	}
+	RB_GC_GUARD(x);
+
+	return y;
+}
+
+static bool
+exp_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = expq(x);
+	return true;
+}
+
+static bool
+exp_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = cexpq(z);
+	return true;
+}
+
+static const struct unary_kernel exp_kernel = {exp_realkernel, exp_compkernel, dd_expq};
+
+static inline VALUE
+quadmath_exp_realsolve(__float128 x)
+{
+	return unary_realsolve(&exp_kernel, x);
+}
+
+static inline VALUE
 quadmath_exp_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(cexpq(z));
+	return unary_nucompsolve(&exp_kernel, z);
 }
 
 /*
  *  call-seq:
- *    QuadMath.exp(x) -> Float128 | Complex | Complex128
+ *    QuadMath.exp(x, accuracy: nil) -> Float128 | Complex | Complex128
+ *    QuadMath.exp(vector, out: nil, accuracy: nil) -> QuadMath::Vector
  *  
  *  xの指数関数を返す．xが実数なら実数解，複素数なら複素数解として各々返却する．
  *  
@@ -144,8 +433,16 @@ quadmath_exp_nucompsolve(__complex128 z)
  *  # => (1.6231578299489788500278329108526+2.5279185426966278702444317537622i)
  */
 static VALUE
-quadmath_exp(VALUE unused_obj, VALUE x)
+quadmath_exp(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts, y;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&exp_kernel, x, opts);
+	if (unary_fastsolve(&exp_kernel, x, opts, &y))
+		return y;
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_exp_realsolve(fixnum_to_cf128(x));
@@ -166,6 +463,9 @@ quadmath_exp(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_exp_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_exp_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_exp_nucompsolve(GetC128(x));
 		break;
@@ -179,21 +479,38 @@ quadmath_exp(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+exp2_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = exp2q(x);
+	return true;
+}
+
+static bool
+exp2_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = cpowq(2, z);
+	return true;
+}
+
+static const struct unary_kernel exp2_kernel = {exp2_realkernel, exp2_compkernel, dd_exp2q};
+
 static inline VALUE
 quadmath_exp2_realsolve(__float128 x)
 {
-	return rb_float128_cf128(exp2q(x));
+	return unary_realsolve(&exp2_kernel, x);
 }
 
 static inline VALUE
 quadmath_exp2_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(cpowq(2, z));
+	return unary_nucompsolve(&exp2_kernel, z);
 }
 
 /*
  *  call-seq:
- *    QuadMath.exp2(x) -> Integer | Rational | Float128 | Complex | Complex128
+ *    QuadMath.exp2(x, accuracy: nil) -> Integer | Rational | Float128 | Complex | Complex128
+ *    QuadMath.exp2(vector, out: nil, accuracy: nil) -> QuadMath::Vector
  *  
  *  2のx乗を返す．xが整数なら正では整数解，負では有理数解，実数なら実数解，複素数なら複素数解として各々返却する．
  *  これは一般に`2 ** x`と計算するのとさして変わらない．唯一の違いは実数の精度が二倍ではなく四倍であることである．
@@ -204,8 +521,16 @@ quadmath_exp2_nucompsolve(__complex128 z)
  *  QuadMath.exp2(Complex128::I) # => (0.76923890136397212657832999366127+0.638961276313634801150032911464701i)
  */
 static VALUE
-quadmath_exp2(VALUE unused_obj, VALUE x)
+quadmath_exp2(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts, y;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&exp2_kernel, x, opts);
+	if (unary_fastsolve(&exp2_kernel, x, opts, &y))
+		return y;
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 	case NUM_BIGNUM:
@@ -223,6 +548,9 @@ quadmath_exp2(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_exp2_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_exp2_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_exp2_nucompsolve(GetC128(x));
 		break;
@@ -236,30 +564,41 @@ quadmath_exp2(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+expm1_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = expm1q(x);
+	return true;
+}
+
+static bool
+expm1_compkernel(__complex128 z, __complex128 *w)
+{
+	if (cimagq(z) == 0)
+		*w = expm1q(crealq(z));
+	else
+		*w = 2 * cexpq(z / 2) * csinhq(z / 2);
+	return true;
+}
+
+static const struct unary_kernel expm1_kernel = {expm1_realkernel, expm1_compkernel};
+
 static inline VALUE
 quadmath_expm1_realsolve(__float128 x)
 {
-	return rb_float128_cf128(expm1q(x));
+	return unary_realsolve(&expm1_kernel, x);
 }
 
 static inline VALUE
 quadmath_expm1_nucompsolve(__complex128 z)
 {
-	if (cimagq(z) == 0)
-	{
-		__float128 real = crealq(z);
-		return rb_complex128_cc128((__complex128)expm1q(real));
-	}
-	else
-	{
-		__complex128 w = 2 * cexpq(z / 2) * csinhq(z / 2);
-		return rb_complex128_cc128(w);
-	}
+	return unary_nucompsolve(&expm1_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.expm1(x) -> Float128 | Complex128
+ *    QuadMath.expm1(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの指数関数より1を引いた値を返す．
  *  この関数はゼロに近傍な値を数式通りにexp(x)-1と計算するよりも高精度化する．
@@ -270,8 +609,14 @@ quadmath_expm1_nucompsolve(__complex128 z)
  *    QuadMath.expm1(Complex128::I) # => (-0.459697694131860282599063392557023+0.841470984807896506652502321630299i)
  */
 static VALUE
-quadmath_expm1(VALUE unused_obj, VALUE x)
+quadmath_expm1(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&expm1_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_expm1_realsolve(fixnum_to_cf128(x));
@@ -292,6 +637,9 @@ quadmath_expm1(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_expm1_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_expm1_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_expm1_nucompsolve(GetC128(x));
 		break;
@@ -305,31 +653,44 @@ quadmath_expm1(VALUE unused_obj, VALUE x)
 	}
 }
 
-static inline VALUE
-quadmath_log_realsolve(__float128 x)
+static bool
+log_realkernel(__float128 x, __float128 *y, __complex128 *w)
 {
-	if (isnanq(x))
-		return rb_float128_cf128(x);
-	else if (!signbitq(x))
-		return rb_float128_cf128(logq(x));
-	else
+	if (isnanq(x) || !signbitq(x))
 	{
-		__complex128 z;
-		__real__ z = logq(fabsq(x));
-		__imag__ z = M_PIq;
-		return rb_complex128_cc128(z);
+		*y = isnanq(x) ? x : logq(x);
+		return true;
 	}
+	__real__ *w = logq(fabsq(x));
+	__imag__ *w = M_PIq;
+	return false;
+}
+
+static bool
+log_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = clogq(z);
+	return true;
+}
+
+static const struct unary_kernel log_kernel = {log_realkernel, log_compkernel, dd_logq};
+
+static inline VALUE
+quadmath_log_realsolve(__float128 x)
+{
+	return unary_realsolve(&log_kernel, x);
 }
 
 static inline VALUE
 quadmath_log_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(clogq(z));
+	return unary_nucompsolve(&log_kernel, z);
 }
 
 /*
  *  call-seq:
- *    QuadMath.log(x) -> Float128 | Complex128
+ *    QuadMath.log(x, accuracy: nil) -> Float128 | Complex128
+ *    QuadMath.log(vector, out: nil, accuracy: nil) -> QuadMath::Vector
  *  
  *  xの自然対数を返す．
  *  xが実数なら正ならば実数解，負なら複素数解，複素数なら複素数解として値を各々返す．
@@ -339,8 +700,16 @@ quadmath_log_nucompsolve(__complex128 z)
  *  QuadMath.log(Complex128::I) # => (0.0+1.5707963267948966192313216916397i)
  */
 static VALUE
-quadmath_log(VALUE unused_obj, VALUE x)
+quadmath_log(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts, y;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&log_kernel, x, opts);
+	if (unary_fastsolve(&log_kernel, x, opts, &y))
+		return y;
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_log_realsolve(fixnum_to_cf128(x));
@@ -361,6 +730,9 @@ quadmath_log(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_log_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_log_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_log_nucompsolve(GetC128(x));
 		break;
@@ -374,31 +746,44 @@ quadmath_log(VALUE unused_obj, VALUE x)
 	}
 }
 
-static inline VALUE
-quadmath_log2_realsolve(__float128 x)
+static bool
+log2_realkernel(__float128 x, __float128 *y, __complex128 *w)
 {
-	if (isnanq(x))
-		return rb_float128_cf128(x);
-	else if (!signbitq(x))
-		return rb_float128_cf128(log2q(x));
-	else
+	if (isnanq(x) || !signbitq(x))
 	{
-		__complex128 z;
-		__real__ z = log2q(fabsq(x));
-		__imag__ z = M_PIq / M_LN2q;
-		return rb_complex128_cc128(z);
+		*y = isnanq(x) ? x : log2q(x);
+		return true;
 	}
+	__real__ *w = log2q(fabsq(x));
+	__imag__ *w = M_PIq / M_LN2q;
+	return false;
+}
+
+static bool
+log2_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = clogq(z) / M_LN2q;
+	return true;
+}
+
+static const struct unary_kernel log2_kernel = {log2_realkernel, log2_compkernel, dd_log2q};
+
+static inline VALUE
+quadmath_log2_realsolve(__float128 x)
+{
+	return unary_realsolve(&log2_kernel, x);
 }
 
 static inline VALUE
 quadmath_log2_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(clogq(z) / M_LN2q);
+	return unary_nucompsolve(&log2_kernel, z);
 }
 
 /*
  *  call-seq:
- *    QuadMath.log2(x) -> Float128 | Complex128
+ *    QuadMath.log2(x, accuracy: nil) -> Float128 | Complex128
+ *    QuadMath.log2(vector, out: nil, accuracy: nil) -> QuadMath::Vector
  *  
  *  xの2を底とする対数を返す．(Binary Logarithm)
  *  xが実数なら正ならば実数解，負なら複素数解，複素数なら複素数解として値を各々返す．
@@ -414,8 +799,16 @@ quadmath_log2_nucompsolve(__complex128 z)
  *    QuadMath.log2(1+1i) # => (0.5+1.1330900354567984524069207364291i)
  */
 static VALUE
-quadmath_log2(VALUE unused_obj, VALUE x)
+quadmath_log2(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts, y;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&log2_kernel, x, opts);
+	if (unary_fastsolve(&log2_kernel, x, opts, &y))
+		return y;
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_log2_realsolve(fixnum_to_cf128(x));
@@ -436,6 +829,9 @@ quadmath_log2(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_log2_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_log2_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_log2_nucompsolve(GetC128(x));
 		break;
@@ -449,31 +845,44 @@ quadmath_log2(VALUE unused_obj, VALUE x)
 	}
 }
 
-static inline VALUE
-quadmath_log10_realsolve(__float128 x)
+static bool
+log10_realkernel(__float128 x, __float128 *y, __complex128 *w)
 {
-	if (isnanq(x))
-		return rb_float128_cf128(x);
-	else if (!signbitq(x))
-		return rb_float128_cf128(log10q(x));
-	else
+	if (isnanq(x) || !signbitq(x))
 	{
-		__complex128 z;
-		__real__ z = log10q(fabsq(x));
-		__imag__ z = M_PIq / M_LN10q;
-		return rb_complex128_cc128(z);
+		*y = isnanq(x) ? x : log10q(x);
+		return true;
 	}
+	__real__ *w = log10q(fabsq(x));
+	__imag__ *w = M_PIq / M_LN10q;
+	return false;
+}
+
+static bool
+log10_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = clog10q(z);
+	return true;
+}
+
+static const struct unary_kernel log10_kernel = {log10_realkernel, log10_compkernel, dd_log10q};
+
+static inline VALUE
+quadmath_log10_realsolve(__float128 x)
+{
+	return unary_realsolve(&log10_kernel, x);
 }
 
 static inline VALUE
 quadmath_log10_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(clog10q(z));
+	return unary_nucompsolve(&log10_kernel, z);
 }
 
 /*
  *  call-seq:
- *    QuadMath.log10(x) -> Float128 | Complex128
+ *    QuadMath.log10(x, accuracy: nil) -> Float128 | Complex128
+ *    QuadMath.log10(vector, out: nil, accuracy: nil) -> QuadMath::Vector
  *  
  *  xの常用対数を返す．
  *  xが実数なら正ならば実数解，負なら複素数解，複素数なら複素数解として値を各々返す．
@@ -490,8 +899,16 @@ quadmath_log10_nucompsolve(__complex128 z)
 
  */
 static VALUE
-quadmath_log10(VALUE unused_obj, VALUE x)
+quadmath_log10(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts, y;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&log10_kernel, x, opts);
+	if (unary_fastsolve(&log10_kernel, x, opts, &y))
+		return y;
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_log10_realsolve(fixnum_to_cf128(x));
@@ -512,6 +929,9 @@ quadmath_log10(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_log10_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_log10_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_log10_nucompsolve(GetC128(x));
 		break;
@@ -525,44 +945,61 @@ quadmath_log10(VALUE unused_obj, VALUE x)
 	}
 }
 
-static inline VALUE
+static inline __complex128
 log1p_realsolve_neg(__float128 x)
 {
 	__complex128 z = 2 * catanhq(x / (2 + x));
 	if (cimagq(z) != M_PIq)
 		__imag__ z = M_PIq;
-	return rb_complex128_cc128(z);
+	return z;
 }
 
-static inline VALUE
-quadmath_log1p_realsolve(__float128 x)
+static bool
+log1p_realkernel(__float128 x, __float128 *y, __complex128 *w)
 {
-	if (isnanq(x))
-		return nanq("");
-	if (x >= -1)
-		return rb_float128_cf128(log1pq(x));
-	else
-		return log1p_realsolve_neg(x);
+	if (isnanq(x) || x >= -1)
+	{
+		*y = isnanq(x) ? x : log1pq(x);
+		return true;
+	}
+	*w = log1p_realsolve_neg(x);
+	return false;
 }
 
-static inline VALUE
-quadmath_log1p_nucompsolve(__complex128 z)
+static bool
+log1p_compkernel(__complex128 z, __complex128 *w)
 {
 	if (cimagq(z) == 0)
 	{
 		__float128 real = crealq(z);
 		if (real >= -1)
-			return rb_complex128_cc128((__complex128)log1pq(real));
+			*w = log1pq(real);
 		else
-			return log1p_realsolve_neg(real);
+			*w = log1p_realsolve_neg(real);
 	}
 	else
-		return rb_complex128_cc128(clogq(1+z));
+		*w = clogq(1+z);
+	return true;
+}
+
+static const struct unary_kernel log1p_kernel = {log1p_realkernel, log1p_compkernel};
+
+static inline VALUE
+quadmath_log1p_realsolve(__float128 x)
+{
+	return unary_realsolve(&log1p_kernel, x);
+}
+
+static inline VALUE
+quadmath_log1p_nucompsolve(__complex128 z)
+{
+	return unary_nucompsolve(&log1p_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.log1p(x) -> Float128 | Complex128
+ *    QuadMath.log1p(vector, out: nil) -> QuadMath::Vector
  *  
  *  xに1を加算した自然対数を返す．
  *  この関数はxがゼロに近傍な値のとき数式通りにlog(1+x)と計算するよりも高精度化する．
@@ -574,8 +1011,14 @@ quadmath_log1p_nucompsolve(__complex128 z)
 
  */
 static VALUE
-quadmath_log1p(VALUE unused_obj, VALUE x)
+quadmath_log1p(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&log1p_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_log1p_realsolve(fixnum_to_cf128(x));
@@ -596,6 +1039,9 @@ quadmath_log1p(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_log1p_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_log1p_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_log1p_nucompsolve(GetC128(x));
 		break;
@@ -610,29 +1056,44 @@ quadmath_log1p(VALUE unused_obj, VALUE x)
 
 }
 
-static inline VALUE
-quadmath_sqrt_realsolve(__float128 x)
+static bool
+sqrt_realkernel(__float128 x, __float128 *y, __complex128 *w)
 {
 	if (!signbitq(x))
-		return rb_float128_cf128(sqrtq(x));
-	else
 	{
-		__complex128 z;
-		__real__ z = 0.q;
-		__imag__ z = sqrtq(fabsq(x));
-		return rb_complex128_cc128(z);
+		*y = sqrtq(x);
+		return true;
 	}
+	__real__ *w = 0.q;
+	__imag__ *w = sqrtq(fabsq(x));
+	return false;
+}
+
+static bool
+sqrt_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = csqrtq(z);
+	return true;
+}
+
+static const struct unary_kernel sqrt_kernel = {sqrt_realkernel, sqrt_compkernel, dd_sqrtq};
+
+static inline VALUE
+quadmath_sqrt_realsolve(__float128 x)
+{
+	return unary_realsolve(&sqrt_kernel, x);
 }
 
 static inline VALUE
 quadmath_sqrt_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(csqrtq(z));
+	return unary_nucompsolve(&sqrt_kernel, z);
 }
 
 /*
  *  call-seq:
- *    QuadMath.sqrt(x) -> Float128 | Complex128
+ *    QuadMath.sqrt(x, accuracy: nil) -> Float128 | Complex128
+ *    QuadMath.sqrt(vector, out: nil, accuracy: nil) -> QuadMath::Vector
  *  
  *  xの平方根を返す．
  *  xが実数であり正の場合は実数解，負の場合は虚数解，複素数の場合は複素数解として各々返却する．
@@ -642,8 +1103,15 @@ quadmath_sqrt_nucompsolve(__complex128 z)
  *    QuadMath.sqrt(1+1i) # => (1.0986841134678099660398011952406+0.455089860562227341304357757822468i)
  */
 static VALUE
-quadmath_sqrt(VALUE unused_obj, VALUE x)
+quadmath_sqrt(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts, y;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&sqrt_kernel, x, opts);
+	if (unary_fastsolve(&sqrt_kernel, x, opts, &y))
+		return y;
 
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
@@ -665,6 +1133,9 @@ quadmath_sqrt(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_sqrt_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_sqrt_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_sqrt_nucompsolve(GetC128(x));
 		break;
@@ -678,24 +1149,43 @@ quadmath_sqrt(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+sqrt3_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	if (!signbitq(x))
+	{
+		*y = cbrtq(x);
+		return true;
+	}
+	*w = cpowq((__complex128)x, 1.q/3.q);
+	return false;
+}
+
+static bool
+sqrt3_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = cpowq(z, (__complex128)(1.q/3.q));
+	return true;
+}
+
+static const struct unary_kernel sqrt3_kernel = {sqrt3_realkernel, sqrt3_compkernel};
+
 static inline VALUE
 quadmath_sqrt3_realsolve(__float128 x)
 {
-	if (!signbitq(x))
-		return rb_float128_cf128(cbrtq(x));
-	else
-		return rb_complex128_cc128(cpowq((__complex128)x, 1.q/3.q));
+	return unary_realsolve(&sqrt3_kernel, x);
 }
 
 static inline VALUE
 quadmath_sqrt3_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(cpowq(z, (__complex128)(1.q/3.q)));
+	return unary_nucompsolve(&sqrt3_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.sqrt3(x) -> Float128 | Complex128
+ *    QuadMath.sqrt3(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの立方根を返す．
  *  xが実数であり正の場合は実数解，負の場合は複素数解，複素数の場合は複素数解として各々返却する．
@@ -705,8 +1195,14 @@ quadmath_sqrt3_nucompsolve(__complex128 z)
  *    QuadMath.sqrt3(1+1i) # => (1.0842150814913511818796660082610+0.290514555507251444503813188624929i)
  */
 static VALUE
-quadmath_sqrt3(VALUE unused_obj, VALUE x)
+quadmath_sqrt3(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&sqrt3_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_sqrt3_realsolve(fixnum_to_cf128(x));
@@ -727,6 +1223,9 @@ quadmath_sqrt3(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_sqrt3_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_sqrt3_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_sqrt3_nucompsolve(GetC128(x));
 		break;
@@ -740,6 +1239,24 @@ quadmath_sqrt3(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+cbrt_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = cbrtq(x);
+	return true;
+}
+
+static bool
+cbrt_compkernel(__complex128 z, __complex128 *w)
+{
+	if (cimagq(z) != 0)
+		return false;
+	*w = cbrtq(crealq(z));
+	return true;
+}
+
+static const struct unary_kernel cbrt_kernel = {cbrt_realkernel, cbrt_compkernel};
+
 static inline VALUE
 quadmath_cbrt_realsolve(__float128 x)
 {
@@ -758,6 +1275,7 @@ quadmath_cbrt_nucompsolve(__complex128 z)
 /*
  *  call-seq:
  *    QuadMath.cbrt(x) -> Float128 | nil
+ *    QuadMath.cbrt(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの実数としての三乗根を返す．
  *  実計算の'x ** 1/3'における複素根はcbrt関数では扱われない．そのため虚数が現れるならnilとして扱われる．
@@ -767,8 +1285,14 @@ quadmath_cbrt_nucompsolve(__complex128 z)
  *    QuadMath.cbrt(1+1i) # => nil
  */
 static VALUE
-quadmath_cbrt(VALUE unused_obj, VALUE x)
+quadmath_cbrt(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&cbrt_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_cbrt_realsolve(fixnum_to_cf128(x));
@@ -788,6 +1312,9 @@ quadmath_cbrt(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_cbrt_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_cbrt_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_cbrt_nucompsolve(GetC128(x));
 		break;
@@ -801,21 +1328,38 @@ quadmath_cbrt(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+sin_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = sinq(x);
+	return true;
+}
+
+static bool
+sin_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = csinq(z);
+	return true;
+}
+
+static const struct unary_kernel sin_kernel = {sin_realkernel, sin_compkernel, dd_sinq};
+
 static inline VALUE
 quadmath_sin_realsolve(__float128 x)
 {
-	return rb_float128_cf128(sinq(x));
+	return unary_realsolve(&sin_kernel, x);
 }
 
 static inline VALUE
 quadmath_sin_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(csinq(z));
+	return unary_nucompsolve(&sin_kernel, z);
 }
 
 /*
  *  call-seq:
- *    QuadMath.sin(x) -> Float128 | Complex128
+ *    QuadMath.sin(x, accuracy: nil) -> Float128 | Complex128
+ *    QuadMath.sin(vector, out: nil, accuracy: nil) -> QuadMath::Vector
  *  
  *  xの正弦を返す．
  *  xが実数なら実数解，複素数なら複素数解として各々返却する．
@@ -824,8 +1368,16 @@ quadmath_sin_nucompsolve(__complex128 z)
  *    QuadMath.sin(1+1i) # => (1.2984575814159772948260423658078+0.634963914784736108255082202991509i)
  */
 static VALUE
-quadmath_sin(VALUE unused_obj, VALUE x)
+quadmath_sin(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts, y;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&sin_kernel, x, opts);
+	if (unary_fastsolve(&sin_kernel, x, opts, &y))
+		return y;
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_sin_realsolve(fixnum_to_cf128(x));
@@ -846,6 +1398,9 @@ quadmath_sin(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_sin_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_sin_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_sin_nucompsolve(GetC128(x));
 		break;
@@ -859,21 +1414,38 @@ quadmath_sin(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+cos_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = cosq(x);
+	return true;
+}
+
+static bool
+cos_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = ccosq(z);
+	return true;
+}
+
+static const struct unary_kernel cos_kernel = {cos_realkernel, cos_compkernel, dd_cosq};
+
 static inline VALUE
 quadmath_cos_realsolve(__float128 x)
 {
-	return rb_float128_cf128(cosq(x));
+	return unary_realsolve(&cos_kernel, x);
 }
 
 static inline VALUE
 quadmath_cos_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(ccosq(z));
+	return unary_nucompsolve(&cos_kernel, z);
 }
 
 /*
  *  call-seq:
- *    QuadMath.cos(x) -> Float128 | Complex128
+ *    QuadMath.cos(x, accuracy: nil) -> Float128 | Complex128
+ *    QuadMath.cos(vector, out: nil, accuracy: nil) -> QuadMath::Vector
  *  
  *  xの余弦を返す．
  *  xが実数なら実数解，複素数なら複素数解として各々返却する．
@@ -882,8 +1454,16 @@ quadmath_cos_nucompsolve(__complex128 z)
  *    QuadMath.cos(1+1i) # => (0.833730025131149048883885394335094-0.988897705762865096382129540892686i)
  */
 static VALUE
-quadmath_cos(VALUE unused_obj, VALUE x)
+quadmath_cos(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts, y;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&cos_kernel, x, opts);
+	if (unary_fastsolve(&cos_kernel, x, opts, &y))
+		return y;
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_cos_realsolve(fixnum_to_cf128(x));
@@ -904,6 +1484,9 @@ quadmath_cos(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_cos_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_cos_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_cos_nucompsolve(GetC128(x));
 		break;
@@ -943,25 +1526,42 @@ tan_realsolve(__float128 x)
 	return y;
 }
 
-static inline VALUE
-quadmath_tan_realsolve(__float128 x)
+static bool
+tan_realkernel(__float128 x, __float128 *y, __complex128 *w)
 {
-	return rb_float128_cf128(tan_realsolve(x));
+	*y = tan_realsolve(x);
+	return true;
 }
 
-static inline VALUE
-quadmath_tan_nucompsolve(__complex128 z)
+static bool
+tan_compkernel(__complex128 z, __complex128 *w)
 {
 	if (cimagq(z) == 0)
 		__real__ z = tan_realsolve(crealq(z));
 	else
 		z = ctanq(z);
-	return rb_complex128_cc128(z);
+	*w = z;
+	return true;
+}
+
+static const struct unary_kernel tan_kernel = {tan_realkernel, tan_compkernel, dd_tanq};
+
+static inline VALUE
+quadmath_tan_realsolve(__float128 x)
+{
+	return unary_realsolve(&tan_kernel, x);
+}
+
+static inline VALUE
+quadmath_tan_nucompsolve(__complex128 z)
+{
+	return unary_nucompsolve(&tan_kernel, z);
 }
 
 /*
  *  call-seq:
- *    QuadMath.tan(x) -> Float128 | Complex128
+ *    QuadMath.tan(x, accuracy: nil) -> Float128 | Complex128
+ *    QuadMath.tan(vector, out: nil, accuracy: nil) -> QuadMath::Vector
  *  
  *  xの正接を返す．
  *  xが実数なら実数解，複素数なら複素数解として各々返却する．
@@ -974,8 +1574,16 @@ quadmath_tan_nucompsolve(__complex128 z)
 
  */
 static VALUE
-quadmath_tan(VALUE unused_obj, VALUE x)
+quadmath_tan(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts, y;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&tan_kernel, x, opts);
+	if (unary_fastsolve(&tan_kernel, x, opts, &y))
+		return y;
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_tan_realsolve(fixnum_to_cf128(x));
@@ -996,6 +1604,9 @@ quadmath_tan(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_tan_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_tan_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_tan_nucompsolve(GetC128(x));
 		break;
@@ -1009,24 +1620,43 @@ quadmath_tan(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+asin_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	if (x >= -1 && x <= 1)
+	{
+		*y = asinq(x);
+		return true;
+	}
+	*w = casinq((__complex128)x);
+	return false;
+}
+
+static bool
+asin_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = casinq(z);
+	return true;
+}
+
+static const struct unary_kernel asin_kernel = {asin_realkernel, asin_compkernel};
+
 static inline VALUE
 quadmath_asin_realsolve(__float128 x)
 {
-	if (x >= -1 && x <= 1)
-		return rb_float128_cf128(asinq(x));
-	else
-		return rb_complex128_cc128(casinq((__complex128)x));
+	return unary_realsolve(&asin_kernel, x);
 }
 
 static inline VALUE
 quadmath_asin_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(casinq(z));
+	return unary_nucompsolve(&asin_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.asin(x) -> Float128 | Complex128
+ *    QuadMath.asin(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの逆正弦を返す．
  *  xが(-1<=x<=1)の範囲なら実数解，ほかは複素数解として各々返却する．
@@ -1037,8 +1667,14 @@ quadmath_asin_nucompsolve(__complex128 z)
 
  */
 static VALUE
-quadmath_asin(VALUE unused_obj, VALUE x)
+quadmath_asin(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&asin_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_asin_realsolve(fixnum_to_cf128(x));
@@ -1059,6 +1695,9 @@ quadmath_asin(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_asin_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_asin_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_asin_nucompsolve(GetC128(x));
 		break;
@@ -1072,24 +1711,43 @@ quadmath_asin(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+acos_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	if (x >= -1 && x <= 1)
+	{
+		*y = acosq(x);
+		return true;
+	}
+	*w = cacosq((__complex128)x);
+	return false;
+}
+
+static bool
+acos_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = cacosq(z);
+	return true;
+}
+
+static const struct unary_kernel acos_kernel = {acos_realkernel, acos_compkernel};
+
 static inline VALUE
 quadmath_acos_realsolve(__float128 x)
 {
-	if (x >= -1 && x <= 1)
-		return rb_float128_cf128(acosq(x));
-	else
-		return rb_complex128_cc128(cacosq((__complex128)x));
+	return unary_realsolve(&acos_kernel, x);
 }
 
 static inline VALUE
 quadmath_acos_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(cacosq(z));
+	return unary_nucompsolve(&acos_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.acos(x) -> Float128 | Complex128
+ *    QuadMath.acos(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの逆余弦を返す．
  *  xが(-1<=x<=1)の範囲なら実数解，ほかは複素数解として各々返却する．
@@ -1099,8 +1757,14 @@ quadmath_acos_nucompsolve(__complex128 z)
  *    QuadMath.acos(1+1i) # => (0.904556894302381364127316795661958-1.0612750619050356520330189162135i)
  */
 static VALUE
-quadmath_acos(VALUE unused_obj, VALUE x)
+quadmath_acos(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&acos_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_acos_realsolve(fixnum_to_cf128(x));
@@ -1121,6 +1785,9 @@ quadmath_acos(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_acos_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_acos_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_acos_nucompsolve(GetC128(x));
 		break;
@@ -1134,21 +1801,38 @@ quadmath_acos(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+atan_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = atanq(x);
+	return true;
+}
+
+static bool
+atan_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = catanq(z);
+	return true;
+}
+
+static const struct unary_kernel atan_kernel = {atan_realkernel, atan_compkernel};
+
 static inline VALUE
 quadmath_atan_realsolve(__float128 x)
 {
-	return rb_float128_cf128(atanq(x));
+	return unary_realsolve(&atan_kernel, x);
 }
 
 static inline VALUE
 quadmath_atan_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(catanq(z));
+	return unary_nucompsolve(&atan_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.atan(x) -> Float128 | Complex128
+ *    QuadMath.atan(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの逆正接を返す．
  *  xが実数なら実数解，複素数なら複素数解として各々返却する．
@@ -1158,8 +1842,14 @@ quadmath_atan_nucompsolve(__complex128 z)
  *    QuadMath.atan(1+1i) # => (1.0172219678978513677227889615504+0.402359478108525093650189833306547i)
  */
 static VALUE
-quadmath_atan(VALUE unused_obj, VALUE x)
+quadmath_atan(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&atan_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_atan_realsolve(fixnum_to_cf128(x));
@@ -1180,6 +1870,9 @@ quadmath_atan(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_atan_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_atan_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_atan_nucompsolve(GetC128(x));
 		break;
@@ -1251,6 +1944,9 @@ quadrant_inline(VALUE xsh, VALUE ysh)
 	case NUM_FLOAT128:
 		x = GetF128(xsh);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		x = dd_to_f128(GetDD(xsh));
+		break;
 	case NUM_COMPLEX128:
 		z = GetC128(xsh);
 		x_nucomp_p = true;
@@ -1288,6 +1984,9 @@ quadrant_inline(VALUE xsh, VALUE ysh)
 	case NUM_FLOAT128:
 		y = GetF128(ysh);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		y = dd_to_f128(GetDD(ysh));
+		break;
 	case NUM_COMPLEX128:
 		w = GetC128(ysh);
 		y_nucomp_p = true;
@@ -1355,21 +2054,38 @@ quadmath_quadrant(VALUE unused_obj, VALUE x, VALUE y)
 	return quadrant_inline(x, y);
 }
 
+static bool
+sinh_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = sinhq(x);
+	return true;
+}
+
+static bool
+sinh_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = csinhq(z);
+	return true;
+}
+
+static const struct unary_kernel sinh_kernel = {sinh_realkernel, sinh_compkernel};
+
 static inline VALUE
 quadmath_sinh_realsolve(__float128 x)
 {
-	return rb_float128_cf128(sinhq(x));
+	return unary_realsolve(&sinh_kernel, x);
 }
 
 static inline VALUE
-quadmath_sinh_nucompsolve(__complex128 x)
+quadmath_sinh_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(csinhq(x));
+	return unary_nucompsolve(&sinh_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.sinh(x) -> Float128 | Complex128
+ *    QuadMath.sinh(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの双曲線正弦を返す．
  *  xが実数なら実数解，複素数なら複素数解として各々返却する．
@@ -1378,8 +2094,14 @@ quadmath_sinh_nucompsolve(__complex128 x)
  *    QuadMath.sinh(1+1i) # => (0.634963914784736108255082202991509+1.2984575814159772948260423658078i)
  */
 static VALUE
-quadmath_sinh(VALUE unused_obj, VALUE x)
+quadmath_sinh(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&sinh_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_sinh_realsolve(fixnum_to_cf128(x));
@@ -1400,6 +2122,9 @@ quadmath_sinh(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_sinh_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_sinh_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_sinh_nucompsolve(GetC128(x));
 		break;
@@ -1413,21 +2138,38 @@ quadmath_sinh(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+cosh_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = coshq(x);
+	return true;
+}
+
+static bool
+cosh_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = ccoshq(z);
+	return true;
+}
+
+static const struct unary_kernel cosh_kernel = {cosh_realkernel, cosh_compkernel};
+
 static inline VALUE
 quadmath_cosh_realsolve(__float128 x)
 {
-	return rb_float128_cf128(coshq(x));
+	return unary_realsolve(&cosh_kernel, x);
 }
 
 static inline VALUE
-quadmath_cosh_nucompsolve(__complex128 x)
+quadmath_cosh_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(ccoshq(x));
+	return unary_nucompsolve(&cosh_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.cosh(x) -> Float128 | Complex128
+ *    QuadMath.cosh(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの双曲線余弦を返す．
  *  xが実数なら実数解，複素数なら複素数解として各々返却する．
@@ -1436,8 +2178,14 @@ quadmath_cosh_nucompsolve(__complex128 x)
  *    QuadMath.cosh(1+1i) # => (0.833730025131149048883885394335094+0.988897705762865096382129540892686i)
  */
 static VALUE
-quadmath_cosh(VALUE unused_obj, VALUE x)
+quadmath_cosh(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&cosh_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_cosh_realsolve(fixnum_to_cf128(x));
@@ -1458,6 +2206,9 @@ quadmath_cosh(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_cosh_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_cosh_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_cosh_nucompsolve(GetC128(x));
 		break;
@@ -1471,21 +2222,38 @@ quadmath_cosh(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+tanh_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = tanhq(x);
+	return true;
+}
+
+static bool
+tanh_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = ctanhq(z);
+	return true;
+}
+
+static const struct unary_kernel tanh_kernel = {tanh_realkernel, tanh_compkernel};
+
 static inline VALUE
 quadmath_tanh_realsolve(__float128 x)
 {
-	return rb_float128_cf128(tanhq(x));
+	return unary_realsolve(&tanh_kernel, x);
 }
 
 static inline VALUE
-quadmath_tanh_nucompsolve(__complex128 x)
+quadmath_tanh_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(ctanhq(x));
+	return unary_nucompsolve(&tanh_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.tanh(x) -> Float128 | Complex128
+ *    QuadMath.tanh(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの双曲線正接を返す．
  *  xが実数なら実数解，複素数なら複素数解として各々返却する．
@@ -1495,8 +2263,14 @@ quadmath_tanh_nucompsolve(__complex128 x)
  *    QuadMath.tanh(1+1i) # => (1.0839233273386945434757520612119+0.271752585319511716528843722498589i)
  */
 static VALUE
-quadmath_tanh(VALUE unused_obj, VALUE x)
+quadmath_tanh(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&tanh_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_tanh_realsolve(fixnum_to_cf128(x));
@@ -1517,6 +2291,9 @@ quadmath_tanh(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_tanh_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_tanh_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_tanh_nucompsolve(GetC128(x));
 		break;
@@ -1530,21 +2307,38 @@ quadmath_tanh(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+asinh_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = asinhq(x);
+	return true;
+}
+
+static bool
+asinh_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = casinhq(z);
+	return true;
+}
+
+static const struct unary_kernel asinh_kernel = {asinh_realkernel, asinh_compkernel};
+
 static inline VALUE
 quadmath_asinh_realsolve(__float128 x)
 {
-	return rb_float128_cf128(asinhq(x));
+	return unary_realsolve(&asinh_kernel, x);
 }
 
 static inline VALUE
-quadmath_asinh_nucompsolve(__complex128 x)
+quadmath_asinh_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(casinhq(x));
+	return unary_nucompsolve(&asinh_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.asinh(x) -> Float128 | Complex128
+ *    QuadMath.asinh(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの逆双曲線正弦を返す．
  *  xが実数なら実数解，複素数なら複素数解として各々返却する．
@@ -1553,8 +2347,14 @@ quadmath_asinh_nucompsolve(__complex128 x)
  *    QuadMath.asinh(1+1i) # => (1.0612750619050356520330189162135+0.666239432492515255104004895977792i)
  */
 static VALUE
-quadmath_asinh(VALUE unused_obj, VALUE x)
+quadmath_asinh(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&asinh_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_asinh_realsolve(fixnum_to_cf128(x));
@@ -1575,6 +2375,9 @@ quadmath_asinh(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_asinh_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_asinh_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_asinh_nucompsolve(GetC128(x));
 		break;
@@ -1588,26 +2391,48 @@ quadmath_asinh(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+acosh_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	if (isnanq(x))
+	{
+		*y = nanq("");
+		return true;
+	}
+	if (x >= 1)
+	{
+		*y = acoshq(x);
+		return true;
+	}
+	*w = cacoshq((__complex128)x);
+	return false;
+}
+
+static bool
+acosh_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = cacoshq(z);
+	return true;
+}
+
+static const struct unary_kernel acosh_kernel = {acosh_realkernel, acosh_compkernel};
+
 static inline VALUE
 quadmath_acosh_realsolve(__float128 x)
 {
-	if (isnan(x))
-		return rb_float128_cf128(nanq(""));
-	if (x >= 1)
-		return rb_float128_cf128(acoshq(x));
-	else
-		return rb_complex128_cc128(cacoshq((__complex128)x));
+	return unary_realsolve(&acosh_kernel, x);
 }
 
 static inline VALUE
-quadmath_acosh_nucompsolve(__complex128 x)
+quadmath_acosh_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(cacoshq(x));
+	return unary_nucompsolve(&acosh_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.acosh(x) -> Float128 | Complex128
+ *    QuadMath.acosh(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの逆双曲線余弦を返す．
  *  xが実数なら定義域(1<=x<=∞)は実数解，それ以外は複素数解，複素数なら複素数解として各々返却する．
@@ -1630,8 +2455,14 @@ quadmath_acosh_nucompsolve(__complex128 x)
  *    QuadMath.acosh(1+1i) # => (1.0612750619050356520330189162135+0.904556894302381364127316795661958i)
  */
 static VALUE
-quadmath_acosh(VALUE unused_obj, VALUE x)
+quadmath_acosh(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&acosh_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_acosh_realsolve(fixnum_to_cf128(x));
@@ -1652,6 +2483,9 @@ quadmath_acosh(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_acosh_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_acosh_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_acosh_nucompsolve(GetC128(x));
 		break;
@@ -1665,26 +2499,48 @@ quadmath_acosh(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+atanh_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	if (isnanq(x))
+	{
+		*y = nanq("");
+		return true;
+	}
+	if (x >= -1 && x <= 1)
+	{
+		*y = atanhq(x);
+		return true;
+	}
+	*w = catanhq((__complex128)x);
+	return false;
+}
+
+static bool
+atanh_compkernel(__complex128 z, __complex128 *w)
+{
+	*w = catanhq(z);
+	return true;
+}
+
+static const struct unary_kernel atanh_kernel = {atanh_realkernel, atanh_compkernel};
+
 static inline VALUE
 quadmath_atanh_realsolve(__float128 x)
 {
-	if (isnan(x))
-		return rb_float128_cf128(nanq(""));
-	if (x >= -1 && x <= 1)
-		return rb_float128_cf128(atanhq(x));
-	else
-		return rb_complex128_cc128(catanhq((__complex128)x));
+	return unary_realsolve(&atanh_kernel, x);
 }
 
 static inline VALUE
-quadmath_atanh_nucompsolve(__complex128 x)
+quadmath_atanh_nucompsolve(__complex128 z)
 {
-	return rb_complex128_cc128(catanhq(x));
+	return unary_nucompsolve(&atanh_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.atanh(x) -> Float128 | Complex128
+ *    QuadMath.atanh(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの逆双曲線正接を返す．
  *  xが実数なら定義域(-1<=x<=1)は実数解，それ以外は複素数解，複素数なら複素数解として各々返却する．
@@ -1708,8 +2564,14 @@ quadmath_atanh_nucompsolve(__complex128 x)
  *    QuadMath.atanh(1+1i) # => (0.402359478108525093650189833306547+1.0172219678978513677227889615504i)
  */
 static VALUE
-quadmath_atanh(VALUE unused_obj, VALUE x)
+quadmath_atanh(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&atanh_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_atanh_realsolve(fixnum_to_cf128(x));
@@ -1730,6 +2592,9 @@ quadmath_atanh(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_atanh_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_atanh_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_atanh_nucompsolve(GetC128(x));
 		break;
@@ -1789,6 +2654,9 @@ hypot_inline(VALUE xsh, VALUE ysh)
 	case NUM_FLOAT128:
 		x = GetF128(xsh);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		x = dd_to_f128(GetDD(xsh));
+		break;
 	case NUM_COMPLEX128:
 		z = GetC128(xsh);
 		x_nucomp_p = true;
@@ -1825,6 +2693,9 @@ hypot_inline(VALUE xsh, VALUE ysh)
 	case NUM_FLOAT128:
 		y = GetF128(ysh);
 		break;
+	case NUM_DOUBLEDOUBLE:
+		y = dd_to_f128(GetDD(ysh));
+		break;
 	case NUM_COMPLEX128:
 		w = GetC128(ysh);
 		y_nucomp_p = true;
@@ -1891,24 +2762,41 @@ extern __complex128 cerfq(__complex128);
 #endif
 
 
+static bool
+erf_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = erfq(x);
+	return true;
+}
+
+static bool
+erf_compkernel(__complex128 z, __complex128 *w)
+{
+	if (cimagq(z) == 0)
+		*w = erfq(crealq(z));
+	else
+		*w = cerfq(z);
+	return true;
+}
+
+static const struct unary_kernel erf_kernel = {erf_realkernel, erf_compkernel};
+
 static inline VALUE
 quadmath_erf_realsolve(__float128 x)
 {
-	return rb_float128_cf128(erfq(x));
+	return unary_realsolve(&erf_kernel, x);
 }
 
 static inline VALUE
 quadmath_erf_nucompsolve(__complex128 z)
 {
-	if (cimagq(z) == 0)
-		return rb_complex128_cc128((__complex128)erfq(crealq(z)));
-	else
-		return rb_complex128_cc128(cerfq(z));
+	return unary_nucompsolve(&erf_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.erf(x) -> Float128 | Complex128
+ *    QuadMath.erf(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの誤差関数を返す．
  *  xが実数なら実数解，複素数なら複素数解として各々返却する．
@@ -1919,8 +2807,14 @@ quadmath_erf_nucompsolve(__complex128 z)
  *    QuadMath.erf(1+1i) # => (1.3161512816979476448802710802436+0.190453469237834686284108861969162i)
  */
 static VALUE
-quadmath_erf(VALUE unused_obj, VALUE x)
+quadmath_erf(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&erf_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_erf_realsolve(fixnum_to_cf128(x));
@@ -1941,6 +2835,9 @@ quadmath_erf(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_erf_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_erf_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_erf_nucompsolve(GetC128(x));
 		break;
@@ -1954,24 +2851,41 @@ quadmath_erf(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+erfc_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = erfcq(x);
+	return true;
+}
+
+static bool
+erfc_compkernel(__complex128 z, __complex128 *w)
+{
+	if (cimagq(z) == 0)
+		*w = erfcq(crealq(z));
+	else
+		*w = cerfcq(z);
+	return true;
+}
+
+static const struct unary_kernel erfc_kernel = {erfc_realkernel, erfc_compkernel};
+
 static inline VALUE
 quadmath_erfc_realsolve(__float128 x)
 {
-	return rb_float128_cf128(erfcq(x));
+	return unary_realsolve(&erfc_kernel, x);
 }
 
 static inline VALUE
 quadmath_erfc_nucompsolve(__complex128 z)
 {
-	if (cimagq(z) == 0)
-		return rb_complex128_cc128((__complex128)erfcq(crealq(z)));
-	else
-		return rb_complex128_cc128(cerfcq(z));
+	return unary_nucompsolve(&erfc_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.erfc(x) -> Float128 | Complex128
+ *    QuadMath.erfc(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの相補誤差関数を返す．
  *  xが実数なら実数解，複素数なら複素数解として各々返却する．
@@ -1982,8 +2896,14 @@ quadmath_erfc_nucompsolve(__complex128 z)
  *    QuadMath.erfc(1+1i) # => (-0.31615128169794764488027108024367-0.190453469237834686284108861969162i)
  */
 static VALUE
-quadmath_erfc(VALUE unused_obj, VALUE x)
+quadmath_erfc(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&erfc_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_erfc_realsolve(fixnum_to_cf128(x));
@@ -2004,6 +2924,9 @@ quadmath_erfc(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_erfc_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_erfc_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_erfc_nucompsolve(GetC128(x));
 		break;
@@ -2034,39 +2957,51 @@ lgamma_negarg(__float128 x)
 }
 
 
-static inline VALUE
-quadmath_lgamma_realsolve(__float128 x)
+static bool
+lgamma_realkernel(__float128 x, __float128 *y, __complex128 *w)
 {
-	if (isnan(x))
-		return rb_float128_cf128(nanq(""));
-	if (!signbitq(x))
-		return rb_float128_cf128(lgammaq(x));
+	if (isnanq(x) || !signbitq(x))
+	{
+		*y = isnanq(x) ? x : lgammaq(x);
+		return true;
+	}
+	*w = lgamma_negarg(x);
+	return false;
+}
+
+static bool
+lgamma_compkernel(__complex128 z, __complex128 *w)
+{
+	if (cimagq(z) == 0)
+	{
+		__float128 real = crealq(z), y;
+		if (!lgamma_realkernel(real, &y, w))
+			return true;
+		*w = y;
+	}
 	else
-		return rb_complex128_cc128(lgamma_negarg(x));
+		*w = clgammaq(z);
+	return true;
 }
 
+static const struct unary_kernel lgamma_kernel = {lgamma_realkernel, lgamma_compkernel};
 
+static inline VALUE
+quadmath_lgamma_realsolve(__float128 x)
+{
+	return unary_realsolve(&lgamma_kernel, x);
+}
 
 static inline VALUE
 quadmath_lgamma_nucompsolve(__complex128 z)
 {
-	if (cimagq(z) == 0)
-	{
-		__float128 real = crealq(z);
-		if (isnanq(real))
-			return rb_complex128_cc128((__complex128)real);
-		else if (!signbitq(real))
-			return rb_complex128_cc128((__complex128)lgammaq(real));
-		else
-			return rb_complex128_cc128(lgamma_negarg(real));
-	}
-	else
-		return rb_complex128_cc128(clgammaq(z));
+	return unary_nucompsolve(&lgamma_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.lgamma(x) -> Float128 | Complex128
+ *    QuadMath.lgamma(vector, out: nil) -> QuadMath::Vector
  *  
  *  xの対数ガンマ関数を返す．
  *  xが実数で正なら実数解，負なら複素数解，複素数なら複素数解を返す．
@@ -2074,8 +3009,14 @@ quadmath_lgamma_nucompsolve(__complex128 z)
  *    
  */
 static VALUE
-quadmath_lgamma(VALUE unused_obj, VALUE x)
+quadmath_lgamma(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&lgamma_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_lgamma_realsolve(fixnum_to_cf128(x));
@@ -2097,6 +3038,9 @@ quadmath_lgamma(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_lgamma_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_lgamma_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_lgamma_nucompsolve(GetC128(x));
 		break;
@@ -2181,6 +3125,9 @@ quadmath_lgamma_r(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_lgamma_r_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_lgamma_r_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_lgamma_r_nucompsolve(GetC128(x));
 		break;
@@ -2201,30 +3148,40 @@ extern __complex128 ctgammaq(__complex128);
 #endif
 
 
-static inline VALUE
-quadmath_gamma_realsolve(__float128 x)
+static bool
+gamma_realkernel(__float128 x, __float128 *y, __complex128 *w)
 {
-	return rb_float128_cf128(tgammaq(x));
+	*y = tgammaq(x);
+	return true;
 }
 
+static bool
+gamma_compkernel(__complex128 z, __complex128 *w)
+{
+	if (cimagq(z) != 0)
+		return false;
+	*w = tgammaq(crealq(z));
+	return true;
+}
+
+static const struct unary_kernel gamma_kernel = {gamma_realkernel, gamma_compkernel};
 
+static inline VALUE
+quadmath_gamma_realsolve(__float128 x)
+{
+	return unary_realsolve(&gamma_kernel, x);
+}
 
 static inline VALUE
 quadmath_gamma_nucompsolve(__complex128 z)
 {
-	if (cimagq(z) == 0)
-		return rb_complex128_cc128((__complex128)tgammaq(crealq(z)));
-	else
-#if 0
-		return rb_complex128_cc128(ctgammaq(z));
-#else
-		rb_raise(rb_eTypeError, "not a real");
-#endif
+	return unary_nucompsolve(&gamma_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.gamma(x) -> Float128 | Complex128
+ *    QuadMath.gamma(vector, out: nil) -> QuadMath::Vector
  *  
  *  xのガンマ関数を返す．
  *  xが実数なら実数解，素数なら複素数解として各々返却する．
@@ -2232,8 +3189,14 @@ quadmath_gamma_nucompsolve(__complex128 z)
  *    
  */
 static VALUE
-quadmath_gamma(VALUE unused_obj, VALUE x)
+quadmath_gamma(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&gamma_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_gamma_realsolve(fixnum_to_cf128(x));
@@ -2258,6 +3221,9 @@ quadmath_gamma(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_gamma_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_gamma_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_gamma_nucompsolve(GetC128(x));
 		break;
@@ -2271,28 +3237,40 @@ quadmath_gamma(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+j0_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = j0q(x);
+	return true;
+}
+
+static bool
+j0_compkernel(__complex128 z, __complex128 *w)
+{
+	if (cimagq(z) != 0)
+		return false;
+	*w = j0q(crealq(z));
+	return true;
+}
+
+static const struct unary_kernel j0_kernel = {j0_realkernel, j0_compkernel};
+
 static inline VALUE
 quadmath_j0_realsolve(__float128 x)
 {
-	return rb_float128_cf128(j0q(x));
+	return unary_realsolve(&j0_kernel, x);
 }
 
 static inline VALUE
-quadmath_j0_nucompsolve(__float128 z)
+quadmath_j0_nucompsolve(__complex128 z)
 {
-	if (cimagq(z) == 0)
-		return rb_complex128_cc128((__complex128)j0q(crealq(z)));
-	else
-#if 0
-		return rb_complex128_cc128(cj0q(z));
-#else
-		rb_raise(rb_eTypeError, "not a real");
-#endif
+	return unary_nucompsolve(&j0_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.j0(x) -> Float128
+ *    QuadMath.j0(vector, out: nil) -> QuadMath::Vector
  *  
  *  Computes the Bessel function of the first kind, first order of +x+.
  *  
@@ -2302,8 +3280,14 @@ quadmath_j0_nucompsolve(__float128 z)
  *    
  */
 static VALUE
-quadmath_j0(VALUE unused_obj, VALUE x)
+quadmath_j0(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&j0_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_j0_realsolve(fixnum_to_cf128(x));
@@ -2328,6 +3312,9 @@ quadmath_j0(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_j0_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_j0_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_j0_nucompsolve(GetC128(x));
 		break;
@@ -2341,28 +3328,40 @@ quadmath_j0(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+j1_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = j1q(x);
+	return true;
+}
+
+static bool
+j1_compkernel(__complex128 z, __complex128 *w)
+{
+	if (cimagq(z) != 0)
+		return false;
+	*w = j1q(crealq(z));
+	return true;
+}
+
+static const struct unary_kernel j1_kernel = {j1_realkernel, j1_compkernel};
+
 static inline VALUE
 quadmath_j1_realsolve(__float128 x)
 {
-	return rb_float128_cf128(j1q(x));
+	return unary_realsolve(&j1_kernel, x);
 }
 
 static inline VALUE
-quadmath_j1_nucompsolve(__float128 z)
+quadmath_j1_nucompsolve(__complex128 z)
 {
-	if (cimagq(z) == 0)
-		return rb_complex128_cc128((__complex128)j1q(crealq(z)));
-	else
-#if 0
-		return rb_complex128_cc128(cj1q(z));
-#else
-		rb_raise(rb_eTypeError, "not a real");
-#endif
+	return unary_nucompsolve(&j1_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.j1(x) -> Float128
+ *    QuadMath.j1(vector, out: nil) -> QuadMath::Vector
  *  
  *  Computes the Bessel function of the first kind, second order of +x+.
  *  
@@ -2371,8 +3370,14 @@ quadmath_j1_nucompsolve(__float128 z)
  *    
  */
 static VALUE
-quadmath_j1(VALUE unused_obj, VALUE x)
+quadmath_j1(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&j1_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_j1_realsolve(fixnum_to_cf128(x));
@@ -2397,6 +3402,9 @@ quadmath_j1(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_j1_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_j1_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_j1_nucompsolve(GetC128(x));
 		break;
@@ -2482,6 +3490,9 @@ quadmath_jn(VALUE unused_obj, VALUE order, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_jn_realsolve(vorder, GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_jn_realsolve(vorder, dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_jn_nucompsolve(vorder, GetC128(x));
 		break;
@@ -2495,28 +3506,40 @@ quadmath_jn(VALUE unused_obj, VALUE order, VALUE x)
 	}
 }
 
+static bool
+y0_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = y0q(x);
+	return true;
+}
+
+static bool
+y0_compkernel(__complex128 z, __complex128 *w)
+{
+	if (cimagq(z) != 0)
+		return false;
+	*w = y0q(crealq(z));
+	return true;
+}
+
+static const struct unary_kernel y0_kernel = {y0_realkernel, y0_compkernel};
+
 static inline VALUE
 quadmath_y0_realsolve(__float128 x)
 {
-	return rb_float128_cf128(y0q(x));
+	return unary_realsolve(&y0_kernel, x);
 }
 
 static inline VALUE
-quadmath_y0_nucompsolve(__float128 z)
+quadmath_y0_nucompsolve(__complex128 z)
 {
-	if (cimagq(z) == 0)
-		return rb_complex128_cc128((__complex128)y0q(crealq(z)));
-	else
-#if 0
-		return rb_complex128_cc128(cy0q(z));
-#else
-		rb_raise(rb_eTypeError, "not a real");
-#endif
+	return unary_nucompsolve(&y0_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.y0(x) -> Float128
+ *    QuadMath.y0(vector, out: nil) -> QuadMath::Vector
  *  
  *  Computes the Bessel function of the second kind, first order of +x+.
  *  
@@ -2528,8 +3551,14 @@ quadmath_y0_nucompsolve(__float128 z)
  *    QuadMath.y0(1/3r) # => -0.734373073454472607761165475056708
  */
 static VALUE
-quadmath_y0(VALUE unused_obj, VALUE x)
+quadmath_y0(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&y0_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_y0_realsolve(fixnum_to_cf128(x));
@@ -2554,6 +3583,9 @@ quadmath_y0(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_y0_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_y0_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_y0_nucompsolve(GetC128(x));
 		break;
@@ -2567,28 +3599,40 @@ quadmath_y0(VALUE unused_obj, VALUE x)
 	}
 }
 
+static bool
+y1_realkernel(__float128 x, __float128 *y, __complex128 *w)
+{
+	*y = y1q(x);
+	return true;
+}
+
+static bool
+y1_compkernel(__complex128 z, __complex128 *w)
+{
+	if (cimagq(z) != 0)
+		return false;
+	*w = y1q(crealq(z));
+	return true;
+}
+
+static const struct unary_kernel y1_kernel = {y1_realkernel, y1_compkernel};
+
 static inline VALUE
 quadmath_y1_realsolve(__float128 x)
 {
-	return rb_float128_cf128(y1q(x));
+	return unary_realsolve(&y1_kernel, x);
 }
 
 static inline VALUE
-quadmath_y1_nucompsolve(__float128 z)
+quadmath_y1_nucompsolve(__complex128 z)
 {
-	if (cimagq(z) == 0)
-		return rb_complex128_cc128((__complex128)y1q(crealq(z)));
-	else
-#if 0
-		return rb_complex128_cc128(cy1q(z));
-#else
-		rb_raise(rb_eTypeError, "not a real");
-#endif
+	return unary_nucompsolve(&y1_kernel, z);
 }
 
 /*
  *  call-seq:
  *    QuadMath.y1(x) -> Float128
+ *    QuadMath.y1(vector, out: nil) -> QuadMath::Vector
  *  
  *  Computes the Bessel function of the second kind, second order of +x+.
  *  
@@ -2600,8 +3644,14 @@ quadmath_y1_nucompsolve(__float128 z)
  *    QuadMath.y1(1/3r) # => -2.0881657798883862661909621637453
  */
 static VALUE
-quadmath_y1(VALUE unused_obj, VALUE x)
+quadmath_y1(int argc, VALUE *argv, VALUE unused_obj)
 {
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (unary_map_p(x, opts))
+		return unary_map(&y1_kernel, x, opts);
+
 	switch (convertion_num_types(x)) {
 	case NUM_FIXNUM:
 		return quadmath_y1_realsolve(fixnum_to_cf128(x));
@@ -2626,6 +3676,9 @@ quadmath_y1(VALUE unused_obj, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_y1_realsolve(GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_y1_realsolve(dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_y1_nucompsolve(GetC128(x));
 		break;
@@ -2695,6 +3748,9 @@ quadmath_yn(VALUE unused_obj, VALUE order, VALUE x)
 	case NUM_FLOAT128:
 		return quadmath_yn_realsolve(vorder, GetF128(x));
 		break;
+	case NUM_DOUBLEDOUBLE:
+		return quadmath_yn_realsolve(vorder, dd_to_f128(GetDD(x)));
+		break;
 	case NUM_COMPLEX128:
 		return quadmath_yn_nucompsolve(vorder, GetC128(x));
 		break;
@@ -2708,47 +3764,102 @@ quadmath_yn(VALUE unused_obj, VALUE order, VALUE x)
 	}
 }
 
+static VALUE
+accuracy_restore(VALUE saved)
+{
+	rb_thread_local_aset(rb_thread_current(), id_accuracy_key, saved);
+	return Qnil;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.with_accuracy(accuracy) { ... } -> object
+ *  
+ *  ブロックの間，exp，exp2，log，log2，log10，sqrt，sin，cos，tanの既定の精度をaccuracyにする．
+ *  accuracyは:fullか:fastで，ブロックの値を返す．既定値はファイバーごとにあり，ブロックを抜けると元に戻る．
+ *  各関数にaccuracy:を渡せば，呼び出しごとにこれより優先して指定できる．
+ *  
+ *  :fullはlibquadmathの結果を返す．:fastはdouble-doubleの表と多項式で計算し，数倍速い代わりに
+ *  誤差が最大512ulp (binary128)，相対誤差で2^-103以内になる．FloatとFloat128およびその実数ベクトルの要素に効き，
+ *  整数，有理数，複素数の引数と，:fastの扱えない範囲の引数はlibquadmathで計算する．
+ *  
+ *  QuadMath.with_accuracy(:fast) { QuadMath.exp(QuadMath::Vector[0.5, 1.5]) }
+ *  QuadMath.sin(1.0, accuracy: :fast) # => 0.841470984807896506652502321630299
+ */
+static VALUE
+quadmath_with_accuracy(VALUE unused_obj, VALUE accuracy)
+{
+	VALUE saved = rb_thread_local_aref(rb_thread_current(), id_accuracy_key);
+
+	rb_need_block();
+	accuracy_fast_p(accuracy);
+	rb_thread_local_aset(rb_thread_current(), id_accuracy_key, accuracy);
+	return rb_ensure(rb_yield, Qnil, accuracy_restore, saved);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.accuracy -> :full | :fast
+ *  
+ *  現在のファイバーの既定の精度を返す．QuadMath.with_accuracyを参照．
+ */
+static VALUE
+quadmath_accuracy(VALUE unused_obj)
+{
+	VALUE accuracy = rb_thread_local_aref(rb_thread_current(), id_accuracy_key);
+
+	return NIL_P(accuracy) ? ID2SYM(id_full) : accuracy;
+}
+
 void
 InitVM_QuadMath(void)
 {
+	id_accuracy = rb_intern_const("accuracy");
+	/* ファイバーローカルの既定の精度の鍵．利用者のThread.current[:accuracy]と混ざらないようにする */
+	id_accuracy_key = rb_intern_const("__quadmath_accuracy__");
+	id_full = rb_intern_const("full");
+	id_fast = rb_intern_const("fast");
+
 	/* Math-Functions */
-	rb_define_module_function(rb_mQuadMath, "exp", quadmath_exp, 1);
-	rb_define_module_function(rb_mQuadMath, "exp2", quadmath_exp2, 1);
-	rb_define_module_function(rb_mQuadMath, "expm1", quadmath_expm1, 1);
-	rb_define_module_function(rb_mQuadMath, "log", quadmath_log, 1);
-	rb_define_module_function(rb_mQuadMath, "log2", quadmath_log2, 1);
-	rb_define_module_function(rb_mQuadMath, "log10", quadmath_log10, 1);
-	rb_define_module_function(rb_mQuadMath, "log1p", quadmath_log1p, 1);
-	rb_define_module_function(rb_mQuadMath, "sqrt", quadmath_sqrt, 1);
-	rb_define_module_function(rb_mQuadMath, "sqrt3", quadmath_sqrt3, 1);
-	rb_define_module_function(rb_mQuadMath, "cbrt", quadmath_cbrt, 1);
-	rb_define_module_function(rb_mQuadMath, "sin", quadmath_sin, 1);
-	rb_define_module_function(rb_mQuadMath, "cos", quadmath_cos, 1);
-	rb_define_module_function(rb_mQuadMath, "tan", quadmath_tan, 1);
-	rb_define_module_function(rb_mQuadMath, "asin", quadmath_asin, 1);
-	rb_define_module_function(rb_mQuadMath, "acos", quadmath_acos, 1);
-	rb_define_module_function(rb_mQuadMath, "atan", quadmath_atan, 1);
+	rb_define_module_function(rb_mQuadMath, "exp", quadmath_exp, -1);
+	rb_define_module_function(rb_mQuadMath, "exp2", quadmath_exp2, -1);
+	rb_define_module_function(rb_mQuadMath, "expm1", quadmath_expm1, -1);
+	rb_define_module_function(rb_mQuadMath, "log", quadmath_log, -1);
+	rb_define_module_function(rb_mQuadMath, "log2", quadmath_log2, -1);
+	rb_define_module_function(rb_mQuadMath, "log10", quadmath_log10, -1);
+	rb_define_module_function(rb_mQuadMath, "log1p", quadmath_log1p, -1);
+	rb_define_module_function(rb_mQuadMath, "sqrt", quadmath_sqrt, -1);
+	rb_define_module_function(rb_mQuadMath, "sqrt3", quadmath_sqrt3, -1);
+	rb_define_module_function(rb_mQuadMath, "cbrt", quadmath_cbrt, -1);
+	rb_define_module_function(rb_mQuadMath, "sin", quadmath_sin, -1);
+	rb_define_module_function(rb_mQuadMath, "cos", quadmath_cos, -1);
+	rb_define_module_function(rb_mQuadMath, "tan", quadmath_tan, -1);
+	rb_define_module_function(rb_mQuadMath, "asin", quadmath_asin, -1);
+	rb_define_module_function(rb_mQuadMath, "acos", quadmath_acos, -1);
+	rb_define_module_function(rb_mQuadMath, "atan", quadmath_atan, -1);
 	rb_define_module_function(rb_mQuadMath, "atan2", quadmath_atan2, 2);
 	rb_define_module_function(rb_mQuadMath, "quadrant", quadmath_quadrant, 2);
-	rb_define_module_function(rb_mQuadMath, "sinh", quadmath_sinh, 1);
-	rb_define_module_function(rb_mQuadMath, "cosh", quadmath_cosh, 1);
-	rb_define_module_function(rb_mQuadMath, "tanh", quadmath_tanh, 1);
-	rb_define_module_function(rb_mQuadMath, "asinh", quadmath_asinh, 1);
-	rb_define_module_function(rb_mQuadMath, "acosh", quadmath_acosh, 1);
-	rb_define_module_function(rb_mQuadMath, "atanh", quadmath_atanh, 1);
+	rb_define_module_function(rb_mQuadMath, "sinh", quadmath_sinh, -1);
+	rb_define_module_function(rb_mQuadMath, "cosh", quadmath_cosh, -1);
+	rb_define_module_function(rb_mQuadMath, "tanh", quadmath_tanh, -1);
+	rb_define_module_function(rb_mQuadMath, "asinh", quadmath_asinh, -1);
+	rb_define_module_function(rb_mQuadMath, "acosh", quadmath_acosh, -1);
+	rb_define_module_function(rb_mQuadMath, "atanh", quadmath_atanh, -1);
 	rb_define_module_function(rb_mQuadMath, "hypot", quadmath_hypot, 2);
-	rb_define_module_function(rb_mQuadMath, "erf", quadmath_erf, 1);
-	rb_define_module_function(rb_mQuadMath, "erfc", quadmath_erfc, 1);
-	rb_define_module_function(rb_mQuadMath, "lgamma", quadmath_lgamma, 1);
+	rb_define_module_function(rb_mQuadMath, "erf", quadmath_erf, -1);
+	rb_define_module_function(rb_mQuadMath, "erfc", quadmath_erfc, -1);
+	rb_define_module_function(rb_mQuadMath, "lgamma", quadmath_lgamma, -1);
 	rb_define_module_function(rb_mQuadMath, "lgamma_r", quadmath_lgamma_r, 1);
 	rb_define_module_function(rb_mQuadMath, "signgam", quadmath_lgamma_r, 1);
-	rb_define_module_function(rb_mQuadMath, "gamma", quadmath_gamma, 1);
-	rb_define_module_function(rb_mQuadMath, "j0", quadmath_j0, 1);
-	rb_define_module_function(rb_mQuadMath, "j1", quadmath_j1, 1);
+	rb_define_module_function(rb_mQuadMath, "gamma", quadmath_gamma, -1);
+	rb_define_module_function(rb_mQuadMath, "j0", quadmath_j0, -1);
+	rb_define_module_function(rb_mQuadMath, "j1", quadmath_j1, -1);
 	rb_define_module_function(rb_mQuadMath, "jn", quadmath_jn, 2);
-	rb_define_module_function(rb_mQuadMath, "y0", quadmath_y0, 1);
-	rb_define_module_function(rb_mQuadMath, "y1", quadmath_y1, 1);
+	rb_define_module_function(rb_mQuadMath, "y0", quadmath_y0, -1);
+	rb_define_module_function(rb_mQuadMath, "y1", quadmath_y1, -1);
 	rb_define_module_function(rb_mQuadMath, "yn", quadmath_yn, 2);
+	rb_define_module_function(rb_mQuadMath, "with_accuracy", quadmath_with_accuracy, 1);
+	rb_define_module_function(rb_mQuadMath, "accuracy", quadmath_accuracy, 0);
 
 	
 	/* Math-Constants */
@@ -23,7 +23,17 @@ int rb_opts_exception_p(VALUE opts, int default_value);
 
 RUBY_EXT_EXTERN VALUE rb_cFloat128;
 RUBY_EXT_EXTERN VALUE rb_cComplex128;
+RUBY_EXT_EXTERN VALUE rb_cDoubleDouble;
 RUBY_EXT_EXTERN VALUE rb_mQuadMath;
+RUBY_EXT_EXTERN VALUE rb_cQuadVector;
+RUBY_EXT_EXTERN VALUE rb_cQuadVectorLazy;
+RUBY_EXT_EXTERN VALUE rb_cQuadStats;
+RUBY_EXT_EXTERN VALUE rb_mQuadBLAS;
+RUBY_EXT_EXTERN VALUE rb_cQuadMatrix;
+RUBY_EXT_EXTERN VALUE rb_cQuadSparseMatrix;
+RUBY_EXT_EXTERN VALUE rb_cQuadFFT;
+RUBY_EXT_EXTERN VALUE rb_cQuadChebyshev;
+RUBY_EXT_EXTERN VALUE rb_cQuadFormula;
 
 /*
  * C API: rb_float128_cf128(x)
@@ -0,0 +1,716 @@
+/*******************************************************************************
+    reduction.c -- Reduction Kernels of module QuadMath
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <stdint.h>
+#include <quadmath.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+#ifndef HAVE_CL2NORM2Q
+/* quadmath.cがmissing/cl2norm2q.cから用意する */
+__float128 cl2norm2q(__complex128, __complex128);
+#endif
+
+/* 最大値でスケーリングしてから二乗和を取る．オーバーフロー・アンダーフローの退避路 */
+static __float128
+real_source_nrm2_rescale(const struct real_source *src)
+{
+	__float128 scale = 0, ssq = 0;
+	bool nan_p = false;
+
+	for (long i = 0; i < src->len; i++)
+	{
+		__float128 ax = fabsq(real_source_at(src, i));
+		if (isinfq(ax))
+			return HUGE_VALQ;
+		else if (isnanq(ax))
+			nan_p = true;
+		else if (scale < ax)
+			scale = ax;
+	}
+	if (nan_p)
+		return nanq("");
+	if (scale == 0)
+		return 0;
+
+	for (long i = 0; i < src->len; i++)
+	{
+		__float128 t = real_source_at(src, i) / scale;
+		ssq = fma_q(t, t, ssq);
+	}
+	return scale * sqrtq(ssq);
+}
+
+/* 並列に計算するときに一度に取り出すブロックの数 */
+#define REDUCE_GRAIN 4
+
+/*
+ * 二進固定小数点の累積器．binary128の最小の非正規化数 2^-16494 を単位とし，
+ * 下位から32ビットずつの桁をint64_tに持つ．足す数の仮数を指数で決まる桁へ整数のまま足すので
+ * 和は厳密であり，足す順序や分け方，スレッド数や機械によらない．丸めは最後に一度だけ行う．
+ * 一回の加算で各桁の変化は2^33未満だから，正規化せずに2^29回まで足せる．
+ * 最上位の桁は符号を兼ね，正規化の後は0か-1である．
+ */
+#define BINNED_DIGITS 1032
+#define BINNED_UNIT_EXP (-16494)
+
+struct binned_acc {
+	int64_t d[BINNED_DIGITS];
+	long lo, hi;  /* 足し込んだ桁の範囲 [lo, hi) */
+	bool nan_p, pinf_p, ninf_p;
+};
+
+static inline void
+binned_init(struct binned_acc *acc)
+{
+	memset(acc->d, 0, sizeof(acc->d));
+	acc->lo = BINNED_DIGITS;
+	acc->hi = 0;
+	acc->nan_p = acc->pinf_p = acc->ninf_p = false;
+}
+
+static inline void
+binned_add(struct binned_acc *acc, __float128 x)
+{
+	union { __float128 f; uint64_t w[2]; } u = { .f = x };
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	const uint64_t hi = u.w[0], lo = u.w[1];
+#else
+	const uint64_t hi = u.w[1], lo = u.w[0];
+#endif
+	const int e = (int)(hi >> 48) & 0x7fff;
+	uint64_t mhi = hi & 0xffffffffffffULL, s[4];
+	int64_t *d;
+	long base;
+	int sh;
+
+	if (e == 0x7fff)
+	{
+		if (mhi | lo)
+			acc->nan_p = true;
+		else if (hi >> 63)
+			acc->ninf_p = true;
+		else
+			acc->pinf_p = true;
+		return;
+	}
+	if (e == 0 && (mhi | lo) == 0)
+		return;
+	if (e != 0)
+		mhi |= 1ULL << 48;
+
+	/* 仮数の最下位ビットは単位の 2^(max(e,1)-1) 倍 */
+	base = (e ? e - 1 : 0) >> 5;
+	sh = (e ? e - 1 : 0) & 31;
+	s[0] = lo & 0xffffffff;
+	s[1] = lo >> 32;
+	s[2] = mhi & 0xffffffff;
+	s[3] = mhi >> 32;
+	d = acc->d + base;
+	if (hi >> 63)
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			const uint64_t w = s[k] << sh;
+			d[k] -= (int64_t)(w & 0xffffffff);
+			d[k + 1] -= (int64_t)(w >> 32);
+		}
+	}
+	else
+	{
+		for (int k = 0; k < 4; k++)
+		{
+			const uint64_t w = s[k] << sh;
+			d[k] += (int64_t)(w & 0xffffffff);
+			d[k + 1] += (int64_t)(w >> 32);
+		}
+	}
+	if (base < acc->lo)
+		acc->lo = base;
+	if (base + 5 > acc->hi)
+		acc->hi = base + 5;
+}
+
+/* 桁上がりを送って[lo, 最上位)の桁を0以上2^32未満にする */
+static void
+binned_normalize(struct binned_acc *acc)
+{
+	int64_t carry = 0;
+	long i;
+
+	if (acc->lo >= acc->hi)
+		return;
+	for (i = acc->lo; i < BINNED_DIGITS - 1 && (i < acc->hi || carry != 0); i++)
+	{
+		const int64_t v = acc->d[i] + carry;
+		acc->d[i] = v & 0xffffffff;
+		carry = v >> 32;
+	}
+	acc->d[i] += carry;
+	if (acc->hi < i + 1)
+		acc->hi = i + 1;
+}
+
+/* 正規化したsrcをdstに足す．整数の加算なので，どのスレッドから先に足しても結果は同じである */
+static void
+binned_merge(struct binned_acc *dst, const struct binned_acc *src)
+{
+	for (long i = src->lo; i < src->hi; i++)
+		if (src->d[i] != 0)
+			__atomic_fetch_add(&dst->d[i], src->d[i], __ATOMIC_RELAXED);
+	if (src->nan_p)
+		__atomic_store_n(&dst->nan_p, true, __ATOMIC_RELAXED);
+	if (src->pinf_p)
+		__atomic_store_n(&dst->pinf_p, true, __ATOMIC_RELAXED);
+	if (src->ninf_p)
+		__atomic_store_n(&dst->ninf_p, true, __ATOMIC_RELAXED);
+}
+
+/*
+ * 累積器の値を最近接偶数丸めで__float128にする．
+ * 最上位の非零ビットから128ビットを取り，残りが非零ならば最下位ビットを立てて
+ * 一度だけ丸める．非正規化数の範囲の和は単位の整数倍で112ビットに収まるから丸めは起きない．
+ */
+static __float128
+binned_value(struct binned_acc *acc)
+{
+	const long top = BINNED_DIGITS - 1;
+	unsigned __int128 m = 0;
+	uint64_t rest;
+	bool neg, sticky;
+	long h;
+	int lz;
+
+	if (acc->nan_p || (acc->pinf_p && acc->ninf_p))
+		return nanq("");
+	if (acc->pinf_p)
+		return HUGE_VALQ;
+	if (acc->ninf_p)
+		return -HUGE_VALQ;
+
+	acc->lo = 0;
+	acc->hi = BINNED_DIGITS;
+	binned_normalize(acc);
+	neg = acc->d[top] < 0;
+	if (neg)
+	{
+		int64_t carry = 1;
+		for (long i = 0; i < top; i++)
+		{
+			const int64_t v = (~acc->d[i] & 0xffffffff) + carry;
+			acc->d[i] = v & 0xffffffff;
+			carry = v >> 32;
+		}
+	}
+	for (h = top - 1; h >= 0 && acc->d[h] == 0; h--)
+		;
+	if (h < 0)
+		return 0;
+
+	for (long k = h; k > h - 4; k--)
+		m = m << 32 | (k >= 0 ? (uint64_t)acc->d[k] : 0);
+	rest = h >= 4 ? (uint64_t)acc->d[h - 4] : 0;
+	lz = __builtin_clz((unsigned int)acc->d[h]);
+	if (lz > 0)
+	{
+		m = m << lz | rest >> (32 - lz);
+		sticky = ((rest << lz) & 0xffffffff) != 0;
+	}
+	else
+		sticky = rest != 0;
+	for (long k = h - 5; k >= 0 && !sticky; k--)
+		sticky = acc->d[k] != 0;
+	m |= sticky;
+
+	return ldexpq(neg ? -(__float128)m : (__float128)m, 32 * (int)(h - 3) - lz + BINNED_UNIT_EXP);
+}
+
+/*
+ * 総和 Σ x[i] か積和 Σ x[i] y[i] をREDUCE_BLOCK個ずつのブロックに分けて計算する．
+ * accがNULLならば各ブロックの部分和をpartialに置き，後で固定した二分木で足し合わせる．
+ * NULLでなければ項 (積は一度丸める) を区間ごとの累積器に厳密に足し，accへ合わせる．
+ * 中断されたときは計算済みのブロック数をblockに残す．
+ * 読み出し元がArrayならばGVLを持ったまま一本のスレッドで呼ぶこと．
+ */
+struct reduce_args {
+	const struct real_source *x;
+	const struct real_source *y;  /* NULLならばxの総和 */
+	long stride;  /* xがベクトルのときの要素の間隔 */
+	__float128 *partial;
+	struct binned_acc *acc;
+	long block;
+	int nthreads;
+};
+
+static inline __float128
+reduce_x_at(const struct reduce_args *args, long i)
+{
+	if (args->x->type == SRC_VECTOR)
+		return args->x->f128[i * args->stride];
+	return real_source_at(args->x, i);
+}
+
+static void
+reduce_blocks(void *ptr, long b0, long b1)
+{
+	const struct reduce_args *args = ptr;
+	const long n = args->x->len;
+
+	for (long b = b0; b < b1; b++)
+	{
+		const long i1 = (b + 1) * REDUCE_BLOCK < n ? (b + 1) * REDUCE_BLOCK : n;
+		__float128 s = 0;
+		if (args->y)
+			for (long i = b * REDUCE_BLOCK; i < i1; i++)
+				s = fma_q(real_source_at(args->x, i), real_source_at(args->y, i), s);
+		else
+			for (long i = b * REDUCE_BLOCK; i < i1; i++)
+				s += reduce_x_at(args, i);
+		args->partial[b] = s;
+	}
+}
+
+static void
+reduce_binned(void *ptr, long b0, long b1)
+{
+	const struct reduce_args *args = ptr;
+	const long n = args->x->len, i1 = b1 * REDUCE_BLOCK < n ? b1 * REDUCE_BLOCK : n;
+	struct binned_acc acc;
+
+	binned_init(&acc);
+	if (args->y)
+		for (long i = b0 * REDUCE_BLOCK; i < i1; i++)
+			binned_add(&acc, real_source_at(args->x, i) * real_source_at(args->y, i));
+	else
+		for (long i = b0 * REDUCE_BLOCK; i < i1; i++)
+			binned_add(&acc, reduce_x_at(args, i));
+	binned_normalize(&acc);
+	binned_merge(args->acc, &acc);
+}
+
+static void *
+reduce_nogvl(void *ptr)
+{
+	struct reduce_args *args = ptr;
+	const long nblocks = (args->x->len + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+
+	if (!quadmath_parallel_for_at(&args->block, nblocks, REDUCE_GRAIN, args->nthreads,
+	                              args->acc ? reduce_binned : reduce_blocks, args))
+		return QUADMATH_INTERRUPTED;
+	return NULL;
+}
+
+__float128
+pairwise_sum_q(const __float128 *x, long n, long stride)
+{
+	if (n <= 8)
+	{
+		__float128 s = 0;
+		for (long i = 0; i < n; i++)
+			s += x[i * stride];
+		return s;
+	}
+	else
+	{
+		long h = n / 2;
+		return pairwise_sum_q(x, h, stride) + pairwise_sum_q(x + h * stride, n - h, stride);
+	}
+}
+
+struct generated_sum_args {
+	long len;
+	reduce_gen_t gen;
+	void *arg;
+	__float128 *partial;
+	struct binned_acc *acc;
+	long block;
+	int nthreads;
+};
+
+/* reduce_blocks()と同じく各ブロックを先頭から順に足す．要素はREDUCE_CHUNK個ずつ作る */
+static void
+generated_sum_blocks(void *ptr, long b0, long b1)
+{
+	const struct generated_sum_args *args = ptr;
+	__float128 y[REDUCE_CHUNK];
+
+	for (long b = b0; b < b1; b++)
+	{
+		const long i1 = (b + 1) * REDUCE_BLOCK < args->len ? (b + 1) * REDUCE_BLOCK : args->len;
+		__float128 s = 0;
+		for (long i0 = b * REDUCE_BLOCK; i0 < i1; i0 += REDUCE_CHUNK)
+		{
+			const long n = i1 - i0 < REDUCE_CHUNK ? i1 - i0 : REDUCE_CHUNK;
+			args->gen(args->arg, i0, n, y);
+			for (long i = 0; i < n; i++)
+				s += y[i];
+		}
+		args->partial[b] = s;
+	}
+}
+
+static void
+generated_sum_binned(void *ptr, long b0, long b1)
+{
+	const struct generated_sum_args *args = ptr;
+	const long i1 = b1 * REDUCE_BLOCK < args->len ? b1 * REDUCE_BLOCK : args->len;
+	__float128 y[REDUCE_CHUNK];
+	struct binned_acc acc;
+
+	binned_init(&acc);
+	for (long i0 = b0 * REDUCE_BLOCK; i0 < i1; i0 += REDUCE_CHUNK)
+	{
+		const long n = i1 - i0 < REDUCE_CHUNK ? i1 - i0 : REDUCE_CHUNK;
+		args->gen(args->arg, i0, n, y);
+		for (long i = 0; i < n; i++)
+			binned_add(&acc, y[i]);
+	}
+	binned_normalize(&acc);
+	binned_merge(args->acc, &acc);
+}
+
+static void *
+generated_sum_nogvl(void *ptr)
+{
+	struct generated_sum_args *args = ptr;
+	const long nblocks = (args->len + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+
+	if (!quadmath_parallel_for_at(&args->block, nblocks, REDUCE_GRAIN, args->nthreads,
+	                              args->acc ? generated_sum_binned : generated_sum_blocks, args))
+		return QUADMATH_INTERRUPTED;
+	return NULL;
+}
+
+__float128
+generated_sum_q(long len, reduce_gen_t gen, void *arg, long work, bool reproducible)
+{
+	const long nblocks = (len + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+	struct generated_sum_args args;
+	VALUE tmp;
+	__float128 s;
+
+	args.len = len;
+	args.gen = gen;
+	args.arg = arg;
+	args.block = 0;
+	args.nthreads = work >= NOGVL_THRESHOLD ? quadmath_threads() : 1;
+	if (reproducible)
+	{
+		args.partial = NULL;
+		args.acc = ALLOCV(tmp, sizeof(struct binned_acc));
+		binned_init(args.acc);
+		quadmath_call_nogvl(generated_sum_nogvl, &args, work);
+		s = binned_value(args.acc);
+	}
+	else
+	{
+		args.partial = ALLOCV_N(__float128, tmp, nblocks > 0 ? nblocks : 1);
+		args.acc = NULL;
+		quadmath_call_nogvl(generated_sum_nogvl, &args, work);
+		s = pairwise_sum_q(args.partial, nblocks, 1);
+	}
+	ALLOCV_END(tmp);
+
+	return s;
+}
+
+/*
+ * Arrayの要素はRubyのオブジェクトなのでGVLを持ったまま読む．
+ * バイナリ文字列はreal_source_init()で凍結した複製なので，GVLなしで読める．
+ */
+static long
+real_source_nogvl_size(struct real_source *src)
+{
+	if (src->type == SRC_ARRAY)
+		return 0;
+	return src->len;
+}
+
+/*
+ * 読み出し元がどちらもGVLなしで読めれば，QuadMath.threads本のスレッドでブロックを分け合う．
+ * yがNULLならばxの総和である．reproducibleならば累積器で厳密に足す．
+ */
+static __float128
+real_source_reduce(struct real_source *x, struct real_source *y, long stride, bool reproducible)
+{
+	const long nblocks = (x->len + REDUCE_BLOCK - 1) / REDUCE_BLOCK;
+	long size = real_source_nogvl_size(x);
+	struct reduce_args args;
+	VALUE tmp;
+	__float128 s;
+
+	if (y)
+	{
+		long ny = real_source_nogvl_size(y);
+		size = size < ny ? size : ny;
+	}
+	args.x = x;
+	args.y = y;
+	args.stride = stride;
+	args.block = 0;
+	args.nthreads = size >= NOGVL_THRESHOLD ? quadmath_threads() : 1;
+	if (reproducible)
+	{
+		args.partial = NULL;
+		args.acc = ALLOCV(tmp, sizeof(struct binned_acc));
+		binned_init(args.acc);
+		quadmath_call_nogvl(reduce_nogvl, &args, size);
+		s = binned_value(args.acc);
+	}
+	else
+	{
+		args.partial = ALLOCV_N(__float128, tmp, nblocks > 0 ? nblocks : 1);
+		args.acc = NULL;
+		quadmath_call_nogvl(reduce_nogvl, &args, size);
+		s = pairwise_sum_q(args.partial, nblocks, 1);
+	}
+	ALLOCV_END(tmp);
+
+	return s;
+}
+
+static __float128
+real_source_nrm2(struct real_source *src, bool reproducible)
+{
+	/*
+	 * doubleの二乗はbinary128の指数範囲に収まるため，
+	 * 入力が二倍精度ならばスケーリングなしの一巡で済む．
+	 */
+	__float128 ssq = real_source_reduce(src, src, 1, reproducible);
+
+	if (finiteq(ssq) && ssq >= FLT128_MIN)
+		return sqrtq(ssq);
+	else
+		return real_source_nrm2_rescale(src);
+}
+
+__float128
+l2norm_q(const __float128 *x, long n)
+{
+	__float128 scale = 0, ssq = 0;
+	bool nan_p = false;
+
+	for (long i = 0; i < n; i++)
+		ssq = fma_q(x[i], x[i], ssq);
+	if (finiteq(ssq) && ssq >= FLT128_MIN)
+		return sqrtq(ssq);
+
+	ssq = 0;
+	for (long i = 0; i < n; i++)
+	{
+		if (isinfq(x[i]))
+			return HUGE_VALQ;
+		else if (isnanq(x[i]))
+			nan_p = true;
+		else if (scale < fabsq(x[i]))
+			scale = fabsq(x[i]);
+	}
+	if (nan_p)
+		return nanq("");
+	if (scale == 0)
+		return 0;
+
+	for (long i = 0; i < n; i++)
+	{
+		__float128 t = x[i] / scale;
+		ssq = fma_q(t, t, ssq);
+	}
+	return scale * sqrtq(ssq);
+}
+
+static inline __float128
+num_abs_cf128(VALUE x)
+{
+	switch (convertion_num_types(x)) {
+	case NUM_COMPLEX:
+	case NUM_COMPLEX128:
+	case NUM_OTHERTYPE:
+		return cabsq(num_to_cc128(x));
+		break;
+	default:
+		return fabsq(num_to_cf128(x));
+		break;
+	}
+}
+
+bool
+opt_reproducible(VALUE opts)
+{
+	static ID kwds[1];
+	VALUE reproducible = Qundef;
+
+	if (!kwds[0])  kwds[0] = rb_intern_const("reproducible");
+	if (!NIL_P(opts))
+		rb_get_kwargs(opts, kwds, 0, 1, &reproducible);
+	return reproducible != Qundef && RTEST(reproducible);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.sum(xs, reproducible: false) -> Float128 | Complex128
+ *
+ *  Returns the sum of the sequence +xs+, which is an Array of numbers, a binary String of doubles (as made by <code>pack('d*')</code>) or a vector.
+ *  A complex Array or vector gives a Complex128, whose real and imaginary parts are summed separately.
+ *  By default the elements are summed in blocks of 1024 and the block sums are added pairwise in a fixed order,
+ *  so the answer does not depend on QuadMath.threads, but it does depend on the order of the elements.
+ *
+ *  With <code>reproducible: true</code> every element is added exactly to a binned fixed-point accumulator,
+ *  and the total is rounded to __float128 only once.
+ *  The answer is the correctly rounded sum, so it is bitwise the same for any order of the elements,
+ *  any number of threads and any machine.
+ *  The mode costs no more than the default, and is often faster, since it adds integers instead of soft floats.
+ *
+ *    QuadMath.sum([1, 2, 3]) # => 6.0
+ *    QuadMath.sum([1e40, 1.0, -1e40]) # => 0.0
+ *    QuadMath.sum([1e40, 1.0, -1e40], reproducible: true) # => 1.0
+ *    QuadMath.sum(QuadMath::Vector[1, Complex(0, 1)]) # => (1.0+1.0i)
+ */
+static VALUE
+quadmath_sum(int argc, VALUE *argv, VALUE unused_obj)
+{
+	VALUE xs, opts, v = Qnil;
+	struct real_source x;
+	bool reproducible;
+	__float128 s;
+
+	rb_scan_args(argc, argv, "1:", &xs, &opts);
+	reproducible = opt_reproducible(opts);
+
+	/* Arrayは一度ベクトルにして，GVLなしで読めるようにする */
+	if (RB_TYPE_P(xs, T_ARRAY))
+		xs = v = rb_qvector_from(xs);
+	if (qvector_p(xs) && GetQVector(xs)->type == VEC_COMPLEX128)
+	{
+		struct QVector *vec = GetQVector(xs);
+		__complex128 z;
+
+		x.type = SRC_VECTOR;
+		x.obj = xs;
+		x.len = vec->len;
+		x.f128 = (const __float128 *)vec->data.c128;
+		__real__ z = real_source_reduce(&x, NULL, 2, reproducible);
+		x.f128 = (const __float128 *)vec->data.c128 + 1;
+		__imag__ z = real_source_reduce(&x, NULL, 2, reproducible);
+		RB_GC_GUARD(xs);
+		return rb_complex128_cc128(z);
+	}
+	real_source_init(&x, xs);
+	s = real_source_reduce(&x, NULL, 1, reproducible);
+	RB_GC_GUARD(x.obj);
+	RB_GC_GUARD(v);
+
+	return rb_float128_cf128(s);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.dot(a, b, reproducible: false) -> Float128
+ *
+ *  Returns the dot product of the real sequences +a+ and +b+.
+ *  Each sequence is an Array of real numbers or a binary String of doubles (as made by <code>pack('d*')</code>).
+ *  Elements are read directly as __float128 and accumulated by fused multiply-adds, so no Float128 object is made per element.
+ *  The products are summed in blocks of 1024 and the block sums are added pairwise in a fixed order,
+ *  so vectors and binary Strings can be shared among QuadMath.threads native threads without the GVL and without changing the answer.
+ *  With <code>reproducible: true</code> each product is rounded once and the products are summed exactly as in QuadMath.sum,
+ *  so the answer does not depend on the order of the elements either.
+ *  If the lengths differ, an ArgumentError is raised.
+ *
+ *    QuadMath.dot([1.0, 2.0, 3.0], [4.0, 5.0, 6.0]) # => 32.0
+ *    QuadMath.dot([1e16, 1.0, -1e16], [1.0, 1.0, 1.0]) # => 1.0
+ *    QuadMath.dot([0.1].pack('d*'), [1]) # => 0.1000000000000000055511151231257827
+ */
+static VALUE
+quadmath_dot(int argc, VALUE *argv, VALUE unused_obj)
+{
+	VALUE a, b, opts;
+	struct real_source x, y;
+	__float128 s;
+
+	rb_scan_args(argc, argv, "2:", &a, &b, &opts);
+	real_source_init(&x, a);
+	real_source_init(&y, b);
+
+	if (x.len != y.len)
+		rb_raise(rb_eArgError,
+		  "length mismatch (%ld for %ld)", y.len, x.len);
+
+	s = real_source_reduce(&x, &y, 1, opt_reproducible(opts));
+	RB_GC_GUARD(x.obj);
+	RB_GC_GUARD(y.obj);
+
+	return rb_float128_cf128(s);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.norm2(a, reproducible: false) -> Float128
+ *
+ *  Returns the Euclidean norm of the real sequence +a+.
+ *  The sequence is the same as QuadMath.dot.
+ *  The squares are accumulated by fused multiply-adds and rescaled only when the plain sum overflows or underflows.
+ *  With <code>reproducible: true</code> the squares are summed exactly as in QuadMath.dot.
+ *
+ *    QuadMath.norm2([3.0, 4.0]) # => 5.0
+ *    QuadMath.norm2([1.0] * 2) # => 1.4142135623730950488016887242096981
+ *    QuadMath.norm2([Float128('1e-3000')] * 2) # => 1.414213562373095048801688724209694e-3000
+ */
+static VALUE
+quadmath_norm2(int argc, VALUE *argv, VALUE unused_obj)
+{
+	VALUE a, opts;
+	struct real_source x;
+	__float128 ans;
+
+	rb_scan_args(argc, argv, "1:", &a, &opts);
+	real_source_init(&x, a);
+	ans = real_source_nrm2(&x, opt_reproducible(opts));
+	RB_GC_GUARD(x.obj);
+
+	return rb_float128_cf128(ans);
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.hypot_n(*xs) -> Float128
+ *
+ *  Returns the square root of the sum of squares of the absolute values of +xs+.
+ *  This is a variadic version of QuadMath.hypot; complex numbers are taken by their absolute value as the L2 norm.
+ *  If any argument is infinite, the answer is Infinity even if another argument is NaN.
+ *
+ *    QuadMath.hypot_n(1, 2, 2) == 3 # => true
+ *    QuadMath.hypot_n(3+4i, 12) # => 13.0
+ *    QuadMath.hypot_n # => 0.0
+ */
+static VALUE
+quadmath_hypot_n(int argc, VALUE *argv, VALUE unused_obj)
+{
+	VALUE tmp;
+	__float128 *abs, ans;
+
+	abs = ALLOCV_N(__float128, tmp, argc);
+
+	for (int i = 0; i < argc; i++)
+		abs[i] = num_abs_cf128(argv[i]);
+
+	/* 二つならばcl2norm2q()に任せ，実数の引数ではQuadMath.hypotと同じ値にする */
+	if (argc == 2)
+		ans = cl2norm2q(abs[0], abs[1]);
+	else
+		ans = l2norm_q(abs, argc);
+
+	ALLOCV_END(tmp);
+
+	return rb_float128_cf128(ans);
+}
+
+void
+InitVM_Reduction(void)
+{
+	rb_define_module_function(rb_mQuadMath, "sum", quadmath_sum, -1);
+	rb_define_module_function(rb_mQuadMath, "dot", quadmath_dot, -1);
+	rb_define_module_function(rb_mQuadMath, "norm2", quadmath_norm2, -1);
+	rb_define_module_function(rb_mQuadMath, "hypot_n", quadmath_hypot_n, -1);
+}
@@ -0,0 +1,526 @@
+/*******************************************************************************
+    sparse.c -- QuadMath::SparseMatrix Class
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <quadmath.h>
+#include <stdint.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+/* 並列化するときの一区間の行数 */
+#define SPMV_GRAIN 256
+
+/*
+ * CSR形式の疎行列．行ポインタと列番号は，寸法と非零数が収まればint32_tで，そうでなければint64_tで持つ．
+ * transは転置のCSR(=元の行列のCSC)で，spmv_transposeの初回に作って使い回す．
+ */
+struct QSparse {
+	long rows;
+	long cols;
+	long nnz;
+	bool idx64;
+	void *rowptr;
+	void *colind;
+	__float128 *val;
+	struct QSparse *trans;
+};
+
+static void
+qsparse_free_data(struct QSparse *sp)
+{
+	if (sp == NULL)  return;
+	xfree(sp->rowptr);
+	xfree(sp->colind);
+	xfree(sp->val);
+	if (sp->trans != NULL)
+	{
+		qsparse_free_data(sp->trans);
+		xfree(sp->trans);
+	}
+}
+
+static void
+free_qsparse(void *v)
+{
+	struct QSparse *sp = v;
+	if (sp != NULL)
+	{
+		qsparse_free_data(sp);
+		xfree(sp);
+	}
+}
+
+static size_t
+qsparse_data_size(const struct QSparse *sp)
+{
+	size_t idx_size = sp->idx64 ? sizeof(int64_t) : sizeof(int32_t);
+	size_t size = idx_size * (sp->rows + 1 + sp->nnz) + sizeof(__float128) * sp->nnz;
+
+	if (sp->trans != NULL)
+		size += sizeof(struct QSparse) + qsparse_data_size(sp->trans);
+	return size;
+}
+
+static size_t
+memsize_qsparse(const void *v)
+{
+	const struct QSparse *sp = v;
+	return sizeof(struct QSparse) + (sp->val != NULL ? qsparse_data_size(sp) : 0);
+}
+
+static const rb_data_type_t qsparse_data_type = {
+	"quadmath_sparse_matrix",
+	{0, free_qsparse, memsize_qsparse,},
+	0, 0,
+	RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static VALUE
+qsparse_allocate(VALUE klass)
+{
+	struct QSparse *sp;
+	VALUE obj = TypedData_Make_Struct(klass, struct QSparse, &qsparse_data_type, sp);
+	sp->rows = sp->cols = sp->nnz = 0;
+	sp->idx64 = false;
+	sp->rowptr = sp->colind = NULL;
+	sp->val = NULL;
+	sp->trans = NULL;
+	return obj;
+}
+
+static struct QSparse *
+GetQSparse(VALUE self)
+{
+	struct QSparse *sp;
+
+	TypedData_Get_Struct(self, struct QSparse, &qsparse_data_type, sp);
+
+	if (sp->val == NULL)
+		rb_raise(rb_eRuntimeError, "uninitialized sparse matrix");
+
+	return sp;
+}
+
+static inline long
+idx_at(const void *p, bool idx64, long i)
+{
+	return idx64 ? (long)((const int64_t *)p)[i] : (long)((const int32_t *)p)[i];
+}
+
+static inline void
+idx_set(void *p, bool idx64, long i, long x)
+{
+	if (idx64)
+		((int64_t *)p)[i] = x;
+	else
+		((int32_t *)p)[i] = (int32_t)x;
+}
+
+static void
+qsparse_setup(struct QSparse *sp, long rows, long cols, long nnz)
+{
+	size_t idx_size;
+
+	sp->rows = rows;
+	sp->cols = cols;
+	sp->nnz = nnz;
+	sp->idx64 = rows > INT32_MAX || cols > INT32_MAX || nnz > INT32_MAX;
+	idx_size = sp->idx64 ? sizeof(int64_t) : sizeof(int32_t);
+	sp->rowptr = ruby_xcalloc(rows + 1, idx_size);
+	sp->colind = ruby_xcalloc(nnz ? nnz : 1, idx_size);
+	sp->val = ruby_xcalloc(nnz ? nnz : 1, sizeof(__float128));
+	sp->trans = NULL;
+}
+
+struct coo_entry {
+	long row;
+	long col;
+	long pos;
+	__float128 val;
+};
+
+/* 重複は入力の順に足すよう，元の位置で順序を確定させる */
+static int
+coo_cmp(const void *a, const void *b)
+{
+	const struct coo_entry *x = a, *y = b;
+
+	if (x->row != y->row)
+		return x->row < y->row ? -1 : 1;
+	if (x->col != y->col)
+		return x->col < y->col ? -1 : 1;
+	return x->pos < y->pos ? -1 : x->pos > y->pos;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::SparseMatrix.from_coo(rows, cols, row_indices, col_indices, values) -> QuadMath::SparseMatrix
+ *
+ *  Returns a +rows+ x +cols+ sparse matrix in compressed sparse row form built from COO triplets.
+ *  +row_indices+ and +col_indices+ are Arrays of Integers, and +values+ is any real sequence accepted by QuadMath.dot.
+ *  Duplicate entries are summed. The indices are stored as 32-bit integers when they fit, otherwise as 64-bit.
+ *  If an index is out of range, an IndexError is raised.
+ *
+ *    a = QuadMath::SparseMatrix.from_coo(2, 3, [0, 1, 1], [0, 0, 2], [1, 2, 3])
+ *    a.to_matrix # => QuadMath::Matrix[[1.0, 0.0, 0.0], [2.0, 0.0, 3.0]]
+ */
+static VALUE
+qsparse_s_from_coo(VALUE klass, VALUE vrows, VALUE vcols, VALUE ri, VALUE ci, VALUE vals)
+{
+	long rows = NUM2LONG(vrows), cols = NUM2LONG(vcols), n, nnz = 0;
+	struct real_source src;
+	struct coo_entry *ent;
+	struct QSparse *sp;
+	VALUE obj, tmp;
+
+	if (rows < 0 || cols < 0)
+		rb_raise(rb_eArgError, "negative matrix size");
+	ri = rb_convert_type(ri, T_ARRAY, "Array", "to_ary");
+	ci = rb_convert_type(ci, T_ARRAY, "Array", "to_ary");
+	real_source_init(&src, vals);
+	n = RARRAY_LEN(ri);
+	if (RARRAY_LEN(ci) != n || src.len != n)
+		rb_raise(rb_eArgError,
+		  "length mismatch (%ld, %ld and %ld)", n, RARRAY_LEN(ci), src.len);
+
+	ent = ALLOCV_N(struct coo_entry, tmp, n ? n : 1);
+	for (long k = 0; k < n; k++)
+	{
+		ent[k].row = NUM2LONG(RARRAY_AREF(ri, k));
+		ent[k].col = NUM2LONG(RARRAY_AREF(ci, k));
+		if (ent[k].row < 0 || ent[k].row >= rows || ent[k].col < 0 || ent[k].col >= cols)
+		{
+			ALLOCV_END(tmp);
+			rb_raise(rb_eIndexError, "index [%ld, %ld] out of matrix", ent[k].row, ent[k].col);
+		}
+		ent[k].pos = k;
+		ent[k].val = real_source_at(&src, k);
+	}
+	qsort(ent, n, sizeof(struct coo_entry), coo_cmp);
+
+	/* 重複を足し合わせて詰める */
+	for (long k = 0; k < n; k++)
+	{
+		if (nnz > 0 && ent[nnz - 1].row == ent[k].row && ent[nnz - 1].col == ent[k].col)
+			ent[nnz - 1].val += ent[k].val;
+		else
+			ent[nnz++] = ent[k];
+	}
+
+	obj = qsparse_allocate(klass);
+	TypedData_Get_Struct(obj, struct QSparse, &qsparse_data_type, sp);
+	qsparse_setup(sp, rows, cols, nnz);
+	for (long k = 0; k < nnz; k++)
+	{
+		idx_set(sp->rowptr, sp->idx64, ent[k].row + 1, idx_at(sp->rowptr, sp->idx64, ent[k].row + 1) + 1);
+		idx_set(sp->colind, sp->idx64, k, ent[k].col);
+		sp->val[k] = ent[k].val;
+	}
+	for (long i = 0; i < rows; i++)
+		idx_set(sp->rowptr, sp->idx64, i + 1,
+		  idx_at(sp->rowptr, sp->idx64, i) + idx_at(sp->rowptr, sp->idx64, i + 1));
+	ALLOCV_END(tmp);
+	RB_GC_GUARD(vals);
+	RB_GC_GUARD(src.obj);
+
+	return obj;
+}
+
+/* :nodoc: */
+static VALUE
+qsparse_initialize_copy(VALUE self, VALUE other)
+{
+	struct QSparse *dst, *src;
+	size_t idx_size;
+
+	if (self == other)  return self;
+
+	TypedData_Get_Struct(self, struct QSparse, &qsparse_data_type, dst);
+	src = GetQSparse(other);
+	if (dst->val != NULL)
+		rb_raise(rb_eRuntimeError, "sparse matrix already initialized");
+
+	qsparse_setup(dst, src->rows, src->cols, src->nnz);
+	idx_size = dst->idx64 ? sizeof(int64_t) : sizeof(int32_t);
+	memcpy(dst->rowptr, src->rowptr, idx_size * (src->rows + 1));
+	memcpy(dst->colind, src->colind, idx_size * src->nnz);
+	memcpy(dst->val, src->val, sizeof(__float128) * src->nnz);
+
+	return self;
+}
+
+/* 転置のCSRを作る．列ごとの計数ソートなので，各行の列番号は昇順に並ぶ */
+static struct QSparse *
+qsparse_transpose(const struct QSparse *sp)
+{
+	struct QSparse *tr = ZALLOC(struct QSparse);
+	long *next = ALLOC_N(long, sp->cols + 1);
+
+	qsparse_setup(tr, sp->cols, sp->rows, sp->nnz);
+	for (long i = 0; i <= sp->cols; i++)
+		next[i] = 0;
+	for (long k = 0; k < sp->nnz; k++)
+		next[idx_at(sp->colind, sp->idx64, k) + 1]++;
+	for (long i = 0; i < sp->cols; i++)
+		next[i + 1] += next[i];
+	for (long i = 0; i <= sp->cols; i++)
+		idx_set(tr->rowptr, tr->idx64, i, next[i]);
+	for (long i = 0; i < sp->rows; i++)
+	{
+		long k0 = idx_at(sp->rowptr, sp->idx64, i), k1 = idx_at(sp->rowptr, sp->idx64, i + 1);
+		for (long k = k0; k < k1; k++)
+		{
+			long pos = next[idx_at(sp->colind, sp->idx64, k)]++;
+			idx_set(tr->colind, tr->idx64, pos, i);
+			tr->val[pos] = sp->val[k];
+		}
+	}
+	xfree(next);
+
+	return tr;
+}
+
+struct spmv_args {
+	const struct QSparse *sp;
+	const __float128 *x;
+	__float128 *y;
+	int nthreads;
+	long row;
+};
+
+static void
+spmv_rows(void *ptr, long i0, long i1)
+{
+	const struct spmv_args *args = ptr;
+	const struct QSparse *sp = args->sp;
+	const __float128 *x = args->x, *val = sp->val;
+	__float128 *y = args->y;
+
+	if (sp->idx64)
+	{
+		const int64_t *rowptr = sp->rowptr, *colind = sp->colind;
+		for (long i = i0; i < i1; i++)
+		{
+			__float128 s = 0;
+			for (int64_t k = rowptr[i]; k < rowptr[i + 1]; k++)
+				s += val[k] * x[colind[k]];
+			y[i] = s;
+		}
+	}
+	else
+	{
+		const int32_t *rowptr = sp->rowptr, *colind = sp->colind;
+		for (long i = i0; i < i1; i++)
+		{
+			__float128 s = 0;
+			for (int32_t k = rowptr[i]; k < rowptr[i + 1]; k++)
+				s += val[k] * x[colind[k]];
+			y[i] = s;
+		}
+	}
+}
+
+static void *
+spmv_nogvl(void *ptr)
+{
+	struct spmv_args *args = ptr;
+
+	if (!quadmath_parallel_for_at(&args->row, args->sp->rows, SPMV_GRAIN, args->nthreads, spmv_rows, args))
+		return QUADMATH_INTERRUPTED;
+
+	return NULL;
+}
+
+static VALUE
+qsparse_spmv_run(const struct QSparse *sp, VALUE x, int nthreads)
+{
+	struct QVector *vx;
+	struct spmv_args args;
+	VALUE y;
+
+	x = rb_qvector_from(x);
+	vx = GetQVector(x);
+	if (vx->type != VEC_FLOAT128)
+		rb_raise(rb_eTypeError, "not a real vector");
+	if (vx->len != sp->cols)
+		rb_raise(rb_eArgError, "size mismatch (%ld for %ld)", vx->len, sp->cols);
+
+	y = rb_qvector_new(VEC_FLOAT128, sp->rows);
+	args.sp = sp;
+	args.x = vx->data.f128;
+	args.y = GetQVector(y)->data.f128;
+	/* GVLを保持したまま複数スレッドに分けても得るものは少ないので，解放するときだけ並列にする */
+	args.nthreads = sp->nnz + sp->rows >= NOGVL_THRESHOLD ? nthreads : 1;
+	args.row = 0;
+	quadmath_call_nogvl(spmv_nogvl, &args, sp->nnz + sp->rows);
+	RB_GC_GUARD(x);
+
+	return y;
+}
+
+/*
+ *  call-seq:
+ *    spmv(x, threads: QuadMath.threads) -> QuadMath::Vector
+ *
+ *  Returns the product of +self+ and the real vector +x+ (or an Array).
+ *  Each row is accumulated in __float128 independently, so the answer does not depend on +threads+.
+ *  When the matrix is large enough to release the GVL, rows are partitioned among +threads+ native threads.
+ *
+ *    a = QuadMath::SparseMatrix.from_coo(2, 3, [0, 1, 1], [0, 0, 2], [1, 2, 3])
+ *    a.spmv([1, 1, 1]) # => QuadMath::Vector[1.0, 5.0]
+ */
+static VALUE
+qsparse_spmv(int argc, VALUE *argv, VALUE self)
+{
+	VALUE x, opts;
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+
+	return qsparse_spmv_run(GetQSparse(self), x, quadmath_opt_threads(opts));
+}
+
+/*
+ *  call-seq:
+ *    spmv_transpose(x, threads: QuadMath.threads) -> QuadMath::Vector
+ *
+ *  Returns the product of the transpose of +self+ and the real vector +x+.
+ *  The transposed structure is built on the first call and kept, so that the product is row-parallel like #spmv.
+ *
+ *    a = QuadMath::SparseMatrix.from_coo(2, 3, [0, 1, 1], [0, 0, 2], [1, 2, 3])
+ *    a.spmv_transpose([1, 1]) # => QuadMath::Vector[3.0, 0.0, 3.0]
+ */
+static VALUE
+qsparse_spmv_transpose(int argc, VALUE *argv, VALUE self)
+{
+	VALUE x, opts;
+	struct QSparse *sp = GetQSparse(self);
+
+	rb_scan_args(argc, argv, "1:", &x, &opts);
+	if (sp->trans == NULL)
+		sp->trans = qsparse_transpose(sp);
+
+	return qsparse_spmv_run(sp->trans, x, quadmath_opt_threads(opts));
+}
+
+/*
+ *  call-seq:
+ *    row_count -> Integer
+ *
+ *  Returns the number of rows.
+ */
+static VALUE
+qsparse_row_count(VALUE self)
+{
+	return LONG2NUM(GetQSparse(self)->rows);
+}
+
+/*
+ *  call-seq:
+ *    column_count -> Integer
+ *
+ *  Returns the number of columns.
+ */
+static VALUE
+qsparse_column_count(VALUE self)
+{
+	return LONG2NUM(GetQSparse(self)->cols);
+}
+
+/*
+ *  call-seq:
+ *    shape -> [Integer, Integer]
+ *
+ *  Returns the pair of the number of rows and columns.
+ */
+static VALUE
+qsparse_shape(VALUE self)
+{
+	struct QSparse *sp = GetQSparse(self);
+
+	return rb_assoc_new(LONG2NUM(sp->rows), LONG2NUM(sp->cols));
+}
+
+/*
+ *  call-seq:
+ *    nnz -> Integer
+ *
+ *  Returns the number of stored entries.
+ */
+static VALUE
+qsparse_nnz(VALUE self)
+{
+	return LONG2NUM(GetQSparse(self)->nnz);
+}
+
+/*
+ *  call-seq:
+ *    index_bits -> 32 | 64
+ *
+ *  Returns the width of the stored row pointers and column indices.
+ */
+static VALUE
+qsparse_index_bits(VALUE self)
+{
+	return INT2FIX(GetQSparse(self)->idx64 ? 64 : 32);
+}
+
+/*
+ *  call-seq:
+ *    to_matrix -> QuadMath::Matrix
+ *
+ *  Returns the dense matrix.
+ */
+static VALUE
+qsparse_to_matrix(VALUE self)
+{
+	struct QSparse *sp = GetQSparse(self);
+	VALUE obj = rb_qmatrix_new(VEC_FLOAT128, sp->rows, sp->cols);
+	struct QMatrix *mat = GetQMatrix(obj);
+
+	for (long i = 0; i < sp->rows; i++)
+	{
+		long k0 = idx_at(sp->rowptr, sp->idx64, i), k1 = idx_at(sp->rowptr, sp->idx64, i + 1);
+		for (long k = k0; k < k1; k++)
+			mat->data.f128[i * sp->cols + idx_at(sp->colind, sp->idx64, k)] = sp->val[k];
+	}
+	return obj;
+}
+
+/*
+ *  call-seq:
+ *    inspect -> String
+ *
+ *  Returns the shape and the number of entries.
+ */
+static VALUE
+qsparse_inspect(VALUE self)
+{
+	struct QSparse *sp = GetQSparse(self);
+
+	return rb_sprintf("#<%"PRIsVALUE" %ldx%ld nnz=%ld>",
+	  rb_obj_class(self), sp->rows, sp->cols, sp->nnz);
+}
+
+void
+InitVM_Sparse(void)
+{
+	rb_define_alloc_func(rb_cQuadSparseMatrix, qsparse_allocate);
+	rb_undef_method(CLASS_OF(rb_cQuadSparseMatrix), "new");
+	rb_define_singleton_method(rb_cQuadSparseMatrix, "from_coo", qsparse_s_from_coo, 5);
+	rb_define_method(rb_cQuadSparseMatrix, "initialize_copy", qsparse_initialize_copy, 1);
+
+	rb_define_method(rb_cQuadSparseMatrix, "row_count", qsparse_row_count, 0);
+	rb_define_method(rb_cQuadSparseMatrix, "column_count", qsparse_column_count, 0);
+	rb_define_method(rb_cQuadSparseMatrix, "shape", qsparse_shape, 0);
+	rb_define_method(rb_cQuadSparseMatrix, "nnz", qsparse_nnz, 0);
+	rb_define_method(rb_cQuadSparseMatrix, "index_bits", qsparse_index_bits, 0);
+	rb_define_method(rb_cQuadSparseMatrix, "to_matrix", qsparse_to_matrix, 0);
+	rb_define_method(rb_cQuadSparseMatrix, "inspect", qsparse_inspect, 0);
+	rb_define_alias(rb_cQuadSparseMatrix, "to_s", "inspect");
+
+	rb_define_method(rb_cQuadSparseMatrix, "spmv", qsparse_spmv, -1);
+	rb_define_method(rb_cQuadSparseMatrix, "spmv_transpose", qsparse_spmv_transpose, -1);
+	rb_define_alias(rb_cQuadSparseMatrix, "*", "spmv");
+}
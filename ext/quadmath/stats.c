@@ -0,0 +1,455 @@
+/*******************************************************************************
+    stats.c -- QuadMath::Stats Class
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <quadmath.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+/*
+ * 中心化モーメントの累積値．
+ * バッチごとに二巡法で局所モーメントを求め，Chan/Pébayの式で併合する．
+ * 要素ごとに除算するWelford法より速く，桁落ちにも強い．
+ */
+struct moments {
+	__float128 n;
+	__float128 mean;
+	__float128 m2;
+	__float128 m3;
+	__float128 m4;
+};
+
+struct QStats {
+	bool paired_p;
+	struct moments x;
+	struct moments y;
+	__float128 cxy;
+};
+
+static size_t
+memsize_stats(const void *_)
+{
+	return sizeof(struct QStats);
+}
+
+static const rb_data_type_t stats_data_type = {
+	"quadmath_stats",
+	{0, RUBY_TYPED_DEFAULT_FREE, memsize_stats,},
+	0, 0,
+	RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static VALUE
+stats_allocate(VALUE klass)
+{
+	struct QStats *st;
+	VALUE obj = TypedData_Make_Struct(klass, struct QStats, &stats_data_type, st);
+	memset(st, 0, sizeof(struct QStats));
+	return obj;
+}
+
+static struct QStats *
+GetStats(VALUE self)
+{
+	struct QStats *st;
+
+	TypedData_Get_Struct(self, struct QStats, &stats_data_type, st);
+
+	return st;
+}
+
+static void
+moments_local(const struct real_source *src, struct moments *b)
+{
+	__float128 sum = 0, comp = 0, c = 0;
+	long n = src->len;
+
+	b->n = n;
+	b->mean = b->m2 = b->m3 = b->m4 = 0;
+	if (n == 0)  return;
+
+	/* Neumaierの補正付き総和 */
+	for (long i = 0; i < n; i++)
+	{
+		__float128 x = real_source_at(src, i), t = sum + x;
+		if (fabsq(sum) >= fabsq(x))
+			comp += (sum - t) + x;
+		else
+			comp += (x - t) + sum;
+		sum = t;
+	}
+	b->mean = (sum + comp) / n;
+
+	for (long i = 0; i < n; i++)
+	{
+		__float128 d = real_source_at(src, i) - b->mean, d2 = d * d;
+		c += d;
+		b->m2 = fma_q(d, d, b->m2);
+		b->m3 = fma_q(d2, d, b->m3);
+		b->m4 = fma_q(d2, d2, b->m4);
+	}
+	/* 二巡法の補正項: 平均の丸め誤差による偏りを打ち消す */
+	b->m2 -= c * c / n;
+}
+
+static void
+moments_merge(struct moments *a, const struct moments *b)
+{
+	__float128 na = a->n, nb = b->n, n = na + nb, d, d2, dn;
+
+	if (nb == 0)  return;
+	if (na == 0)  { *a = *b;  return; }
+
+	d = b->mean - a->mean;
+	dn = d / n;
+	d2 = d * d;
+
+	a->m4 += b->m4 + d2 * d2 * na * nb * (na * na - na * nb + nb * nb) / (n * n * n)
+	       + 6 * dn * dn * (na * na * b->m2 + nb * nb * a->m2)
+	       + 4 * dn * (na * b->m3 - nb * a->m3);
+	a->m3 += b->m3 + d2 * d * na * nb * (na - nb) / (n * n)
+	       + 3 * dn * (na * b->m2 - nb * a->m2);
+	a->m2 += b->m2 + d2 * na * nb / n;
+	a->mean += dn * nb;
+	a->n = n;
+}
+
+static __float128
+comoment_local(const struct real_source *xs, const struct real_source *ys,
+               __float128 mx, __float128 my)
+{
+	__float128 c = 0;
+
+	for (long i = 0; i < xs->len; i++)
+		c = fma_q(real_source_at(xs, i) - mx, real_source_at(ys, i) - my, c);
+
+	return c;
+}
+
+static void
+stats_push_sources(struct QStats *st, const struct real_source *xs, const struct real_source *ys)
+{
+	struct moments bx, by;
+	__float128 n0 = st->x.n, n;
+
+	moments_local(xs, &bx);
+	if (ys == NULL)
+	{
+		moments_merge(&st->x, &bx);
+		return;
+	}
+	moments_local(ys, &by);
+
+	n = n0 + bx.n;
+	if (n0 == 0)
+		st->cxy = comoment_local(xs, ys, bx.mean, by.mean);
+	else if (bx.n != 0)
+		st->cxy += comoment_local(xs, ys, bx.mean, by.mean)
+		         + (bx.mean - st->x.mean) * (by.mean - st->y.mean) * n0 * bx.n / n;
+
+	moments_merge(&st->x, &bx);
+	moments_merge(&st->y, &by);
+}
+
+static void
+stats_source_init(struct real_source *src, VALUE obj, VALUE *tmp)
+{
+	if (rb_obj_is_kind_of(obj, rb_cNumeric))
+	{
+		*tmp = rb_ary_new_from_args(1, obj);
+		obj = *tmp;
+	}
+	real_source_init(src, obj);
+}
+
+/*
+ *  call-seq:
+ *    push(xs) -> self
+ *    push(xs, ys) -> self
+ *    self << xs -> self
+ *
+ *  Ingests a batch +xs+ into the accumulators.
+ *  A batch is an Array of reals, a binary String of doubles (as made by <code>pack('d*')</code>), a real QuadMath::Vector or a single real.
+ *  Elements are read directly as __float128, so no Float128 object is made per element.
+ *
+ *  Giving a second batch +ys+ of the same length makes +self+ paired, and #covariance and #correlation become available.
+ *  Once paired, every batch must be given with its pair.
+ *
+ *    st = QuadMath::Stats.new
+ *    st << [1.0, 2.0, 3.0] << [4.0].pack('d*')
+ *    st.mean # => 2.5
+ */
+static VALUE
+stats_push(int argc, VALUE *argv, VALUE self)
+{
+	struct QStats *st = GetStats(self);
+	struct real_source xs, ys;
+	VALUE x, y, tmp_x = Qnil, tmp_y = Qnil;
+
+	rb_scan_args(argc, argv, "11", &x, &y);
+	rb_check_frozen(self);
+
+	stats_source_init(&xs, x, &tmp_x);
+	if (NIL_P(y))
+	{
+		if (st->paired_p)
+			rb_raise(rb_eArgError, "paired stats needs a pair of batches");
+		stats_push_sources(st, &xs, NULL);
+	}
+	else
+	{
+		if (!st->paired_p && st->x.n != 0)
+			rb_raise(rb_eArgError, "unpaired stats can't take a pair of batches");
+		stats_source_init(&ys, y, &tmp_y);
+		if (xs.len != ys.len)
+			rb_raise(rb_eArgError,
+			  "length mismatch (%ld for %ld)", ys.len, xs.len);
+		st->paired_p = true;
+		stats_push_sources(st, &xs, &ys);
+	}
+	RB_GC_GUARD(tmp_x);
+	RB_GC_GUARD(tmp_y);
+
+	return self;
+}
+
+static VALUE
+stats_lshift(VALUE self, VALUE xs)
+{
+	return stats_push(1, &xs, self);
+}
+
+/*
+ *  call-seq:
+ *    merge(other) -> self
+ *
+ *  Merges the accumulators of +other+ into +self+, as if the batches of +other+ had been pushed to +self+.
+ *  This is useful to combine the statistics computed by each worker.
+ */
+static VALUE
+stats_merge(VALUE self, VALUE other)
+{
+	struct QStats *st = GetStats(self), *ot = GetStats(other);
+	__float128 n0 = st->x.n, n1 = ot->x.n;
+
+	rb_check_frozen(self);
+
+	if (n1 == 0)  return self;
+	/* 空ならば，push([], [])で対になっていても相手の状態を引き継ぐ */
+	if (n0 == 0)
+		st->paired_p = ot->paired_p;
+	else if (st->paired_p != ot->paired_p)
+		rb_raise(rb_eArgError, "can't merge paired and unpaired stats");
+
+	if (ot->paired_p)
+	{
+		if (n0 == 0)
+			st->cxy = ot->cxy;
+		else
+			st->cxy += ot->cxy
+			         + (ot->x.mean - st->x.mean) * (ot->y.mean - st->y.mean) * n0 * n1 / (n0 + n1);
+		moments_merge(&st->y, &ot->y);
+	}
+	moments_merge(&st->x, &ot->x);
+
+	return self;
+}
+
+/*
+ *  call-seq:
+ *    count -> Integer
+ *
+ *  Returns the number of ingested elements.
+ */
+static VALUE
+stats_count(VALUE self)
+{
+	struct QStats *st = GetStats(self);
+
+	return LL2NUM((long long)st->x.n);
+}
+
+static inline __float128
+stats_variance_cf128(const struct moments *m, bool population_p)
+{
+	__float128 dof = population_p ? m->n : m->n - 1;
+
+	if (dof <= 0)
+		return nanq("");
+
+	return m->m2 / dof;
+}
+
+static bool
+population_opt_p(int argc, VALUE *argv)
+{
+	static ID kwds[1];
+	VALUE opts, population = Qfalse;
+
+	if (!kwds[0])  kwds[0] = rb_intern_const("population");
+
+	rb_scan_args(argc, argv, "0:", &opts);
+	if (!NIL_P(opts))
+	{
+		rb_get_kwargs(opts, kwds, 0, 1, &population);
+		if (population == Qundef)  population = Qfalse;
+	}
+	return RTEST(population);
+}
+
+/*
+ *  call-seq:
+ *    mean -> Float128
+ *
+ *  Returns the arithmetic mean. If nothing is ingested, returns NaN.
+ *
+ *    QuadMath::Stats.new.push([1e16, 1.0, -1e16]).mean # => 0.333333333333333333333333333333333
+ */
+static VALUE
+stats_mean(VALUE self)
+{
+	struct QStats *st = GetStats(self);
+
+	if (st->x.n == 0)
+		return rb_float128_cf128(nanq(""));
+
+	return rb_float128_cf128(st->x.mean);
+}
+
+/*
+ *  call-seq:
+ *    variance(population: false) -> Float128
+ *
+ *  Returns the unbiased sample variance, or the population variance if +population+ is true.
+ *  If there are too few elements, returns NaN.
+ *
+ *    st = QuadMath::Stats.new.push([1e9 + 4, 1e9 + 7, 1e9 + 13, 1e9 + 16])
+ *    st.variance # => 30.0
+ *    st.variance(population: true) # => 22.5
+ */
+static VALUE
+stats_variance(int argc, VALUE *argv, VALUE self)
+{
+	struct QStats *st = GetStats(self);
+	bool population_p = population_opt_p(argc, argv);
+
+	return rb_float128_cf128(stats_variance_cf128(&st->x, population_p));
+}
+
+/*
+ *  call-seq:
+ *    stddev(population: false) -> Float128
+ *
+ *  Returns the square root of #variance.
+ */
+static VALUE
+stats_stddev(int argc, VALUE *argv, VALUE self)
+{
+	struct QStats *st = GetStats(self);
+	bool population_p = population_opt_p(argc, argv);
+
+	return rb_float128_cf128(sqrtq(stats_variance_cf128(&st->x, population_p)));
+}
+
+/*
+ *  call-seq:
+ *    skewness -> Float128
+ *
+ *  Returns the population skewness g1 = sqrt(n) * M3 / M2**1.5.
+ *
+ *    QuadMath::Stats.new.push([1, 2, 3, 10]).skewness # => 1.0182337649086284351372158814309826
+ */
+static VALUE
+stats_skewness(VALUE self)
+{
+	struct QStats *st = GetStats(self);
+	const struct moments *m = &st->x;
+
+	if (m->n == 0 || m->m2 == 0)
+		return rb_float128_cf128(nanq(""));
+
+	return rb_float128_cf128(sqrtq(m->n) * m->m3 / (m->m2 * sqrtq(m->m2)));
+}
+
+/*
+ *  call-seq:
+ *    kurtosis -> Float128
+ *
+ *  Returns the population excess kurtosis g2 = n * M4 / M2**2 - 3.
+ */
+static VALUE
+stats_kurtosis(VALUE self)
+{
+	struct QStats *st = GetStats(self);
+	const struct moments *m = &st->x;
+
+	if (m->n == 0 || m->m2 == 0)
+		return rb_float128_cf128(nanq(""));
+
+	return rb_float128_cf128(m->n * m->m4 / (m->m2 * m->m2) - 3);
+}
+
+/*
+ *  call-seq:
+ *    covariance(population: false) -> Float128
+ *
+ *  Returns the unbiased sample covariance of the paired batches, or the population covariance if +population+ is true.
+ *  If +self+ is not paired, a RuntimeError is raised.
+ *
+ *    QuadMath::Stats.new.push([1, 2, 3], [2, 4, 6]).covariance # => 2.0
+ */
+static VALUE
+stats_covariance(int argc, VALUE *argv, VALUE self)
+{
+	struct QStats *st = GetStats(self);
+	bool population_p = population_opt_p(argc, argv);
+	__float128 dof;
+
+	if (!st->paired_p)
+		rb_raise(rb_eRuntimeError, "covariance needs paired batches");
+
+	dof = population_p ? st->x.n : st->x.n - 1;
+	if (dof <= 0)
+		return rb_float128_cf128(nanq(""));
+
+	return rb_float128_cf128(st->cxy / dof);
+}
+
+/*
+ *  call-seq:
+ *    correlation -> Float128
+ *
+ *  Returns Pearson's correlation coefficient of the paired batches.
+ *  If +self+ is not paired, a RuntimeError is raised.
+ */
+static VALUE
+stats_correlation(VALUE self)
+{
+	struct QStats *st = GetStats(self);
+
+	if (!st->paired_p)
+		rb_raise(rb_eRuntimeError, "correlation needs paired batches");
+
+	return rb_float128_cf128(st->cxy / sqrtq(st->x.m2 * st->y.m2));
+}
+
+void
+InitVM_Stats(void)
+{
+	rb_define_alloc_func(rb_cQuadStats, stats_allocate);
+
+	rb_define_method(rb_cQuadStats, "push", stats_push, -1);
+	rb_define_method(rb_cQuadStats, "<<", stats_lshift, 1);
+	rb_define_method(rb_cQuadStats, "merge", stats_merge, 1);
+
+	rb_define_method(rb_cQuadStats, "count", stats_count, 0);
+	rb_define_method(rb_cQuadStats, "mean", stats_mean, 0);
+	rb_define_method(rb_cQuadStats, "variance", stats_variance, -1);
+	rb_define_method(rb_cQuadStats, "stddev", stats_stddev, -1);
+	rb_define_method(rb_cQuadStats, "skewness", stats_skewness, 0);
+	rb_define_method(rb_cQuadStats, "kurtosis", stats_kurtosis, 0);
+	rb_define_method(rb_cQuadStats, "covariance", stats_covariance, -1);
+	rb_define_method(rb_cQuadStats, "correlation", stats_correlation, 0);
+}
@@ -0,0 +1,799 @@
+/*******************************************************************************
+    vector.c -- QuadMath::Vector Class
+
+    Author: Hironobu Inatsuka
+*******************************************************************************/
+#include <ruby.h>
+#include <quadmath.h>
+#include "rb_quadmath.h"
+#include "internal/rb_quadmath.h"
+
+static void
+free_qvector(void *v)
+{
+	struct QVector *vec = v;
+	if (vec != NULL)
+	{
+		xfree(vec->data.ptr);
+		xfree(vec);
+	}
+}
+
+static size_t
+memsize_qvector(const void *v)
+{
+	const struct QVector *vec = v;
+	size_t elem_size = vec->type == VEC_FLOAT128 ?
+		sizeof(__float128) : sizeof(__complex128);
+	return sizeof(struct QVector) + elem_size * vec->len;
+}
+
+static const rb_data_type_t qvector_data_type = {
+	"quadmath_vector",
+	{0, free_qvector, memsize_qvector,},
+	0, 0,
+	RUBY_TYPED_FREE_IMMEDIATELY,
+};
+
+static void
+qvector_setup(struct QVector *vec, enum VECTOR_ELEM_TYPES type, long len)
+{
+	if (len < 0)
+		rb_raise(rb_eArgError, "negative vector size");
+	vec->type = type;
+	vec->len = len;
+	if (type == VEC_FLOAT128)
+		vec->data.f128 = ruby_xcalloc(len ? len : 1, sizeof(__float128));
+	else
+		vec->data.c128 = ruby_xcalloc(len ? len : 1, sizeof(__complex128));
+}
+
+static VALUE
+qvector_allocate(VALUE klass)
+{
+	struct QVector *vec;
+	VALUE obj = TypedData_Make_Struct(klass, struct QVector, &qvector_data_type, vec);
+	vec->type = VEC_FLOAT128;
+	vec->len = 0;
+	vec->data.ptr = NULL;
+	return obj;
+}
+
+VALUE
+rb_qvector_new(enum VECTOR_ELEM_TYPES type, long len)
+{
+	struct QVector *vec;
+	VALUE obj = qvector_allocate(rb_cQuadVector);
+	TypedData_Get_Struct(obj, struct QVector, &qvector_data_type, vec);
+	qvector_setup(vec, type, len);
+	return obj;
+}
+
+struct QVector *
+GetQVector(VALUE self)
+{
+	struct QVector *vec;
+
+	TypedData_Get_Struct(self, struct QVector, &qvector_data_type, vec);
+
+	if (vec->data.ptr == NULL)
+		rb_raise(rb_eRuntimeError, "uninitialized vector");
+
+	return vec;
+}
+
+bool
+qvector_p(VALUE obj)
+{
+	return rb_typeddata_is_kind_of(obj, &qvector_data_type);
+}
+
+static inline bool
+num_nucomp_p(VALUE x)
+{
+	switch (convertion_num_types(x)) {
+	case NUM_COMPLEX:
+	case NUM_COMPLEX128:
+		return true;
+		break;
+	case NUM_OTHERTYPE:
+		return !RTEST(rb_funcall(x, rb_intern("real?"), 0));
+		break;
+	default:
+		return false;
+		break;
+	}
+}
+
+static inline void
+qvector_store(struct QVector *vec, long i, VALUE x)
+{
+	if (vec->type == VEC_FLOAT128)
+		vec->data.f128[i] = num_to_cf128(x);
+	else
+		vec->data.c128[i] = num_to_cc128(x);
+}
+
+static inline VALUE
+qvector_fetch(const struct QVector *vec, long i)
+{
+	if (vec->type == VEC_FLOAT128)
+		return rb_float128_cf128(vec->data.f128[i]);
+	else
+		return rb_complex128_cc128(vec->data.c128[i]);
+}
+
+static VALUE
+qvector_from_array(VALUE ary)
+{
+	long len = RARRAY_LEN(ary);
+	enum VECTOR_ELEM_TYPES type = VEC_FLOAT128;
+	VALUE obj;
+	struct QVector *vec;
+
+	for (long i = 0; i < len; i++)
+	{
+		if (num_nucomp_p(RARRAY_AREF(ary, i)))
+		{
+			type = VEC_COMPLEX128;
+			break;
+		}
+	}
+	obj = rb_qvector_new(type, len);
+	vec = GetQVector(obj);
+	for (long i = 0; i < len && i < RARRAY_LEN(ary); i++)
+		qvector_store(vec, i, RARRAY_AREF(ary, i));
+
+	return obj;
+}
+
+VALUE
+rb_qvector_from(VALUE obj)
+{
+	VALUE retval;
+	struct real_source src;
+	struct QVector *vec;
+
+	if (qvector_p(obj))
+		return obj;
+	else if (RB_TYPE_P(obj, T_ARRAY))
+		return qvector_from_array(obj);
+
+	real_source_init(&src, obj);
+	retval = rb_qvector_new(VEC_FLOAT128, src.len);
+	vec = GetQVector(retval);
+	for (long i = 0; i < src.len; i++)
+		vec->data.f128[i] = real_source_at(&src, i);
+	RB_GC_GUARD(src.obj);
+
+	return retval;
+}
+
+/* 実数ベクトルを複素数ベクトルに昇格する．すでに複素数ならばそのまま返す */
+VALUE
+rb_qvector_to_complex(VALUE obj)
+{
+	struct QVector *src = GetQVector(obj), *dst;
+	VALUE retval;
+
+	if (src->type == VEC_COMPLEX128)
+		return obj;
+
+	retval = rb_qvector_new(VEC_COMPLEX128, src->len);
+	dst = GetQVector(retval);
+	for (long i = 0; i < src->len; i++)
+		dst->data.c128[i] = src->data.f128[i];
+
+	return retval;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::Vector.new(size, complex: false) -> QuadMath::Vector
+ *
+ *  Returns a zero-filled vector of +size+ elements.
+ *  The elements are packed as __float128, or as __complex128 if +complex+ is true.
+ *
+ *    QuadMath::Vector.new(3) # => QuadMath::Vector[0.0, 0.0, 0.0]
+ *    QuadMath::Vector.new(1, complex: true) # => QuadMath::Vector[(0.0+0.0i)]
+ */
+static VALUE
+qvector_initialize(int argc, VALUE *argv, VALUE self)
+{
+	static ID kwds[1];
+	VALUE size, opts, complex_p = Qfalse;
+	struct QVector *vec;
+
+	if (!kwds[0])  kwds[0] = rb_intern_const("complex");
+
+	rb_scan_args(argc, argv, "1:", &size, &opts);
+	if (!NIL_P(opts))
+	{
+		rb_get_kwargs(opts, kwds, 0, 1, &complex_p);
+		if (complex_p == Qundef)  complex_p = Qfalse;
+	}
+
+	TypedData_Get_Struct(self, struct QVector, &qvector_data_type, vec);
+	if (vec->data.ptr != NULL)
+		rb_raise(rb_eRuntimeError, "vector already initialized");
+
+	qvector_setup(vec, RTEST(complex_p) ? VEC_COMPLEX128 : VEC_FLOAT128, NUM2LONG(size));
+
+	return self;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::Vector[*xs] -> QuadMath::Vector
+ *
+ *  Returns a vector of +xs+.
+ *  If any element is a complex number, the vector holds Complex128 elements.
+ *
+ *    QuadMath::Vector[1, 1/3r, 0.5] # => QuadMath::Vector[1.0, 0.333333333333333333333333333333333, 0.5]
+ *    QuadMath::Vector[1, 1i] # => QuadMath::Vector[(1.0+0.0i), (0.0+1.0i)]
+ */
+static VALUE
+qvector_s_aref(int argc, VALUE *argv, VALUE klass)
+{
+	return qvector_from_array(rb_ary_new_from_values(argc, argv));
+}
+
+/*
+ *  call-seq:
+ *    QuadMath::Vector.from(obj) -> QuadMath::Vector
+ *
+ *  Converts +obj+ into a vector.
+ *  +obj+ is an Array of numerics, a binary String of doubles (as made by <code>pack('d*')</code>) or a vector, which is copied.
+ *
+ *    QuadMath::Vector.from([1, 2]) # => QuadMath::Vector[1.0, 2.0]
+ *    QuadMath::Vector.from([0.5].pack('d*')) # => QuadMath::Vector[0.5]
+ */
+static VALUE
+qvector_s_from(VALUE klass, VALUE obj)
+{
+	if (qvector_p(obj))
+		return rb_obj_dup(obj);
+	else
+		return rb_qvector_from(obj);
+}
+
+/* :nodoc: */
+static VALUE
+qvector_initialize_copy(VALUE self, VALUE other)
+{
+	struct QVector *dst, *src;
+	size_t elem_size;
+
+	if (self == other)  return self;
+
+	TypedData_Get_Struct(self, struct QVector, &qvector_data_type, dst);
+	src = GetQVector(other);
+
+	if (dst->data.ptr != NULL)
+		rb_raise(rb_eRuntimeError, "vector already initialized");
+
+	qvector_setup(dst, src->type, src->len);
+	elem_size = src->type == VEC_FLOAT128 ?
+		sizeof(__float128) : sizeof(__complex128);
+	memcpy(dst->data.ptr, src->data.ptr, elem_size * src->len);
+
+	return self;
+}
+
+/*
+ *  call-seq:
+ *    size -> Integer
+ *    length -> Integer
+ *
+ *  Returns the number of elements.
+ */
+static VALUE
+qvector_size(VALUE self)
+{
+	return LONG2NUM(GetQVector(self)->len);
+}
+
+/*
+ *  call-seq:
+ *    complex? -> bool
+ *
+ *  Returns true if the elements are Complex128.
+ */
+static VALUE
+qvector_complex_p(VALUE self)
+{
+	return GetQVector(self)->type == VEC_COMPLEX128 ? Qtrue : Qfalse;
+}
+
+/*
+ *  call-seq:
+ *    self[i] -> Float128 | Complex128 | nil
+ *
+ *  Returns the element at +i+. A negative index counts from the end.
+ *  If +i+ is out of range, returns nil.
+ */
+static VALUE
+qvector_aref(VALUE self, VALUE idx)
+{
+	struct QVector *vec = GetQVector(self);
+	long i = NUM2LONG(idx);
+
+	if (i < 0)  i += vec->len;
+	if (i < 0 || i >= vec->len)
+		return Qnil;
+
+	return qvector_fetch(vec, i);
+}
+
+/*
+ *  call-seq:
+ *    self[i] = x -> x
+ *
+ *  Stores +x+ at +i+. A vector does not grow, so an IndexError is raised if +i+ is out of range.
+ *  A complex number can be stored only into a complex vector.
+ */
+static VALUE
+qvector_aset(VALUE self, VALUE idx, VALUE x)
+{
+	struct QVector *vec = GetQVector(self);
+	long i = NUM2LONG(idx), orig = i;
+
+	rb_check_frozen(self);
+
+	if (i < 0)  i += vec->len;
+	if (i < 0 || i >= vec->len)
+		rb_raise(rb_eIndexError, "index %ld out of vector", orig);
+
+	qvector_store(vec, i, x);
+
+	return x;
+}
+
+/*
+ *  call-seq:
+ *    each {|x| ... } -> self
+ *    each -> Enumerator
+ *
+ *  Yields each element as Float128 or Complex128.
+ */
+static VALUE
+qvector_each(VALUE self)
+{
+	RETURN_SIZED_ENUMERATOR(self, 0, 0, qvector_size);
+
+	for (long i = 0; i < GetQVector(self)->len; i++)
+		rb_yield(qvector_fetch(GetQVector(self), i));
+
+	return self;
+}
+
+/*
+ * 要素を使い回すオブジェクトに読み出す．ブロックの中でベクトルが作り直されることもあるので，
+ * 要素の型に合わせてオブジェクトを用意する．ブロックで凍結されたオブジェクトは書き換えず，作り直す．
+ */
+struct qvector_flyweight {
+	VALUE real, complex;
+	__float128 *f128;
+	__complex128 *c128;
+};
+
+static VALUE
+qvector_flyweight_at(struct qvector_flyweight *fw, const struct QVector *vec, long i)
+{
+	if (vec->type == VEC_FLOAT128)
+	{
+		if (NIL_P(fw->real) || RB_OBJ_FROZEN(fw->real))
+			fw->real = rb_float128_flyweight(&fw->f128);
+		*fw->f128 = vec->data.f128[i];
+		return fw->real;
+	}
+	else
+	{
+		if (NIL_P(fw->complex) || RB_OBJ_FROZEN(fw->complex))
+			fw->complex = rb_complex128_flyweight(&fw->c128);
+		*fw->c128 = vec->data.c128[i];
+		return fw->complex;
+	}
+}
+
+/*
+ *  call-seq:
+ *    each_value {|x| ... } -> self
+ *
+ *  Like #each, but yields one Float128 (or Complex128) object that is overwritten with each element in turn,
+ *  so iterating allocates nothing per element.
+ *  The yielded object is not frozen and is valid only inside the block: it changes when the next element is yielded.
+ *  Methods that would return the object itself, such as <code>x.to_f128</code>, <code>Float128(x)</code>, <code>+x</code> or <code>x.dup</code>,
+ *  return a frozen copy instead, which can be kept.
+ *  Core methods that return an argument or the receiver as is, such as <code>[x].max</code> or <code>x.clamp(a, b)</code>,
+ *  still return the reused object; convert their results before keeping them.
+ *  Since the object must not outlive the block, a block is required; use #each for an Enumerator.
+ *
+ *    s = 0
+ *    QuadMath::Vector[1, 2, 3].each_value { |x| s += x }
+ *    s # => 6.0
+ */
+static VALUE
+qvector_each_value(VALUE self)
+{
+	struct qvector_flyweight fw = { Qnil, Qnil, NULL, NULL };
+
+	rb_need_block();
+
+	for (long i = 0; i < GetQVector(self)->len; i++)
+		rb_yield(qvector_flyweight_at(&fw, GetQVector(self), i));
+	RB_GC_GUARD(fw.real);
+	RB_GC_GUARD(fw.complex);
+
+	return self;
+}
+
+/*
+ *  call-seq:
+ *    map! {|x| ... } -> self
+ *
+ *  Replaces each element with the value of the block.
+ *  The block is given the element as by #each_value, and its result is converted and stored straight into the vector as by #[]=,
+ *  so a block that returns a Float or an Integer allocates nothing.
+ *  A complex result can be stored only into a complex vector.
+ *  As with #each_value, a block is required.
+ *
+ *    v = QuadMath::Vector[1, 2, 3]
+ *    v.map! { |x| x.to_f * 0.5 } # => QuadMath::Vector[0.5, 1.0, 1.5]
+ */
+static VALUE
+qvector_map_bang(VALUE self)
+{
+	struct qvector_flyweight fw = { Qnil, Qnil, NULL, NULL };
+
+	rb_need_block();
+	rb_check_frozen(self);
+
+	for (long i = 0; i < GetQVector(self)->len; i++)
+	{
+		VALUE y = rb_yield(qvector_flyweight_at(&fw, GetQVector(self), i));
+		rb_check_frozen(self);
+		if (i < GetQVector(self)->len)
+			qvector_store(GetQVector(self), i, y);
+	}
+	RB_GC_GUARD(fw.real);
+	RB_GC_GUARD(fw.complex);
+
+	return self;
+}
+
+/*
+ *  call-seq:
+ *    to_a -> Array
+ *
+ *  Returns the elements as an Array of Float128 or Complex128.
+ */
+static VALUE
+qvector_to_a(VALUE self)
+{
+	struct QVector *vec = GetQVector(self);
+	VALUE ary = rb_ary_new_capa(vec->len);
+
+	for (long i = 0; i < vec->len; i++)
+		rb_ary_push(ary, qvector_fetch(vec, i));
+
+	return ary;
+}
+
+/*
+ *  call-seq:
+ *    self == other -> bool
+ *
+ *  Returns true if +other+ is a vector of the same size and every pair of elements compares equal.
+ *  A real vector can be equal to a complex vector whose imaginary parts are zero.
+ */
+static VALUE
+qvector_eq(VALUE self, VALUE other)
+{
+	struct QVector *x, *y;
+
+	if (!qvector_p(other))
+		return Qfalse;
+
+	x = GetQVector(self);
+	y = GetQVector(other);
+
+	if (x->len != y->len)
+		return Qfalse;
+
+	for (long i = 0; i < x->len; i++)
+	{
+		__complex128 z = x->type == VEC_FLOAT128 ?
+			(__complex128)x->data.f128[i] : x->data.c128[i];
+		__complex128 w = y->type == VEC_FLOAT128 ?
+			(__complex128)y->data.f128[i] : y->data.c128[i];
+		if (z != w)
+			return Qfalse;
+	}
+	return Qtrue;
+}
+
+/*
+ *  call-seq:
+ *    inspect -> String
+ *
+ *  Returns the vector in the form of QuadMath::Vector[...].
+ */
+static VALUE
+qvector_inspect(VALUE self)
+{
+	struct QVector *vec = GetQVector(self);
+	VALUE str = rb_str_new_cstr("QuadMath::Vector[");
+
+	for (long i = 0; i < vec->len; i++)
+	{
+		if (i > 0)  rb_str_cat2(str, ", ");
+		rb_str_append(str, rb_inspect(qvector_fetch(vec, i)));
+	}
+	rb_str_cat2(str, "]");
+
+	return str;
+}
+
+static VALUE
+qvector_clone_data(struct QVector *src)
+{
+	VALUE obj = rb_qvector_new(src->type, src->len);
+	struct QVector *dst = GetQVector(obj);
+	size_t elem_size = src->type == VEC_FLOAT128 ?
+		sizeof(__float128) : sizeof(__complex128);
+
+	memcpy(dst->data.ptr, src->data.ptr, elem_size * src->len);
+
+	return obj;
+}
+
+static void
+cumsum_f128(__float128 *x, long n)
+{
+	__float128 s = 0;
+	for (long i = 0; i < n; i++)
+		x[i] = s += x[i];
+}
+
+static void
+cumsum_c128(__complex128 *z, long n)
+{
+	__complex128 s = 0;
+	for (long i = 0; i < n; i++)
+		z[i] = s += z[i];
+}
+
+static void
+cumprod_f128(__float128 *x, long n)
+{
+	__float128 p = 1;
+	for (long i = 0; i < n; i++)
+		x[i] = p *= x[i];
+}
+
+static void
+cumprod_c128(__complex128 *z, long n)
+{
+	__complex128 p = 1;
+	for (long i = 0; i < n; i++)
+		z[i] = p *= z[i];
+}
+
+/* NaNに出会ったら以降はNaNを伝播する */
+static void
+cummax_f128(__float128 *x, long n)
+{
+	for (long i = 1; i < n; i++)
+		if (isnanq(x[i - 1]) || x[i - 1] > x[i])
+			x[i] = x[i - 1];
+}
+
+static void
+cummin_f128(__float128 *x, long n)
+{
+	for (long i = 1; i < n; i++)
+		if (isnanq(x[i - 1]) || x[i - 1] < x[i])
+			x[i] = x[i - 1];
+}
+
+/*
+ *  call-seq:
+ *    cumsum -> QuadMath::Vector
+ *
+ *  Returns the vector of prefix sums of +self+ accumulated in quadruple precision.
+ *
+ *    QuadMath::Vector[1, 2, 3].cumsum # => QuadMath::Vector[1.0, 3.0, 6.0]
+ *    QuadMath.cumsum([0.1] * 3) # => QuadMath::Vector[0.1000000000000000055511151231257827, 0.2000000000000000111022302462515654, 0.3000000000000000166533453693773481]
+ */
+static VALUE
+qvector_cumsum(VALUE self)
+{
+	VALUE retval = qvector_clone_data(GetQVector(self));
+	struct QVector *vec = GetQVector(retval);
+
+	if (vec->type == VEC_FLOAT128)
+		cumsum_f128(vec->data.f128, vec->len);
+	else
+		cumsum_c128(vec->data.c128, vec->len);
+
+	return retval;
+}
+
+/*
+ *  call-seq:
+ *    cumprod -> QuadMath::Vector
+ *
+ *  Returns the vector of prefix products of +self+.
+ *
+ *    QuadMath::Vector[1, 2, 3, 4].cumprod # => QuadMath::Vector[1.0, 2.0, 6.0, 24.0]
+ */
+static VALUE
+qvector_cumprod(VALUE self)
+{
+	VALUE retval = qvector_clone_data(GetQVector(self));
+	struct QVector *vec = GetQVector(retval);
+
+	if (vec->type == VEC_FLOAT128)
+		cumprod_f128(vec->data.f128, vec->len);
+	else
+		cumprod_c128(vec->data.c128, vec->len);
+
+	return retval;
+}
+
+/*
+ *  call-seq:
+ *    cummax -> QuadMath::Vector
+ *
+ *  Returns the vector of running maxima of +self+.
+ *  Once NaN appears, the rest is NaN. A complex vector raises a TypeError.
+ *
+ *    QuadMath::Vector[1, 3, 2, 5].cummax # => QuadMath::Vector[1.0, 3.0, 3.0, 5.0]
+ */
+static VALUE
+qvector_cummax(VALUE self)
+{
+	VALUE retval;
+	struct QVector *vec = GetQVector(self);
+
+	if (vec->type != VEC_FLOAT128)
+		rb_raise(rb_eTypeError, "not a real vector");
+
+	retval = qvector_clone_data(vec);
+	vec = GetQVector(retval);
+	cummax_f128(vec->data.f128, vec->len);
+
+	return retval;
+}
+
+/*
+ *  call-seq:
+ *    cummin -> QuadMath::Vector
+ *
+ *  Returns the vector of running minima of +self+.
+ *  Once NaN appears, the rest is NaN. A complex vector raises a TypeError.
+ *
+ *    QuadMath::Vector[3, 1, 2, 0].cummin # => QuadMath::Vector[3.0, 1.0, 1.0, 0.0]
+ */
+static VALUE
+qvector_cummin(VALUE self)
+{
+	VALUE retval;
+	struct QVector *vec = GetQVector(self);
+
+	if (vec->type != VEC_FLOAT128)
+		rb_raise(rb_eTypeError, "not a real vector");
+
+	retval = qvector_clone_data(vec);
+	vec = GetQVector(retval);
+	cummin_f128(vec->data.f128, vec->len);
+
+	return retval;
+}
+
+/*
+ *  call-seq:
+ *    diff -> QuadMath::Vector
+ *
+ *  Returns the vector of differences between adjacent elements, which is one element shorter than +self+.
+ *
+ *    QuadMath::Vector[1, 4, 9, 16].diff # => QuadMath::Vector[3.0, 5.0, 7.0]
+ */
+static VALUE
+qvector_diff(VALUE self)
+{
+	struct QVector *src = GetQVector(self), *dst;
+	long n = src->len > 0 ? src->len - 1 : 0;
+	VALUE retval = rb_qvector_new(src->type, n);
+
+	dst = GetQVector(retval);
+	if (src->type == VEC_FLOAT128)
+		for (long i = 0; i < n; i++)
+			dst->data.f128[i] = src->data.f128[i + 1] - src->data.f128[i];
+	else
+		for (long i = 0; i < n; i++)
+			dst->data.c128[i] = src->data.c128[i + 1] - src->data.c128[i];
+
+	return retval;
+}
+
+/*
+ *  call-seq:
+ *    QuadMath.cumsum(xs) -> QuadMath::Vector
+ *    QuadMath.cumprod(xs) -> QuadMath::Vector
+ *    QuadMath.cummax(xs) -> QuadMath::Vector
+ *    QuadMath.cummin(xs) -> QuadMath::Vector
+ *    QuadMath.diff(xs) -> QuadMath::Vector
+ *
+ *  Module function versions of QuadMath::Vector#cumsum and so on.
+ *  +xs+ is a vector, an Array of numerics or a binary String of doubles, and is packed once before the scan.
+ */
+static VALUE
+quadmath_cumsum(VALUE unused_obj, VALUE xs)
+{
+	return qvector_cumsum(rb_qvector_from(xs));
+}
+
+static VALUE
+quadmath_cumprod(VALUE unused_obj, VALUE xs)
+{
+	return qvector_cumprod(rb_qvector_from(xs));
+}
+
+static VALUE
+quadmath_cummax(VALUE unused_obj, VALUE xs)
+{
+	return qvector_cummax(rb_qvector_from(xs));
+}
+
+static VALUE
+quadmath_cummin(VALUE unused_obj, VALUE xs)
+{
+	return qvector_cummin(rb_qvector_from(xs));
+}
+
+static VALUE
+quadmath_diff(VALUE unused_obj, VALUE xs)
+{
+	return qvector_diff(rb_qvector_from(xs));
+}
+
+void
+InitVM_Vector(void)
+{
+	rb_include_module(rb_cQuadVector, rb_mEnumerable);
+
+	rb_define_alloc_func(rb_cQuadVector, qvector_allocate);
+	rb_define_singleton_method(rb_cQuadVector, "[]", qvector_s_aref, -1);
+	rb_define_singleton_method(rb_cQuadVector, "from", qvector_s_from, 1);
+
+	rb_define_method(rb_cQuadVector, "initialize", qvector_initialize, -1);
+	rb_define_method(rb_cQuadVector, "initialize_copy", qvector_initialize_copy, 1);
+
+	rb_define_method(rb_cQuadVector, "size", qvector_size, 0);
+	rb_define_alias(rb_cQuadVector, "length", "size");
+	rb_define_method(rb_cQuadVector, "complex?", qvector_complex_p, 0);
+	rb_define_method(rb_cQuadVector, "[]", qvector_aref, 1);
+	rb_define_method(rb_cQuadVector, "[]=", qvector_aset, 2);
+	rb_define_method(rb_cQuadVector, "each", qvector_each, 0);
+	rb_define_method(rb_cQuadVector, "each_value", qvector_each_value, 0);
+	rb_define_method(rb_cQuadVector, "map!", qvector_map_bang, 0);
+	rb_define_method(rb_cQuadVector, "to_a", qvector_to_a, 0);
+	rb_define_method(rb_cQuadVector, "==", qvector_eq, 1);
+	rb_define_method(rb_cQuadVector, "inspect", qvector_inspect, 0);
+	rb_define_alias(rb_cQuadVector, "to_s", "inspect");
+
+	/* Scan kernels */
+	rb_define_method(rb_cQuadVector, "cumsum", qvector_cumsum, 0);
+	rb_define_method(rb_cQuadVector, "cumprod", qvector_cumprod, 0);
+	rb_define_method(rb_cQuadVector, "cummax", qvector_cummax, 0);
+	rb_define_method(rb_cQuadVector, "cummin", qvector_cummin, 0);
+	rb_define_method(rb_cQuadVector, "diff", qvector_diff, 0);
+
+	rb_define_module_function(rb_mQuadMath, "cumsum", quadmath_cumsum, 1);
+	rb_define_module_function(rb_mQuadMath, "cumprod", quadmath_cumprod, 1);
+	rb_define_module_function(rb_mQuadMath, "cummax", quadmath_cummax, 1);
+	rb_define_module_function(rb_mQuadMath, "cummin", quadmath_cummin, 1);
+	rb_define_module_function(rb_mQuadMath, "diff", quadmath_diff, 1);
+}
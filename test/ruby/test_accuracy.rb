@@ -0,0 +1,92 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestAccuracy < Minitest::Test
+  V = QuadMath::Vector
+  FAST = %i[exp exp2 log log2 log10 sqrt sin cos tan].freeze
+  BOUND = 2r**-103
+
+  def arguments(f)
+    r = Random.new(f.hash & 0xffff)
+    case f
+    when :exp, :exp2 then Array.new(300) { r.rand(-600.0..600.0).to_f128 / 3 }
+    when :log, :log2, :log10, :sqrt then Array.new(300) { (r.rand * 2r**r.rand(-900..900)).to_f128 / 3 }
+    else Array.new(300) { r.rand(-1000.0..1000.0).to_f128 / 3 }
+    end
+  end
+
+  def assert_close(expected, actual, msg)
+    err = expected.zero? ? actual.abs.to_r : ((actual - expected) / expected).abs.to_r
+    assert_operator err, :<=, BOUND, msg
+  end
+
+  def test_default_is_full
+    assert_equal :full, QuadMath.accuracy
+    assert_equal :fast, QuadMath.with_accuracy(:fast) { QuadMath.accuracy }
+    assert_equal :full, QuadMath.accuracy
+  end
+
+  def test_fiber_local_independent_of_user_keys
+    Thread.current[:accuracy] = :high
+    assert_equal QuadMath.exp(1, accuracy: :full), QuadMath.exp(1)
+    assert_equal :full, QuadMath.accuracy
+    QuadMath.with_accuracy(:fast) { assert_equal :high, Thread.current[:accuracy] }
+  ensure
+    Thread.current[:accuracy] = nil
+  end
+
+  def test_fast_within_bound
+    FAST.each do |f|
+      arguments(f).each do |x|
+        assert_close QuadMath.send(f, x), QuadMath.send(f, x, accuracy: :fast), "#{f}(#{x})"
+      end
+    end
+  end
+
+  def test_fast_vectors_match_fast_scalars
+    FAST.each do |f|
+      xs = arguments(f)
+      y = QuadMath.send(f, V[*xs], accuracy: :fast)
+      assert_equal xs.map { |x| QuadMath.send(f, x, accuracy: :fast) }, y.to_a, f.to_s
+      assert_equal y, QuadMath.with_accuracy(:fast) { QuadMath.send(f, xs) }
+    end
+  end
+
+  def test_tiny_trigonometric_arguments
+    [-295, -305, -320, -4000, -4940].each do |e|
+      x = QuadMath.sqrt(2) * Float128("1e#{e}")
+      %i[sin tan].each do |f|
+        assert_close QuadMath.send(f, x), QuadMath.send(f, x, accuracy: :fast), "#{f}(sqrt(2)e#{e})"
+      end
+      assert_equal 1, QuadMath.cos(x, accuracy: :fast)
+    end
+  end
+
+  def test_special_arguments
+    zero = 0.to_f128
+    assert_equal zero, QuadMath.sin(zero, accuracy: :fast)
+    assert_equal "-0x0p+0", quadmath_sprintf("%Qa", QuadMath.sin(-0.0.to_f128, accuracy: :fast))
+    assert_equal 1, QuadMath.exp(zero, accuracy: :fast)
+    assert QuadMath.exp(Float128::NAN, accuracy: :fast).nan?
+    assert_equal Float128::INFINITY, QuadMath.exp(Float128::INFINITY, accuracy: :fast)
+    assert_equal 0, QuadMath.exp(-Float128::INFINITY, accuracy: :fast)
+    assert_equal QuadMath.sin(Float128('1e10')), QuadMath.sin(Float128('1e10'), accuracy: :fast)
+    assert_equal QuadMath.log(Float128::DENORM_MIN), QuadMath.log(Float128::DENORM_MIN, accuracy: :fast)
+    assert QuadMath.sqrt(-1, accuracy: :fast).is_a?(Complex128)
+  end
+
+  def test_near_multiples_of_half_pi
+    pio2 = QuadMath.atan(1) * 2
+    [1, 2, 3, 1000].each do |k|
+      x = pio2 * k
+      assert_close QuadMath.sin(x), QuadMath.sin(x, accuracy: :fast), "sin(#{k}pi/2)"
+      assert_close QuadMath.cos(x), QuadMath.cos(x, accuracy: :fast), "cos(#{k}pi/2)"
+    end
+  end
+
+  def test_errors
+    assert_raises(ArgumentError) { QuadMath.sin(1, accuracy: :x) }
+    assert_raises(ArgumentError) { QuadMath.with_accuracy(:x) {} }
+  end
+end
@@ -0,0 +1,90 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestArith < Minitest::Test
+  V = QuadMath::Vector
+
+  SPECIAL = [
+    0.0.to_f128, -0.0.to_f128, 1.to_f128, -1.to_f128,
+    Float128::INFINITY, -Float128::INFINITY, Float128::NAN,
+    Float128::MAX, -Float128::MAX, Float128::MIN, -Float128::MIN,
+    Float128::DENORM_MIN, -Float128::DENORM_MIN, Float128::MIN / 3, Float128::EPSILON,
+    1 + Float128::EPSILON, 1/3r.to_f128, Float128('1e4000'), Float128('-1e-4000'),
+  ].freeze
+
+  def values
+    r = Random.new(7)
+    randoms = Array.new(200) { (r.rand(-1.0..1.0) * 2r**r.rand(-200..200)).to_f128 / 3 }
+    SPECIAL + randoms
+  end
+
+  def bits(x)
+    quadmath_sprintf("%Qa", x)
+  end
+
+  def assert_bits(expected, actual, msg = nil)
+    assert_equal expected.map { |x| bits(x) }, actual.to_a.map { |x| bits(x) }, msg
+  end
+
+  def test_elementwise_matches_scalar_operators
+    xs = values
+    pairs = xs.product(xs)
+    a = V[*pairs.map(&:first)]
+    b = V[*pairs.map(&:last)]
+    %i[+ - * /].each do |op|
+      assert_bits pairs.map { |x, y| x.send(op, y) }, a.send(op, b), op.to_s
+    end
+  end
+
+  def test_fma_matches_scalar
+    xs = values
+    r = Random.new(8)
+    triples = Array.new(20_000) { [xs.sample(random: r), xs.sample(random: r), xs.sample(random: r)] }
+    a, b, c = triples.transpose.map { |col| V[*col] }
+    assert_bits triples.map { |x, y, z| Float128.fma(x, y, z) }, QuadMath.fma(a, b, c)
+  end
+
+  def test_fma_rounds_once
+    e = Float128::EPSILON
+    x = 1 + e
+    assert_equal e * e, QuadMath.fma(x, x, -(1 + 2 * e))
+    assert_equal e * e, QuadMath.fma(V[x], V[x], V[-(1 + 2 * e)])[0]
+  end
+
+  def test_scalar_broadcast
+    v = V[1, 2, 4]
+    assert_equal V[2, 3, 5], v + 1
+    assert_equal V[0.5, 1, 2], v / 2
+    assert_equal V[-1, -2, -4], v * -1
+    assert_equal V[7, 9, 13], QuadMath.fma(v, 2, 5)
+  end
+
+  def test_complex_elementwise
+    a = V[1i, 2]
+    b = V[1, 1 - 1i]
+    assert a.complex?
+    assert_equal [Complex(1, 1), Complex(3, -1)], (a + b).to_a.map(&:to_c)
+    assert_equal [Complex(0, 1), Complex(2, -2)], (a * b).to_a.map(&:to_c)
+    assert_equal [Complex(0, 2), Complex(4, 0)], (a * 2).to_a.map(&:to_c)
+  end
+
+  def test_long_vectors_and_threads
+    a = V[*Array.new(40_000) { |i| i / 7r }]
+    b = V[*Array.new(40_000) { |i| 1 / (i + 1r) }]
+    old = QuadMath.threads
+    QuadMath.threads = 1
+    one = [a + b, a * b, QuadMath.fma(a, b, a)]
+    QuadMath.threads = 4
+    assert_equal one, [a + b, a * b, QuadMath.fma(a, b, a)]
+    assert_equal a[12_345] * b[12_345], one[1][12_345]
+  ensure
+    QuadMath.threads = old
+  end
+
+  def test_errors
+    assert_raises(ArgumentError) { V[1, 2] + V[1] }
+    assert_raises(ArgumentError) { QuadMath.fma(V[1, 2], V[1], V[1, 2]) }
+    assert_raises(TypeError) { V[1, 2] + "a" }
+  end
+end
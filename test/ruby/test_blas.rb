@@ -0,0 +1,56 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestBLAS < Minitest::Test
+  V = QuadMath::Vector
+  B = QuadMath::BLAS
+
+  def test_axpy
+    y = V[1, 1]
+    assert_same y, B.axpy(2, V[3, 4], y)
+    assert_equal V[7, 9], y
+    z = V[1i, 1]
+    B.axpy(1i, V[1, 1i], z)
+    assert_equal [Complex(0, 2), Complex(0, 0)], z.to_a.map(&:to_c)
+  end
+
+  def test_axpy_errors
+    assert_raises(ArgumentError) { B.axpy(1, V[1, 2], V[1]) }
+    assert_raises(TypeError) { B.axpy(1, V[1i], V[1]) }
+    assert_raises(FrozenError) { B.axpy(1, V[1], V[1].freeze) }
+  end
+
+  def test_scal
+    assert_equal V[2, 4], B.scal(2, V[1, 2])
+    r = B.scal(1i, V[1, 1i])
+    assert_equal [Complex(0, 1), Complex(-1, 0)], r.to_a.map(&:to_c)
+  end
+
+  def test_dot_and_dotc
+    assert_equal 11, B.dot(V[1, 2], V[3, 4])
+    assert_equal Complex(-1, 0), B.dot(V[1i], V[1i]).to_c
+    assert_equal Complex(1, 0), B.dotc(V[1i], V[1i]).to_c
+    assert_equal 0, B.dot(V[], V[])
+  end
+
+  def test_nrm2_asum_iamax
+    assert_equal 5, B.nrm2(V[3, 4i])
+    assert_equal 5, B.nrm2(V[3, 4])
+    assert_equal 3, B.asum(V[-1, 2])
+    assert_equal 7, B.asum(V[3+4i])
+    assert_equal 1, B.iamax(V[1, -5, 5])
+    assert_nil B.iamax(V[])
+  end
+
+  def test_long_vectors
+    n = 100_003
+    x = V.from(Array.new(n) { |i| i % 7 - 3 })
+    y = V.from(Array.new(n) { |i| i % 5 })
+    expected = (0...n).sum { |i| (i % 7 - 3) * (i % 5) }
+    assert_equal expected, B.dot(x, y)
+    B.axpy(-1, x, y)
+    assert_equal (0...n).sum { |i| i % 5 - (i % 7 - 3) }, QuadMath.sum(y)
+    assert_equal 0, B.iamax(x)
+  end
+end
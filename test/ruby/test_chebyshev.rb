@@ -0,0 +1,60 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestChebyshev < Minitest::Test
+  C = QuadMath::Chebyshev
+  V = QuadMath::Vector
+
+  def test_fit_exp
+    cheb = C.fit(:exp, 0..1, degree: 30)
+    assert_operator cheb.max_error, :<, 1e-32
+    assert_operator cheb.degree, :<=, 30
+    assert_equal 0..1, cheb.domain
+    assert_kind_of Float128, cheb.domain.first
+    xs = Array.new(101) { |i| i / 100r }
+    xs.each { |x| assert_in_delta QuadMath.exp(x.to_f128), cheb.call(x), 1e-32 }
+  end
+
+  def test_fit_block
+    cheb = C.fit(0..1, degree: 2) { |x| x * x }
+    assert_in_delta 0.25, cheb.call(0.5), 1e-33
+    assert_in_delta 0.25, cheb[0.5], 1e-33
+    assert_equal 2, cheb.degree
+    c = cheb.coefficients
+    assert_in_delta 3/8r.to_f128, c[0], 1e-33
+    assert_in_delta 1/2r.to_f128, c[1], 1e-33
+    assert_in_delta 1/8r.to_f128, c[2], 1e-33
+  end
+
+  def test_trailing_coefficients_are_dropped
+    assert_equal 0, C.fit(-2..3, degree: 20) { |_| 1 }.degree
+  end
+
+  def test_call_vector
+    cheb = C.fit(:sin, -1..2, degree: 40)
+    xs = Array.new(5000) { |i| -1 + 3 * i / 4999r }
+    y = cheb.call(xs)
+    assert_kind_of V, y
+    assert_equal 5000, y.size
+    assert_equal y, cheb.call(V[*xs], threads: 1)
+    assert_equal y, cheb.call(xs, threads: 4)
+    [0, 1234, 4999].each { |i| assert_equal cheb.call(xs[i]), y[i] }
+  end
+
+  def test_inspect
+    assert_match(/\A#<QuadMath::Chebyshev degree=2 domain=0\.\.1 max_error=/, C.fit(0..1, degree: 2) { |x| x * x }.inspect)
+  end
+
+  def test_errors
+    cheb = C.fit(0..1, degree: 2) { |x| x * x }
+    assert_raises(Math::DomainError) { cheb.call(2) }
+    assert_raises(Math::DomainError) { cheb.call([0.5, -0.1]) }
+    assert_raises(ArgumentError) { C.fit(:nope, 0..1) }
+    assert_raises(ArgumentError) { C.fit(1..0) { |x| x } }
+    assert_raises(ArgumentError) { C.fit(0..1) }
+    assert_raises(ArgumentError) { C.fit(0..1, degree: -1) { |x| x } }
+    assert_raises(TypeError) { C.fit(0..1) { |_| "a" } }
+    assert_raises(NoMethodError) { C.new }
+  end
+end
@@ -0,0 +1,75 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestConvolve < Minitest::Test
+  V = QuadMath::Vector
+
+  def seq(n, seed)
+    Array.new(n) { |j| ((j * seed) % 17 - 8) / 5r }
+  end
+
+  def naive(a, b)
+    Array.new(a.size + b.size - 1) { |k| (0...a.size).sum { |j| (0...b.size).cover?(k - j) ? a[j] * b[k - j] : 0 } }
+  end
+
+  def max_diff(a, b)
+    a.to_a.zip(b.to_a).map { |x, y| (x.to_c - y.to_c).abs }.max
+  end
+
+  def test_convolve_examples
+    assert_operator max_diff(QuadMath.convolve([1, 2, 3], [0, 1, 0.5]), [0, 1, 2.5, 4, 1.5]), :<, 1e-32
+    assert_operator max_diff(QuadMath.convolve([1, 2, 3], [0, 1, 0.5], mode: :same), [1, 2.5, 4]), :<, 1e-32
+    assert_operator max_diff(QuadMath.convolve([1, 2, 3], [0, 1, 0.5], mode: :valid), [2.5]), :<, 1e-32
+  end
+
+  def test_direct_matches_fft
+    [[1, 1], [5, 3], [64, 64], [300, 41], [257, 500]].each do |m, n|
+      a = seq(m, 7)
+      b = seq(n, 5)
+      direct = QuadMath.convolve(a, b, method: :direct)
+      fft = QuadMath.convolve(a, b, method: :fft)
+      auto = QuadMath.convolve(a, b)
+      assert_equal m + n - 1, direct.size
+      assert_operator max_diff(direct, naive(a, b)), :<, 1e-28, "#{m}x#{n}"
+      assert_operator max_diff(fft, direct), :<, 1e-28, "#{m}x#{n}"
+      assert_operator max_diff(auto, direct), :<, 1e-28, "#{m}x#{n}"
+      refute fft.complex?
+    end
+  end
+
+  def test_modes_are_slices_of_full
+    a = seq(40, 3)
+    b = seq(11, 4)
+    full = QuadMath.convolve(a, b).to_a
+    assert_equal full[5, 40], QuadMath.convolve(a, b, mode: :same).to_a
+    assert_equal full[10, 30], QuadMath.convolve(a, b, mode: :valid).to_a
+    assert_operator max_diff(QuadMath.convolve(b, a, mode: :valid), full[10, 30]), :<, 1e-30
+  end
+
+  def test_complex_convolve
+    c = QuadMath.convolve([1i, 2], [1, 1])
+    assert c.complex?
+    assert_operator max_diff(c, [1i, 2+1i, 2]), :<, 1e-32
+    a = Array.new(100) { |j| Complex(j % 5, j % 3) }
+    b = Array.new(50) { |j| Complex(j % 7 - 3, 1) }
+    assert_operator max_diff(QuadMath.convolve(a, b, method: :fft), QuadMath.convolve(a, b, method: :direct)), :<, 1e-28
+  end
+
+  def test_correlate
+    assert_operator max_diff(QuadMath.correlate([1, 2, 3], [0, 1, 0.5]), [3.5]), :<, 1e-32
+    full = QuadMath.correlate([1, 2, 3], [0, 1, 0.5], mode: :full)
+    assert_operator max_diff(full, [0.5, 2, 3.5, 3, 0]), :<, 1e-32
+    a = seq(200, 9)
+    v = seq(30, 2)
+    assert_operator max_diff(QuadMath.correlate(a, v, method: :fft), QuadMath.correlate(a, v, method: :direct)), :<, 1e-28
+    c = QuadMath.correlate([1, 1i], [1i])
+    assert_operator max_diff(c, [-1i, 1]), :<, 1e-32
+  end
+
+  def test_errors
+    assert_raises(ArgumentError) { QuadMath.convolve([1], [1], mode: :x) }
+    assert_raises(ArgumentError) { QuadMath.convolve([1], [1], method: :x) }
+    assert_raises(ArgumentError) { QuadMath.convolve([], [1]) }
+  end
+end
@@ -0,0 +1,95 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestDoubleDouble < Minitest::Test
+  DD = QuadMath::DoubleDouble
+
+  def test_conversions
+    a = "0.1".to_dd
+    assert_kind_of DD, a
+    assert_equal 0.1, a.hi
+    assert_equal(-5.551115123125783e-18, a.lo)
+    assert_equal 0.1, a.to_f
+    assert_equal a.hi.to_r + a.lo.to_r, a.to_r
+    assert_equal "0.1", a.to_s
+    assert_equal "0.333333333333333333333333333333332", (1.to_dd / 3).to_s
+    assert_equal 0, "abc".to_dd
+  end
+
+  def test_conversions_into_quad_types
+    a = 1.to_dd / 3
+    assert_equal a.to_f128, Float128(a)
+    c = a.to_c128
+    assert_kind_of Complex128, c
+    assert_equal a.to_f128, c.real
+    assert_equal 0, c.imag
+    assert_equal c.to_c, Complex128(a).to_c
+    assert_equal Complex(1, 0), Complex128(1.to_dd).to_c
+  end
+
+  def test_exact_round_trips
+    [1/3r, 2r**-1000, -12345678901234567890123456789r, 0.1r].each do |r|
+      x = r.to_dd
+      assert_equal x, x.to_r.to_dd, r.to_s
+      assert_equal x, x.to_s.to_dd, r.to_s
+      assert_equal x, x.to_f128.to_dd, r.to_s
+    end
+    assert_equal 2**100 + 1, (2**100 + 1).to_dd.to_i
+  end
+
+  def test_arithmetic_precision
+    third = 1.to_dd / 3
+    assert_operator (third.to_r - 1/3r).abs, :<=, DD::EPSILON.to_r / 3
+    assert_equal 2r**-60, (1.to_dd + 2r**-60).to_r - 1
+    assert_equal 1024, 2.to_dd**10
+    assert_in_delta Math.sqrt(2), 2.to_dd**0.5, 1e-15
+    assert_operator ((2.to_dd**0.5) * (2.to_dd**0.5) - 2).abs, :<, 1e-30
+  end
+
+  def test_mixed_types
+    assert_equal 3, 1.to_dd + 2
+    assert_equal 3, 2 + 1.to_dd
+    assert_equal 3, 1.5 * 2.to_dd
+    assert_kind_of DD, 2 + 1.to_dd
+    assert_kind_of Float128, Float128(1) + 1.to_dd
+    assert_kind_of Float128, 1.to_dd + Float128(1)
+  end
+
+  def test_comparison_and_hash
+    assert_equal(-1, 1.to_dd <=> 2)
+    assert_equal 1.to_dd, 1
+    refute 1.to_dd.eql?(1)
+    assert 1.to_dd.eql?(1.to_dd)
+    assert_equal 1.to_dd.hash, 1.to_dd.hash
+    assert_equal 1, { 1.to_dd => 1 }[1.to_dd]
+    assert_operator "0.1".to_dd, :<, 0.1
+  end
+
+  def test_rounding
+    assert_equal 1, 7.to_dd % 3
+    assert_equal 2, -7.to_dd % 3
+    assert_equal 3, 2.5.to_dd.round
+    assert_equal 2, 2.5.to_dd.floor
+    assert_equal(-2, -2.5.to_dd.ceil)
+    assert_equal(-2, -2.5.to_dd.truncate)
+    assert_in_delta 2.57, 2.567.to_dd.round(2), 1e-15
+    assert_equal 100_000_000_000_000_000_000, 1e20.to_dd.to_i
+  end
+
+  def test_special_values
+    assert_equal DD::INFINITY, 1.to_dd / 0
+    assert DD::NAN.nan?
+    assert_equal 1, DD::INFINITY.infinite?
+    assert_equal(-1, (-DD::INFINITY).infinite?)
+    assert_nil 1.to_dd.infinite?
+    assert 1.to_dd.finite?
+    assert_equal 106, DD::MANT_DIG
+    assert_equal 31, DD::DIG
+  end
+
+  def test_quadmath_functions
+    assert_equal QuadMath.sqrt(2), QuadMath.sqrt(2.to_dd)
+    assert_kind_of Float128, QuadMath.exp(1.to_dd)
+  end
+end
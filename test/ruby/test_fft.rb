@@ -0,0 +1,83 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestFFT < Minitest::Test
+  F = QuadMath::FFT
+  V = QuadMath::Vector
+
+  def signal(n)
+    Array.new(n) { |j| Complex((j * 7 % 11 - 5) / 3r, (j * 5 % 13 - 6) / 7r) }
+  end
+
+  def max_diff(a, b)
+    a.to_a.zip(b.to_a).map { |x, y| (x.to_c - y.to_c).abs }.max
+  end
+
+  def naive_dft(x)
+    n = x.size
+    Array.new(n) do |k|
+      x.each_with_index.sum { |v, j| v.to_c * Complex.polar(1.0, -2 * Math::PI * j * k / n) }
+    end
+  end
+
+  def test_forward_example
+    assert_operator max_diff(F.plan(4).forward([1, 2, 3, 4]), [10, -2+2i, -2, -2-2i]), :<, 1e-32
+    assert_equal 4, F.plan(4).size
+  end
+
+  def test_impulse_and_constant
+    n = 24
+    delta = [1] + [0] * (n - 1)
+    assert_operator max_diff(F.plan(n).forward(delta), [1] * n), :<, 1e-33
+    assert_operator max_diff(F.plan(n).forward([1] * n), [n] + [0] * (n - 1)), :<, 1e-31
+  end
+
+  def test_forward_matches_naive_dft
+    [1, 2, 3, 5, 8, 12, 30, 37, 64].each do |n|
+      x = signal(n)
+      assert_operator max_diff(F.plan(n).forward(x), naive_dft(x)), :<, 1e-11, "n=#{n}"
+    end
+  end
+
+  def test_round_trip
+    [1, 2, 3, 4, 6, 7, 16, 45, 97, 128, 210, 1000].each do |n|
+      plan = F.plan(n)
+      x = signal(n)
+      assert_operator max_diff(plan.inverse(plan.forward(x)), x), :<, 1e-30, "n=#{n}"
+    end
+  end
+
+  def test_parseval
+    n = 60
+    x = signal(n)
+    y = F.plan(n).forward(x)
+    ex = x.sum { |v| v.abs2 }
+    ey = y.to_a.sum { |v| v.to_c.abs2 } / n
+    assert_operator (ex - ey).abs / ex, :<, 1e-31
+  end
+
+  def test_real_transforms
+    [2, 5, 8, 9, 64, 101].each do |n|
+      plan = F.plan(n)
+      x = Array.new(n) { |j| (j * 3 % 7 - 3) / 2r }
+      spec = plan.rforward(x)
+      assert_equal n / 2 + 1, spec.size
+      assert_operator max_diff(spec, plan.forward(x).to_a.first(n / 2 + 1)), :<, 1e-30, "n=#{n}"
+      back = plan.rinverse(spec)
+      refute back.complex?
+      assert_operator back.to_a.zip(x).map { |a, b| (a - b).abs }.max, :<, 1e-30, "n=#{n}"
+    end
+  end
+
+  def test_inspect
+    assert_equal "#<QuadMath::FFT n=12 radix=4x3>", F.plan(12).inspect
+    assert_match(/bluestein/, F.plan(37).inspect)
+  end
+
+  def test_errors
+    assert_raises(ArgumentError) { F.plan(4).forward([1, 2, 3]) }
+    assert_raises(ArgumentError) { F.plan(4).rinverse([1, 2]) }
+    assert_raises(ArgumentError) { F.plan(-1) }
+  end
+end
@@ -0,0 +1,76 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestFormula < Minitest::Test
+  V = QuadMath::Vector
+
+  def test_compile_and_call
+    f = QuadMath.compile("a*x**2 + b*sin(x)")
+    assert_equal [:a, :x, :b], f.variables
+    assert_equal "a*x**2 + b*sin(x)", f.source
+    assert_equal 18, f.call(a: 2, x: 3, b: 0)
+    assert_equal 18, f[2, 3, 0]
+    assert_kind_of Float128, f.call(2, 3, 0)
+    assert_equal V[2, 8, 18], f.call(2, V[1, 2, 3], 0)
+  end
+
+  def test_matches_ruby_arithmetic
+    f = QuadMath.compile("(x - y) / (x + y) % 1 + fma(x, y, -1) - hypot(x, y)**2 + atan2(y, x)")
+    x = 7/3r.to_f128
+    y = -2/9r.to_f128
+    expected = (x - y) / (x + y) % 1 + Float128.fma(x, y, -1) - QuadMath.hypot(x, y) * QuadMath.hypot(x, y) + QuadMath.atan2(y, x)
+    assert_equal expected, f.call(x, y)
+  end
+
+  def test_constant_folding
+    assert_match(/\(1 insns\)/, QuadMath.compile("2*3+PI").inspect)
+    assert_equal 6 + QuadMath::PI, QuadMath.compile("2*3+PI").call
+    assert_equal Float128("0.1"), QuadMath.compile("0.1").call
+  end
+
+  def test_real_domain
+    assert QuadMath.compile("sqrt(x)").call(-1).nan?
+    assert QuadMath.compile("log(x)").call([-1, 1]).to_a.first.nan?
+  end
+
+  def test_vector_evaluation
+    f = QuadMath.compile("exp(-x*x/2) * c")
+    xs = Array.new(5000) { |i| (i - 2500) / 500r }
+    y = f.call(x: xs, c: 3)
+    assert_equal 5000, y.size
+    [0, 1, 257, 2500, 4999].each { |i| assert_equal f.call(x: xs[i], c: 3), y[i] }
+    old = QuadMath.threads
+    QuadMath.threads = 4
+    assert_equal y, f.call(x: V[*xs], c: 3)
+  ensure
+    QuadMath.threads = old
+  end
+
+  def test_parse_errors
+    {
+      "1+" => /unexpected end at 2/,
+      "(1" => /'\)' expected at 2/,
+      "1)" => /unexpected character at 1/,
+      "1 $ 2" => /unexpected character at 2/,
+      "" => /unexpected end at 0/,
+      "foo(1)" => /undefined function foo at 0/,
+      "sin(1,2)" => /wrong number of arguments for sin \(given 2\)/,
+      "FOO" => /undefined constant FOO at 0/,
+      "x" + "+(x" * 300 + ")" * 300 => /nested too deeply/,
+    }.each do |source, message|
+      e = assert_raises(ArgumentError, source) { QuadMath.compile(source) }
+      assert_match message, e.message
+    end
+  end
+
+  def test_call_errors
+    f = QuadMath.compile("x + y")
+    assert_raises(ArgumentError) { f.call(1) }
+    assert_raises(ArgumentError) { f.call(x: 1) }
+    assert_raises(ArgumentError) { f.call(x: 1, y: 2, z: 3) }
+    assert_raises(ArgumentError) { f.call([1, 2], [1, 2, 3]) }
+    assert_raises(TypeError) { f.call(1i, 2) }
+    assert_raises(TypeError) { f.call([1i], [2]) }
+  end
+end
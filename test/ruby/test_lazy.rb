@@ -0,0 +1,85 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestLazy < Minitest::Test
+  V = QuadMath::Vector
+
+  def setup
+    @a = V[*Array.new(1000) { |i| (i - 500) / 37r }]
+    @b = V[*Array.new(1000) { |i| 1 / (i + 1r) }]
+  end
+
+  def test_example
+    a = V[1, 2, 3]
+    b = V[4, 5, 6]
+    e = (a.lazy * b + 1).exp
+    assert_equal "#<QuadMath::Vector::Lazy exp((v0 * v1) + 1.0) size=3>", e.inspect
+    assert_equal 3, e.size
+    assert_equal QuadMath.exp(a * b + 1), e.force
+    assert_equal QuadMath.sum(QuadMath.exp(a * b + 1)), e.sum
+  end
+
+  def test_operators_match_eager
+    a = @a.lazy
+    assert_equal @a + @b, (a + @b).force
+    assert_equal @a - @b, (a - @b).force
+    assert_equal @a * @b, (a * @b).force
+    assert_equal @a / @b, (a / @b).force
+    assert_equal @a * @a, (a**2).force
+    assert_equal @a * -1, (-a).force
+    assert_equal @a + 2, (2 + a).force
+    assert_equal @a + 1.5, (a + 1.5).to_v
+  end
+
+  def test_functions_match_eager
+    %i[exp sin cos atan tanh expm1].each do |f|
+      assert_equal QuadMath.send(f, @a), @a.lazy.send(f).force, f.to_s
+    end
+    pos = @b.lazy
+    %i[log sqrt cbrt lgamma].each do |f|
+      assert_equal QuadMath.send(f, @b), pos.send(f).force, f.to_s
+    end
+  end
+
+  def test_sum_matches_eager
+    e = (@a.lazy * @b).sin + @a
+    assert_equal QuadMath.sum(QuadMath.sin(@a * @b) + @a), e.sum
+  end
+
+  def test_shared_leaves
+    a = @a.lazy
+    e = a * a + a
+    assert_match(/\(v0 \* v0\) \+ v0/, e.inspect)
+    assert_equal @a * @a + @a, e.force
+  end
+
+  def test_independent_of_threads
+    a = V[*Array.new(50_000) { |i| i / 1000r }]
+    e = (a.lazy * 3 - 1).exp.sqrt
+    old = QuadMath.threads
+    QuadMath.threads = 1
+    one = [e.force, e.sum]
+    QuadMath.threads = 4
+    assert_equal one, [e.force, e.sum]
+  ensure
+    QuadMath.threads = old
+  end
+
+  def test_expression_size_is_bounded
+    s = V[1, 2].lazy
+    15.times { s = s * s }
+    assert_equal 1, s.force[0]
+    assert s.force[1].infinite?
+    e = assert_raises(ArgumentError) { s * s }
+    assert_match(/expression too large/, e.message)
+  end
+
+  def test_errors
+    a = V[1, 2, 3].lazy
+    assert_raises(ArgumentError) { a + V[1] }
+    assert_raises(TypeError) { a + 1i }
+    assert_raises(TypeError) { V[1i].lazy }
+    assert_raises(ArgumentError) { (0...300).inject(a) { |s, _| a + s } }
+  end
+end
@@ -0,0 +1,252 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestLinAlg < Minitest::Test
+  M = QuadMath::Matrix
+  V = QuadMath::Vector
+
+  def hilbert(n)
+    Array.new(n) { |i| Array.new(n) { |j| 1/(i + j + 1r) } }
+  end
+
+  def max_abs_diff(a, b)
+    a.to_a.flatten.zip(b.to_a.flatten).map { |x, y| (x - y).abs }.max
+  end
+
+  def test_lu_example
+    l, u, perm = M[[1, 2], [3, 4]].lu
+    assert_equal [1, 0], perm
+    assert_equal M[[1, 0], [1/3r, 1]], l
+    assert_equal 3, u[0, 0]
+    assert_equal 0, u[1, 0]
+    assert_in_delta 2/3r.to_f128, u[1, 1], 1e-33
+  end
+
+  def test_lu_reconstructs
+    rows = Array.new(40) { |i| Array.new(40) { |j| ((i * 31 + j * 17) % 23 - 11) + (i == j ? 30 : 0) } }
+    l, u, perm = M[*rows].lu
+    pa = M[*perm.map { |i| rows[i] }]
+    assert_operator max_abs_diff(l * u, pa), :<, 1e-28
+    40.times do |i|
+      assert_equal 1, l[i, i]
+      (i + 1...40).each { |j| assert_equal 0, l[i, j] }
+      (0...i).each { |j| assert_equal 0, u[i, j] }
+    end
+  end
+
+  def test_solve
+    x = M[[2, 1], [1, 3]].solve([3, 5])
+    assert_in_delta 4/5r.to_f128, x[0], 1e-32
+    assert_in_delta 7/5r.to_f128, x[1], 1e-32
+  end
+
+  def test_solve_ill_conditioned
+    n = 10
+    h = hilbert(n)
+    b = h.map(&:sum)
+    x = M[*h].solve(b)
+    assert_operator x.to_a.map { |e| (e - 1).abs }.max, :<, 1e-18
+  end
+
+  def test_solve_many_right_hand_sides
+    a = M[[4, 1, 0], [1, 4, 1], [0, 1, 4]]
+    b = M[[1, 0], [0, 1], [0, 0]]
+    x = a.solve(b)
+    assert_kind_of M, x
+    assert_operator max_abs_diff(a * x, b), :<, 1e-32
+  end
+
+  def test_complex_solve
+    a = M[[1i, 1], [1, 2]]
+    x = a.solve([1, 1i])
+    assert x.complex?
+    r = (a * x).to_a.map(&:to_c)
+    assert_in_delta 0, (r[0] - 1).abs, 1e-32
+    assert_in_delta 0, (r[1] - 1i).abs, 1e-32
+  end
+
+  def test_singular
+    assert_raises(ZeroDivisionError) { M[[1, 2], [2, 4]].lu }
+    assert_raises(ZeroDivisionError) { M[[1, 2], [2, 4]].solve([1, 1]) }
+    assert_raises(ArgumentError) { M[[1, 2], [3, 4]].solve([1, 2, 3]) }
+  end
+
+  def test_refine_solve
+    expected = V[0.375, -0.125]
+    assert_equal expected, QuadMath.refine_solve([[3, 1], [1, 3]], [1, 0])
+    assert_equal expected, QuadMath.refine_solve([3.0, 1.0, 1.0, 3.0].pack('d*'), [1, 0])
+    assert_equal expected, QuadMath.refine_solve(M[[3, 1], [1, 3]], [1, 0])
+    assert_raises(ZeroDivisionError) { QuadMath.refine_solve([[1, 2], [2, 4]], [1, 0]) }
+    assert_raises(ArgumentError) { QuadMath.refine_solve([1.0, 2.0, 3.0].pack('d*'), [1, 0]) }
+  end
+
+  def test_refine_solve_binary_string_changed_while_reading
+    b = [1.0, 0.0].pack('d*')
+    clear = Class.new(Numeric) do
+      define_method(:to_f128) { b.clear; Float128(3) }
+    end.new
+    assert_equal V[0.375, -0.125], QuadMath.refine_solve([[clear, 1], [1, 3]], b)
+    assert_empty b
+  end
+
+  def test_refine_solve_reaches_quad_accuracy
+    n = 20
+    a = Array.new(n) { |i| Array.new(n) { |j| i == j ? 4 : 1/(i + j + 1r) } }
+    b = a.map(&:sum)
+    x = nil
+    assert_silent { x = QuadMath.refine_solve(a, b) }
+    assert_operator x.to_a.map { |e| (e - 1).abs }.max, :<, 1e-32
+  end
+
+  def test_refine_solve_warns_when_not_converged
+    h = Array.new(8) { |i| Array.new(8) { |j| 1.0 / (i + j + 1) } }
+    assert_output(nil, /refine_solve did not converge in 1 iterations/) do
+      QuadMath.refine_solve(h, [1] * 8, max_iter: 1)
+    end
+  end
+  def test_qr_example
+    q, r = M[[3, 1], [4, 2]].qr
+    assert_operator max_abs_diff(q, M[[-3/5r, -4/5r], [-4/5r, 3/5r]]), :<, 1e-33
+    assert_operator max_abs_diff(r, M[[-5, -11/5r], [0, 2/5r]]), :<, 1e-32
+  end
+
+  def test_qr_reconstructs
+    m, n = 70, 12
+    rows = Array.new(m) { |i| Array.new(n) { |j| ((i * 37 + j * 11) % 29 - 14) / 7r } }
+    a = M[*rows]
+    q, r = a.qr
+    assert_equal [m, n], q.shape
+    assert_equal [n, n], r.shape
+    assert_operator max_abs_diff(q * r, a), :<, 1e-30
+    assert_operator max_abs_diff(q.transpose * q, M.identity(n)), :<, 1e-32
+    n.times { |i| (0...i).each { |j| assert_equal 0, r[i, j] } }
+  end
+
+  def test_qr_wide
+    q, r = M[[1, 2, 3], [4, 5, 6]].qr
+    assert_equal [2, 2], q.shape
+    assert_equal [2, 3], r.shape
+    assert_operator max_abs_diff(q * r, M[[1, 2, 3], [4, 5, 6]]), :<, 1e-32
+  end
+
+  def test_complex_qr
+    a = M[[1i, 1], [1, 2], [0, 1i]]
+    q, r = a.qr
+    assert q.complex?
+    diff = (q * r).to_a.flatten.zip(a.to_a.flatten).map { |x, y| (x.to_c - y.to_c).abs }
+    assert_operator diff.max, :<, 1e-32
+  end
+
+  def test_lstsq
+    x = QuadMath.lstsq([[1, 0], [1, 1], [1, 2]], [1, 2, 4])
+    assert_in_delta 5/6r.to_f128, x[0], 1e-32
+    assert_in_delta 3/2r.to_f128, x[1], 1e-32
+    xs = QuadMath.lstsq(M[[1, 0], [1, 1], [1, 2]], M[[1, 0], [2, 1], [4, 2]])
+    assert_kind_of M, xs
+    assert_operator max_abs_diff(xs, M[[5/6r, 0], [3/2r, 1]]), :<, 1e-32
+  end
+
+  def test_lstsq_residual_is_orthogonal
+    # 悪条件なべき乗基底での多項式当てはめ
+    t = Array.new(200) { |i| 1000 + i / 10r }
+    a = M[*t.map { |x| Array.new(4) { |k| x**k } }]
+    b = t.map { |x| (x - 1005)**3 + 1/3r }
+    x = QuadMath.lstsq(a, b)
+    res = V[*b] - a * x
+    scale = a.to_a.flatten.map(&:abs).max * b.map(&:abs).max
+    assert_operator (a.transpose * res).to_a.map(&:abs).max / scale, :<, 1e-24
+  end
+
+  def test_complex_lstsq
+    a = M[[1i, 1], [1, 2], [0, 1i]]
+    x = QuadMath.lstsq(a, [1, 1, 1])
+    assert x.complex?
+    assert_in_delta 0, (x[0].to_c - Complex(1/7r, -1/7r)).abs, 1e-32
+    assert_in_delta 0, (x[1].to_c - Complex(3/7r, -1/7r)).abs, 1e-32
+  end
+
+  def test_lstsq_errors
+    assert_raises(ZeroDivisionError) { QuadMath.lstsq([[1, 2], [2, 4], [3, 6]], [1, 2, 3]) }
+    assert_raises(ArgumentError) { QuadMath.lstsq([[1, 2, 3]], [1]) }
+    assert_raises(ArgumentError) { QuadMath.lstsq([[1, 0], [0, 1], [1, 1]], [1, 2]) }
+  end
+  def spd(n)
+    b = Array.new(n) { |i| Array.new(n) { |j| ((i * 13 + j * 7) % 17 - 8) / 5r } }
+    Array.new(n) { |i| Array.new(n) { |j| (0...n).sum { |k| b[i][k] * b[j][k] } + (i == j ? 1 : 0) } }
+  end
+
+  def test_cholesky_example
+    assert_operator max_abs_diff(M[[4, 2], [2, 5]].cholesky, M[[2, 0], [1, 2]]), :<, 1e-33
+    assert_equal M[[4, 2], [2, 5]].cholesky, M[[4, 99], [2, 5]].cholesky
+    x = M[[4, 2], [2, 5]].cholesky_solve([6, 7])
+    assert_in_delta 1, x[0], 1e-33
+    assert_in_delta 1, x[1], 1e-33
+  end
+
+  def test_cholesky_reconstructs
+    n = 100
+    a = M[*spd(n)]
+    l = a.cholesky
+    assert_operator max_abs_diff(l * l.transpose, a), :<, 1e-28
+    n.times { |i| (i + 1...n).each { |j| assert_equal 0, l[i, j] } }
+  end
+
+  def test_cholesky_independent_of_threads
+    a = M[*spd(90)]
+    assert_equal a.cholesky(threads: 1), a.cholesky(threads: 4)
+    assert_equal a.cholesky_solve([1] * 90, threads: 1), a.cholesky_solve([1] * 90, threads: 3)
+  end
+
+  def test_cholesky_solve_many_right_hand_sides
+    a = M[*spd(40)]
+    b = M[*Array.new(40) { |i| [i, 1, -i] }]
+    x = a.cholesky_solve(b)
+    assert_kind_of M, x
+    assert_operator max_abs_diff(a * x, b), :<, 1e-27
+  end
+
+  def test_complex_cholesky
+    a = M[[2, 1i], [-1i, 2]]
+    l = a.cholesky.to_a.map { |row| row.map(&:to_c) }
+    llh = Array.new(2) { |i| Array.new(2) { |j| (0..1).sum { |k| l[i][k] * l[j][k].conj } } }
+    diff = llh.flatten.zip([2, 1i, -1i, 2]).map { |x, y| (x - y).abs }
+    assert_operator diff.max, :<, 1e-32
+  end
+
+  def test_cholesky_errors
+    assert_raises(Math::DomainError) { M[[1, 2], [2, 1]].cholesky }
+    assert_raises(Math::DomainError) { M[[1, 2], [2, 1]].cholesky_solve([1, 1]) }
+    assert_raises(ArgumentError) { M[[1, 2, 3], [1, 2, 3]].cholesky }
+  end
+  def test_eigh_example
+    w, v = M[[2, 1], [1, 2]].eigh
+    assert_in_delta 1, w[0], 1e-33
+    assert_in_delta 3, w[1], 1e-33
+    assert_operator max_abs_diff(v.transpose * v, M.identity(2)), :<, 1e-33
+  end
+
+  def test_eigh_residual
+    n = 30
+    a = M[*spd(n)]
+    w, v = a.eigh
+    assert_equal n, w.size
+    assert_equal [n, n], v.shape
+    (n - 1).times { |i| assert_operator w[i], :<=, w[i + 1] }
+    vw = M[*Array.new(n) { |i| Array.new(n) { |j| v[i, j] * w[j] } }]
+    scale = w.to_a.map(&:abs).max
+    assert_operator max_abs_diff(a * v, vw) / scale, :<, 1e-30
+    assert_operator max_abs_diff(v.transpose * v, M.identity(n)), :<, 1e-30
+  end
+
+  def test_eigh_hilbert
+    w, = M[*hilbert(8)].eigh
+    assert_operator w[0], :>, 0
+    assert_in_delta 1.1109e-10, w[0].to_f, 1e-13
+  end
+
+  def test_eigh_errors
+    assert_raises(TypeError) { M[[1i, 0], [0, 1]].eigh }
+    assert_raises(ArgumentError) { M[[1, 2, 3], [1, 2, 3]].eigh }
+  end
+end
@@ -0,0 +1,78 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestMatrix < Minitest::Test
+  M = QuadMath::Matrix
+  V = QuadMath::Vector
+
+  def naive(a, b)
+    a.map { |row| b.transpose.map { |col| row.zip(col).sum { |x, y| x * y } } }
+  end
+
+  def int_matrix(m, n, seed)
+    Array.new(m) { |i| Array.new(n) { |j| (i * 7 + j * 13 + seed) % 11 - 5 } }
+  end
+
+  def test_construction
+    assert_equal [2, 3], M.new(2, 3).shape
+    m = M[[1, 2], [3, 4]]
+    assert_equal 2, m.row_count
+    assert_equal 2, m.column_count
+    assert_equal 3, m[1, 0]
+    assert_equal [[1, 3], [2, 4]], m.transpose.to_a
+    assert_equal [[1, 0], [0, 1]], M.identity(2).to_a
+    assert M.identity(1, complex: true).complex?
+  end
+
+  def test_gemm_examples
+    c = M.new(2, 2)
+    assert_same c, QuadMath::BLAS.gemm(1, M[[1, 2], [3, 4]], M.identity(2), 0, c)
+    assert_equal M[[1, 2], [3, 4]], c
+    y = V.new(2)
+    QuadMath::BLAS.gemv(1, M[[1, 2], [3, 4]], V[1, 1], 0, y)
+    assert_equal V[3, 7], y
+    assert_equal M[[3], [7]], M[[1, 2], [3, 4]] * M[[1], [1]]
+    assert_equal V[3, 7], M[[1, 2], [3, 4]] * [1, 1]
+  end
+
+  def test_gemm_alpha_beta
+    a = M[[1, 2], [3, 4]]
+    c = M[[1, 1], [1, 1]]
+    QuadMath::BLAS.gemm(2, a, a, 3, c)
+    assert_equal [[17, 23], [33, 47]], c.to_a
+  end
+
+  def test_gemm_blocked_against_naive
+    a = int_matrix(67, 131, 1)
+    b = int_matrix(131, 45, 2)
+    expected = naive(a, b)
+    [1, 3].each do |t|
+      c = M.new(67, 45)
+      QuadMath::BLAS.gemm(1, M[*a], M[*b], 0, c, threads: t)
+      assert_equal expected, c.to_a
+    end
+  end
+
+  def test_complex_gemm
+    a = M[[1i, 2], [0, 1]]
+    assert_equal [[Complex(-1, 0), Complex(2, 2)], [0, 1]], (a * a).to_a.map { |r| r.map(&:to_c) }
+  end
+
+  def test_shape_and_type_errors
+    assert_raises(ArgumentError) { M[[1, 2]] * M[[1, 2]] }
+    assert_raises(ArgumentError) { QuadMath::BLAS.gemv(1, M[[1, 2]], V[1], 0, V[0]) }
+    assert_raises(TypeError) { QuadMath::BLAS.gemm(1, M[[1]], M[[1i]], 0, M.new(1, 1)) }
+    assert_raises(FrozenError) { QuadMath::BLAS.gemm(1, M[[1]], M[[1]], 0, M.new(1, 1).freeze) }
+  end
+
+  def test_output_must_not_alias_input
+    a = M[[1, 2], [3, 4]]
+    assert_raises(ArgumentError) { QuadMath::BLAS.gemm(1, a, M.identity(2), 0, a) }
+    assert_raises(ArgumentError) { QuadMath::BLAS.gemm(1, M.identity(2), a, 0, a) }
+    assert_equal M[[1, 2], [3, 4]], a
+    x = V[1, 1]
+    assert_raises(ArgumentError) { QuadMath::BLAS.gemv(1, a, x, 0, x) }
+    assert_equal V[1, 1], x
+  end
+end
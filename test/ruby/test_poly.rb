@@ -0,0 +1,66 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestPoly < Minitest::Test
+  V = QuadMath::Vector
+
+  def from_roots(roots)
+    roots.inject([1]) { |c, r| (c + [0]).zip([0] + c).map { |a, b| a - r * b } }
+  end
+
+  def sorted_real(z)
+    z.to_a.map { |w| w.to_c.real }.sort
+  end
+
+  def test_polyval_examples
+    assert_equal 2, QuadMath.polyval([1, -3, 2], 3)
+    assert_kind_of Float128, QuadMath.polyval([1, -3, 2], 3)
+    assert_equal 0, QuadMath.polyval([1, 0, 1], Complex(0, 1)).to_c.abs
+    y = QuadMath.polyval([1, -3, 2], [0, 1, 2])
+    assert_kind_of V, y
+    assert_equal [2, 0, 0], y.to_a
+  end
+
+  def test_polyval_is_horner_in_quad
+    c = from_roots([1/3r, 2/7r, 3/11r])
+    x = 0.3.to_f128
+    expected = (x - 1/3r.to_f128) * (x - 2/7r.to_f128) * (x - 3/11r.to_f128)
+    assert_in_delta expected, QuadMath.polyval(c.map(&:to_f128), x), 1e-33
+  end
+
+  def test_roots_example
+    r = sorted_real(QuadMath.roots([1, -3, 2]))
+    assert_in_delta 1, r[0], 1e-32
+    assert_in_delta 2, r[1], 1e-32
+  end
+
+  def test_roots_leading_and_trailing_zeros
+    z = QuadMath.roots([0, 1, -3, 2, 0, 0])
+    assert_equal 4, z.size
+    r = sorted_real(z)
+    assert_equal [0, 0], r.first(2)
+    assert_in_delta 1, r[2], 1e-32
+    assert_in_delta 2, r[3], 1e-32
+    assert_equal 0, QuadMath.roots([5]).size
+  end
+
+  def test_complex_roots
+    z = QuadMath.roots([1, 0, 1]).to_a.map(&:to_c).sort_by(&:imag)
+    assert_in_delta 0, (z[0] + 1i).abs, 1e-32
+    assert_in_delta 0, (z[1] - 1i).abs, 1e-32
+    w = QuadMath.roots([1, -1i]).to_a.first.to_c
+    assert_in_delta 0, (w - 1i).abs, 1e-32
+  end
+
+  def test_wilkinson
+    z = QuadMath.roots(from_roots((1..20).to_a))
+    assert_operator sorted_real(z).each_with_index.map { |r, i| (r - (i + 1)).abs }.max, :<, 1e-15
+  end
+
+  def test_roots_warns_when_not_converged
+    assert_output(nil, /roots did not converge in 1 iterations/) do
+      QuadMath.roots([1] + [0] * 19 + [-1], max_iter: 1)
+    end
+  end
+end
@@ -0,0 +1,115 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestReduction < Minitest::Test
+  def test_dot
+    assert_equal 32, QuadMath.dot([1.0, 2.0, 3.0], [4.0, 5.0, 6.0])
+    assert_equal 1, QuadMath.dot([1e16, 1.0, -1e16], [1.0, 1.0, 1.0])
+    assert_equal 0.1.to_f128, QuadMath.dot([0.1].pack('d*'), [1])
+    assert_equal 0, QuadMath.dot([], [])
+    assert_kind_of Float128, QuadMath.dot([1], [2])
+  end
+
+  def test_dot_mixed_sources
+    a = [1.5, 2.25, -3.0]
+    b = [2, 1/4r, 0.5.to_f128]
+    expected = 1.5 * 2 + 2.25 * 0.25 - 3.0 * 0.5
+    assert_equal expected, QuadMath.dot(a, b)
+    assert_equal expected, QuadMath.dot(a.pack('d*'), b)
+  end
+
+  def test_dot_length_mismatch
+    assert_raises(ArgumentError) { QuadMath.dot([1, 2], [1]) }
+  end
+
+  def test_dot_rejects_complex
+    assert_raises(TypeError) { QuadMath.dot([1i], [1]) }
+  end
+
+  def test_norm2
+    assert_equal 5, QuadMath.norm2([3.0, 4.0])
+    assert_equal 5, QuadMath.norm2([3.0, 4.0].pack('d*'))
+    assert_equal QuadMath.sqrt(2), QuadMath.norm2([1.0] * 2)
+    assert_equal 0, QuadMath.norm2([])
+  end
+
+  def test_norm2_rescales
+    tiny = Float128('1e-3000')
+    assert_in_delta 1, QuadMath.norm2([tiny] * 2) / (tiny * QuadMath.sqrt(2)), Float128::EPSILON * 4
+    huge = Float128('1e4000')
+    assert_in_delta 1, QuadMath.norm2([huge, huge]) / (huge * QuadMath.sqrt(2)), Float128::EPSILON * 4
+  end
+
+  def test_hypot_n
+    assert QuadMath.hypot_n(1, 2, 2) == 3
+    assert_equal 13, QuadMath.hypot_n(3+4i, 12)
+    assert_equal 0, QuadMath.hypot_n
+    assert QuadMath.hypot_n(Float::INFINITY, Float::NAN).infinite?
+    assert QuadMath.hypot_n(1, Float::NAN).nan?
+    assert_equal QuadMath.hypot(Float128(1) / 3, 0.7), QuadMath.hypot_n(Float128(1) / 3, 0.7)
+  end
+  def ill_conditioned(n, seed)
+    r = Random.new(seed)
+    Array.new(n) { r.rand(-1.0..1.0) * 10.0**r.rand(-20..20) }.flat_map { |x| [x, -x * (1 + 2.0**-40)] }
+  end
+
+  def test_sum
+    assert_equal 6, QuadMath.sum([1, 2, 3])
+    assert_equal 0, QuadMath.sum([])
+    assert_equal 1, QuadMath.sum([1e30, 1, -1e30])
+    assert_equal 4, QuadMath.sum([1.5, 2.5].pack('d*'))
+    assert_equal 3, QuadMath.sum(QuadMath::Vector[1, 2])
+    assert_equal Complex(2, 1), QuadMath.sum([1i, 2]).to_c
+  end
+
+  def test_reproducible_sum_is_correctly_rounded
+    xs = ill_conditioned(5000, 1)
+    exact = xs.sum { |x| x.to_r }
+    s = QuadMath.sum(xs, reproducible: true)
+    assert_operator (s.to_r - exact).abs, :<=, exact.abs * 2r**-113
+  end
+
+  def test_reproducible_sum_is_independent_of_order
+    xs = ill_conditioned(20_000, 2)
+    expected = QuadMath.sum(xs, reproducible: true)
+    r = Random.new(3)
+    3.times { assert_equal expected, QuadMath.sum(xs.shuffle(random: r), reproducible: true) }
+    assert_equal expected, QuadMath.sum(xs.reverse.pack('d*'), reproducible: true)
+    assert_equal expected, QuadMath.sum(QuadMath::Vector[*xs], reproducible: true)
+  end
+
+  def test_reproducible_sum_extreme_values
+    assert_equal 1, QuadMath.sum([1e30, 1, -1e30], reproducible: true)
+    tiny = Float128('1e-4000')
+    huge = Float128('1e4000')
+    assert_equal tiny, QuadMath.sum([huge, tiny, -huge], reproducible: true)
+    assert QuadMath.sum([Float128('1e4932')] * 2, reproducible: true).infinite?
+    assert QuadMath.sum([Float::INFINITY, 1], reproducible: true).infinite?
+    assert QuadMath.sum([Float::INFINITY, -Float::INFINITY], reproducible: true).nan?
+    assert QuadMath.sum([Float::NAN, 1], reproducible: true).nan?
+    assert_equal 0, QuadMath.sum([], reproducible: true)
+    assert_equal Complex(2, 1), QuadMath.sum([1i, 2], reproducible: true).to_c
+  end
+
+  def test_reproducible_dot_and_norm2
+    xs = ill_conditioned(5000, 4)
+    ys = Array.new(xs.size) { |i| 1 + i % 7 }
+    d = QuadMath.dot(xs, ys, reproducible: true)
+    perm = (0...xs.size).to_a.shuffle(random: Random.new(5))
+    assert_equal d, QuadMath.dot(perm.map { |i| xs[i] }, perm.map { |i| ys[i] }, reproducible: true)
+    assert_equal 1, QuadMath.dot([1e16, 1.0, -1e16], [1.0, 1.0, 1.0], reproducible: true)
+    n = QuadMath.norm2(xs, reproducible: true)
+    assert_equal n, QuadMath.norm2(xs.reverse, reproducible: true)
+    assert_equal 5, QuadMath.norm2([3.0, 4.0], reproducible: true)
+  end
+
+  def test_default_sum_is_independent_of_threads
+    xs = QuadMath::Vector[*ill_conditioned(30_000, 6)]
+    old = QuadMath.threads
+    sums = [1, 4, 7].map { |n| QuadMath.threads = n; [QuadMath.sum(xs), QuadMath.sum(xs, reproducible: true)] }
+    assert_equal [sums[0]] * 3, sums
+  ensure
+    QuadMath.threads = old
+  end
+end
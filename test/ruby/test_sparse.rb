@@ -0,0 +1,80 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestSparseMatrix < Minitest::Test
+  S = QuadMath::SparseMatrix
+  M = QuadMath::Matrix
+  V = QuadMath::Vector
+
+  def random_coo(rows, cols, nnz, seed)
+    r = Random.new(seed)
+    ri = Array.new(nnz) { r.rand(rows) }
+    ci = Array.new(nnz) { r.rand(cols) }
+    vals = Array.new(nnz) { r.rand(-1000..1000) / 7r }
+    [ri, ci, vals]
+  end
+
+  def test_from_coo_example
+    a = S.from_coo(2, 3, [0, 1, 1], [0, 0, 2], [1, 2, 3])
+    assert_equal [2, 3], a.shape
+    assert_equal 2, a.row_count
+    assert_equal 3, a.column_count
+    assert_equal 3, a.nnz
+    assert_equal 32, a.index_bits
+    assert_equal M[[1, 0, 0], [2, 0, 3]], a.to_matrix
+  end
+
+  def test_duplicates_are_summed
+    a = S.from_coo(2, 2, [0, 1, 0], [1, 0, 1], [1, 5, 2])
+    assert_equal 2, a.nnz
+    assert_equal M[[0, 3], [5, 0]], a.to_matrix
+  end
+
+  def test_64bit_indices
+    a = S.from_coo(2, 3_000_000_000, [0, 1], [2_999_999_999, 0], [1, 2])
+    assert_equal 64, a.index_bits
+    assert_equal 2, a.nnz
+  end
+
+  def test_spmv_examples
+    a = S.from_coo(2, 3, [0, 1, 1], [0, 0, 2], [1, 2, 3])
+    assert_equal V[1, 5], a.spmv([1, 1, 1])
+    assert_equal V[3, 0, 3], a.spmv_transpose([1, 1])
+    assert_equal V[1, 5], a.spmv(V[1, 1, 1])
+  end
+
+  def test_spmv_against_dense
+    ri, ci, vals = random_coo(120, 90, 800, 1)
+    a = S.from_coo(120, 90, ri, ci, vals)
+    d = a.to_matrix
+    x = Array.new(90) { |i| (i % 11 - 5) / 3r }
+    y = Array.new(120) { |i| (i % 7 - 3) / 5r }
+    assert_operator (a.spmv(x) - d * V[*x]).to_a.map(&:abs).max, :<, 1e-30
+    assert_operator (a.spmv_transpose(y) - d.transpose * V[*y]).to_a.map(&:abs).max, :<, 1e-30
+  end
+
+  def test_independent_of_threads
+    ri, ci, vals = random_coo(3000, 2000, 20_000, 2)
+    a = S.from_coo(3000, 2000, ri, ci, vals)
+    x = Array.new(2000) { |i| 1 / (i + 1r) }
+    y = Array.new(3000) { |i| (i % 13) - 6 }
+    assert_equal a.spmv(x, threads: 1), a.spmv(x, threads: 4)
+    assert_equal a.spmv_transpose(y, threads: 1), a.spmv_transpose(y, threads: 3)
+  end
+
+  def test_empty
+    assert_equal V[], S.from_coo(0, 0, [], [], []).spmv([])
+    assert_equal V[0, 0], S.from_coo(2, 3, [], [], []).spmv([1, 2, 3])
+  end
+
+  def test_errors
+    a = S.from_coo(2, 3, [0, 1, 1], [0, 0, 2], [1, 2, 3])
+    assert_raises(IndexError) { S.from_coo(2, 2, [2], [0], [1]) }
+    assert_raises(IndexError) { S.from_coo(2, 2, [1], [-1], [1]) }
+    assert_raises(ArgumentError) { S.from_coo(2, 2, [1, 0], [1], [1]) }
+    assert_raises(ArgumentError) { S.from_coo(-1, 2, [], [], []) }
+    assert_raises(ArgumentError) { a.spmv([1, 1]) }
+    assert_raises(ArgumentError) { a.spmv_transpose([1, 1, 1]) }
+  end
+end
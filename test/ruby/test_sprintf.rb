@@ -0,0 +1,49 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestSprintf < Minitest::Test
+  V = QuadMath::Vector
+
+  def test_scalar
+    assert_equal "2.000000", quadmath_sprintf("%Qf", 2)
+    assert_equal "0.700000", quadmath_sprintf("%Qf", 7/10r)
+    assert_equal "0.333333333333333333333333333333333", quadmath_sprintf("%.*Qf", Float128::DIG, 1/3r)
+    assert_equal "+1.41421356237309504880e+00                   ", quadmath_sprintf("%+-#*.*Qe", 46, 20, QuadMath.sqrt(2))
+  end
+
+  def test_vector
+    assert_equal ["1.000", "2.500"], quadmath_sprintf("%.3Qf", V[1, 2.5])
+    assert_equal ["1.00", "2.50"], quadmath_sprintf("%.*Qf", 2, [1, 2.5])
+    assert_equal [], quadmath_sprintf("%Qe", V[])
+  end
+
+  def test_long_vector
+    xs = Array.new(10_000) { |i| i / 8r }
+    strs = quadmath_sprintf("%.3Qf", xs)
+    assert_equal 10_000, strs.size
+    assert_equal "0.000", strs[0]
+    assert_equal "1249.875", strs[-1]
+    assert_equal "512.125", strs[4097]
+  end
+
+  def test_wide_element
+    strs = quadmath_sprintf("%.300Qf", [1, 2])
+    assert_equal 302, strs[0].size
+    assert_equal "2." + "0" * 300, strs[1]
+  end
+
+  def test_vector_needs_a_single_conversion
+    ["x=%.3Qf!", "%.3Qf %.3Qf", "%.3Qf!", " %.3Qf"].each do |format|
+      assert_raises(ArgumentError, format) { quadmath_sprintf(format, [1, 2.5], 3) }
+    end
+    assert_raises(ArgumentError) { quadmath_sprintf("%.3Qf", [1, 2.5], 3) }
+    assert_raises(TypeError) { quadmath_sprintf("%.3Qf", [1i]) }
+  end
+
+  def test_errors
+    assert_raises(ArgumentError) { quadmath_sprintf("%Qf") }
+    assert_raises(ArgumentError) { quadmath_sprintf("%%") }
+    assert_raises(ArgumentError) { quadmath_sprintf("%*Qf", -1, 1) }
+  end
+end
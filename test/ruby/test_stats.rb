@@ -0,0 +1,81 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestStats < Minitest::Test
+  def test_mixed_batches
+    st = QuadMath::Stats.new
+    st << [1.0, 2.0, 3.0] << [4.0].pack('d*')
+    assert_equal 4, st.count
+    assert_equal 2.5, st.mean
+  end
+
+  def test_mean_without_cancellation
+    assert_equal 1/3r.to_f128, QuadMath::Stats.new.push([1e16, 1.0, -1e16]).mean
+  end
+
+  def test_variance
+    st = QuadMath::Stats.new.push([1e9 + 4, 1e9 + 7, 1e9 + 13, 1e9 + 16])
+    assert_equal 30, st.variance
+    assert_equal 22.5, st.variance(population: true)
+    assert_equal QuadMath.sqrt(30), st.stddev
+  end
+
+  def test_higher_moments
+    st = QuadMath::Stats.new.push([1, 2, 3, 10])
+    assert_in_delta Float128('1.0182337649086284351372158814309826'), st.skewness, 1e-30
+    st = QuadMath::Stats.new.push([1, 2, 3, 4])
+    assert_equal 0, st.skewness
+    assert_equal(-1.36, st.kurtosis.to_f.round(12))
+  end
+
+  def test_empty_is_nan
+    st = QuadMath::Stats.new
+    assert_equal 0, st.count
+    assert st.mean.nan?
+    assert st.variance.nan?
+    assert QuadMath::Stats.new.push([1]).variance.nan?
+  end
+
+  def test_merge_matches_single_pass
+    xs = Array.new(1000) { |i| Math.sin(i) * 1e6 + 1e9 }
+    whole = QuadMath::Stats.new.push(xs)
+    a = QuadMath::Stats.new.push(xs[0, 300])
+    b = QuadMath::Stats.new.push(xs[300..])
+    a.merge(b)
+    assert_equal whole.count, a.count
+    assert_in_delta whole.mean, a.mean, whole.mean * 1e-30
+    assert_in_delta whole.variance, a.variance, whole.variance * 1e-28
+    assert_in_delta whole.skewness, a.skewness, 1e-26
+    assert_equal a, a.merge(QuadMath::Stats.new)
+  end
+
+  def test_covariance
+    st = QuadMath::Stats.new.push([1, 2, 3], [2, 4, 6])
+    assert_equal 2, st.covariance
+    assert_equal 4/3r.to_f128, st.covariance(population: true)
+    assert_in_delta 1, st.correlation, 1e-32
+    a = QuadMath::Stats.new.push([1, 2], [2, 4])
+    a.merge(QuadMath::Stats.new.push([3], [6]))
+    assert_in_delta 2, a.covariance, 1e-32
+  end
+
+  def test_pairing_errors
+    assert_raises(RuntimeError) { QuadMath::Stats.new.push([1, 2]).covariance }
+    assert_raises(RuntimeError) { QuadMath::Stats.new.push([1, 2]).correlation }
+    assert_raises(ArgumentError) { QuadMath::Stats.new.push([1], [1]).push([2]) }
+    assert_raises(ArgumentError) { QuadMath::Stats.new.push([1]).push([2], [2]) }
+    assert_raises(ArgumentError) { QuadMath::Stats.new.push([1, 2], [1]) }
+    assert_raises(ArgumentError) { QuadMath::Stats.new.push([1]).merge(QuadMath::Stats.new.push([1], [1])) }
+  end
+
+  def test_empty_takes_pairing_of_merged
+    st = QuadMath::Stats.new.push([], []).merge(QuadMath::Stats.new.push([1, 2]))
+    assert_raises(RuntimeError) { st.covariance }
+    assert_equal 3, st.push([3]).count
+    st = QuadMath::Stats.new.merge(QuadMath::Stats.new.push([1, 2], [2, 4]))
+    assert_equal 1, st.covariance
+    st = QuadMath::Stats.new.push([1, 2], [2, 4]).merge(QuadMath::Stats.new.push([]))
+    assert_equal 1, st.covariance
+  end
+end
@@ -0,0 +1,87 @@
+# frozen_string_literal: true
+
+require "test_helper"
+require "rbconfig"
+
+class TestThreads < Minitest::Test
+  M = QuadMath::Matrix
+  V = QuadMath::Vector
+
+  def setup
+    @threads = QuadMath.threads
+  end
+
+  def teardown
+    QuadMath.threads = @threads
+  end
+
+  def under_threads(*counts)
+    counts.map do |n|
+      QuadMath.threads = n
+      yield
+    end
+  end
+
+  def assert_same_under_threads(&block)
+    one, *rest = under_threads(1, 2, 3, 8, &block)
+    rest.each { |r| assert_equal one, r }
+  end
+
+  def test_threads_accessor
+    QuadMath.threads = 4
+    assert_equal 4, QuadMath.threads
+    QuadMath.threads = 1000
+    assert_equal 256, QuadMath.threads
+    assert_raises(ArgumentError) { QuadMath.threads = 0 }
+    assert_raises(ArgumentError) { QuadMath.threads = -1 }
+    assert_raises(TypeError) { QuadMath.threads = "2" }
+  end
+
+  def test_environment_variable
+    lib = File.expand_path("../../lib", __dir__)
+    out = IO.popen({ "QUADMATH_NUM_THREADS" => "3" }, [RbConfig.ruby, "-I", lib, "-rquadmath", "-e", "print QuadMath.threads"], &:read)
+    assert_equal "3", out
+    out = IO.popen({ "QUADMATH_NUM_THREADS" => "x" }, [RbConfig.ruby, "-I", lib, "-rquadmath", "-e", "print QuadMath.threads"], err: %i[child out], &:read)
+    assert_match(/QUADMATH_NUM_THREADS is ignored: x/, out)
+    assert_match(/1\z/, out)
+  end
+
+  def test_reductions_independent_of_threads
+    xs = V[*Array.new(100_000) { |i| (i % 977 - 488) / 13r + 1e20 * (i % 3 - 1) }]
+    ys = V[*Array.new(100_000) { |i| 1 / (i + 1r) }]
+    assert_same_under_threads { QuadMath.sum(xs) }
+    assert_same_under_threads { QuadMath.dot(xs, ys) }
+    assert_same_under_threads { QuadMath.norm2(xs) }
+    assert_same_under_threads { QuadMath::BLAS.asum(xs) }
+    assert_same_under_threads { QuadMath.cumsum(xs) }
+  end
+
+  def test_maps_independent_of_threads
+    xs = V[*Array.new(50_000) { |i| i / 1000r }]
+    assert_same_under_threads { QuadMath.exp(xs) }
+    assert_same_under_threads { QuadMath.sin(xs) }
+    assert_same_under_threads do
+      y = V[*Array.new(50_000, 1)]
+      QuadMath::BLAS.axpy(1/3r, xs, y)
+      y
+    end
+  end
+
+  def test_matrix_kernels_independent_of_threads
+    n = 96
+    a = M[*Array.new(n) { |i| Array.new(n) { |j| ((i * 17 + j * 5) % 23 - 11) / 3r + (i == j ? n : 0) } }]
+    assert_same_under_threads { a * a }
+    assert_same_under_threads { a.lu }
+    assert_same_under_threads { a.solve([1] * n) }
+  end
+
+  def test_threads_survive_fork
+    skip "fork is not available" unless Process.respond_to?(:fork)
+    xs = V[*Array.new(50_000) { |i| i / 7r }]
+    QuadMath.threads = 4
+    expected = QuadMath.sum(QuadMath.sqrt(xs))
+    pid = fork { exit!(QuadMath.sum(QuadMath.sqrt(xs)) == expected ? 0 : 1) }
+    _, status = Process.wait2(pid)
+    assert_predicate status, :success?
+  end
+end
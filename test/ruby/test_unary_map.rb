@@ -0,0 +1,76 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestUnaryMap < Minitest::Test
+  V = QuadMath::Vector
+
+  def test_map_over_array_and_vector
+    assert_equal V[2, 3], QuadMath.sqrt([4, 9])
+    assert_equal V[2, 3], QuadMath.sqrt(V[4, 9])
+    y = QuadMath.exp(V[0, 1])
+    assert_equal 1, y[0]
+    assert_equal QuadMath.exp(1.to_f128), y[1]
+  end
+
+  def test_elements_match_scalar_calls
+    xs = Array.new(5000) { |i| (i - 2500) / 97r }
+    %i[exp sin cos atan sinh expm1].each do |f|
+      y = QuadMath.send(f, xs)
+      [0, 1, 2500, 4321, 4999].each { |i| assert_equal QuadMath.send(f, xs[i].to_f128), y[i], "#{f}(#{xs[i]})" }
+    end
+  end
+
+  def test_complex_result_promotes_vector
+    y = QuadMath.log([1, -1])
+    assert y.complex?
+    assert_in_delta 0, (y[1].to_c - Complex(0, Math::PI)).abs, 1e-15
+    assert QuadMath.sqrt([1i, 4]).complex?
+  end
+
+  def test_out
+    v = V[0, 1]
+    assert_same v, QuadMath.exp(v, out: v)
+    assert_equal 1, v[0]
+    o = V[0, 0]
+    assert_same o, QuadMath.sqrt([4, 9], out: o)
+    assert_equal V[2, 3], o
+  end
+
+  def test_out_left_unchanged_on_domain_error
+    v = V[4, 9, -1, 16]
+    e = assert_raises(Math::DomainError) { QuadMath.sqrt(v, out: v) }
+    assert_match(/at 2/, e.message)
+    assert_equal V[4, 9, -1, 16], v
+    w = V[*Array.new(10_000) { |i| i + 1 }]
+    w[9000] = -1
+    assert_raises(Math::DomainError) { QuadMath.log(w, out: w) }
+    assert_equal 1, w[0]
+    assert_equal(-1, w[9000])
+  end
+
+  def test_out_errors
+    assert_raises(TypeError) { QuadMath.exp([1, 2], out: [0, 0]) }
+    assert_raises(ArgumentError) { QuadMath.exp([1, 2], out: V[0]) }
+    assert_raises(TypeError) { QuadMath.exp([1i, 2], out: V[0, 0]) }
+    assert_raises(ArgumentError) { QuadMath.exp(1, out: V[0]) }
+  end
+
+  def test_frozen_out
+    v = V[1, 2].freeze
+    assert_raises(FrozenError) { QuadMath.exp(v, out: v) }
+    assert_raises(FrozenError) { QuadMath.exp([1, 2], out: V[0, 0].freeze) }
+    assert_equal [1, 2], v.to_a
+  end
+
+  def test_independent_of_threads
+    xs = V[*Array.new(20_000) { |i| i / 1000r }]
+    old = QuadMath.threads
+    QuadMath.threads = 1
+    one = QuadMath.log1p(xs)
+    QuadMath.threads = 4
+    assert_equal one, QuadMath.log1p(xs)
+  ensure
+    QuadMath.threads = old
+  end
+end
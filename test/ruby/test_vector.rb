@@ -0,0 +1,165 @@
+# frozen_string_literal: true
+
+require "test_helper"
+
+class TestVector < Minitest::Test
+  V = QuadMath::Vector
+
+  def test_new
+    assert_equal V[0, 0, 0], V.new(3)
+    refute V.new(3).complex?
+    assert V.new(1, complex: true).complex?
+    assert_equal 0, V.new(0).size
+  end
+
+  def test_brackets
+    v = V[1, 1/3r, 0.5]
+    assert_equal 3, v.length
+    assert_equal 1/3r.to_f128, v[1]
+    assert_equal 0.5, v[-1]
+    assert_nil v[3]
+    assert V[1, 1i].complex?
+    assert_equal Complex(0, 1), V[1, 1i][1].to_c
+  end
+
+  def test_from
+    assert_equal V[1, 2], V.from([1, 2])
+    assert_equal V[0.5], V.from([0.5].pack('d*'))
+    v = V[1, 2]
+    w = V.from(v)
+    assert_equal v, w
+    refute_same v, w
+  end
+
+  def test_store
+    v = V[1, 2]
+    v[0] = 1/4r
+    v[-1] = 3
+    assert_equal V[0.25, 3], v
+    assert_raises(IndexError) { v[2] = 0 }
+    assert_raises(TypeError) { v[0] = 1i }
+    assert_raises(FrozenError) { v.freeze[0] = 1 }
+  end
+
+  def test_each_and_to_a
+    v = V[1, 2, 3]
+    assert_equal [1, 2, 3], v.to_a
+    assert_equal [1, 2, 3], v.each.to_a
+    assert_equal 3, v.each.size
+    assert v.to_a.all? { |x| x.is_a?(Float128) && x.frozen? }
+  end
+
+  def test_each_value
+    v = V[3, 1, 2]
+    s = 0
+    assert_same v, v.each_value { |x| s += x }
+    assert_equal 6, s
+    seen = []
+    v.each_value { |x| seen << x.to_f }
+    assert_equal [3.0, 1.0, 2.0], seen
+    c = V[1i, 2]
+    imag = []
+    c.each_value { |z| imag << z.imag }
+    assert_equal [1, 0], imag
+  end
+
+  def test_each_value_and_map_need_a_block
+    assert_raises(LocalJumpError) { V[3, 1, 2].each_value }
+    assert_raises(LocalJumpError) { V[3, 1, 2].map! }
+  end
+
+  def test_each_value_object_does_not_escape
+    v = V[3, 1, 2]
+    %i[to_f128 +@ real conj conjugate itself dup clone nonzero?].each do |m|
+      kept = []
+      v.each_value { |x| kept << x.send(m) }
+      assert_equal [3, 1, 2], kept, m.to_s
+      assert kept.all?(&:frozen?), m.to_s
+      assert_equal 3, kept.uniq(&:object_id).size, m.to_s
+    end
+    frozen = []
+    v.each_value { |x| frozen << x.freeze }
+    assert_equal [3, 1, 2], frozen
+  end
+
+  def test_each_value_object_through_conversions
+    kept = []
+    V[1, 2, 3].each_value { |x| kept << Float128(x) << Complex128(x) }
+    assert_equal [1, 1, 2, 2, 3, 3], kept.map(&:to_c)
+    kept = []
+    V[1i, 2, Complex(3, -1)].each_value { |z| kept << Complex128(z) << z.real }
+    assert_equal [1i, 0, 2, 2, Complex(3, -1), 3], kept.map(&:to_c)
+  end
+
+  def test_complex_each_value_object_does_not_escape
+    v = V[1i, 2, Complex(3, -1)]
+    expected = [1i, 2, Complex(3, -1)]
+    %i[to_c128 +@ itself dup clone nonzero?].each do |m|
+      kept = []
+      v.each_value { |z| kept << z.send(m) }
+      assert_equal expected, kept.map(&:to_c), m.to_s
+      assert kept.all?(&:frozen?), m.to_s
+    end
+    conj = []
+    v.each_value { |z| conj << z.conjugate }
+    assert_equal expected.map(&:conj), conj.map(&:to_c)
+  end
+
+  def test_map!
+    v = V[1, 2, 3]
+    assert_same v, v.map! { |x| x.to_f * 0.5 }
+    assert_equal V[0.5, 1, 1.5], v
+    v.map! { |x| x + 1 }
+    assert_equal V[1.5, 2, 2.5], v
+    assert_raises(TypeError) { v.map! { 1i } }
+    assert_raises(FrozenError) { v.freeze.map! { |x| x } }
+    c = V[1i, 2]
+    c.map! { |z| z * 1i }
+    assert_equal [-1, 2i], c.to_a.map(&:to_c)
+  end
+
+  def test_inspect
+    assert_equal "QuadMath::Vector[0.5, 1.0]", V[0.5, 1].inspect
+  end
+
+  def test_cumsum
+    assert_equal V[1, 3, 6], V[1, 2, 3].cumsum
+    assert_equal V[1, 3, 6], QuadMath.cumsum([1, 2, 3])
+    assert_equal V[], V[].cumsum
+    drift = QuadMath.cumsum([0.1] * 10)
+    assert_equal 0.1.to_f128 * 10, drift[-1]
+    z = V[1i, 1].cumsum
+    assert z.complex?
+    assert_equal Complex(1, 1), z[1].to_c
+  end
+
+  def test_cumprod
+    assert_equal V[1, 2, 6, 24], V[1, 2, 3, 4].cumprod
+    assert_equal Complex(-1, 0), QuadMath.cumprod([1i, 1i])[1].to_c
+  end
+
+  def test_cummax_cummin
+    assert_equal V[1, 3, 3, 5], V[1, 3, 2, 5].cummax
+    assert_equal V[3, 1, 1, 0], V[3, 1, 2, 0].cummin
+    m = QuadMath.cummax([1, Float::NAN, 5])
+    assert_equal 1, m[0]
+    assert m[1].nan?
+    assert m[2].nan?
+    assert_raises(TypeError) { V[1i].cummax }
+    assert_raises(TypeError) { V[1i].cummin }
+  end
+
+  def test_diff
+    assert_equal V[3, 5, 7], V[1, 4, 9, 16].diff
+    assert_equal V[3, 5, 7], QuadMath.diff([1, 4, 9, 16])
+    assert_equal V[], V[1].diff
+    assert_equal V[], V[].diff
+  end
+
+  def test_scans_do_not_modify_receiver
+    v = V[1, 2, 3]
+    v.cumsum
+    v.cumprod
+    assert_equal V[1, 2, 3], v
+  end
+end